@@ -106,6 +106,10 @@ function(process_cunit_source_file SOURCE_FILE HEADER_FILE SUITES TESTS)
 
     # Extract fixtures that must be handled by CMake (.disabled and .timeout).
     parse_cunit_fixtures("${match}" disabled timeout)
+    # Benchmarks only run when explicitly requested.
+    if(test MATCHES "^bench" AND NOT BUILD_BENCHMARKS)
+      set(disabled "TRUE")
+    endif()
     list(APPEND suites_wo_init_n_clean "${suite}")
     list(APPEND tests "${suite}:${test}:${disabled}:${timeout}")
   endforeach()
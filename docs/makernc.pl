@@ -63,6 +63,7 @@ my %typehint2xmltype =
    "uint32" => "Int",
    "natint" => "Int",
    "natint_255" => "Int",
+   "recv_batch_size" => "Int",
    "domainId" => "String",
    "participantIndex" => "String",
    "port" => "Int",
@@ -81,6 +82,7 @@ my %typehint2xmltype =
    "cipher" => "Enum",
    "besmode" => "Enum",
    "retransmit_merging" => "Enum",
+   "timed_event_queue" => "Enum",
    "sched_prio_class" => "Enum",
    "sched_class" => "Enum",
    "maybe_int32" => "String",
@@ -109,12 +111,13 @@ my %enum_values =
    "verbosity" => "finest;finer;fine;config;info;warning;severe;none",
    "besmode" => "full;writers;minimal",
    "retransmit_merging" => "never;adaptive;always",
+   "timed_event_queue" => "heap;wheel",
    "sched_prio_class" => "relative;absolute",
    "sched_class" => "realtime;timeshare;default",
    "cipher" => "null;blowfish;aes128;aes192;aes256",
    "boolean_default" => "false;true;default",
    "many_sockets_mode" => "false;true;single;none;many",
-   "transport_selector" => "default;udp;udp6;tcp;tcp6;raweth");
+   "transport_selector" => "default;udp;udp6;tcp;tcp6;raweth;shm");
 
 # should extrace these from the source ...
 my %comma_values =
@@ -127,6 +130,7 @@ my %range =
    "dyn_port" => "-1;65535",
    "general_cfgelems/startupmodeduration" => "0;60000",
    "natint_255" => "0;255",
+   "recv_batch_size" => "1;64",
    "duration_ms_1hr" => "0;1hr",
    "duration_100ms_1hr" => "100ms;1hr",
    "duration_ms_1s" => "0;1s",
@@ -1168,6 +1168,70 @@ dds_get_topic_filter(dds_entity_t topic);
 DDS_DEPRECATED_EXPORT dds_topic_filter_fn
 dds_topic_get_filter(dds_entity_t topic);
 
+/** Comparison operators for field filters */
+typedef enum dds_field_filter_cmp {
+  DDS_FIELD_FILTER_EQ,
+  DDS_FIELD_FILTER_NE,
+  DDS_FIELD_FILTER_LT,
+  DDS_FIELD_FILTER_LE,
+  DDS_FIELD_FILTER_GT,
+  DDS_FIELD_FILTER_GE
+} dds_field_filter_cmp_t;
+
+/**
+ * @brief A term of a field filter: "field cmp value".
+ *
+ * The field is identified by its offset in the sample type (i.e.,
+ * offsetof), and must be a primitive member of the topic type or of a struct
+ * nested in it, not part of an array, sequence or union. The member of
+ * value that is used depends on the type of the field: "i" for signed
+ * integers, "d" for floating-point numbers and "u" for everything else
+ * (unsigned integers, characters, booleans and enums).
+ */
+typedef struct dds_field_filter_term {
+  uint32_t offset;
+  dds_field_filter_cmp_t cmp;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+  } value;
+} dds_field_filter_term_t;
+
+/**
+ * @brief Sets a filter on a topic that is evaluated on serialized data.
+ *
+ * A sample passes the filter if all terms hold. Unlike a filter set with
+ * dds_set_topic_filter, it does not require deserializing the sample, which
+ * makes rejecting samples much cheaper. If a topic has both kinds of filter,
+ * a sample must pass both. Only topics created from a topic descriptor
+ * support field filters.
+ *
+ * The field filter is also advertised in discovery by the readers of the
+ * topic, allowing remote writers that address a reader via unicast to not
+ * send it samples it would reject. Changing the filter re-advertises it, but
+ * until a remote writer has processed the update it continues to filter on
+ * the previous one, so samples accepted only by the new filter may be lost
+ * during that time.
+ *
+ * @param[in]  topic   The topic on which the content filter is set.
+ * @param[in]  nterms  The number of terms, 0 removes the field filter.
+ * @param[in]  terms   The terms (may be NULL if nterms is 0).
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The filter has been set.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             A term refers to an offset that is not that of a primitive
+ *             field of the topic type or uses an invalid comparison.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *             The topic does not support field filters or the operation is
+ *             invoked on an inappropriate object.
+ */
+DDS_EXPORT dds_return_t
+dds_set_topic_field_filter(dds_entity_t topic, uint32_t nterms, const dds_field_filter_term_t *terms);
+
 /**
  * @brief Creates a new instance of a DDS subscriber
  *
@@ -2850,6 +2914,100 @@ dds_takecdr(
   dds_sample_info_t *si,
   uint32_t mask);
 
+/**
+ * @brief Return serialized samples obtained from dds_readcdr or dds_takecdr.
+ *
+ * Releases the references to the serialized samples. This is all that is
+ * needed to treat the result of dds_readcdr and dds_takecdr as a loan of the
+ * samples stored in the reader: they can be accessed using
+ * dds_serdata_view, dds_serdata_get_field and dds_serdata_to_sample, which
+ * only deserialize what is needed, and then returned using this function.
+ *
+ * @param[in,out] buf An array of pointers to serialized samples, the pointers
+ *                    are set to NULL.
+ * @param[in]  bufsz The number of samples in buf, as returned by the read/take
+ *                   operation.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The samples were returned.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             buf is NULL and bufsz > 0.
+ */
+DDS_EXPORT dds_return_t
+dds_return_serdata_loan(struct ddsi_serdata **buf, int32_t bufsz);
+
+/**
+ * @brief Zero-copy view of a serialized sample as a sample.
+ *
+ * For types without strings, sequences or unions and where the in-memory
+ * layout matches the serialized form, the serialized data can be accessed in
+ * place as if it were a sample. The result remains valid until the
+ * serialized sample is returned.
+ *
+ * @param[in]  serdata A serialized sample obtained from dds_readcdr or dds_takecdr.
+ *
+ * @returns A pointer to the sample, or NULL if the type doesn't allow it or the
+ *          sample contains no valid data (only the key fields).
+ */
+DDS_EXPORT const void *
+dds_serdata_view(const struct ddsi_serdata *serdata);
+
+/**
+ * @brief Read a single field of a serialized sample.
+ *
+ * Reads the field without deserializing the sample. The field is identified
+ * by its offset in the sample type and must be a primitive field of the type
+ * or of a struct nested in it, not part of an array, sequence or union, the
+ * same as for a term of a field filter.
+ *
+ * @param[in]  serdata A serialized sample obtained from dds_readcdr or dds_takecdr.
+ * @param[in]  offset  Offset of the field in the sample type (i.e., offsetof).
+ * @param[out] value   Where to store the value, must be large enough for the field.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The value of the field is stored in value.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             One of the arguments is NULL or offset does not identify a
+ *             primitive field of the type.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *             The topic was not created from a topic descriptor.
+ * @retval DDS_RETCODE_PRECONDITION_NOT_MET
+ *             The sample contains no valid data (only the key fields).
+ * @retval DDS_RETCODE_ERROR
+ *             The serialized sample is malformed.
+ */
+DDS_EXPORT dds_return_t
+dds_serdata_get_field(const struct ddsi_serdata *serdata, uint32_t offset, void *value);
+
+/**
+ * @brief Deserialize a serialized sample.
+ *
+ * Deserializes the sample into memory provided by the application, exactly
+ * as dds_read/dds_take would have done. Samples without valid data are not
+ * associated with a type, their key can be obtained using
+ * dds_instance_get_key.
+ *
+ * @param[in]  serdata A serialized sample obtained from dds_readcdr or dds_takecdr.
+ * @param[out] sample  The sample to fill, previously initialised as for dds_read.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The sample has been deserialized.
+ * @retval DDS_RETCODE_BAD_PARAMETER
+ *             One of the arguments is NULL.
+ * @retval DDS_RETCODE_PRECONDITION_NOT_MET
+ *             The sample contains no valid data.
+ * @retval DDS_RETCODE_ERROR
+ *             The sample could not be deserialized.
+ */
+DDS_EXPORT dds_return_t
+dds_serdata_to_sample(const struct ddsi_serdata *serdata, void *sample);
+
 /**
  * @brief Access the collection of data values (of same type) and sample info from the
  *        data reader, readcondition or querycondition but scoped by the given
@@ -3491,6 +3649,36 @@ dds_domain_set_deafmute (
   bool mute,
   dds_duration_t reset_after);
 
+/**
+ * @brief This operation returns the number of packets received by the
+ * domain's network stack and the number of system calls it used to receive
+ * them. It is a support function for performance measurements and is
+ * subject to change.
+ *
+ * @param[in] entity  A domain entity or an entity bound to a domain, such
+ *                    as a participant, reader or writer.
+ * @param[out] packets  Number of packets received since the domain was
+ *                    created.
+ * @param[out] syscalls  Number of receive system calls made since the
+ *                    domain was created; with batched receives (see
+ *                    Internal/ReceiveBatchSize) this can be much less than
+ *                    the number of packets.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK
+ *             The operation was successful.
+ * @retval DDS_BAD_PARAMETER
+ *             The entity parameter is not a valid parameter.
+ * @retval DDS_RETCODE_ILLEGAL_OPERATION
+ *             The operation is invoked on an inappropriate object.
+*/
+DDS_EXPORT dds_return_t
+dds_domain_get_recv_stats (
+  dds_entity_t entity,
+  uint64_t *packets,
+  uint64_t *syscalls);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -52,6 +52,25 @@ dds_key_descriptor_t;
   API is a pointer to the "topic_descriptor_t" struct type.
 */
 
+/*
+  Type-specific (de)serializers, optionally generated by the preprocessor
+  (idlc -genmarshal). They are equivalent to interpreting m_ops, but
+  without the overhead of decoding the instructions at run-time.
+*/
+
+struct dds_istream;
+struct dds_ostream;
+
+typedef struct dds_topic_marshal_ops
+{
+  void (*m_write) (struct dds_ostream *os, const void *sample);
+  void (*m_read) (struct dds_istream *is, void *sample);
+  void (*m_write_key) (struct dds_ostream *os, const void *sample);
+  void (*m_extract_key) (struct dds_istream *is, struct dds_ostream *os);
+  bool (*m_normalize) (char *data, uint32_t *off, uint32_t size, bool bswap);
+}
+dds_topic_marshal_ops_t;
+
 typedef struct dds_topic_descriptor
 {
   const uint32_t m_size;               /* Size of topic type */
@@ -63,6 +82,7 @@ typedef struct dds_topic_descriptor
   const uint32_t m_nops;               /* Number of ops in m_ops */
   const uint32_t * m_ops;              /* Marshalling meta data */
   const char * m_meta;                 /* XML topic description meta data */
+  const dds_topic_marshal_ops_t * m_marshal; /* Generated (de)serializers (iff DDS_TOPIC_GENERATED_OPS) */
 }
 dds_topic_descriptor_t;
 
@@ -71,6 +91,7 @@ dds_topic_descriptor_t;
 #define DDS_TOPIC_NO_OPTIMIZE 0x0001
 #define DDS_TOPIC_FIXED_KEY 0x0002
 #define DDS_TOPIC_CONTAINS_UNION 0x0004
+#define DDS_TOPIC_GENERATED_OPS 0x0008
 
 /*
   Masks for read condition, read, take: there is only one mask here,
@@ -39,6 +39,12 @@ DDS_EXPORT void dds_topic_set_filter_with_ctx
 DDS_EXPORT dds_topic_intern_filter_fn dds_topic_get_filter_with_ctx
   (dds_entity_t topic);
 
+bool dds_topic_field_filter_accepts (const struct dds_field_filter *ff, const struct ddsi_serdata *sample);
+
+/* Converts the field filter of the topic to the form in which a reader advertises it in discovery,
+   the caller must free dst->terms */
+void dds_topic_advertised_field_filter (nn_field_filter_t *dst, const struct dds_topic *tp);
+
 DDS_EXPORT dds_entity_t dds_create_topic_impl (dds_entity_t participant, struct ddsi_sertopic **sertopic, const dds_qos_t *qos, const dds_listener_t *listener, const ddsi_plist_t *sedp_plist);
 
 #if defined (__cplusplus)
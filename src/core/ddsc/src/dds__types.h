@@ -20,6 +20,7 @@
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsi/ddsi_builtin_topic_if.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
 #include "dds__handles.h"
 
 #if defined (__cplusplus)
@@ -301,6 +302,15 @@ typedef struct dds_writer {
 typedef bool (*dds_topic_intern_filter_fn) (const void * sample, void *ctx);
 #endif
 
+/* Field filter compiled for the topic type, a sample is accepted if all terms
+   hold.  Replaced filters are kept until the topic is deleted because readers
+   may be evaluating them concurrently */
+struct dds_field_filter {
+  struct dds_field_filter *older;
+  uint32_t nterms;
+  struct dds_stream_field_term terms[];
+};
+
 typedef struct dds_topic {
   struct dds_entity m_entity;
   struct ddsi_sertopic *m_stopic;
@@ -308,6 +318,7 @@ typedef struct dds_topic {
 
   dds_topic_intern_filter_fn filter_fn;
   void *filter_ctx;
+  struct dds_field_filter *field_filter;
 
   /* Status metrics */
 
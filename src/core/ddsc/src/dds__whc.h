@@ -12,6 +12,7 @@
 #ifndef DDS__WHC_H
 #define DDS__WHC_H
 
+#include "dds/export.h"
 #include "dds/ddsi/q_whc.h"
 
 #if defined (__cplusplus)
@@ -22,9 +23,9 @@ struct ddsi_domaingv;
 struct whc_writer_info;
 struct dds_writer;
 
-struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wrinfo);
-struct whc_writer_info *whc_make_wrinfo (struct dds_writer *wr, const dds_qos_t *qos);
-void whc_free_wrinfo (struct whc_writer_info *);
+DDS_EXPORT struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wrinfo);
+DDS_EXPORT struct whc_writer_info *whc_make_wrinfo (struct dds_writer *wr, const dds_qos_t *qos);
+DDS_EXPORT void whc_free_wrinfo (struct whc_writer_info *);
 
 #if defined (__cplusplus)
 }
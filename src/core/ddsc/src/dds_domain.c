@@ -303,6 +303,26 @@ dds_return_t dds_domain_set_deafmute (dds_entity_t entity, bool deaf, bool mute,
   return rc;
 }
 
+dds_return_t dds_domain_get_recv_stats (dds_entity_t entity, uint64_t *packets, uint64_t *syscalls)
+{
+  struct dds_entity *e;
+  dds_return_t rc;
+  if (packets == NULL || syscalls == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if ((rc = dds_entity_pin (entity, &e)) < 0)
+    return rc;
+  if (e->m_domain == NULL)
+    rc = DDS_RETCODE_ILLEGAL_OPERATION;
+  else
+  {
+    *packets = ddsrt_atomic_ld64 (&e->m_domain->gv.recv_packets);
+    *syscalls = ddsrt_atomic_ld64 (&e->m_domain->gv.recv_syscalls);
+    rc = DDS_RETCODE_OK;
+  }
+  dds_entity_unpin (e);
+  return rc;
+}
+
 #include "dds__entity.h"
 static void pushdown_set_batch (struct dds_entity *e, bool enable)
 {
@@ -374,7 +374,6 @@ int32_t dds_handle_pin_for_delete (dds_handle_t hdl, bool explicit, struct dds_h
 bool dds_handle_drop_childref_and_pin (struct dds_handle_link *link, bool may_delete_parent)
 {
   bool del_parent = false;
-  ddsrt_mutex_lock (&handles.lock);
   uint32_t cf, cf1;
   do {
     cf = ddsrt_atomic_ld32 (&link->cnt_flags);
@@ -412,7 +411,6 @@ bool dds_handle_drop_childref_and_pin (struct dds_handle_link *link, bool may_de
       }
     }
   } while (!ddsrt_atomic_cas32 (&link->cnt_flags, cf, cf1));
-  ddsrt_mutex_unlock (&handles.lock);
   return del_parent;
 }
 
@@ -436,12 +434,14 @@ void dds_handle_unpin (struct dds_handle_link *link)
   else
     assert ((cf & HDL_PINCOUNT_MASK) >= 1u);
 #endif
-  ddsrt_mutex_lock (&handles.lock);
+  /* close_wait checks the pin count with handles.lock held, so taking the lock before
+     signalling suffices to not lose the wakeup */
   if ((ddsrt_atomic_dec32_nv (&link->cnt_flags) & (HDL_FLAG_CLOSING | HDL_PINCOUNT_MASK)) == (HDL_FLAG_CLOSING | 1u))
   {
+    ddsrt_mutex_lock (&handles.lock);
     ddsrt_cond_broadcast (&handles.cond);
+    ddsrt_mutex_unlock (&handles.lock);
   }
-  ddsrt_mutex_unlock (&handles.lock);
 }
 
 void dds_handle_add_ref (struct dds_handle_link *link)
@@ -457,12 +457,12 @@ bool dds_handle_drop_ref (struct dds_handle_link *link)
     assert ((old & HDL_REFCOUNT_MASK) > 0);
     new = old - HDL_REFCOUNT_UNIT;
   } while (!ddsrt_atomic_cas32 (&link->cnt_flags, old, new));
-  ddsrt_mutex_lock (&handles.lock);
   if ((new & (HDL_FLAG_CLOSING | HDL_PINCOUNT_MASK)) == (HDL_FLAG_CLOSING | 1u))
   {
+    ddsrt_mutex_lock (&handles.lock);
     ddsrt_cond_broadcast (&handles.cond);
+    ddsrt_mutex_unlock (&handles.lock);
   }
-  ddsrt_mutex_unlock (&handles.lock);
   return ((new & HDL_REFCOUNT_MASK) == 0);
 }
 
@@ -475,12 +475,12 @@ bool dds_handle_unpin_and_drop_ref (struct dds_handle_link *link)
     assert ((old & HDL_PINCOUNT_MASK) > 0);
     new = old - HDL_REFCOUNT_UNIT - 1u;
   } while (!ddsrt_atomic_cas32 (&link->cnt_flags, old, new));
-  ddsrt_mutex_lock (&handles.lock);
   if ((new & (HDL_FLAG_CLOSING | HDL_PINCOUNT_MASK)) == (HDL_FLAG_CLOSING | 1u))
   {
+    ddsrt_mutex_lock (&handles.lock);
     ddsrt_cond_broadcast (&handles.cond);
+    ddsrt_mutex_unlock (&handles.lock);
   }
-  ddsrt_mutex_unlock (&handles.lock);
   return ((new & HDL_REFCOUNT_MASK) == 0);
 }
 
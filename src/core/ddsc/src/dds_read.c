@@ -20,6 +20,8 @@
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_sertopic.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
 
 /*
   dds_read_impl: Core read/take function. Usually maxs is size of buf and si
@@ -522,3 +524,65 @@ dds_return_t dds_return_loan (dds_entity_t reader_or_condition, void **buf, int3
   dds_entity_unpin (entity);
   return DDS_RETCODE_OK;
 }
+
+dds_return_t dds_return_serdata_loan (struct ddsi_serdata **buf, int32_t bufsz)
+{
+  if (buf == NULL && bufsz > 0)
+    return DDS_RETCODE_BAD_PARAMETER;
+  for (int32_t i = 0; i < bufsz; i++)
+  {
+    if (buf[i])
+    {
+      ddsi_serdata_unref (buf[i]);
+      buf[i] = NULL;
+    }
+  }
+  return DDS_RETCODE_OK;
+}
+
+static const struct ddsi_sertopic_default *serdata_default_topic (const struct ddsi_serdata *serdata)
+{
+  /* samples without valid data are topicless, and only the default sertopic
+     has a type description that allows looking at the serialized form */
+  if (serdata->kind != SDK_DATA || serdata->topic == NULL || serdata->topic->ops != &ddsi_sertopic_ops_default)
+    return NULL;
+  return (const struct ddsi_sertopic_default *) serdata->topic;
+}
+
+const void *dds_serdata_view (const struct ddsi_serdata *serdata)
+{
+  const struct ddsi_sertopic_default *st;
+  if (serdata == NULL || (st = serdata_default_topic (serdata)) == NULL || st->opt_size == 0)
+    return NULL;
+  /* the data is in native endianness and validated on reception, and
+     opt_size means the serialized form is exactly the in-memory layout */
+  const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *) serdata;
+  assert (d->pos >= st->opt_size);
+  return ddsi_serdata_default_data (d);
+}
+
+dds_return_t dds_serdata_get_field (const struct ddsi_serdata *serdata, uint32_t offset, void *value)
+{
+  const struct ddsi_sertopic_default *st;
+  struct dds_stream_fieldref f;
+  dds_istream_t is;
+  if (serdata == NULL || value == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if (serdata->kind != SDK_DATA)
+    return DDS_RETCODE_PRECONDITION_NOT_MET;
+  if ((st = serdata_default_topic (serdata)) == NULL)
+    return DDS_RETCODE_ILLEGAL_OPERATION;
+  if (!dds_stream_fieldref_init (&f, &st->type, offset))
+    return DDS_RETCODE_BAD_PARAMETER;
+  dds_istream_from_serdata_default (&is, (const struct ddsi_serdata_default *) serdata);
+  return dds_stream_read_field (&is, &st->type, &f, value) ? DDS_RETCODE_OK : DDS_RETCODE_ERROR;
+}
+
+dds_return_t dds_serdata_to_sample (const struct ddsi_serdata *serdata, void *sample)
+{
+  if (serdata == NULL || sample == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if (serdata->topic == NULL)
+    return DDS_RETCODE_PRECONDITION_NOT_MET;
+  return ddsi_serdata_to_sample (serdata, sample, NULL, NULL) ? DDS_RETCODE_OK : DDS_RETCODE_ERROR;
+}
@@ -13,6 +13,7 @@
 #include <string.h>
 #include "dds/dds.h"
 #include "dds/version.h"
+#include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/static_assert.h"
 #include "dds__participant.h"
 #include "dds__subscriber.h"
@@ -493,8 +494,14 @@ static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscribe
      it; and then invoke those listeners that are in the pending set */
   dds_entity_init_complete (&rd->m_entity);
 
-  rc = new_reader (&rd->m_rd, &rd->m_entity.m_guid, NULL, pp, tp->m_stopic, rqos, &rd->m_rhc->common.rhc, dds_reader_status_cb, rd);
+  /* The field filter is advertised in discovery so that writers can skip sending
+     samples the reader will reject anyway, dds_set_topic_field_filter waits until
+     the reader is registered (see dds_topic_defer_set_qos) and then updates it */
+  nn_field_filter_t field_filter;
+  dds_topic_advertised_field_filter (&field_filter, tp);
+  rc = new_reader (&rd->m_rd, &rd->m_entity.m_guid, NULL, pp, tp->m_stopic, rqos, &field_filter, &rd->m_rhc->common.rhc, dds_reader_status_cb, rd);
   assert (rc == DDS_RETCODE_OK); /* FIXME: can be out-of-resources at the very least */
+  ddsrt_free (field_filter.terms);
   thread_state_asleep (lookup_thread_state ());
 
   rd->m_entity.m_iid = get_entity_instance_id (&rd->m_entity.m_domain->gv, &rd->m_entity.m_guid);
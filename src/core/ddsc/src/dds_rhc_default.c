@@ -13,13 +13,6 @@
 #include <string.h>
 #include <limits.h>
 
-#if HAVE_VALGRIND && ! defined (NDEBUG)
-#include <memcheck.h>
-#define USE_VALGRIND 1
-#else
-#define USE_VALGRIND 0
-#endif
-
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/sync.h"
 
@@ -27,7 +20,9 @@
 #include "dds__reader.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds__rhc_default.h"
+#include "dds__topic.h"
 #include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_lwregs.h"
 #include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/circlist.h"
@@ -88,8 +83,8 @@
    price to pay for the significant performance gain from not having to do
    anything in the case of a single (or single dominant) writer.
 
-   (Note: "registrations" may perhaps be moved to a global registration table
-   of <reader,instance,writer> tuples, using a lock-free hash table, but that
+   (Note: "registrations" is backed by a domain-wide registration table of
+   <reader,instance,writer> tuples, using a lock-free hash table, but that
    doesn't affect the model.)
 
    The unique identifiers for instances and writers are approximately uniformly
@@ -174,77 +169,56 @@
  ******   LIVE WRITERS   ******
  ******************************/
 
-struct lwreg
-{
-  uint64_t iid;
-  uint64_t wr_iid;
-};
-
+/* The registrations themselves are in the domain-wide table (gv->m_lwregs), shared
+   with all other readers; an RHC only knows its slot in the table and how many
+   registrations it has there, so that in the typical case of no registrations in the
+   table, it doesn't need to look there. */
 struct lwregs
 {
-  struct ddsrt_ehh * regs;
+  struct ddsi_lwregs *regs;
+  uint32_t slot;
+  uint32_t count;
 };
 
-static uint32_t lwreg_hash (const void *vl)
+static void lwregs_init (struct lwregs *rt, struct ddsi_lwregs *regs)
 {
-  const struct lwreg * l = vl;
-  return (uint32_t) (l->iid ^ l->wr_iid);
-}
-
-static int lwreg_equals (const void *va, const void *vb)
-{
-  const struct lwreg * a = va;
-  const struct lwreg * b = vb;
-  return a->iid == b->iid && a->wr_iid == b->wr_iid;
-}
-
-static void lwregs_init (struct lwregs *rt)
-{
-  rt->regs = NULL;
+  rt->regs = regs;
+  rt->slot = ddsi_lwregs_alloc_slot (regs);
+  rt->count = 0;
 }
 
 static void lwregs_fini (struct lwregs *rt)
 {
-  if (rt->regs)
-    ddsrt_ehh_free (rt->regs);
+  ddsi_lwregs_free_slot (rt->regs, rt->slot, rt->count);
 }
 
 static int lwregs_contains (struct lwregs *rt, uint64_t iid, uint64_t wr_iid)
 {
-  struct lwreg dummy = { .iid = iid, .wr_iid = wr_iid };
-  return rt->regs != NULL && ddsrt_ehh_lookup (rt->regs, &dummy) != NULL;
+  return rt->count > 0 && ddsi_lwregs_contains (rt->regs, rt->slot, iid, wr_iid);
 }
 
 static int lwregs_add (struct lwregs *rt, uint64_t iid, uint64_t wr_iid)
 {
-  struct lwreg dummy = { .iid = iid, .wr_iid = wr_iid };
-  if (rt->regs == NULL)
-    rt->regs = ddsrt_ehh_new (sizeof (struct lwreg), 1, lwreg_hash, lwreg_equals);
-  return ddsrt_ehh_add (rt->regs, &dummy);
+  if (!ddsi_lwregs_add (rt->regs, rt->slot, iid, wr_iid))
+    return 0;
+  rt->count++;
+  return 1;
 }
 
 static int lwregs_delete (struct lwregs *rt, uint64_t iid, uint64_t wr_iid)
 {
-  struct lwreg dummy = { .iid = iid, .wr_iid = wr_iid };
-  return rt->regs != NULL && ddsrt_ehh_remove (rt->regs, &dummy);
-}
-
-#if 0
-void lwregs_dump (struct lwregs *rt)
-{
-  struct ddsrt_ehh_iter it;
-  for (struct lwreg *r = ddsrt_ehh_iter_first(rt->regs, &it); r; r = ddsrt_ehh_iter_next(&it))
-    printf("iid=%"PRIu64" wr_iid=%"PRIu64"\n", r->iid, r->wr_iid);
+  if (rt->count == 0 || !ddsi_lwregs_delete (rt->regs, rt->slot, iid, wr_iid))
+    return 0;
+  rt->count--;
+  return 1;
 }
-#endif
 
 /*************************
  ******     RHC     ******
  *************************/
 
 struct rhc_sample {
-  struct ddsi_serdata *sample; /* serialised data (either just_key or real data) */
-  struct rhc_sample *next;     /* next sample in time ordering, or oldest sample if most recent */
+  struct ddsi_serdata *sample; /* serialised data (either just_key or real data), null if freed */
   uint64_t wr_iid;             /* unique id for writer of this sample (perhaps better in serdata) */
   dds_querycond_mask_t conds;  /* matching query conditions */
   bool isread;                 /* READ or NOT_READ sample state */
@@ -259,13 +233,14 @@ struct rhc_sample {
 struct rhc_instance {
   uint64_t iid;                /* unique instance id, key of table, also serves as instance handle */
   uint64_t wr_iid;             /* unique of id of writer of latest sample or 0; if wrcount = 0 it is the wr_iid that caused  */
-  struct rhc_sample *latest;   /* latest received sample; circular list old->new; null if no sample */
+  struct rhc_sample *samples;  /* ring buffer of samples, old->new starting at samples[first] */
+  uint32_t first;              /* index of oldest sample in samples */
+  uint32_t size;               /* capacity of samples, 0 if not yet allocated */
   uint32_t nvsamples;          /* number of "valid" samples in instance */
   uint32_t nvread;             /* number of READ "valid" samples in instance (0 <= nvread <= nvsamples) */
   dds_querycond_mask_t conds;  /* matching query conditions */
   uint32_t wrcount;            /* number of live writers */
   unsigned isnew : 1;          /* NEW or NOT_NEW view state */
-  unsigned a_sample_free : 1;  /* whether or not a_sample is in use */
   unsigned isdisposed : 1;     /* DISPOSED or NOT_DISPOSED (if not disposed, wrcount determines ALIVE/NOT_ALIVE_NO_WRITERS) */
   unsigned autodispose : 1;    /* wrcount > 0 => at least one registered writer has had auto-dispose set on some update */
   unsigned wr_iid_islive : 1;  /* whether wr_iid is of a live writer */
@@ -282,7 +257,7 @@ struct rhc_instance {
   struct deadline_elem deadline; /* element in deadline missed administration */
 #endif
   struct ddsi_tkmap_instance *tk;/* backref into TK for unref'ing */
-  struct rhc_sample a_sample;  /* pre-allocated storage for 1 sample */
+  struct rhc_sample a_sample;  /* pre-allocated storage for 1 sample, used as samples while size = 1 */
 };
 
 typedef enum rhc_store_result {
@@ -295,7 +270,7 @@ struct dds_rhc_default {
   struct dds_rhc common;
   struct ddsrt_hh *instances;
   struct ddsrt_circlist nonempty_instances; /* circular, points to most recently added one, NULL if none */
-  struct lwregs registrations;       /* should be a global one (with lock-free lookups) */
+  struct lwregs registrations;       /* this reader's view on the domain-wide table */
 
   /* Instance/Sample maximums from resource limits QoS */
 
@@ -324,6 +299,12 @@ struct dds_rhc_default {
   const struct ddsi_sertopic *topic; /* topic description */
   uint32_t history_depth;            /* depth, 1 for KEEP_LAST_1, 2**32-1 for KEEP_ALL */
 
+  /* Single lock protecting everything in the cache: the instance and sample state, the
+     counters above, the non-empty instance list, the condition trigger counts and the
+     lifespan/deadline administrations all change together in store, read and take.  A
+     take removes the samples from the cache, so converting them to the application
+     representation and releasing them is done after releasing the lock (see
+     dds_rhc_take_w_qminv). */
   ddsrt_mutex_t lock;
   dds_readcond * conds;              /* List of associated read conditions */
   uint32_t nconds;                   /* Number of associated read conditions */
@@ -413,7 +394,8 @@ static bool topicless_to_clean_invsample (const struct ddsi_sertopic *topic, con
 }
 
 static uint32_t qmask_of_inst (const struct rhc_instance *inst);
-static void free_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst, struct rhc_sample *s);
+static void free_sample (struct dds_rhc_default *rhc, struct rhc_sample *s);
+static void inst_remove_freed_samples (struct dds_rhc_default *rhc, struct rhc_instance *inst, uint32_t nslots);
 static void get_trigger_info_cmn (struct trigger_info_cmn *info, struct rhc_instance *inst);
 static void get_trigger_info_pre (struct trigger_info_pre *info, struct rhc_instance *inst);
 static void init_trigger_info_qcond (struct trigger_info_qcond *qc);
@@ -483,16 +465,7 @@ static void drop_expired_samples (struct dds_rhc_default *rhc, struct rhc_sample
   get_trigger_info_pre (&pre, inst);
   init_trigger_info_qcond (&trig_qc);
 
-  /* Find prev sample: in case of history depth of 1 this is the sample itself,
-    * (which is inst->latest). In case of larger history depth the most likely sample
-    * to be expired is the oldest, in which case inst->latest is the previous
-    * sample and inst->latest->next points to sample (circular list). We can
-    * assume that 'sample' is in the list, so a check to avoid infinite loop is not
-    * required here. */
-  struct rhc_sample *psample = inst->latest;
-  while (psample->next != sample)
-    psample = psample->next;
-
+  const uint32_t nslots = inst->nvsamples;
   rhc->n_vsamples--;
   if (sample->isread)
   {
@@ -500,18 +473,10 @@ static void drop_expired_samples (struct dds_rhc_default *rhc, struct rhc_sample
     rhc->n_vread--;
     trig_qc.dec_sample_read = true;
   }
-  if (--inst->nvsamples > 0)
-  {
-    if (inst->latest == sample)
-      inst->latest = psample;
-    psample->next = sample->next;
-  }
-  else
-  {
-    inst->latest = NULL;
-  }
+  inst->nvsamples--;
   trig_qc.dec_conds_sample = sample->conds;
-  free_sample (rhc, inst, sample);
+  free_sample (rhc, sample);
+  inst_remove_freed_samples (rhc, inst, nslots);
   get_trigger_info_cmn (&post.c, inst);
   update_conditions_locked (rhc, false, &pre, &post, &trig_qc, inst, NULL, &ntriggers);
   if (inst_is_empty (inst))
@@ -568,7 +533,7 @@ struct dds_rhc *dds_rhc_default_new_xchecks (dds_reader *reader, struct ddsi_dom
   memset (rhc, 0, sizeof (*rhc));
   rhc->common.common.ops = &dds_rhc_default_ops;
 
-  lwregs_init (&rhc->registrations);
+  lwregs_init (&rhc->registrations, gv->m_lwregs);
   ddsrt_mutex_init (&rhc->lock);
   rhc->instances = ddsrt_hh_new (1, instance_iid_hash, instance_iid_eq);
   ddsrt_circlist_init (&rhc->nonempty_instances);
@@ -633,46 +598,101 @@ static bool eval_predicate_invsample (const struct dds_rhc_default *rhc, const s
   return ret;
 }
 
-static struct rhc_sample *alloc_sample (struct rhc_instance *inst)
+/* Samples of an instance are stored in a ring buffer, the k-th oldest one is at
+   samples[(first + k) % size].  The ring starts out as the pre-allocated a_sample,
+   and grows when needed, for KEEP_LAST directly to the history depth if that is
+   reasonable, otherwise by doubling its size. */
+#define RHC_MAX_INITIAL_RING_SIZE 64
+
+static struct rhc_sample *inst_sample (const struct rhc_instance *inst, uint32_t k)
 {
-  if (inst->a_sample_free)
-  {
-    inst->a_sample_free = 0;
-#if USE_VALGRIND
-    VALGRIND_MAKE_MEM_UNDEFINED (&inst->a_sample, sizeof (inst->a_sample));
+  uint32_t i = inst->first + k;
+  assert (k < inst->size);
+  if (i >= inst->size)
+    i -= inst->size;
+  return &inst->samples[i];
+}
+
+static struct rhc_sample *inst_latest (const struct rhc_instance *inst)
+{
+  return (inst->nvsamples == 0) ? NULL : inst_sample (inst, inst->nvsamples - 1);
+}
+
+static void move_sample (struct dds_rhc_default *rhc, struct rhc_sample *dst, struct rhc_sample *src)
+{
+#ifdef DDSI_INCLUDE_LIFESPAN
+  /* the lifespan administration references the sample */
+  lifespan_unregister_sample_locked (&rhc->lifespan, &src->lifespan);
+  *dst = *src;
+  lifespan_register_sample_locked (&rhc->lifespan, &dst->lifespan);
+#else
+  DDSRT_UNUSED_ARG (rhc);
+  *dst = *src;
 #endif
-    return &inst->a_sample;
-  }
+}
+
+static void inst_grow_samples (struct dds_rhc_default *rhc, struct rhc_instance *inst)
+{
+  uint32_t size;
+  if (rhc->history_depth <= RHC_MAX_INITIAL_RING_SIZE)
+    size = rhc->history_depth;
+  else if (inst->size > rhc->history_depth / 2)
+    size = rhc->history_depth;
   else
-  {
-    /* This instead of sizeof(rhc_sample) gets us type checking */
-    struct rhc_sample *s;
-    s = ddsrt_malloc (sizeof (*s));
-    return s;
-  }
+    size = 2 * inst->size;
+  assert (size > inst->size);
+  struct rhc_sample *samples = ddsrt_malloc (size * sizeof (*samples));
+  for (uint32_t k = 0; k < inst->nvsamples; k++)
+    move_sample (rhc, &samples[k], inst_sample (inst, k));
+  if (inst->samples != &inst->a_sample)
+    ddsrt_free (inst->samples);
+  inst->samples = samples;
+  inst->size = size;
+  inst->first = 0;
+}
+
+static struct rhc_sample *alloc_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst)
+{
+  /* appends a new latest sample */
+  if (inst->nvsamples == inst->size)
+    inst_grow_samples (rhc, inst);
+  return inst_sample (inst, inst->nvsamples++);
 }
 
-static void free_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst, struct rhc_sample *s)
+static void free_sample (struct dds_rhc_default *rhc, struct rhc_sample *s)
 {
 #ifndef DDSI_INCLUDE_LIFESPAN
   DDSRT_UNUSED_ARG (rhc);
 #endif
-  ddsi_serdata_unref (s->sample);
+  /* NULL if taken, then the reference has been passed on */
+  if (s->sample)
+    ddsi_serdata_unref (s->sample);
+  s->sample = NULL;
 #ifdef DDSI_INCLUDE_LIFESPAN
   lifespan_unregister_sample_locked (&rhc->lifespan, &s->lifespan);
 #endif
-  if (s == &inst->a_sample)
-  {
-    assert (!inst->a_sample_free);
-#if USE_VALGRIND
-    VALGRIND_MAKE_MEM_NOACCESS (&inst->a_sample, sizeof (inst->a_sample));
-#endif
-    inst->a_sample_free = 1;
-  }
-  else
+}
+
+static void inst_remove_freed_samples (struct dds_rhc_default *rhc, struct rhc_instance *inst, uint32_t nslots)
+{
+  /* Of the nslots oldest entries in the ring, the freed ones have been removed from
+     inst->nvsamples.  Moving the remaining ones towards the latest end means the
+     common cases of taking everything or the oldest ones require no moving at all. */
+  uint32_t nkeep = inst->nvsamples, w = nslots, k = nslots;
+  assert (nkeep <= nslots && nslots <= inst->size);
+  while (nkeep > 0)
   {
-    ddsrt_free (s);
+    struct rhc_sample * const s = inst_sample (inst, --k);
+    if (s->sample != NULL)
+    {
+      if (--w != k)
+        move_sample (rhc, inst_sample (inst, w), s);
+      nkeep--;
+    }
   }
+  inst->first += w;
+  if (inst->first >= inst->size)
+    inst->first -= inst->size;
 }
 
 static void inst_clear_invsample (struct dds_rhc_default *rhc, struct rhc_instance *inst, struct trigger_info_qcond *trig_qc)
@@ -719,6 +739,8 @@ static void free_empty_instance (struct rhc_instance *inst, struct dds_rhc_defau
 {
   assert (inst_is_empty (inst));
   ddsi_tkmap_instance_unref (rhc->tkmap, inst->tk);
+  if (inst->samples != &inst->a_sample)
+    ddsrt_free (inst->samples);
 #ifdef DDSI_INCLUDE_DEADLINE_MISSED
   if (inst->deadline_reg)
     deadline_unregister_instance_locked (&rhc->deadline, &inst->deadline);
@@ -728,17 +750,13 @@ static void free_empty_instance (struct rhc_instance *inst, struct dds_rhc_defau
 
 static void free_instance_rhc_free (struct rhc_instance *inst, struct dds_rhc_default *rhc)
 {
-  struct rhc_sample *s = inst->latest;
   const bool was_empty = inst_is_empty (inst);
   struct trigger_info_qcond dummy_trig_qc;
 
-  if (s)
+  if (inst->nvsamples > 0)
   {
-    do {
-      struct rhc_sample * const s1 = s->next;
-      free_sample (rhc, inst, s);
-      s = s1;
-    } while (s != inst->latest);
+    for (uint32_t k = 0; k < inst->nvsamples; k++)
+      free_sample (rhc, inst_sample (inst, k));
     rhc->n_vsamples -= inst->nvsamples;
     rhc->n_vread -= inst->nvread;
     inst->nvsamples = 0;
@@ -851,17 +869,24 @@ static bool add_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
      counts - are included in the sample).  While this would be place to do it,
      we do it later to avoid having to roll back on allocation failure */
 
+  /* Likewise, get the reference to be stored first: that may involve copying a
+     sample received over the network and failing that the sample is rejected */
+  struct ddsi_serdata * const stored = ddsi_serdata_ref_detached (sample);
+  if (stored == NULL)
+    return false;
+
   /* We don't do backfilling in BY_SOURCE mode -- we could, but
      choose not to -- and having already filtered out samples
-     preceding inst->latest, we can simply insert it without any
+     preceding the latest one, we can simply insert it without any
      searching */
   if (inst->nvsamples == rhc->history_depth)
   {
-    /* replace oldest sample; latest points to the latest one, the
-       list is circular from old -> new, so latest->next is the oldest */
+    /* replace oldest sample in place, it then becomes the latest one */
     inst_clear_invsample_if_exists (rhc, inst, trig_qc);
-    assert (inst->latest != NULL);
-    s = inst->latest->next;
+    assert (inst->size == rhc->history_depth);
+    s = inst_sample (inst, 0);
+    if (++inst->first == inst->size)
+      inst->first = 0;
     assert (trig_qc->dec_conds_sample == 0);
     ddsi_serdata_unref (s->sample);
 
@@ -886,6 +911,7 @@ static bool add_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
       cb_data->extra = DDS_REJECTED_BY_SAMPLES_LIMIT;
       cb_data->handle = inst->iid;
       cb_data->add = true;
+      ddsi_serdata_unref (stored);
       return false;
     }
 
@@ -896,26 +922,17 @@ static bool add_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
       cb_data->extra = DDS_REJECTED_BY_SAMPLES_PER_INSTANCE_LIMIT;
       cb_data->handle = inst->iid;
       cb_data->add = true;
+      ddsi_serdata_unref (stored);
       return false;
     }
 
     /* add new latest sample */
-    s = alloc_sample (inst);
+    s = alloc_sample (rhc, inst);
     inst_clear_invsample_if_exists (rhc, inst, trig_qc);
-    if (inst->latest == NULL)
-    {
-      s->next = s;
-    }
-    else
-    {
-      s->next = inst->latest->next;
-      inst->latest->next = s;
-    }
-    inst->nvsamples++;
     rhc->n_vsamples++;
   }
 
-  s->sample = ddsi_serdata_ref (sample); /* drops const (tho refcount does change) */
+  s->sample = stored;
   s->wr_iid = wrinfo->iid;
   s->isread = false;
   s->disposed_gen = inst->disposed_gen;
@@ -935,7 +952,6 @@ static bool add_sample (struct dds_rhc_default *rhc, struct rhc_instance *inst,
   }
 
   trig_qc->inc_conds_sample = s->conds;
-  inst->latest = s;
   *nda = true;
   return true;
 }
@@ -946,6 +962,8 @@ static bool content_filter_accepts (const dds_reader *reader, const struct ddsi_
   if (reader)
   {
     const struct dds_topic *tp = reader->m_topic;
+    if (tp->field_filter && !dds_topic_field_filter_accepts (tp->field_filter, sample))
+      return false;
     if (tp->filter_fn)
     {
       char *tmp = ddsi_sertopic_alloc_sample (tp->m_stopic);
@@ -1090,10 +1108,10 @@ static void dds_rhc_register (struct dds_rhc_default *rhc, struct rhc_instance *
        increment the writer count & explicitly register the second
        one, too.
 
-       If I decide on a global table of registrations implemented
-       using concurrent hopscotch-hashing, then this should still
-       scale well because lwregs_add first calls lwregs_contains,
-       which is lock-free.  (Not that it probably can't be optimised
+       The global table of registrations is implemented using
+       concurrent hopscotch-hashing, so this should still scale well
+       because lwregs_add first does a lock-free lookup.  (Not that
+       it probably can't be optimised
        by a combined add-if-unknown-delete-if-known operation -- but
        the value of that is likely negligible because the
        registrations should be fairly stable.) */
@@ -1120,8 +1138,8 @@ static void dds_rhc_register (struct dds_rhc_default *rhc, struct rhc_instance *
   }
   else
   {
-    /* As above -- if using concurrent hopscotch hashing, if the
-       writer is already known, lwregs_add is lock-free */
+    /* As above -- if the writer is already known, lwregs_add is
+       lock-free */
     if (inst->wrcount == 1)
     {
       /* 2nd writer => properly register the one we knew about */
@@ -1263,7 +1281,7 @@ static int rhc_unregister_updateinst (struct dds_rhc_default *rhc, struct rhc_in
          care.) */
       if (!inst->isdisposed)
       {
-        if (inst->latest == NULL || inst->latest->isread)
+        if (inst->nvsamples == 0 || inst_latest (inst)->isread)
         {
           inst_set_invsample (rhc, inst, trig_qc, nda);
           update_inst (inst, wrinfo, false, tstamp);
@@ -1338,7 +1356,8 @@ static struct rhc_instance *alloc_new_instance (struct dds_rhc_default *rhc, con
   inst->autodispose = wrinfo->auto_dispose;
   inst->deadline_reg = 0;
   inst->isnew = 1;
-  inst->a_sample_free = 1;
+  inst->samples = &inst->a_sample;
+  inst->size = 1;
   inst->conds = 0;
   inst->wr_iid = wrinfo->iid;
   inst->wr_iid_islive = (inst->wrcount != 0);
@@ -1496,13 +1515,13 @@ static void update_viewstate_and_disposedness (struct dds_rhc_default * __restri
 }
 
 /*
-  dds_rhc_store: DDSI up call into read cache to store new sample. Returns whether sample
-  delivered (true unless a reliable sample rejected).
+  rhc_store_locked: stores a sample in the read cache with the lock held, the
+  notifications that result from it are accumulated in *notify_data_available,
+  triggers/ntriggers and cb_data, to be done after releasing the lock.
 */
 
-static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+static rhc_store_result_t rhc_store_locked (struct dds_rhc_default * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk, bool * __restrict notify_data_available_out, dds_entity *triggers[], size_t * __restrict ntriggers, status_cb_data_t * __restrict cb_data)
 {
-  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
   const uint64_t wr_iid = wrinfo->iid;
   const uint32_t statusinfo = sample->statusinfo;
   const bool has_data = (sample->kind == SDK_DATA);
@@ -1513,10 +1532,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
   struct trigger_info_post post;
   struct trigger_info_qcond trig_qc;
   rhc_store_result_t stored;
-  status_cb_data_t cb_data;   /* Callback data for reader status callback */
   bool notify_data_available;
-  dds_entity *triggers[MAX_FAST_TRIGGERS];
-  size_t ntriggers;
 
   TRACE ("rhc_store %"PRIx64",%"PRIx64" si %x has_data %d:", tk->m_iid, wr_iid, statusinfo, has_data);
   if (!has_data && statusinfo == 0)
@@ -1525,19 +1541,15 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
        register, which we do implicitly. (Currently DDSI2 won't allow
        it through anyway.) */
     TRACE (" ignore explicit register\n");
-    return true;
+    return RHC_FILTERED;
   }
 
   notify_data_available = false;
   dummy_instance.iid = tk->m_iid;
   stored = RHC_FILTERED;
-  cb_data.raw_status_id = -1;
-  ntriggers = 0;
 
   init_trigger_info_qcond (&trig_qc);
 
-  ddsrt_mutex_lock (&rhc->lock);
-
   inst = ddsrt_hh_lookup (rhc->instances, &dummy_instance);
   if (inst == NULL)
   {
@@ -1553,7 +1565,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     else
     {
       TRACE (" new instance\n");
-      stored = rhc_store_new_instance (&inst, rhc, wrinfo, sample, tk, has_data, &cb_data, &trig_qc, &notify_data_available);
+      stored = rhc_store_new_instance (&inst, rhc, wrinfo, sample, tk, has_data, cb_data, &trig_qc, &notify_data_available);
       if (stored != RHC_STORED)
         goto error_or_nochange;
 
@@ -1575,7 +1587,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
       dds_rhc_register (rhc, inst, wr_iid, wrinfo->auto_dispose, false, &notify_data_available);
       if (notify_data_available)
       {
-        if (inst->latest == NULL || inst->latest->isread)
+        if (inst->nvsamples == 0 || inst_latest (inst)->isread)
         {
           const bool was_empty = inst_is_empty (inst);
           inst_set_invsample (rhc, inst, &trig_qc, &notify_data_available);
@@ -1586,10 +1598,10 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     }
 
     /* notify sample lost */
-    cb_data.raw_status_id = (int) DDS_SAMPLE_LOST_STATUS_ID;
-    cb_data.extra = 0;
-    cb_data.handle = 0;
-    cb_data.add = true;
+    cb_data->raw_status_id = (int) DDS_SAMPLE_LOST_STATUS_ID;
+    cb_data->extra = 0;
+    cb_data->handle = 0;
+    cb_data->add = true;
   }
   else
   {
@@ -1624,7 +1636,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
       if (has_data)
       {
         TRACE (" add_sample");
-        if (!add_sample (rhc, inst, wrinfo, sample, &cb_data, &trig_qc, &notify_data_available))
+        if (!add_sample (rhc, inst, wrinfo, sample, cb_data, &trig_qc, &notify_data_available))
         {
           TRACE ("(reject)\n");
           stored = RHC_REJECTED;
@@ -1639,7 +1651,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
       }
 
       /* If instance became disposed, add an invalid sample if there are no samples left */
-      if ((bool) inst->isdisposed > old_isdisposed && (inst->latest == NULL || inst->latest->isread))
+      if ((bool) inst->isdisposed > old_isdisposed && (inst->nvsamples == 0 || inst_latest (inst)->isread))
         inst_set_invsample (rhc, inst, &trig_qc, &notify_data_available);
 
       update_inst (inst, wrinfo, true, sample->timestamp);
@@ -1649,7 +1661,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
          guaranteed that we end up with a non-empty instance: for
          example, if the instance was disposed & empty, nothing
          changes. */
-      if (inst->latest || (bool) inst->isdisposed > old_isdisposed)
+      if (inst->nvsamples > 0 || (bool) inst->isdisposed > old_isdisposed)
       {
         if (was_empty)
           account_for_empty_to_nonempty_transition (rhc, inst);
@@ -1689,23 +1701,88 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     get_trigger_info_cmn (&post.c, inst);
   }
 
-  postprocess_instance_update (rhc, &inst, &pre, &post, &trig_qc, triggers, &ntriggers);
+  postprocess_instance_update (rhc, &inst, &pre, &post, &trig_qc, triggers, ntriggers);
 
 error_or_nochange:
-  ddsrt_mutex_unlock (&rhc->lock);
+  if (notify_data_available)
+    *notify_data_available_out = true;
+  return stored;
+}
 
+static void rhc_store_notify (struct dds_rhc_default * __restrict rhc, bool notify_data_available, dds_entity *triggers[], size_t ntriggers, const status_cb_data_t *cb_data)
+{
   if (rhc->reader)
   {
     if (notify_data_available)
       dds_reader_data_available_cb (rhc->reader);
     for (size_t i = 0; i < ntriggers; i++)
       dds_entity_status_signal (triggers[i], 0);
-    if (cb_data.raw_status_id >= 0)
-      dds_reader_status_cb (&rhc->reader->m_entity, &cb_data);
+    if (cb_data->raw_status_id >= 0)
+      dds_reader_status_cb (&rhc->reader->m_entity, (status_cb_data_t *) cb_data);
   }
+}
+
+/*
+  dds_rhc_store: DDSI up call into read cache to store new sample. Returns whether sample
+  delivered (true unless a reliable sample rejected).
+*/
+
+static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+{
+  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
+  status_cb_data_t cb_data;   /* Callback data for reader status callback */
+  bool notify_data_available = false;
+  dds_entity *triggers[MAX_FAST_TRIGGERS];
+  size_t ntriggers = 0;
+  rhc_store_result_t stored;
+
+  cb_data.raw_status_id = -1;
+  ddsrt_mutex_lock (&rhc->lock);
+  stored = rhc_store_locked (rhc, wrinfo, sample, tk, &notify_data_available, triggers, &ntriggers, &cb_data);
+  ddsrt_mutex_unlock (&rhc->lock);
+  rhc_store_notify (rhc, notify_data_available, triggers, ntriggers, &cb_data);
   return !(rhc->reliable && stored == RHC_REJECTED);
 }
 
+/*
+  dds_rhc_store_batch: stores a batch of samples while holding the lock only once, and
+  notifying the application once.  Returns the number of samples delivered, which is
+  less than n only if a reliable sample was rejected.
+*/
+
+static uint32_t dds_rhc_default_store_batch (struct ddsi_rhc * __restrict rhc_common, uint32_t n, const struct ddsi_rhc_store_elem * __restrict elems)
+{
+  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
+  status_cb_data_t cb_data;
+  bool notify_data_available = false;
+  dds_entity *triggers[MAX_FAST_TRIGGERS];
+  size_t ntriggers = 0;
+  uint32_t i;
+
+  cb_data.raw_status_id = -1;
+  ddsrt_mutex_lock (&rhc->lock);
+  for (i = 0; i < n; i++)
+  {
+    cb_data.raw_status_id = -1;
+    const rhc_store_result_t stored = rhc_store_locked (rhc, elems[i].wrinfo, elems[i].sample, elems[i].tk, &notify_data_available, triggers, &ntriggers, &cb_data);
+    if (rhc->reliable && stored == RHC_REJECTED)
+      break;
+    if (cb_data.raw_status_id >= 0 || ntriggers == MAX_FAST_TRIGGERS)
+    {
+      /* status callbacks can't be combined and the triggers array is full,
+         so notify now (rare) */
+      ddsrt_mutex_unlock (&rhc->lock);
+      rhc_store_notify (rhc, notify_data_available, triggers, ntriggers, &cb_data);
+      notify_data_available = false;
+      ntriggers = 0;
+      ddsrt_mutex_lock (&rhc->lock);
+    }
+  }
+  ddsrt_mutex_unlock (&rhc->lock);
+  rhc_store_notify (rhc, notify_data_available, triggers, ntriggers, &cb_data);
+  return i;
+}
+
 static void dds_rhc_default_unregister_wr (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo)
 {
   /* Only to be called when writer with ID WR_IID has died.
@@ -1993,26 +2070,23 @@ static int32_t read_w_qminv_inst (struct dds_rhc_default * const __restrict rhc,
   init_trigger_info_qcond (&trig_qc);
 
   /* any valid samples precede a possible invalid sample */
-  if (inst->latest)
+  for (uint32_t k = 0; k < inst->nvsamples && n < max_samples; k++)
   {
-    struct rhc_sample *sample = inst->latest->next, * const end1 = sample;
-    do {
-      if ((qmask_of_sample (sample) & qminv) == 0 && (qcmask == 0 || (sample->conds & qcmask)))
+    struct rhc_sample * const sample = inst_sample (inst, k);
+    if ((qmask_of_sample (sample) & qminv) == 0 && (qcmask == 0 || (sample->conds & qcmask)))
+    {
+      /* sample state matches too */
+      set_sample_info (info_seq + n, inst, sample);
+      to_sample (sample->sample, values + n, 0, 0);
+      if (!sample->isread)
       {
-        /* sample state matches too */
-        set_sample_info (info_seq + n, inst, sample);
-        to_sample (sample->sample, values + n, 0, 0);
-        if (!sample->isread)
-        {
-          read_sample_update_conditions (rhc, &pre, &post, &trig_qc, inst, sample->conds, false);
-          sample->isread = true;
-          inst->nvread++;
-          rhc->n_vread++;
-        }
-        ++n;
+        read_sample_update_conditions (rhc, &pre, &post, &trig_qc, inst, sample->conds, false);
+        sample->isread = true;
+        inst->nvread++;
+        rhc->n_vread++;
       }
-      sample = sample->next;
-    } while (n < max_samples && sample != end1);
+      ++n;
+    }
   }
 
   /* add an invalid sample if it exists, matches and there is room in the result */
@@ -2054,7 +2128,7 @@ static int32_t read_w_qminv_inst (struct dds_rhc_default * const __restrict rhc,
   return n;
 }
 
-static int32_t take_w_qminv_inst (struct dds_rhc_default * const __restrict rhc, struct rhc_instance * __restrict * __restrict instptr, void * __restrict * __restrict values, dds_sample_info_t * __restrict info_seq, const int32_t max_samples, const uint32_t qminv, const dds_querycond_mask_t qcmask, size_t * __restrict ntriggers, read_take_to_sample_t to_sample, read_take_to_invsample_t to_invsample)
+static int32_t take_w_qminv_inst (struct dds_rhc_default * const __restrict rhc, struct rhc_instance * __restrict * __restrict instptr, struct ddsi_serdata * __restrict * __restrict values, dds_sample_info_t * __restrict info_seq, const int32_t max_samples, const uint32_t qminv, const dds_querycond_mask_t qcmask, size_t * __restrict ntriggers)
 {
   struct rhc_instance *inst = *instptr;
   assert (max_samples > 0);
@@ -2071,45 +2145,32 @@ static int32_t take_w_qminv_inst (struct dds_rhc_default * const __restrict rhc,
   get_trigger_info_pre (&pre, inst);
   init_trigger_info_qcond (&trig_qc);
 
-  if (inst->latest)
+  const uint32_t nslots = inst->nvsamples;
+  for (uint32_t k = 0; k < nslots && n < max_samples; k++)
   {
-    struct rhc_sample *psample = inst->latest;
-    struct rhc_sample *sample = psample->next;
-    uint32_t nvsamples = inst->nvsamples;
-    while (nvsamples--)
+    struct rhc_sample * const sample = inst_sample (inst, k);
+    if ((qmask_of_sample (sample) & qminv) != 0 || (qcmask != 0 && !(sample->conds & qcmask)))
     {
-      struct rhc_sample * const sample1 = sample->next;
-      if ((qmask_of_sample (sample) & qminv) != 0 || (qcmask != 0 && !(sample->conds & qcmask)))
-      {
-        /* sample mask doesn't match, or content predicate doesn't match */
-        psample = sample;
-      }
-      else
-      {
-        take_sample_update_conditions (rhc, &pre, &post, &trig_qc, inst, sample->conds, sample->isread);
-        set_sample_info (info_seq + n, inst, sample);
-        to_sample (sample->sample, values + n, 0, 0);
-        rhc->n_vsamples--;
-        if (sample->isread)
-        {
-          inst->nvread--;
-          rhc->n_vread--;
-        }
-        if (--inst->nvsamples == 0)
-          inst->latest = NULL;
-        else
-        {
-          if (inst->latest == sample)
-            inst->latest = psample;
-          psample->next = sample1;
-        }
-        free_sample (rhc, inst, sample);
-        if (++n == max_samples)
-          break;
-      }
-      sample = sample1;
+      /* sample mask doesn't match, or content predicate doesn't match */
+      continue;
+    }
+    take_sample_update_conditions (rhc, &pre, &post, &trig_qc, inst, sample->conds, sample->isread);
+    set_sample_info (info_seq + n, inst, sample);
+    /* the sample is removed, so its reference can be handed over as is */
+    values[n] = sample->sample;
+    sample->sample = NULL;
+    rhc->n_vsamples--;
+    if (sample->isread)
+    {
+      inst->nvread--;
+      rhc->n_vread--;
     }
+    inst->nvsamples--;
+    free_sample (rhc, sample);
+    ++n;
   }
+  if (inst->nvsamples < nslots)
+    inst_remove_freed_samples (rhc, inst, nslots);
 
   if (inst->inv_exists && n < max_samples && (qmask_of_invsample (inst) & qminv) == 0 && (qcmask == 0 || (inst->conds & qcmask) != 0))
   {
@@ -2119,7 +2180,7 @@ static int32_t take_w_qminv_inst (struct dds_rhc_default * const __restrict rhc,
 #endif
     take_sample_update_conditions (rhc, &pre, &post, &trig_qc, inst, inst->conds, inst->inv_isread);
     set_sample_info_invsample (info_seq + n, inst);
-    to_invsample (rhc->topic, inst->tk->m_sample, values + n, 0, 0);
+    values[n] = ddsi_serdata_ref (inst->tk->m_sample);
     inst_clear_invsample (rhc, inst, &dummy_trig_qc);
     ++n;
   }
@@ -2191,7 +2252,7 @@ static int32_t read_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock,
   return n;
 }
 
-static int32_t take_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock, void * __restrict * __restrict values, dds_sample_info_t * __restrict info_seq, int32_t max_samples, uint32_t qminv, dds_instance_handle_t handle, dds_readcond * __restrict cond, read_take_to_sample_t to_sample, read_take_to_invsample_t to_invsample)
+static int32_t take_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock, struct ddsi_serdata * __restrict * __restrict values, dds_sample_info_t * __restrict info_seq, int32_t max_samples, uint32_t qminv, dds_instance_handle_t handle, dds_readcond * __restrict cond)
 {
   int32_t n = 0;
   size_t ntriggers = SIZE_MAX;
@@ -2213,7 +2274,7 @@ static int32_t take_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock,
     struct rhc_instance template, *inst;
     template.iid = handle;
     if ((inst = ddsrt_hh_lookup (rhc->instances, &template)) != NULL)
-      n = take_w_qminv_inst (rhc, &inst, values, info_seq, max_samples, qminv, qcmask, &ntriggers, to_sample, to_invsample);
+      n = take_w_qminv_inst (rhc, &inst, values, info_seq, max_samples, qminv, qcmask, &ntriggers);
     else
       n = DDS_RETCODE_PRECONDITION_NOT_MET;
   }
@@ -2224,7 +2285,7 @@ static int32_t take_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock,
     while (n_insts-- > 0 && n < max_samples)
     {
       struct rhc_instance * const inst1 = next_nonempty_instance (inst);
-      n += take_w_qminv_inst (rhc, &inst, values + n, info_seq + n, max_samples - n, qminv, qcmask, &ntriggers, to_sample, to_invsample);
+      n += take_w_qminv_inst (rhc, &inst, values + n, info_seq + n, max_samples - n, qminv, qcmask, &ntriggers);
       inst = inst1;
     }
   }
@@ -2245,10 +2306,30 @@ static int32_t dds_rhc_read_w_qminv (struct dds_rhc_default *rhc, bool lock, voi
   return read_w_qminv (rhc, lock, values, info_seq, (int32_t) max_samples, qminv, handle, cond, read_take_to_sample, read_take_to_invsample);
 }
 
+#define TAKE_MAX_ON_STACK 32
+
 static int32_t dds_rhc_take_w_qminv (struct dds_rhc_default *rhc, bool lock, void **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t qminv, dds_instance_handle_t handle, dds_readcond *cond)
 {
+  /* Taking only collects the references to the serialized samples while holding the
+     lock, converting them and dropping the references (typically freeing them) happens
+     after releasing it.  Reading converts while holding the lock: the samples stay in
+     the cache and doing it later would cost a reference count update on each of them
+     for every read */
+  struct ddsi_serdata *sds_stack[TAKE_MAX_ON_STACK];
+  struct ddsi_serdata **sds = (max_samples <= TAKE_MAX_ON_STACK) ? sds_stack : ddsrt_malloc (max_samples * sizeof (*sds));
   assert (max_samples <= INT32_MAX);
-  return take_w_qminv (rhc, lock, values, info_seq, (int32_t) max_samples, qminv, handle, cond, read_take_to_sample, read_take_to_invsample);
+  const int32_t n = take_w_qminv (rhc, lock, sds, info_seq, (int32_t) max_samples, qminv, handle, cond);
+  for (int32_t i = 0; i < n; i++)
+  {
+    if (info_seq[i].valid_data)
+      (void) read_take_to_sample (sds[i], &values[i], NULL, NULL);
+    else
+      (void) read_take_to_invsample (rhc->topic, sds[i], &values[i], NULL, NULL);
+    ddsi_serdata_unref (sds[i]);
+  }
+  if (sds != sds_stack)
+    ddsrt_free (sds);
+  return n;
 }
 
 static int32_t dds_rhc_readcdr_w_qminv (struct dds_rhc_default *rhc, bool lock, struct ddsi_serdata **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t qminv, dds_instance_handle_t handle, dds_readcond *cond)
@@ -2260,9 +2341,8 @@ static int32_t dds_rhc_readcdr_w_qminv (struct dds_rhc_default *rhc, bool lock,
 
 static int32_t dds_rhc_takecdr_w_qminv (struct dds_rhc_default *rhc, bool lock, struct ddsi_serdata **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t qminv, dds_instance_handle_t handle, dds_readcond *cond)
 {
-  DDSRT_STATIC_ASSERT (sizeof (void *) == sizeof (struct ddsi_serdata *));
   assert (max_samples <= INT32_MAX);
-  return take_w_qminv (rhc, lock, (void **) values, info_seq, (int32_t) max_samples, qminv, handle, cond, read_take_to_sample_ref, read_take_to_invsample_ref);
+  return take_w_qminv (rhc, lock, values, info_seq, (int32_t) max_samples, qminv, handle, cond);
 }
 
 /*************************
@@ -2384,15 +2464,12 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
       uint32_t matches = 0;
 
       inst->conds = (inst->conds & ~qcmask) | (instmatch ? qcmask : 0);
-      if (inst->latest)
+      for (uint32_t k = 0; k < inst->nvsamples; k++)
       {
-        struct rhc_sample *sample = inst->latest->next, * const end = sample;
-        do {
-          const bool m = eval_predicate_sample (rhc, sample->sample, cond->m_query.m_filter);
-          sample->conds = (sample->conds & ~qcmask) | (m ? qcmask : 0);
-          matches += m;
-          sample = sample->next;
-        } while (sample != end);
+        struct rhc_sample * const sample = inst_sample (inst, k);
+        const bool m = eval_predicate_sample (rhc, sample->sample, cond->m_query.m_filter);
+        sample->conds = (sample->conds & ~qcmask) | (m ? qcmask : 0);
+        matches += m;
       }
 
       if (!inst_is_empty (inst) && rhc_get_cond_trigger (inst, cond))
@@ -2591,13 +2668,14 @@ static bool update_conditions_locked (struct dds_rhc_default *rhc, bool called_f
         {
           if (inst->inv_exists)
             mcurrent += (qmask_of_invsample (inst) & iter->m_qminv) == 0 && (inst->conds & qcmask) != 0;
-          if (inst->latest)
+          /* while taking, samples already taken are still in the ring, but freed */
+          for (uint32_t k = 0, nlive = 0; nlive < inst->nvsamples; k++)
           {
-            struct rhc_sample *sample = inst->latest->next, * const end = sample;
-            do {
-              mcurrent += (qmask_of_sample (sample) & iter->m_qminv) == 0 && (sample->conds & qcmask) != 0;
-              sample = sample->next;
-            } while (sample != end);
+            const struct rhc_sample * const sample = inst_sample (inst, k);
+            if (sample->sample == NULL)
+              continue;
+            mcurrent += (qmask_of_sample (sample) & iter->m_qminv) == 0 && (sample->conds & qcmask) != 0;
+            nlive++;
           }
         }
         if (mdelta == 0 && mcurrent == 0)
@@ -2633,10 +2711,18 @@ static bool update_conditions_locked (struct dds_rhc_default *rhc, bool called_f
 
     if (trigger)
     {
+      /* in a batch store, a condition may trigger more than once; ntriggers = SIZE_MAX
+         means there is no array for deferring the signal */
+      size_t k = 0;
       if (*ntriggers < MAX_FAST_TRIGGERS)
-        triggers[(*ntriggers)++] = &iter->m_entity;
-      else
+      {
+        while (k < *ntriggers && triggers[k] != &iter->m_entity)
+          k++;
+      }
+      if (*ntriggers >= MAX_FAST_TRIGGERS)
         dds_entity_status_signal (&iter->m_entity, DDS_DATA_AVAILABLE_STATUS);
+      else if (k == *ntriggers)
+        triggers[(*ntriggers)++] = &iter->m_entity;
     }
     TRACE ("\n");
     iter = iter->m_next;
@@ -2715,7 +2801,6 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
   for (inst = ddsrt_hh_iter_first (rhc->instances, &iter); inst; inst = ddsrt_hh_iter_next (&iter))
   {
     uint32_t n_vsamples_in_instance = 0, n_read_vsamples_in_instance = 0;
-    bool a_sample_free = true;
 
     n_instances++;
     if (inst->isnew)
@@ -2729,24 +2814,22 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
     else if (inst->wrcount == 0)
       n_not_alive_no_writers++;
 
-    if (inst->latest)
+    assert (inst->nvsamples <= inst->size && inst->first < inst->size);
+    assert ((inst->samples == &inst->a_sample) == (inst->size == 1));
+    for (uint32_t k = 0; k < inst->nvsamples; k++)
     {
-      struct rhc_sample *sample = inst->latest->next, * const end = sample;
-      do {
-        if (sample == &inst->a_sample)
-        {
-          assert (a_sample_free);
-          a_sample_free = false;
-        }
-        n_vsamples++;
-        n_vsamples_in_instance++;
-        if (sample->isread)
-        {
-          n_vread++;
-          n_read_vsamples_in_instance++;
-        }
-        sample = sample->next;
-      } while (sample != end);
+      const struct rhc_sample * const sample = inst_sample (inst, k);
+      assert (sample->sample != NULL);
+#ifdef DDSI_INCLUDE_LIFESPAN
+      assert (sample->inst == inst);
+#endif
+      n_vsamples++;
+      n_vsamples_in_instance++;
+      if (sample->isread)
+      {
+        n_vread++;
+        n_read_vsamples_in_instance++;
+      }
     }
 
     if (inst->inv_exists)
@@ -2757,7 +2840,6 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
 
     assert (n_read_vsamples_in_instance == inst->nvread);
     assert (n_vsamples_in_instance == inst->nvsamples);
-    assert (a_sample_free == inst->a_sample_free);
 
     if (check_conds)
     {
@@ -2770,18 +2852,15 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
           if (rciter->m_query.m_filter != 0 && rciter->m_query.m_filter (rhc->qcond_eval_samplebuf))
             qcmask |= rciter->m_query.m_qcmask;
         assert ((inst->conds & enabled_qcmask) == qcmask);
-        if (inst->latest)
+        for (uint32_t k = 0; k < inst->nvsamples; k++)
         {
-          struct rhc_sample *sample = inst->latest->next, * const end = sample;
-          do {
-            ddsi_serdata_to_sample (sample->sample, rhc->qcond_eval_samplebuf, NULL, NULL);
-            qcmask = 0;
-            for (rciter = rhc->conds; rciter; rciter = rciter->m_next)
-              if (rciter->m_query.m_filter != 0 && rciter->m_query.m_filter (rhc->qcond_eval_samplebuf))
-                qcmask |= rciter->m_query.m_qcmask;
-            assert ((sample->conds & enabled_qcmask) == qcmask);
-            sample = sample->next;
-          } while (sample != end);
+          const struct rhc_sample * const sample = inst_sample (inst, k);
+          ddsi_serdata_to_sample (sample->sample, rhc->qcond_eval_samplebuf, NULL, NULL);
+          qcmask = 0;
+          for (rciter = rhc->conds; rciter; rciter = rciter->m_next)
+            if (rciter->m_query.m_filter != 0 && rciter->m_query.m_filter (rhc->qcond_eval_samplebuf))
+              qcmask |= rciter->m_query.m_qcmask;
+          assert ((sample->conds & enabled_qcmask) == qcmask);
         }
       }
 
@@ -2795,13 +2874,10 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
         {
           if (inst->inv_exists)
             cond_match_count[i] += (qmask_of_invsample (inst) & rciter->m_qminv) == 0 && (inst->conds & rciter->m_query.m_qcmask) != 0;
-          if (inst->latest)
+          for (uint32_t k = 0; k < inst->nvsamples; k++)
           {
-            struct rhc_sample *sample = inst->latest->next, * const end = sample;
-            do {
-              cond_match_count[i] += ((qmask_of_sample (sample) & rciter->m_qminv) == 0 && (sample->conds & rciter->m_query.m_qcmask) != 0);
-              sample = sample->next;
-            } while (sample != end);
+            const struct rhc_sample * const sample = inst_sample (inst, k);
+            cond_match_count[i] += ((qmask_of_sample (sample) & rciter->m_qminv) == 0 && (sample->conds & rciter->m_query.m_qcmask) != 0);
           }
         }
       }
@@ -2854,6 +2930,7 @@ static int rhc_check_counts_locked (struct dds_rhc_default *rhc, bool check_cond
 static const struct dds_rhc_ops dds_rhc_default_ops = {
   .rhc_ops = {
     .store = dds_rhc_default_store,
+    .store_batch = dds_rhc_default_store_batch,
     .unregister_wr = dds_rhc_default_unregister_wr,
     .relinquish_ownership = dds_rhc_default_relinquish_ownership,
     .set_qos = dds_rhc_default_set_qos,
@@ -16,6 +16,7 @@
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/string.h"
+#include "dds/ddsrt/static_assert.h"
 #include "dds__topic.h"
 #include "dds__listener.h"
 #include "dds__participant.h"
@@ -32,6 +33,7 @@
 #include "dds/ddsi/ddsi_plist.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_cdrstream.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
 #include "dds/ddsi/ddsi_security_omg.h"
 #include "dds__serdata_builtintopic.h"
 
@@ -153,6 +155,12 @@ static dds_return_t dds_topic_delete (dds_entity *e)
   assert (dds_entity_kind (e->m_parent) == DDS_KIND_PARTICIPANT);
   dds_participant * const pp = (dds_participant *) e->m_parent;
   ddsi_sertopic_unref (tp->m_stopic);
+  while (tp->field_filter)
+  {
+    struct dds_field_filter *ff = tp->field_filter;
+    tp->field_filter = ff->older;
+    ddsrt_free (ff);
+  }
 
   ddsrt_mutex_lock (&pp->m_entity.m_mutex);
   if (--ktp->refc == 0)
@@ -421,6 +429,8 @@ dds_entity_t dds_create_topic (dds_entity_t participant, const dds_topic_descrip
     st->type.m_keys[i] = desc->m_keys[i].m_index;
   st->type.m_nops = dds_stream_countops (desc->m_ops);
   st->type.m_ops = ddsrt_memdup (desc->m_ops, st->type.m_nops * sizeof (*st->type.m_ops));
+  st->type.m_marshal = (desc->m_flagset & DDS_TOPIC_GENERATED_OPS) ? desc->m_marshal : NULL;
+  st->cdr_align = dds_stream_cdr_align (&st->type);
 
   /* Check if topic cannot be optimised (memcpy marshal) */
   if (!(st->type.m_flagset & DDS_TOPIC_NO_OPTIMIZE)) {
@@ -563,6 +573,164 @@ dds_topic_intern_filter_fn dds_topic_get_filter_with_ctx (dds_entity_t topic)
   return (filter == dds_topic_chaining_filter) ? 0 : filter;
 }
 
+DDSRT_STATIC_ASSERT ((int) DDS_FIELD_FILTER_EQ == (int) DDS_STREAM_FIELD_EQ && (int) DDS_FIELD_FILTER_NE == (int) DDS_STREAM_FIELD_NE &&
+                     (int) DDS_FIELD_FILTER_LT == (int) DDS_STREAM_FIELD_LT && (int) DDS_FIELD_FILTER_LE == (int) DDS_STREAM_FIELD_LE &&
+                     (int) DDS_FIELD_FILTER_GT == (int) DDS_STREAM_FIELD_GT && (int) DDS_FIELD_FILTER_GE == (int) DDS_STREAM_FIELD_GE);
+
+void dds_topic_advertised_field_filter (nn_field_filter_t *dst, const struct dds_topic *tp)
+{
+  const struct dds_field_filter *ff = tp->field_filter;
+  if (ff == NULL || ff->nterms == 0)
+  {
+    dst->type_hash = 0;
+    dst->n = 0;
+    dst->terms = NULL;
+    return;
+  }
+  /* only topics using the default sertopic can have a field filter */
+  dst->type_hash = dds_stream_fieldref_type_hash (&((const struct ddsi_sertopic_default *) tp->m_stopic)->type);
+  dst->n = ff->nterms;
+  dst->terms = ddsrt_malloc (ff->nterms * sizeof (*dst->terms));
+  for (uint32_t i = 0; i < ff->nterms; i++)
+  {
+    dst->terms[i].op_index = ff->terms[i].ref.op_index;
+    dst->terms[i].cmp = (uint32_t) ff->terms[i].cmp;
+    memcpy (&dst->terms[i].value, &ff->terms[i].value, sizeof (dst->terms[i].value));
+  }
+}
+
+static void pushdown_field_filter (dds_entity *e, struct dds_topic *tp)
+{
+  /* on input: both entities claimed but no mutexes held */
+  switch (dds_entity_kind (e))
+  {
+    case DDS_KIND_READER: {
+      dds_reader * const rd = (dds_reader *) e;
+      if (rd->m_topic != tp)
+        break;
+      /* lock(rd) -> lock(tp) is allowed; always advertising the filter in effect
+         when holding the reader lock means concurrent changes can't reorder */
+      struct ddsi_domaingv * const gv = &e->m_domain->gv;
+      struct reader *ddsi_rd;
+      nn_field_filter_t ff;
+      ddsrt_mutex_lock (&e->m_mutex);
+      ddsrt_mutex_lock (&tp->m_entity.m_mutex);
+      dds_topic_advertised_field_filter (&ff, tp);
+      ddsrt_mutex_unlock (&tp->m_entity.m_mutex);
+      thread_state_awake (lookup_thread_state (), gv);
+      if ((ddsi_rd = entidx_lookup_reader_guid (gv->entity_index, &e->m_guid)) != NULL)
+        update_reader_field_filter (ddsi_rd, &ff);
+      thread_state_asleep (lookup_thread_state ());
+      ddsrt_mutex_unlock (&e->m_mutex);
+      ddsrt_free (ff.terms);
+      break;
+    }
+    case DDS_KIND_PARTICIPANT:
+    case DDS_KIND_SUBSCRIBER: {
+      struct dds_entity *c;
+      dds_instance_handle_t last_iid = 0;
+      ddsrt_mutex_lock (&e->m_mutex);
+      while ((c = ddsrt_avl_lookup_succ (&dds_entity_children_td, &e->m_children, &last_iid)) != NULL)
+      {
+        struct dds_entity *x;
+        last_iid = c->m_iid;
+        if (dds_entity_pin (c->m_hdllink.hdl, &x) == DDS_RETCODE_OK)
+        {
+          assert (x == c);
+          /* see dds_get_children for why "c" remains valid despite unlocking m_mutex */
+          ddsrt_mutex_unlock (&e->m_mutex);
+          pushdown_field_filter (c, tp);
+          ddsrt_mutex_lock (&e->m_mutex);
+          dds_entity_unpin (c);
+        }
+      }
+      ddsrt_mutex_unlock (&e->m_mutex);
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+dds_return_t dds_set_topic_field_filter (dds_entity_t topic, uint32_t nterms, const dds_field_filter_term_t *terms)
+{
+  dds_topic *t;
+  dds_return_t rc;
+  if (nterms > 0 && terms == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  if ((rc = dds_topic_lock (topic, &t)) != DDS_RETCODE_OK)
+    return rc;
+  if (t->m_stopic->ops != &ddsi_sertopic_ops_default)
+  {
+    dds_topic_unlock (t);
+    return DDS_RETCODE_ILLEGAL_OPERATION;
+  }
+  const struct ddsi_sertopic_default *st = (const struct ddsi_sertopic_default *) t->m_stopic;
+  struct dds_field_filter *ff = NULL;
+  if (nterms > 0)
+  {
+    ff = ddsrt_malloc (sizeof (*ff) + nterms * sizeof (ff->terms[0]));
+    ff->nterms = nterms;
+    for (uint32_t i = 0; i < nterms; i++)
+    {
+      if ((uint32_t) terms[i].cmp > (uint32_t) DDS_FIELD_FILTER_GE || !dds_stream_fieldref_init (&ff->terms[i].ref, &st->type, terms[i].offset))
+      {
+        ddsrt_free (ff);
+        dds_topic_unlock (t);
+        return DDS_RETCODE_BAD_PARAMETER;
+      }
+      ff->terms[i].cmp = (enum dds_stream_field_cmp) terms[i].cmp;
+      memcpy (&ff->terms[i].value, &terms[i].value, sizeof (ff->terms[i].value));
+    }
+  }
+
+  /* Same as for a QoS change: a reader being created takes the filter in effect
+     for discovery but isn't a child of its subscriber yet, so wait until it is
+     to be sure the new one gets pushed down to it */
+  struct dds_participant * const pp = dds_entity_participant (&t->m_entity);
+  ddsrt_mutex_lock (&pp->m_entity.m_mutex);
+  while (t->m_ktopic->defer_set_qos != 0)
+    ddsrt_cond_wait (&pp->m_entity.m_cond, &pp->m_entity.m_mutex);
+  /* the replaced filter may be in use by a reader, it is freed with the topic */
+  if (ff)
+  {
+    ff->older = t->field_filter;
+    t->field_filter = ff;
+  }
+  else if (t->field_filter && t->field_filter->nterms > 0)
+  {
+    ff = ddsrt_malloc (sizeof (*ff));
+    ff->older = t->field_filter;
+    ff->nterms = 0;
+    t->field_filter = ff;
+  }
+  ddsrt_mutex_unlock (&pp->m_entity.m_mutex);
+  ddsrt_mutex_unlock (&t->m_entity.m_mutex);
+
+  /* Readers advertise the filter in discovery, so they must re-advertise it:
+     otherwise remote writers keep filtering on the old one */
+  if (ff)
+  {
+    dds_entity *x;
+    if (dds_entity_pin (pp->m_entity.m_hdllink.hdl, &x) == DDS_RETCODE_OK)
+    {
+      pushdown_field_filter (x, t);
+      dds_entity_unpin (x);
+    }
+  }
+  dds_topic_unpin (t);
+  return DDS_RETCODE_OK;
+}
+
+bool dds_topic_field_filter_accepts (const struct dds_field_filter *ff, const struct ddsi_serdata *sample)
+{
+  const struct ddsi_sertopic_default *st = (const struct ddsi_sertopic_default *) sample->topic;
+  assert (sample->kind == SDK_DATA);
+  assert (sample->ops == &ddsi_serdata_ops_cdr || sample->ops == &ddsi_serdata_ops_cdr_nokey);
+  return dds_stream_field_terms_hold ((const struct ddsi_serdata_default *) sample, &st->type, ff->nterms, ff->terms);
+}
+
 dds_return_t dds_get_name (dds_entity_t topic, char *name, size_t size)
 {
   dds_topic *t;
@@ -33,6 +33,7 @@
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds__whc.h"
+#include "dds__whc_ring.h"
 #include "dds__entity.h"
 #include "dds__writer.h"
 
@@ -88,6 +89,7 @@ struct whc_writer_info {
   dds_writer * writer; /* can be NULL, eg in case of whc for built-in writers */
   unsigned is_transient_local: 1;
   unsigned has_deadline: 1;
+  unsigned has_lifespan: 1;
   uint32_t hdepth; /* 0 = unlimited */
   uint32_t tldepth; /* 0 = disabled/unlimited (no need to maintain an index if KEEP_ALL <=> is_transient_local + tldepth=0) */
   uint32_t idxdepth; /* = max (hdepth, tldepth) */
@@ -428,6 +430,7 @@ struct whc_writer_info *whc_make_wrinfo (struct dds_writer *wr, const dds_qos_t
   wrinfo->writer = wr;
   wrinfo->is_transient_local = (qos->durability.kind == DDS_DURABILITY_TRANSIENT_LOCAL);
   wrinfo->has_deadline = (qos->deadline.deadline != DDS_INFINITY);
+  wrinfo->has_lifespan = ((qos->present & QP_LIFESPAN) && qos->lifespan.duration != DDS_INFINITY);
   wrinfo->hdepth = (qos->history.kind == DDS_HISTORY_KEEP_ALL) ? 0 : (unsigned) qos->history.depth;
   if (!wrinfo->is_transient_local)
     wrinfo->tldepth = 0;
@@ -450,6 +453,11 @@ struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wri
 
   assert ((wrinfo->hdepth == 0 || wrinfo->tldepth <= wrinfo->hdepth) || wrinfo->is_transient_local);
 
+  /* volatile data without deadline or lifespan never leaves holes in the sequence numbers
+     other than those of overwritten samples and can be stored in a simple ring */
+  if (gv->config.whc_ring && !wrinfo->is_transient_local && !wrinfo->has_deadline && !wrinfo->has_lifespan)
+    return whc_ring_new (gv, wrinfo->hdepth);
+
   whc = ddsrt_malloc (sizeof (*whc));
   whc->common.ops = &whc_ops;
   ddsrt_mutex_init (&whc->lock);
@@ -1177,7 +1185,7 @@ static struct whc_node *whc_default_insert_seq (struct whc_impl *whc, seqno_t ma
   newn->idxnode_pos = 0;
   newn->last_rexmit_ts.v = 0;
   newn->rexmit_count = 0;
-  newn->serdata = ddsi_serdata_ref (serdata);
+  newn->serdata = serdata;
   newn->next_seq = NULL;
   newn->prev_seq = whc->maxseq_node;
   if (newn->prev_seq)
@@ -1265,8 +1273,15 @@ static int whc_default_insert (struct whc *whc_generic, seqno_t max_drop_seq, se
    temporarily, a gap may be among the possibilities */
   assert (whc->seq_size == 0 || seq > whc->maxseq_node->seq);
 
-  /* Always insert in seq admin */
-  newn = whc_default_insert_seq (whc, max_drop_seq, seq, exp, plist, serdata);
+  /* Always insert in seq admin, provided a reference that can be stored can be had
+     (failing that, the caller retains ownership of plist) */
+  struct ddsi_serdata * const stored = ddsi_serdata_ref_detached (serdata);
+  if (stored == NULL)
+  {
+    ddsrt_mutex_unlock (&whc->lock);
+    return DDS_RETCODE_OUT_OF_RESOURCES;
+  }
+  newn = whc_default_insert_seq (whc, max_drop_seq, seq, exp, plist, stored);
 
   TRACE ("  whcn %p:", (void*)newn);
 
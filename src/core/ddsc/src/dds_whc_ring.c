@@ -0,0 +1,669 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_plist.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/q_rtps.h"
+#include "dds/ddsi/q_protocol.h"
+#include "dds/ddsi/q_config.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds__whc_ring.h"
+
+/* Writer history cache for volatile writers without deadline.  These never
+   retain acknowledged data, and so the samples present in the WHC always
+   form a single range of sequence numbers, with only occasional holes
+   where a KEEP_LAST writer overwrote an older sample of the same instance
+   (or the writer published data while no reliable readers were matched).
+
+   That allows storing the samples in a ring indexed by (seq - base), which
+   makes looking up a sample for a retransmit an array access and dropping
+   acknowledged samples a matter of advancing the head of the ring.  Holes
+   are slots without a sample.  The first and the last slot in use always
+   contain a sample.
+
+   The per-instance index is only needed for KEEP_LAST, and records the
+   sequence numbers of the last hdepth samples of each instance: whether
+   such a sample is still present follows from the ring itself. */
+
+#define WHC_RING_MIN_SIZE 64u
+
+struct whc_ring_slot {
+  struct ddsi_serdata *serdata; /* NULL if no sample with this sequence number */
+  struct ddsi_plist *plist; /* 0 if nothing special */
+  size_t size;
+  unsigned unacked: 1; /* counted in whc::unacked_bytes iff 1 */
+  unsigned borrowed: 1; /* at most one can borrow it at any time */
+  uint32_t rexmit_count;
+  ddsrt_mtime_t last_rexmit_ts;
+#ifdef DDSI_INCLUDE_LIFESPAN
+  ddsrt_mtime_t t_expire;
+#endif
+};
+
+struct whc_ring_idxnode {
+  uint64_t iid;
+  uint32_t headidx;
+  seqno_t hist[]; /* 0 if unused */
+};
+
+struct whc_ring {
+  struct whc common;
+  ddsrt_mutex_t lock;
+  struct ddsi_domaingv *gv;
+  struct ddsi_tkmap *tkmap;
+  uint32_t hdepth; /* 0 = KEEP_ALL, no index */
+  uint32_t mask; /* ring size - 1, ring size is a power of 2 */
+  uint32_t head; /* slot for seq = base */
+  uint32_t count; /* number of slots in use */
+  uint32_t nsamples; /* number of slots in use that contain a sample */
+  seqno_t base;
+  seqno_t max_drop_seq;
+  size_t unacked_bytes;
+  size_t sample_overhead;
+  uint32_t fragment_size;
+  struct ddsrt_hh *idx_hash; /* NULL iff hdepth = 0 */
+  struct whc_ring_slot *slots;
+};
+
+/* The samples dropped by remove_acked_messages, passed to the caller as an
+   opaque "struct whc_node" list so they can be freed without holding any
+   locks */
+struct whc_ring_deferred_free_list {
+  uint32_t n;
+  struct {
+    struct ddsi_serdata *serdata;
+    struct ddsi_plist *plist;
+  } e[];
+};
+
+struct whc_ring_sample_iter {
+  struct whc_sample_iter_base c;
+  bool first;
+};
+
+/* check that our definition of whc_sample_iter fits in the type that callers allocate */
+DDSRT_STATIC_ASSERT (sizeof (struct whc_ring_sample_iter) <= sizeof (struct whc_sample_iter));
+
+#define TRACE(...) DDS_CLOG (DDS_LC_WHC, &whc->gv->logconfig, __VA_ARGS__)
+
+static uint32_t whc_ring_idxnode_hash_key (const void *vn)
+{
+  const struct whc_ring_idxnode *n = vn;
+  return (uint32_t) n->iid;
+}
+
+static int whc_ring_idxnode_eq_key (const void *va, const void *vb)
+{
+  const struct whc_ring_idxnode *a = va;
+  const struct whc_ring_idxnode *b = vb;
+  return (a->iid == b->iid);
+}
+
+static struct whc_ring_slot *whc_ring_slot (const struct whc_ring *whc, seqno_t seq)
+{
+  assert (seq >= whc->base && seq - whc->base < whc->count);
+  return &whc->slots[(whc->head + (uint32_t) (seq - whc->base)) & whc->mask];
+}
+
+static struct whc_ring_slot *whc_ring_findseq (const struct whc_ring *whc, seqno_t seq)
+{
+  if (seq < whc->base || seq - whc->base >= whc->count)
+    return NULL;
+  struct whc_ring_slot * const slot = whc_ring_slot (whc, seq);
+  return slot->serdata ? slot : NULL;
+}
+
+static bool whc_ring_slot_expired (const struct whc_ring_slot *slot)
+{
+  /* Lifespan can be set after the writer has been created: samples are then
+     expired lazily, by no longer making them available for retransmitting */
+#ifdef DDSI_INCLUDE_LIFESPAN
+  return slot->t_expire.v != DDS_NEVER && slot->t_expire.v <= ddsrt_time_monotonic ().v;
+#else
+  (void) slot;
+  return false;
+#endif
+}
+
+static struct whc_ring_slot *whc_ring_findnext (const struct whc_ring *whc, seqno_t *seq)
+{
+  /* first unexpired sample with sequence number > *seq */
+  if (whc->count == 0)
+    return NULL;
+  for (seqno_t s = (*seq < whc->base) ? whc->base : *seq + 1; s < whc->base + whc->count; s++)
+  {
+    struct whc_ring_slot * const slot = whc_ring_slot (whc, s);
+    if (slot->serdata && !whc_ring_slot_expired (slot))
+    {
+      *seq = s;
+      return slot;
+    }
+  }
+  return NULL;
+}
+
+static void whc_ring_resize (struct whc_ring *whc, uint32_t size)
+{
+  assert (size >= whc->count && (size & (size - 1)) == 0);
+  struct whc_ring_slot *slots = ddsrt_malloc (size * sizeof (*slots));
+  const uint32_t n1 = (whc->count < whc->mask + 1 - whc->head) ? whc->count : whc->mask + 1 - whc->head;
+  memcpy (slots, &whc->slots[whc->head], n1 * sizeof (*slots));
+  memcpy (slots + n1, whc->slots, (whc->count - n1) * sizeof (*slots));
+  ddsrt_free (whc->slots);
+  whc->slots = slots;
+  whc->mask = size - 1;
+  whc->head = 0;
+}
+
+static void whc_ring_trim (struct whc_ring *whc)
+{
+  while (whc->count > 0 && whc->slots[whc->head].serdata == NULL)
+  {
+    whc->head = (whc->head + 1) & whc->mask;
+    whc->base++;
+    whc->count--;
+  }
+  while (whc->count > 0 && whc_ring_slot (whc, whc->base + whc->count - 1)->serdata == NULL)
+    whc->count--;
+  assert ((whc->count == 0) == (whc->nsamples == 0));
+}
+
+static struct whc_ring_slot *whc_ring_append (struct whc_ring *whc, seqno_t seq)
+{
+  if (whc->count == 0)
+  {
+    whc->base = seq;
+    whc->head = 0;
+  }
+  else
+  {
+    /* a gap is possible if data was published while no reliable readers were
+       matched: fill it with empty slots */
+    const seqno_t newcount = seq - whc->base + 1;
+    assert (seq >= whc->base + whc->count);
+    assert (newcount < INT32_MAX);
+    if (newcount > whc->mask + 1)
+    {
+      uint32_t size = whc->mask + 1;
+      while (size < newcount)
+        size *= 2;
+      whc_ring_resize (whc, size);
+    }
+    while (whc->base + whc->count < seq)
+    {
+      struct whc_ring_slot * const slot = &whc->slots[(whc->head + whc->count++) & whc->mask];
+      slot->serdata = NULL;
+      slot->plist = NULL;
+      slot->borrowed = 0;
+      slot->unacked = 0;
+    }
+  }
+  return &whc->slots[(whc->head + whc->count++) & whc->mask];
+}
+
+static void free_slot_contents (struct whc_ring_slot *slot)
+{
+  ddsi_serdata_unref (slot->serdata);
+  if (slot->plist) {
+    ddsi_plist_fini (slot->plist);
+    ddsrt_free (slot->plist);
+  }
+}
+
+static void whc_ring_delete_one (struct whc_ring *whc, struct whc_ring_slot *slot)
+{
+  if (slot->unacked)
+  {
+    assert (whc->unacked_bytes >= slot->size);
+    whc->unacked_bytes -= slot->size;
+  }
+  /* if borrowed, ownership of the contents shifts to the borrowed copy */
+  if (!slot->borrowed)
+    free_slot_contents (slot);
+  slot->serdata = NULL;
+  slot->plist = NULL;
+  slot->borrowed = 0;
+  slot->unacked = 0;
+  whc->nsamples--;
+  whc_ring_trim (whc);
+}
+
+static void get_state_locked (const struct whc_ring *whc, struct whc_state *st)
+{
+  if (whc->nsamples == 0)
+  {
+    st->min_seq = st->max_seq = -1;
+    st->unacked_bytes = 0;
+  }
+  else
+  {
+    st->min_seq = whc->base;
+    st->max_seq = whc->base + whc->count - 1;
+    st->unacked_bytes = whc->unacked_bytes;
+  }
+}
+
+static void whc_ring_get_state (const struct whc *whc_generic, struct whc_state *st)
+{
+  const struct whc_ring * const whc = (const struct whc_ring *) whc_generic;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  get_state_locked (whc, st);
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+}
+
+static seqno_t whc_ring_next_seq (const struct whc *whc_generic, seqno_t seq)
+{
+  const struct whc_ring * const whc = (const struct whc_ring *) whc_generic;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  if (whc_ring_findnext (whc, &seq) == NULL)
+    seq = MAX_SEQ_NUMBER;
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+  return seq;
+}
+
+static size_t whc_ring_sample_size (const struct whc_ring *whc, const struct ddsi_serdata *serdata)
+{
+  size_t sz = ddsi_serdata_size (serdata);
+  return sz + ((sz + whc->fragment_size - 1) / whc->fragment_size) * whc->sample_overhead;
+}
+
+static void whc_ring_delete_instance (struct whc_ring *whc, seqno_t max_drop_seq, struct whc_ring_idxnode *idxn)
+{
+  if (!ddsrt_hh_remove (whc->idx_hash, idxn))
+    assert (0);
+  for (uint32_t i = 0; i < whc->hdepth; i++)
+  {
+    struct whc_ring_slot *slot;
+    if (idxn->hist[i] != 0 && idxn->hist[i] <= max_drop_seq && (slot = whc_ring_findseq (whc, idxn->hist[i])) != NULL)
+    {
+      TRACE (" prune %"PRId64, idxn->hist[i]);
+      whc_ring_delete_one (whc, slot);
+    }
+  }
+  ddsrt_free (idxn);
+}
+
+static void whc_ring_insert_idx (struct whc_ring *whc, seqno_t seq, struct ddsi_tkmap_instance *tk)
+{
+  union {
+    struct whc_ring_idxnode idxn;
+    char pad[sizeof (struct whc_ring_idxnode) + sizeof (seqno_t)];
+  } template;
+  struct whc_ring_idxnode *idxn;
+  template.idxn.iid = tk->m_iid;
+  if ((idxn = ddsrt_hh_lookup (whc->idx_hash, &template)) != NULL)
+  {
+    if (++idxn->headidx == whc->hdepth)
+      idxn->headidx = 0;
+    const seqno_t oldseq = idxn->hist[idxn->headidx];
+    struct whc_ring_slot *oldslot;
+    idxn->hist[idxn->headidx] = seq;
+    if (oldseq != 0 && (oldslot = whc_ring_findseq (whc, oldseq)) != NULL)
+    {
+      TRACE (" prune %"PRId64, oldseq);
+      whc_ring_delete_one (whc, oldslot);
+    }
+  }
+  else
+  {
+    TRACE (" newkey");
+    idxn = ddsrt_malloc (sizeof (*idxn) + whc->hdepth * sizeof (idxn->hist[0]));
+    idxn->iid = tk->m_iid;
+    idxn->headidx = 0;
+    idxn->hist[0] = seq;
+    for (uint32_t i = 1; i < whc->hdepth; i++)
+      idxn->hist[i] = 0;
+    if (!ddsrt_hh_add (whc->idx_hash, idxn))
+      assert (0);
+  }
+}
+
+static int whc_ring_insert (struct whc *whc_generic, seqno_t max_drop_seq, seqno_t seq, ddsrt_mtime_t exp, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk)
+{
+  struct whc_ring * const whc = (struct whc_ring *) whc_generic;
+  struct whc_ring_slot *slot;
+
+  ddsrt_mutex_lock (&whc->lock);
+  TRACE ("whc_ring_insert(%p max_drop_seq %"PRId64" seq %"PRId64" plist %p serdata %p:%"PRIx32") ring [%"PRId64",%"PRId64") size %"PRIu32":",
+         (void *) whc, max_drop_seq, seq, (void *) plist, (void *) serdata, serdata->hash,
+         whc->base, whc->base + whc->count, whc->mask + 1);
+
+  assert (max_drop_seq < MAX_SEQ_NUMBER);
+  assert (max_drop_seq >= whc->max_drop_seq);
+  assert (whc->count == 0 || seq >= whc->base + whc->count);
+
+  /* failing to get a reference that can be stored, the caller retains ownership of plist */
+  struct ddsi_serdata * const stored = ddsi_serdata_ref_detached (serdata);
+  if (stored == NULL)
+  {
+    ddsrt_mutex_unlock (&whc->lock);
+    return DDS_RETCODE_OUT_OF_RESOURCES;
+  }
+  slot = whc_ring_append (whc, seq);
+  slot->serdata = stored;
+  slot->plist = plist;
+  slot->size = whc_ring_sample_size (whc, serdata);
+  slot->unacked = (seq > max_drop_seq);
+  slot->borrowed = 0;
+  slot->rexmit_count = 0;
+  slot->last_rexmit_ts.v = 0;
+#ifdef DDSI_INCLUDE_LIFESPAN
+  slot->t_expire = exp;
+#else
+  DDSRT_UNUSED_ARG (exp);
+#endif
+  whc->nsamples++;
+  if (slot->unacked)
+    whc->unacked_bytes += slot->size;
+
+  /* Special case of empty data (such as commit messages) can't go into index */
+  if (serdata->kind != SDK_EMPTY)
+  {
+    if (serdata->statusinfo & NN_STATUSINFO_UNREGISTER)
+    {
+      union {
+        struct whc_ring_idxnode idxn;
+        char pad[sizeof (struct whc_ring_idxnode) + sizeof (seqno_t)];
+      } template;
+      struct whc_ring_idxnode *idxn;
+      template.idxn.iid = tk->m_iid;
+      if (whc->idx_hash && (idxn = ddsrt_hh_lookup (whc->idx_hash, &template)) != NULL)
+      {
+        TRACE (" unreg:delete");
+        whc_ring_delete_instance (whc, max_drop_seq, idxn);
+      }
+      if (seq <= max_drop_seq)
+      {
+        TRACE (" unreg:seq <= max_drop_seq: delete");
+        whc_ring_delete_one (whc, slot);
+      }
+    }
+    else if (whc->idx_hash)
+    {
+      whc_ring_insert_idx (whc, seq, tk);
+    }
+  }
+  TRACE ("\n");
+  ddsrt_mutex_unlock (&whc->lock);
+  return 0;
+}
+
+static uint32_t whc_ring_remove_acked_messages (struct whc *whc_generic, seqno_t max_drop_seq, struct whc_state *whcst, struct whc_node **deferred_free_list)
+{
+  struct whc_ring * const whc = (struct whc_ring *) whc_generic;
+  struct whc_ring_deferred_free_list *dfl = NULL;
+  uint32_t ndropped = 0;
+
+  ddsrt_mutex_lock (&whc->lock);
+  assert (max_drop_seq < MAX_SEQ_NUMBER);
+  assert (max_drop_seq >= whc->max_drop_seq);
+  TRACE ("whc_ring_remove_acked_messages(%p max_drop_seq %"PRId64") ring [%"PRId64",%"PRId64")\n",
+         (void *) whc, max_drop_seq, whc->base, whc->base + whc->count);
+
+  whc->max_drop_seq = max_drop_seq;
+  if (whc->count > 0 && max_drop_seq >= whc->base)
+  {
+    /* everything up to and including max_drop_seq goes in one go */
+    const uint32_t n = (max_drop_seq - whc->base >= whc->count) ? whc->count : (uint32_t) (max_drop_seq - whc->base + 1);
+    dfl = ddsrt_malloc (sizeof (*dfl) + n * sizeof (dfl->e[0]));
+    dfl->n = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      struct whc_ring_slot * const slot = &whc->slots[(whc->head + i) & whc->mask];
+      if (slot->serdata == NULL)
+        continue;
+      ndropped++;
+      if (slot->unacked)
+      {
+        assert (whc->unacked_bytes >= slot->size);
+        whc->unacked_bytes -= slot->size;
+      }
+      if (!slot->borrowed)
+      {
+        dfl->e[dfl->n].serdata = slot->serdata;
+        dfl->e[dfl->n].plist = slot->plist;
+        dfl->n++;
+      }
+    }
+    whc->head = (whc->head + n) & whc->mask;
+    whc->base += n;
+    whc->count -= n;
+    assert (ndropped <= whc->nsamples);
+    whc->nsamples -= ndropped;
+    whc_ring_trim (whc);
+    if (whc->mask + 1 > WHC_RING_MIN_SIZE && whc->count < (whc->mask + 1) / 8)
+      whc_ring_resize (whc, (whc->mask + 1) / 2);
+    if (dfl->n == 0)
+    {
+      ddsrt_free (dfl);
+      dfl = NULL;
+    }
+  }
+  get_state_locked (whc, whcst);
+  ddsrt_mutex_unlock (&whc->lock);
+  *deferred_free_list = (struct whc_node *) dfl;
+  return ndropped;
+}
+
+static void whc_ring_free_deferred_free_list (struct whc *whc_generic, struct whc_node *deferred_free_list)
+{
+  struct whc_ring_deferred_free_list * const dfl = (struct whc_ring_deferred_free_list *) deferred_free_list;
+  (void) whc_generic;
+  if (dfl == NULL)
+    return;
+  for (uint32_t i = 0; i < dfl->n; i++)
+  {
+    ddsi_serdata_unref (dfl->e[i].serdata);
+    if (dfl->e[i].plist)
+    {
+      ddsi_plist_fini (dfl->e[i].plist);
+      ddsrt_free (dfl->e[i].plist);
+    }
+  }
+  ddsrt_free (dfl);
+}
+
+static uint32_t whc_ring_downgrade_to_volatile (struct whc *whc_generic, struct whc_state *st)
+{
+  /* always volatile */
+  whc_ring_get_state (whc_generic, st);
+  return 0;
+}
+
+static void make_borrowed_sample (struct whc_borrowed_sample *sample, seqno_t seq, struct whc_ring_slot *slot)
+{
+  assert (!slot->borrowed);
+  slot->borrowed = 1;
+  sample->seq = seq;
+  sample->plist = slot->plist;
+  sample->serdata = slot->serdata;
+  sample->unacked = slot->unacked;
+  sample->rexmit_count = slot->rexmit_count;
+  sample->last_rexmit_ts = slot->last_rexmit_ts;
+}
+
+static bool whc_ring_borrow_sample (const struct whc *whc_generic, seqno_t seq, struct whc_borrowed_sample *sample)
+{
+  const struct whc_ring * const whc = (const struct whc_ring *) whc_generic;
+  struct whc_ring_slot *slot;
+  bool found;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  if ((slot = whc_ring_findseq (whc, seq)) == NULL || whc_ring_slot_expired (slot))
+    found = false;
+  else
+  {
+    make_borrowed_sample (sample, seq, slot);
+    found = true;
+  }
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+  return found;
+}
+
+static bool whc_ring_borrow_sample_key (const struct whc *whc_generic, const struct ddsi_serdata *serdata_key, struct whc_borrowed_sample *sample)
+{
+  const struct whc_ring * const whc = (const struct whc_ring *) whc_generic;
+  union {
+    struct whc_ring_idxnode idxn;
+    char pad[sizeof (struct whc_ring_idxnode) + sizeof (seqno_t)];
+  } template;
+  struct whc_ring_idxnode *idxn;
+  struct whc_ring_slot *slot;
+  bool found = false;
+  if (whc->idx_hash == NULL)
+    return false;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &whc->lock);
+  template.idxn.iid = ddsi_tkmap_lookup (whc->tkmap, serdata_key);
+  if ((idxn = ddsrt_hh_lookup (whc->idx_hash, &template)) != NULL &&
+      (slot = whc_ring_findseq (whc, idxn->hist[idxn->headidx])) != NULL &&
+      !whc_ring_slot_expired (slot))
+  {
+    make_borrowed_sample (sample, idxn->hist[idxn->headidx], slot);
+    found = true;
+  }
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &whc->lock);
+  return found;
+}
+
+static void return_sample_locked (struct whc_ring *whc, struct whc_borrowed_sample *sample, bool update_retransmit_info)
+{
+  struct whc_ring_slot *slot;
+  if ((slot = whc_ring_findseq (whc, sample->seq)) == NULL)
+  {
+    /* data no longer present in WHC - that means ownership for serdata, plist shifted to the borrowed copy and "returning" it really becomes "destroying" it */
+    ddsi_serdata_unref (sample->serdata);
+    if (sample->plist)
+    {
+      ddsi_plist_fini (sample->plist);
+      ddsrt_free (sample->plist);
+    }
+  }
+  else
+  {
+    assert (slot->borrowed);
+    slot->borrowed = 0;
+    if (update_retransmit_info)
+    {
+      slot->rexmit_count = sample->rexmit_count;
+      slot->last_rexmit_ts = sample->last_rexmit_ts;
+    }
+  }
+}
+
+static void whc_ring_return_sample (struct whc *whc_generic, struct whc_borrowed_sample *sample, bool update_retransmit_info)
+{
+  struct whc_ring * const whc = (struct whc_ring *) whc_generic;
+  ddsrt_mutex_lock (&whc->lock);
+  return_sample_locked (whc, sample, update_retransmit_info);
+  ddsrt_mutex_unlock (&whc->lock);
+}
+
+static void whc_ring_sample_iter_init (const struct whc *whc_generic, struct whc_sample_iter *opaque_it)
+{
+  struct whc_ring_sample_iter *it = (struct whc_ring_sample_iter *) opaque_it;
+  it->c.whc = (struct whc *) whc_generic;
+  it->first = true;
+}
+
+static bool whc_ring_sample_iter_borrow_next (struct whc_sample_iter *opaque_it, struct whc_borrowed_sample *sample)
+{
+  struct whc_ring_sample_iter * const it = (struct whc_ring_sample_iter *) opaque_it;
+  struct whc_ring * const whc = (struct whc_ring *) it->c.whc;
+  struct whc_ring_slot *slot;
+  seqno_t seq;
+  bool valid;
+  ddsrt_mutex_lock (&whc->lock);
+  if (!it->first)
+  {
+    seq = sample->seq;
+    return_sample_locked (whc, sample, false);
+  }
+  else
+  {
+    it->first = false;
+    seq = 0;
+  }
+  if ((slot = whc_ring_findnext (whc, &seq)) == NULL)
+    valid = false;
+  else
+  {
+    make_borrowed_sample (sample, seq, slot);
+    valid = true;
+  }
+  ddsrt_mutex_unlock (&whc->lock);
+  return valid;
+}
+
+static void whc_ring_free (struct whc *whc_generic)
+{
+  struct whc_ring * const whc = (struct whc_ring *) whc_generic;
+  for (uint32_t i = 0; i < whc->count; i++)
+  {
+    struct whc_ring_slot * const slot = &whc->slots[(whc->head + i) & whc->mask];
+    if (slot->serdata)
+      free_slot_contents (slot);
+  }
+  if (whc->idx_hash)
+  {
+    struct ddsrt_hh_iter it;
+    struct whc_ring_idxnode *idxn;
+    for (idxn = ddsrt_hh_iter_first (whc->idx_hash, &it); idxn != NULL; idxn = ddsrt_hh_iter_next (&it))
+      ddsrt_free (idxn);
+    ddsrt_hh_free (whc->idx_hash);
+  }
+  ddsrt_free (whc->slots);
+  ddsrt_mutex_destroy (&whc->lock);
+  ddsrt_free (whc);
+}
+
+static const struct whc_ops whc_ring_ops = {
+  .insert = whc_ring_insert,
+  .remove_acked_messages = whc_ring_remove_acked_messages,
+  .free_deferred_free_list = whc_ring_free_deferred_free_list,
+  .get_state = whc_ring_get_state,
+  .next_seq = whc_ring_next_seq,
+  .borrow_sample = whc_ring_borrow_sample,
+  .borrow_sample_key = whc_ring_borrow_sample_key,
+  .return_sample = whc_ring_return_sample,
+  .sample_iter_init = whc_ring_sample_iter_init,
+  .sample_iter_borrow_next = whc_ring_sample_iter_borrow_next,
+  .downgrade_to_volatile = whc_ring_downgrade_to_volatile,
+  .free = whc_ring_free
+};
+
+struct whc *whc_ring_new (struct ddsi_domaingv *gv, uint32_t hdepth)
+{
+  struct whc_ring *whc = ddsrt_malloc (sizeof (*whc));
+  whc->common.ops = &whc_ring_ops;
+  ddsrt_mutex_init (&whc->lock);
+  whc->gv = gv;
+  whc->tkmap = gv->m_tkmap;
+  whc->hdepth = hdepth;
+  whc->mask = WHC_RING_MIN_SIZE - 1;
+  whc->head = 0;
+  whc->count = 0;
+  whc->nsamples = 0;
+  whc->base = 1;
+  whc->max_drop_seq = 0;
+  whc->unacked_bytes = 0;
+  whc->sample_overhead = 80; /* INFO_TS, DATA (estimate), inline QoS */
+  whc->fragment_size = gv->config.fragment_size;
+  whc->idx_hash = (hdepth > 0) ? ddsrt_hh_new (1, whc_ring_idxnode_hash_key, whc_ring_idxnode_eq_key) : NULL;
+  whc->slots = ddsrt_malloc (WHC_RING_MIN_SIZE * sizeof (*whc->slots));
+  return (struct whc *) whc;
+}
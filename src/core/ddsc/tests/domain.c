@@ -287,3 +287,39 @@ CU_Test(ddsc_domain_create, invalid_xml)
   domain = dds_create_domain(1, "<CycloneDDS incorrect XML");
   CU_ASSERT_FATAL(domain == DDS_RETCODE_ERROR);
 }
+
+CU_Test(ddsc_domain, recv_stats)
+{
+  /* SPDP messages sent to itself as a peer guarantee some packets get received */
+  const char *config = "<"DDS_PROJECT_NAME"><Domain id=\"any\">"
+    "<Discovery><ParticipantIndex>auto</ParticipantIndex><Peers><Peer address=\"127.0.0.1\"/></Peers></Discovery>"
+    "<Internal><ReceiveBatchSize>8</ReceiveBatchSize></Internal></Domain></"DDS_PROJECT_NAME">";
+  dds_entity_t domain, pp;
+  dds_return_t rc;
+  uint64_t packets = 0, syscalls = 0;
+
+  rc = dds_domain_get_recv_stats (DDS_CYCLONEDDS_HANDLE, &packets, &syscalls);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_ILLEGAL_OPERATION || rc == DDS_RETCODE_PRECONDITION_NOT_MET);
+
+  domain = dds_create_domain (1, config);
+  CU_ASSERT_FATAL (domain > 0);
+  pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  rc = dds_domain_get_recv_stats (pp, NULL, &syscalls);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_BAD_PARAMETER);
+
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    rc = dds_domain_get_recv_stats (pp, &packets, &syscalls);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+    if (packets == 0)
+      dds_sleepfor (DDS_MSECS (100));
+  } while (packets == 0 && dds_time () < tend);
+  CU_ASSERT (packets > 0);
+  CU_ASSERT (syscalls > 0);
+  rc = dds_domain_get_recv_stats (domain, &packets, &syscalls);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+
+  rc = dds_delete (domain);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+}
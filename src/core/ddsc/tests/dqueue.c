@@ -0,0 +1,189 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <limits.h>
+
+#include "dds/dds.h"
+#include "config_env.h"
+
+#include "dds__entity.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_radmin.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/ddsi_entity_index.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsrt/environ.h"
+
+#include "test_common.h"
+
+#define DDS_DOMAINID_PUB 0
+#define DDS_DOMAINID_SUB 1
+#define DDS_CONFIG_NO_PORT_GAIN "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
+/* Data of proxy writers with a transport priority below the threshold goes
+   through the delivery queues instead of being delivered synchronously */
+#define DDS_CONFIG_DQUEUES "<Internal><DeliveryQueueThreads>4</DeliveryQueueThreads><SynchronousDeliveryPriorityThreshold>1</SynchronousDeliveryPriorityThreshold></Internal>"
+
+#define NWRITERS 16
+#define NSAMPLES 100
+
+static dds_entity_t g_pub_domain = 0;
+static dds_entity_t g_pub_participant = 0;
+static dds_entity_t g_sub_domain = 0;
+static dds_entity_t g_sub_participant = 0;
+
+static void dqueue_init (void)
+{
+  /* Domains for pub and sub use a different domain id, but the portgain setting
+     in configuration is 0, so that both domains will map to the same port number.
+     This allows to create two domains in a single test process. */
+  char *conf_pub = ddsrt_expand_envvars (DDS_CONFIG_NO_PORT_GAIN, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars (DDS_CONFIG_NO_PORT_GAIN DDS_CONFIG_DQUEUES, DDS_DOMAINID_SUB);
+  g_pub_domain = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+  CU_ASSERT_FATAL (g_pub_domain > 0);
+  g_sub_domain = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (g_sub_domain > 0);
+  dds_free (conf_pub);
+  dds_free (conf_sub);
+
+  g_pub_participant = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+  CU_ASSERT_FATAL (g_pub_participant > 0);
+  g_sub_participant = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+  CU_ASSERT_FATAL (g_sub_participant > 0);
+}
+
+static void dqueue_fini (void)
+{
+  dds_delete (g_sub_domain);
+  dds_delete (g_pub_domain);
+}
+
+static bool all_matched (const dds_entity_t *writers, dds_entity_t reader)
+{
+  dds_subscription_matched_status_t sm;
+  CU_ASSERT_FATAL (dds_get_subscription_matched_status (reader, &sm) == 0);
+  if (sm.current_count != NWRITERS)
+    return false;
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    dds_publication_matched_status_t pm;
+    CU_ASSERT_FATAL (dds_get_publication_matched_status (writers[i], &pm) == 0);
+    if (pm.current_count != 1)
+      return false;
+  }
+  return true;
+}
+
+CU_Test(ddsc_dqueue, spread_over_threads, .init = dqueue_init, .fini = dqueue_fini, .timeout = 30)
+{
+  dds_entity_t pub_topic, sub_topic, reader, writers[NWRITERS];
+  dds_return_t rc;
+  char name[100];
+
+  create_unique_topic_name ("ddsc_dqueue_spread", name, sizeof (name));
+  pub_topic = dds_create_topic (g_pub_participant, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (pub_topic > 0);
+  sub_topic = dds_create_topic (g_sub_participant, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (sub_topic > 0);
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  reader = dds_create_reader (g_sub_participant, sub_topic, qos, NULL);
+  CU_ASSERT_FATAL (reader > 0);
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    writers[i] = dds_create_writer (g_pub_participant, pub_topic, qos, NULL);
+    CU_ASSERT_FATAL (writers[i] > 0);
+  }
+  dds_delete_qos (qos);
+
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (!all_matched (writers, reader) && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (all_matched (writers, reader));
+
+  /* Each writer gets its own proxy writer, these must be spread over more than
+     one of the user delivery queues */
+  struct dds_entity *rd_entity, *wr_entity;
+  rc = dds_entity_pin (reader, &rd_entity);
+  CU_ASSERT_FATAL (rc == 0);
+  struct ddsi_domaingv * const gv = &rd_entity->m_domain->gv;
+  CU_ASSERT_FATAL (gv->n_user_dqueues == 4);
+  bool used[4] = { false, false, false, false };
+  thread_state_awake (lookup_thread_state (), gv);
+  for (int i = 0; i < NWRITERS; i++)
+  {
+    rc = dds_entity_pin (writers[i], &wr_entity);
+    CU_ASSERT_FATAL (rc == 0);
+    struct proxy_writer *pwr = entidx_lookup_proxy_writer_guid (gv->entity_index, &wr_entity->m_guid);
+    dds_entity_unpin (wr_entity);
+    CU_ASSERT_FATAL (pwr != NULL);
+    uint32_t k;
+    for (k = 0; k < gv->n_user_dqueues && pwr->dqueue != gv->user_dqueues[k]; k++)
+      ;
+    CU_ASSERT_FATAL (k < gv->n_user_dqueues);
+    used[k] = true;
+  }
+  thread_state_asleep (lookup_thread_state ());
+  uint32_t nused = 0;
+  for (uint32_t k = 0; k < gv->n_user_dqueues; k++)
+    nused += used[k];
+  CU_ASSERT (nused > 1);
+
+  /* Interleave the writers so that all queues have work at the same time */
+  for (int32_t s = 1; s <= NSAMPLES; s++)
+  {
+    for (int32_t i = 0; i < NWRITERS; i++)
+    {
+      Space_Type1 sample = { i, s, 0 };
+      rc = dds_write (writers[i], &sample);
+      CU_ASSERT_FATAL (rc == 0);
+    }
+  }
+
+  /* The key is the writer, and the samples of each writer must arrive in order */
+  int32_t last[NWRITERS] = { 0 };
+  int32_t ntaken = 0, nout_of_order = 0;
+  tend = dds_time () + DDS_SECS (10);
+  while (ntaken < NWRITERS * NSAMPLES && dds_time () < tend)
+  {
+    void *raw[16] = { NULL };
+    dds_sample_info_t si[16];
+    int32_t n = dds_take (reader, raw, si, 16, 16);
+    CU_ASSERT_FATAL (n >= 0);
+    for (int32_t j = 0; j < n; j++)
+    {
+      const Space_Type1 *sample = raw[j];
+      CU_ASSERT_FATAL (si[j].valid_data);
+      CU_ASSERT_FATAL (sample->long_1 >= 0 && sample->long_1 < NWRITERS);
+      if (sample->long_2 != last[sample->long_1] + 1)
+        nout_of_order++;
+      last[sample->long_1] = sample->long_2;
+    }
+    ntaken += n;
+    (void) dds_return_loan (reader, raw, n);
+    if (n == 0)
+      dds_sleepfor (DDS_MSECS (10));
+  }
+  CU_ASSERT (ntaken == NWRITERS * NSAMPLES);
+  CU_ASSERT (nout_of_order == 0);
+
+  /* ... and the queues the proxy writers were assigned to must all have been used */
+  for (uint32_t k = 0; k < gv->n_user_dqueues; k++)
+  {
+    struct nn_dqueue_stats st;
+    nn_dqueue_get_stats (gv->user_dqueues[k], &st);
+    printf ("%s: max_nof_samples %"PRIu32" full %"PRIu32" throttled %"PRIu32"\n", st.name, st.max_nof_samples, st.nof_full, st.nof_throttled);
+    CU_ASSERT (used[k] == (st.max_nof_samples > 0));
+  }
+  dds_entity_unpin (rd_entity);
+}
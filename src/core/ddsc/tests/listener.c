@@ -330,17 +330,19 @@ CU_Test (ddsc_listener, matched)
   // - first: durability service history depth 1: 2nd write of 2 pushes
   //   the 1st write of it out of the history and only 2 samples arrive
   // - second: d.s. keep-all: both writes are kept and 3 samples arrive
+  // the retransmitted samples and the new one may be delivered as a single batch
+  // and so the number of data available invocations varies
   dotest ("sm da r(d=tl) pm w'(d=tl,h=1,ds=0/1) ; ?sm r ?pm w' ;"
           " wr w' 1 ; ?da r read{(1,0,0)} r ;"
           " deaf P' ; ?pm(1,0,0,-1,r) w' ; wr w' 2 wr w' 2 ;"
           " hearing P' ; ?pm(2,1,1,1,r) w' ; wr w' 3 ;"
-          " ?da(2) r read{s(1,0,0),f(2,0,0),f(3,0,0)} r ;"
+          " ?da r sleep 0.3 read{s(1,0,0),f(2,0,0),f(3,0,0)} r ;"
           " -w' ?sm r ?da r read(3,3) r");
   dotest ("sm da r(d=tl) pm w'(d=tl,h=1,ds=0/all) ; ?sm r ?pm w' ;"
           " wr w' 1 ; ?da r read{(1,0,0)} r ;"
           " deaf P' ; ?pm(1,0,0,-1,r) w' ; wr w' 2 wr w' 2 ;"
           " hearing P' ; ?pm(2,1,1,1,r) w' ; wr w' 3 ;"
-          " ?da(3) r read{s(1,0,0),f(2,0,0),f(2,0,0),f(3,0,0)} r ;"
+          " ?da r sleep 0.3 read{s(1,0,0),f(2,0,0),f(2,0,0),f(3,0,0)} r ;"
           " -w' ?sm r ?da r read(4,3) r");
 }
 
@@ -477,6 +479,13 @@ CU_Test (ddsc_listener, sample_rejected)
   dotest ("sr r(rl=1) ; wr w 0 wrfail w 0 wrfail w 0 ; ?sr r");
   dotest ("sr r(rl=1) ; wr w 0 wrfail w 0 ; read(1,0) r ; disp w 0 ; read(1,1) r ; ?sr r");
 
+  // remote writer: the receive thread retries until the reader has room, meanwhile
+  // the other reader must get each sample exactly once
+  dotest ("sm sr r(rl=1) pm w' ; ?sm r ?pm w' ; sm s ; ?sm s ?pm w' ;"
+          " wr w' 0 wr w' 1 wr w' 2 ; ?sr r take{(0,0,0)} r ;"
+          " sleep 0.3 take{(1,0,0)} r ; sleep 0.3 take{(2,0,0)} r ;"
+          " take{(0,0,0),(1,0,0),(2,0,0)} s");
+
   // best-effort: writes should succeed despite not delivering the data adding
   // the data in the RHC, also check number of samples rejected
   dotest ("sr r(rl=1,r=be) ; wr w(r=be) 0 wr w 0 wr w 0 ; ?sr(2,1,s) r");
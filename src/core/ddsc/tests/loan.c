@@ -323,3 +323,111 @@ CU_Test (ddsc_loan, read_cleanup, .init = create_entities, .fini = delete_entiti
   result = dds_return_loan (reader, ptrs, n);
   CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
 }
+
+/* struct Fixed { int32 id; int32 a; double x; }, keyed on id: the CDR
+   representation is the in-memory representation */
+struct fixed {
+  int32_t id;
+  int32_t a;
+  double x;
+};
+
+static const dds_topic_descriptor_t fixed_desc =
+{
+  .m_size = sizeof (struct fixed),
+  .m_align = 8u,
+  .m_flagset = DDS_TOPIC_FIXED_KEY,
+  .m_nkeys = 1,
+  .m_typename = "ddsc_loan_fixed",
+  .m_keys = (const dds_key_descriptor_t[]) { { "id", 0 } },
+  .m_nops = 4,
+  .m_ops = (const uint32_t[]) {
+    DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_SGN | DDS_OP_FLAG_KEY, offsetof (struct fixed, id),
+    DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_SGN, offsetof (struct fixed, a),
+    DDS_OP_ADR | DDS_OP_TYPE_8BY | DDS_OP_FLAG_FP, offsetof (struct fixed, x),
+    DDS_OP_RTS
+  },
+  .m_meta = ""
+};
+
+CU_Test (ddsc_loan, serdata, .init = create_entities, .fini = delete_entities)
+{
+  char topicname[100];
+  dds_return_t result;
+  const dds_entity_t tp = dds_create_topic (participant, &fixed_desc, create_unique_topic_name ("ddsc_loan_serdata", topicname, sizeof topicname), NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  const dds_entity_t wr = dds_create_writer (participant, tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (participant, tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  for (int32_t i = 0; i < 3; i++)
+  {
+    const struct fixed s = { .id = i, .a = 10 * i, .x = 0.5 * i };
+    result = dds_write (wr, &s);
+    CU_ASSERT_FATAL (result == 0);
+  }
+
+  struct ddsi_serdata *sds[3] = { NULL };
+  dds_sample_info_t si[3];
+  int32_t n = dds_readcdr (rd, sds, 3, si, 0);
+  CU_ASSERT_FATAL (n == 3);
+  for (int32_t i = 0; i < n; i++)
+  {
+    /* the view points into the stored sample, so reading twice gives the same address */
+    const struct fixed *v = dds_serdata_view (sds[i]);
+    CU_ASSERT_FATAL (v != NULL);
+    CU_ASSERT (v->id == i && v->a == 10 * i && v->x == 0.5 * i);
+    double x;
+    result = dds_serdata_get_field (sds[i], offsetof (struct fixed, x), &x);
+    CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+    CU_ASSERT (x == 0.5 * i);
+    result = dds_serdata_get_field (sds[i], offsetof (struct fixed, x) + 1, &x);
+    CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+    struct fixed s;
+    result = dds_serdata_to_sample (sds[i], &s);
+    CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+    CU_ASSERT (s.id == i && s.a == 10 * i && s.x == 0.5 * i);
+  }
+  const void *v0 = dds_serdata_view (sds[0]);
+  result = dds_return_serdata_loan (sds, n);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (sds[0] == NULL && sds[1] == NULL && sds[2] == NULL);
+
+  /* read doesn't copy the samples, and a sample without valid data has no type */
+  result = dds_dispose (wr, &(struct fixed){ .id = 7 });
+  CU_ASSERT_FATAL (result == 0);
+  struct ddsi_serdata *sds4[4] = { NULL };
+  dds_sample_info_t si4[4];
+  n = dds_takecdr (rd, sds4, 4, si4, 0);
+  CU_ASSERT_FATAL (n == 4);
+  int ninvalid = 0, nv0 = 0;
+  for (int32_t i = 0; i < n; i++)
+  {
+    if (si4[i].valid_data)
+    {
+      nv0 += (dds_serdata_view (sds4[i]) == v0);
+      continue;
+    }
+    ninvalid++;
+    CU_ASSERT (dds_serdata_view (sds4[i]) == NULL);
+    CU_ASSERT (dds_serdata_get_field (sds4[i], offsetof (struct fixed, x), &(double){0}) == DDS_RETCODE_PRECONDITION_NOT_MET);
+    CU_ASSERT (dds_serdata_to_sample (sds4[i], &(struct fixed){0}) == DDS_RETCODE_PRECONDITION_NOT_MET);
+  }
+  CU_ASSERT (ninvalid == 1 && nv0 == 1);
+  result = dds_return_serdata_loan (sds4, n);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  n = dds_takecdr (rd, sds, 3, si, 0);
+  CU_ASSERT_FATAL (n == 0);
+
+  /* a type with a sequence can't be viewed */
+  const RoundTripModule_DataType s = { .payload = { ._length = 1, ._buffer = (uint8_t[]) { 'a' } } };
+  result = dds_write (writer, &s);
+  CU_ASSERT_FATAL (result == 0);
+  n = dds_takecdr (reader, sds, 1, si, 0);
+  CU_ASSERT_FATAL (n == 1);
+  CU_ASSERT (dds_serdata_view (sds[0]) == NULL);
+  result = dds_return_serdata_loan (sds, n);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  result = dds_return_serdata_loan (NULL, 1);
+  CU_ASSERT (result == DDS_RETCODE_BAD_PARAMETER);
+}
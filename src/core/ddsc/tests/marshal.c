@@ -0,0 +1,257 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+#include "CUnit/Test.h"
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
+#include "MarshalTypes.h"
+
+/* MarshalTypes.idl is compiled with "idlc -genmarshal", so its descriptors have
+   both the marshalling ops and the generated (de)serializers.  A topic with the
+   generated functions and one without them using the same descriptor must give
+   identical results. */
+
+static void init_topic (struct ddsi_sertopic_default *tp, const dds_topic_descriptor_t *desc, bool generated)
+{
+    memset (tp, 0, sizeof (*tp));
+    tp->type.m_size = desc->m_size;
+    tp->type.m_align = desc->m_align;
+    tp->type.m_flagset = generated ? desc->m_flagset : (desc->m_flagset & ~(uint32_t) DDS_TOPIC_GENERATED_OPS);
+    tp->type.m_nkeys = desc->m_nkeys;
+    tp->type.m_keys = (desc->m_nkeys > 0) ? ddsrt_malloc (desc->m_nkeys * sizeof (*tp->type.m_keys)) : NULL;
+    for (uint32_t i = 0; i < desc->m_nkeys; i++)
+        tp->type.m_keys[i] = desc->m_keys[i].m_index;
+    tp->type.m_ops = (uint32_t *) desc->m_ops;
+    tp->type.m_nops = dds_stream_countops (desc->m_ops);
+    tp->type.m_marshal = generated ? desc->m_marshal : NULL;
+    tp->opt_size = 0;
+}
+
+static void fini_topic (struct ddsi_sertopic_default *tp)
+{
+    ddsrt_free (tp->type.m_keys);
+}
+
+static void random_string (char *buf, size_t size, ddsrt_prng_t *prng)
+{
+    const size_t len = ddsrt_prng_random (prng) % size;
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (char) ('a' + ddsrt_prng_random (prng) % 26);
+    buf[len] = 0;
+}
+
+static void random_longseq (MarshalTypes_LongSeq *seq, ddsrt_prng_t *prng)
+{
+    seq->_length = seq->_maximum = ddsrt_prng_random (prng) % 8;
+    seq->_buffer = dds_alloc (seq->_length * sizeof (*seq->_buffer) + 1);
+    seq->_release = true;
+    for (uint32_t i = 0; i < seq->_length; i++)
+        seq->_buffer[i] = (int32_t) ddsrt_prng_random (prng);
+}
+
+static void random_pos (MarshalTypes_Pos *pos, ddsrt_prng_t *prng)
+{
+    pos->x = (double) ddsrt_prng_random (prng) / 3.0;
+    pos->y = (double) ddsrt_prng_random (prng) / 5.0;
+    pos->z = (double) ddsrt_prng_random (prng) / 7.0;
+}
+
+static void random_nested (void *vs, ddsrt_prng_t *prng)
+{
+    MarshalTypes_Nested *s = vs;
+    char buf[32];
+    memset (s, 0, sizeof (*s));
+    random_string (buf, sizeof (buf), prng);
+    s->label = dds_string_dup (buf);
+    s->id.unit = (uint8_t) ddsrt_prng_random (prng);
+    random_string (s->id.name, sizeof (s->id.name), prng);
+    s->id.site = (int32_t) ddsrt_prng_random (prng);
+    random_pos (&s->pos, prng);
+    s->seq = (uint16_t) ddsrt_prng_random (prng);
+    for (uint32_t i = 0; i < 3; i++)
+        s->arr[i] = (int16_t) ddsrt_prng_random (prng);
+    for (uint32_t i = 0; i < 2; i++)
+        random_pos (&s->path[i], prng);
+    random_longseq (&s->values, prng);
+}
+
+#define TELEMETRY_GROUPS(G) \
+    G(0)  G(1)  G(2)  G(3)  G(4)  G(5)  G(6)  G(7)  G(8)  G(9)  \
+    G(10) G(11) G(12) G(13) G(14) G(15) G(16) G(17) G(18) G(19) \
+    G(20) G(21) G(22) G(23) G(24) G(25) G(26) G(27) G(28) G(29) \
+    G(30) G(31) G(32) G(33) G(34) G(35) G(36) G(37) G(38) G(39)
+
+static void random_telemetry (void *vs, ddsrt_prng_t *prng)
+{
+    MarshalTypes_Telemetry *s = vs;
+    char buf[32];
+    memset (s, 0, sizeof (*s));
+    random_string (buf, sizeof (buf), prng);
+    s->source = dds_string_dup (buf);
+    random_pos (&s->pos, prng);
+    s->id = (int32_t) ddsrt_prng_random (prng);
+#define TELEMETRY_INIT(n) \
+    s->l##n = (int32_t) ddsrt_prng_random (prng); \
+    s->d##n = (double) ddsrt_prng_random (prng) / 7.0; \
+    s->s##n = (int16_t) ddsrt_prng_random (prng); \
+    s->o##n = (uint8_t) ddsrt_prng_random (prng); \
+    s->f##n = (float) ddsrt_prng_random (prng) / 3.0f;
+    TELEMETRY_GROUPS (TELEMETRY_INIT)
+#undef TELEMETRY_INIT
+    for (uint32_t i = 0; i < 9; i++)
+        s->cov[i] = (float) ddsrt_prng_random (prng) / 11.0f;
+    random_longseq (&s->samples, prng);
+}
+
+static void check_equivalence (const dds_topic_descriptor_t *desc, void (*random_sample) (void *s, ddsrt_prng_t *prng))
+{
+    struct ddsi_sertopic_default tpi, tpg;
+    ddsrt_prng_t prng;
+    CU_ASSERT_FATAL ((desc->m_flagset & DDS_TOPIC_GENERATED_OPS) && desc->m_marshal != NULL);
+    init_topic (&tpi, desc, false);
+    init_topic (&tpg, desc, true);
+    ddsrt_prng_init_simple (&prng, ddsrt_random ());
+    void *s = ddsrt_malloc (desc->m_size);
+    void *ri = ddsrt_calloc (1, desc->m_size);
+    void *rg = ddsrt_calloc (1, desc->m_size);
+    for (int iter = 0; iter < 100; iter++)
+    {
+        dds_ostream_t osi, osg, oki, okg;
+        dds_istream_t is;
+        random_sample (s, &prng);
+
+        /* identical serialized form */
+        dds_ostream_init (&osi, 0);
+        dds_ostream_init (&osg, 0);
+        dds_stream_write_sample (&osi, s, &tpi);
+        dds_stream_write_sample (&osg, s, &tpg);
+        CU_ASSERT_FATAL (osi.m_index == osg.m_index);
+        CU_ASSERT_FATAL (memcmp (osi.m_buffer, osg.m_buffer, osi.m_index) == 0);
+
+        /* identical key, both from the sample and from the serialized form */
+        dds_ostream_init (&oki, 0);
+        dds_ostream_init (&okg, 0);
+        dds_stream_write_key (&oki, s, &tpi);
+        dds_stream_write_key (&okg, s, &tpg);
+        CU_ASSERT_FATAL (oki.m_index == okg.m_index && memcmp (oki.m_buffer, okg.m_buffer, oki.m_index) == 0);
+        okg.m_index = 0;
+        is.m_buffer = osg.m_buffer; is.m_size = osg.m_index; is.m_index = 0;
+        dds_stream_extract_key_from_data (&is, &okg, &tpg);
+        CU_ASSERT_FATAL (oki.m_index == okg.m_index && memcmp (oki.m_buffer, okg.m_buffer, oki.m_index) == 0);
+        dds_ostream_fini (&oki);
+        dds_ostream_fini (&okg);
+
+        /* validation accepts the data and rejects any truncation of it, and
+           byte-swapping does the same thing to the data */
+        CU_ASSERT_FATAL (dds_stream_normalize (osi.m_buffer, osi.m_index, false, &tpi, false));
+        CU_ASSERT_FATAL (dds_stream_normalize (osg.m_buffer, osg.m_index, false, &tpg, false));
+        for (uint32_t size = 0; size < osi.m_index; size++)
+        {
+            CU_ASSERT_FATAL (!dds_stream_normalize (osi.m_buffer, size, false, &tpi, false));
+            CU_ASSERT_FATAL (!dds_stream_normalize (osg.m_buffer, size, false, &tpg, false));
+        }
+        {
+            char *bi = ddsrt_memdup (osi.m_buffer, osi.m_index);
+            char *bg = ddsrt_memdup (osg.m_buffer, osg.m_index);
+            const bool swapi = dds_stream_normalize (bi, osi.m_index, true, &tpi, false);
+            const bool swapg = dds_stream_normalize (bg, osg.m_index, true, &tpg, false);
+            CU_ASSERT_FATAL (swapi == swapg);
+            CU_ASSERT_FATAL (memcmp (bi, bg, osi.m_index) == 0);
+            ddsrt_free (bi);
+            ddsrt_free (bg);
+        }
+
+        /* reading gives back the original, also when reusing a sample: the types
+           have padding, so compare by serializing the result */
+        for (int k = 0; k < 2; k++)
+        {
+            dds_ostream_t os;
+            is.m_buffer = osi.m_buffer; is.m_size = osi.m_index; is.m_index = 0;
+            dds_stream_read_sample (&is, ri, &tpi);
+            CU_ASSERT_FATAL (is.m_index == osi.m_index);
+            is.m_buffer = osg.m_buffer; is.m_size = osg.m_index; is.m_index = 0;
+            dds_stream_read_sample (&is, rg, &tpg);
+            CU_ASSERT_FATAL (is.m_index == osg.m_index);
+            dds_ostream_init (&os, 0);
+            dds_stream_write_sample (&os, rg, &tpi);
+            CU_ASSERT_FATAL (os.m_index == osi.m_index && memcmp (os.m_buffer, osi.m_buffer, os.m_index) == 0);
+            os.m_index = 0;
+            dds_stream_write_sample (&os, ri, &tpg);
+            CU_ASSERT_FATAL (os.m_index == osi.m_index && memcmp (os.m_buffer, osi.m_buffer, os.m_index) == 0);
+            dds_ostream_fini (&os);
+        }
+        dds_sample_free (s, desc, DDS_FREE_CONTENTS);
+        dds_ostream_fini (&osi);
+        dds_ostream_fini (&osg);
+    }
+    dds_sample_free (ri, desc, DDS_FREE_ALL);
+    dds_sample_free (rg, desc, DDS_FREE_ALL);
+    ddsrt_free (s);
+    fini_topic (&tpi);
+    fini_topic (&tpg);
+}
+
+CU_Test(ddsc_marshal, nested_keys)
+{
+    check_equivalence (&MarshalTypes_Nested_desc, random_nested);
+}
+
+CU_Test(ddsc_marshal, telemetry)
+{
+    check_equivalence (&MarshalTypes_Telemetry_desc, random_telemetry);
+}
+
+CU_Test(ddsc_marshal, bench_telemetry, .timeout = 300)
+{
+    const int n = 100000;
+    struct ddsi_sertopic_default tp[2];
+    ddsrt_prng_t prng;
+    MarshalTypes_Telemetry s, r;
+    init_topic (&tp[0], &MarshalTypes_Telemetry_desc, false);
+    init_topic (&tp[1], &MarshalTypes_Telemetry_desc, true);
+    ddsrt_prng_init_simple (&prng, ddsrt_random ());
+    random_telemetry (&s, &prng);
+    memset (&r, 0, sizeof (r));
+    for (int g = 0; g < 2; g++)
+    {
+        dds_ostream_t os;
+        dds_istream_t is;
+        dds_ostream_init (&os, 0);
+        const dds_time_t t0 = dds_time ();
+        for (int i = 0; i < n; i++)
+        {
+            os.m_index = 0;
+            dds_stream_write_sample (&os, &s, &tp[g]);
+        }
+        const dds_time_t t1 = dds_time ();
+        for (int i = 0; i < n; i++)
+        {
+            is.m_buffer = os.m_buffer; is.m_size = os.m_index; is.m_index = 0;
+            dds_stream_read_sample (&is, &r, &tp[g]);
+        }
+        const dds_time_t t2 = dds_time ();
+        printf ("%s: %"PRIu32" bytes, write %.1f ns, read %.1f ns\n", g ? "generated" : "interpreted",
+                os.m_index, (double) (t1 - t0) / n, (double) (t2 - t1) / n);
+        dds_ostream_fini (&os);
+    }
+    dds_sample_free (&s, &MarshalTypes_Telemetry_desc, DDS_FREE_CONTENTS);
+    dds_sample_free (&r, &MarshalTypes_Telemetry_desc, DDS_FREE_CONTENTS);
+    fini_topic (&tp[0]);
+    fini_topic (&tp[1]);
+}
@@ -10,6 +10,7 @@
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
 #include <assert.h>
+#include <stdio.h>
 #include <limits.h>
 
 #include "dds/dds.h"
@@ -723,3 +724,52 @@ CU_Test(ddsc_unregister_instance_ts, dispose_unregistered_sample, .init=unregist
 /*************************************************************************************************/
 
 #endif
+
+/*************************************************************************************************/
+/* Unregistering 500k instances by instance handle.  The writer's history keeps the instances
+   alive, and the instance handles are looked up in the instance id index of the key-to-instance
+   map, so the cost per unregister should not depend on the number of instances. */
+CU_Test(ddsc_unregister_instance_ih, bench_many_instances, .timeout = 300)
+{
+    const uint32_t n = 500000;
+    dds_instance_handle_t *ihs;
+    Space_Type1 testData = { 0, 0, 0 };
+    dds_qos_t *qos;
+    dds_return_t ret;
+    char name[100];
+
+    g_participant = dds_create_participant(DDS_DOMAIN_DEFAULT, NULL, NULL);
+    CU_ASSERT_FATAL(g_participant > 0);
+    g_topic = dds_create_topic(g_participant, &Space_Type1_desc, create_unique_topic_name("ddsc_unregistering_bench", name, 100), NULL, NULL);
+    CU_ASSERT_FATAL(g_topic > 0);
+    qos = dds_create_qos();
+    dds_qset_durability(qos, DDS_DURABILITY_TRANSIENT_LOCAL);
+    dds_qset_history(qos, DDS_HISTORY_KEEP_LAST, 1);
+    dds_qset_writer_data_lifecycle(qos, false);
+    g_writer = dds_create_writer(g_participant, g_topic, qos, NULL);
+    CU_ASSERT_FATAL(g_writer > 0);
+    dds_delete_qos(qos);
+
+    ihs = dds_alloc(n * sizeof(*ihs));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        testData.long_1 = (int32_t) i;
+        ret = dds_write(g_writer, &testData);
+        CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+        ihs[i] = dds_lookup_instance(g_writer, &testData);
+        CU_ASSERT_NOT_EQUAL_FATAL(ihs[i], DDS_HANDLE_NIL);
+    }
+
+    const dds_time_t t0 = dds_time();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        ret = dds_unregister_instance_ih(g_writer, ihs[i]);
+        CU_ASSERT_EQUAL_FATAL(ret, DDS_RETCODE_OK);
+    }
+    const dds_time_t t1 = dds_time();
+    printf("unregister %u instances by handle: %.1f ns/unregister\n", n, (double) (t1 - t0) / n);
+
+    dds_free(ihs);
+    dds_delete(g_participant);
+}
+/*************************************************************************************************/
@@ -19,13 +19,19 @@
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_whc.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_serdata.h"
 #include "dds__entity.h"
+#include "dds__topic.h"
+#include "dds__whc.h"
+#include "dds__whc_ring.h"
 
 #include "test_common.h"
 
 #define DDS_DOMAINID_PUB 0
 #define DDS_DOMAINID_SUB 1
 #define DDS_CONFIG_NO_PORT_GAIN "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
+#define DDS_CONFIG_WHC_RING "<Internal><WhcRing>true</WhcRing></Internal>"
 #define DDS_CONFIG_NO_PORT_GAIN_LOG "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Tracing><OutputFile>cyclonedds_whc_test.${CYCLONEDDS_DOMAIN_ID}.${CYCLONEDDS_PID}.log</OutputFile><Verbosity>finest</Verbosity></Tracing><Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>"
 
 #define SAMPLE_COUNT 5
@@ -40,13 +46,13 @@ static dds_entity_t g_remote_domain        = 0;
 static dds_entity_t g_remote_participant   = 0;
 static dds_entity_t g_remote_subscriber    = 0;
 
-static void whc_init(void)
+static void whc_init_config(const char *config)
 {
   /* Domains for pub and sub use a different domain id, but the portgain setting
          * in configuration is 0, so that both domains will map to the same port number.
          * This allows to create two domains in a single test process. */
-  char *conf_pub = ddsrt_expand_envvars(DDS_CONFIG_NO_PORT_GAIN, DDS_DOMAINID_PUB);
-  char *conf_sub = ddsrt_expand_envvars(DDS_CONFIG_NO_PORT_GAIN, DDS_DOMAINID_SUB);
+  char *conf_pub = ddsrt_expand_envvars(config, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars(config, DDS_DOMAINID_SUB);
   g_domain = dds_create_domain(DDS_DOMAINID_PUB, conf_pub);
   g_remote_domain = dds_create_domain(DDS_DOMAINID_SUB, conf_sub);
   dds_free(conf_pub);
@@ -70,6 +76,16 @@ static void whc_init(void)
   CU_ASSERT_FATAL(g_publisher > 0);
 }
 
+static void whc_init(void)
+{
+  whc_init_config(DDS_CONFIG_NO_PORT_GAIN);
+}
+
+static void whc_init_ring(void)
+{
+  whc_init_config(DDS_CONFIG_NO_PORT_GAIN DDS_CONFIG_WHC_RING);
+}
+
 static void whc_fini (void)
 {
   dds_delete_qos(g_qos);
@@ -245,7 +261,7 @@ static void test_whc_end_state(dds_durability_kind_t d, dds_reliability_kind_t r
 }
 
 #define ARRAY_LEN(A) ((int32_t)(sizeof(A) / sizeof(A[0])))
-CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
+static void test_whc_end_state_all(bool volatile_only)
 {
   dds_durability_kind_t dur[] = {V, TL};
   dds_reliability_kind_t rel[] = {BE, R};
@@ -278,6 +294,8 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
                       {
                         if (rel[i_r] == BE && dur[i_d] == TL)
                           continue;
+                        else if (volatile_only && dur[i_d] != V)
+                          continue;
                         else if (hist[i_h] == KA && i_hd > 0)
                           continue;
                         else if (dhist[i_dh] == KA && i_dhd > 0)
@@ -290,6 +308,17 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
                       }
 }
 
+CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
+{
+  test_whc_end_state_all(false);
+}
+
+CU_Test(ddsc_whc, check_end_state_ring, .init=whc_init_ring, .fini=whc_fini, .timeout=30)
+{
+  /* the ring WHC is only used for volatile writers */
+  test_whc_end_state_all(true);
+}
+
 #undef ARRAY_LEN
 #undef V
 #undef TL
@@ -297,3 +326,101 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
 #undef BE
 #undef KA
 #undef KL
+
+/* Micro-benchmark comparing the default and the ring WHC for a reliable KEEP_ALL
+   writer with a window of unacknowledged samples: every batch of samples is
+   followed by some retransmits and an acknowledgement of the oldest batch */
+#define WHC_BENCH_NSAMPLES 1000000
+#define WHC_BENCH_WINDOW 1000
+#define WHC_BENCH_BATCH 50
+#define WHC_BENCH_REXMITS 10
+#define WHC_BENCH_NKEYS 16
+
+static void whc_bench (const char *name, struct whc *whc, struct ddsi_serdata **sd, struct ddsi_tkmap_instance **tk)
+{
+  dds_duration_t t_insert = 0, t_borrow = 0, t_ack = 0;
+  uint32_t nborrowed = 0, nacked = 0;
+  seqno_t seq = 0, max_drop_seq = 0;
+  uint32_t rnd = 1;
+  while (seq < WHC_BENCH_NSAMPLES)
+  {
+    dds_time_t t0 = dds_time ();
+    for (int i = 0; i < WHC_BENCH_BATCH; i++)
+    {
+      seq++;
+      whc_insert (whc, max_drop_seq, seq, DDSRT_MTIME_NEVER, NULL, sd[seq % WHC_BENCH_NKEYS], tk[seq % WHC_BENCH_NKEYS]);
+    }
+    dds_time_t t1 = dds_time ();
+    for (int i = 0; i < WHC_BENCH_REXMITS; i++)
+    {
+      struct whc_borrowed_sample sample;
+      rnd = rnd * 1103515245u + 12345u;
+      if (whc_borrow_sample (whc, max_drop_seq + 1 + (seqno_t) ((rnd >> 8) % (uint32_t) (seq - max_drop_seq)), &sample))
+      {
+        sample.rexmit_count++;
+        whc_return_sample (whc, &sample, true);
+        nborrowed++;
+      }
+    }
+    dds_time_t t2 = dds_time ();
+    if (seq > WHC_BENCH_WINDOW)
+    {
+      struct whc_node *deferred_free_list;
+      struct whc_state whcst;
+      max_drop_seq = seq - WHC_BENCH_WINDOW;
+      nacked += whc_remove_acked_messages (whc, max_drop_seq, &whcst, &deferred_free_list);
+      whc_free_deferred_free_list (whc, deferred_free_list);
+      CU_ASSERT (whcst.min_seq == max_drop_seq + 1 && whcst.max_seq == seq);
+    }
+    dds_time_t t3 = dds_time ();
+    t_insert += t1 - t0;
+    t_borrow += t2 - t1;
+    t_ack += t3 - t2;
+  }
+  CU_ASSERT (nborrowed == WHC_BENCH_NSAMPLES / WHC_BENCH_BATCH * WHC_BENCH_REXMITS);
+  CU_ASSERT (nacked == WHC_BENCH_NSAMPLES - WHC_BENCH_WINDOW);
+  printf ("whc %s: insert %.1f ns/sample, borrow+return %.1f ns/sample, ack %.1f ns/sample\n", name,
+          (double) t_insert / WHC_BENCH_NSAMPLES, (double) t_borrow / nborrowed, (double) t_ack / nacked);
+  whc_free (whc);
+}
+
+CU_Test(ddsc_whc, bench, .init=whc_init, .fini=whc_fini, .timeout=120)
+{
+  struct ddsi_serdata *sd[WHC_BENCH_NKEYS];
+  struct ddsi_tkmap_instance *tk[WHC_BENCH_NKEYS];
+  struct dds_topic *tp;
+  char name[100];
+  dds_return_t ret;
+
+  create_unique_topic_name ("ddsc_whc_bench", name, sizeof name);
+  dds_entity_t topic = dds_create_topic (g_participant, &Space_Type1_desc, name, NULL, NULL);
+  CU_ASSERT_FATAL (topic > 0);
+  ret = dds_topic_pin (topic, &tp);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_OK);
+  struct ddsi_domaingv * const gv = &tp->m_entity.m_domain->gv;
+  thread_state_awake (lookup_thread_state (), gv);
+  for (int32_t k = 0; k < WHC_BENCH_NKEYS; k++)
+  {
+    Space_Type1 sample = { k, 0, 0 };
+    sd[k] = ddsi_serdata_from_sample (tp->m_stopic, SDK_DATA, &sample);
+    tk[k] = ddsi_tkmap_lookup_instance_ref (gv->m_tkmap, sd[k]);
+  }
+
+  dds_qset_durability (g_qos, DDS_DURABILITY_VOLATILE);
+  dds_qset_history (g_qos, DDS_HISTORY_KEEP_ALL, 0);
+  dds_qset_deadline (g_qos, DDS_INFINITY);
+  dds_qset_durability_service (g_qos, 0, DDS_HISTORY_KEEP_LAST, 1, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  struct whc_writer_info *wrinfo = whc_make_wrinfo (NULL, g_qos);
+  whc_bench ("default", whc_new (gv, wrinfo), sd, tk);
+  whc_bench ("ring", whc_ring_new (gv, 0), sd, tk);
+  whc_free_wrinfo (wrinfo);
+
+  for (int32_t k = 0; k < WHC_BENCH_NKEYS; k++)
+  {
+    ddsi_tkmap_instance_unref (gv->m_tkmap, tk[k]);
+    ddsi_serdata_unref (sd[k]);
+  }
+  thread_state_asleep (lookup_thread_state ());
+  dds_topic_unpin (tp);
+  dds_delete (topic);
+}
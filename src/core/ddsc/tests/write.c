@@ -16,6 +16,8 @@
 #include "RoundTrip.h"
 #include "Space.h"
 #include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/threads.h"
 
 /* Tests in this file only concern themselves with very basic api tests of
    dds_write and dds_write_ts */
@@ -158,3 +160,129 @@ CU_Test(ddsc_write, simpletypes)
     dds_delete(top);
     dds_delete(par);
 }
+
+/* Writing to a topic with a string key, first creating 1M instances, then
+   updating them. The key does not fit in a keyhash, so each write hashes the
+   serialised key for the instance lookup. */
+CU_Test(ddsc_write, bench_string_key, .timeout = 300)
+{
+    const uint32_t n = 1000000;
+    dds_entity_t par, top, wri;
+    dds_qos_t *qos;
+    char key[32];
+    Space_simpletypes st_data;
+
+    par = dds_create_participant(DDS_DOMAIN_DEFAULT, NULL, NULL);
+    CU_ASSERT_FATAL(par > 0);
+    top = dds_create_topic(par, &Space_simpletypes_desc, "SimpleTypesBench", NULL, NULL);
+    CU_ASSERT_FATAL(top > 0);
+    qos = dds_create_qos();
+    dds_qset_reliability(qos, DDS_RELIABILITY_BEST_EFFORT, 0);
+    wri = dds_create_writer(par, top, qos, NULL);
+    CU_ASSERT_FATAL(wri > 0);
+    dds_delete_qos(qos);
+
+    memset(&st_data, 0, sizeof(st_data));
+    st_data.s = key;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const dds_time_t t0 = dds_time();
+        for (uint32_t i = 0; i < n; i++)
+        {
+            snprintf(key, sizeof(key), "sensor/instance-%07u", i);
+            st_data.l = pass;
+            CU_ASSERT_EQUAL_FATAL(dds_write(wri, &st_data), DDS_RETCODE_OK);
+        }
+        const dds_time_t t1 = dds_time();
+        printf("%s %u string-keyed instances: %.1f ns/write\n", pass == 0 ? "create" : "update", n, (double) (t1 - t0) / n);
+    }
+
+    dds_delete(wri);
+    dds_delete(top);
+    dds_delete(par);
+}
+
+/* Every dds_write and dds_take starts by looking up and pinning the entity handle,
+   so with each thread writing and taking on its own writer and reader, throughput
+   should scale with the number of threads rather than be limited by contention on
+   the handle table. */
+#define MT_BENCH_MAX_THREADS 16
+#define MT_BENCH_ITERATIONS 20000
+
+struct mt_bench_arg {
+    dds_entity_t wri, rd;
+    ddsrt_atomic_uint32_t *start;
+    uint32_t id;
+};
+
+static uint32_t mt_bench_thread(void *varg)
+{
+    struct mt_bench_arg * const arg = varg;
+    Space_Type1 sample = { (int32_t) arg->id, 0, 0 };
+    void *ptrs[1] = { NULL };
+    dds_sample_info_t si;
+    uint32_t errs = 0;
+    while (ddsrt_atomic_ld32(arg->start) == 0)
+        dds_sleepfor(DDS_MSECS(1));
+    for (int32_t i = 0; i < MT_BENCH_ITERATIONS; i++)
+    {
+        sample.long_2 = i;
+        if (dds_write(arg->wri, &sample) != DDS_RETCODE_OK)
+            errs++;
+        if (dds_take(arg->rd, ptrs, &si, 1, 1) != 1)
+            errs++;
+    }
+    dds_return_loan(arg->rd, ptrs, 1);
+    return errs;
+}
+
+CU_Test(ddsc_write, bench_multithreaded_write_take, .timeout = 300)
+{
+    struct mt_bench_arg args[MT_BENCH_MAX_THREADS];
+    ddsrt_thread_t tids[MT_BENCH_MAX_THREADS];
+    ddsrt_threadattr_t tattr;
+    ddsrt_atomic_uint32_t start;
+    dds_entity_t par;
+    dds_qos_t *qos;
+    char name[32];
+
+    par = dds_create_participant(DDS_DOMAIN_DEFAULT, NULL, NULL);
+    CU_ASSERT_FATAL(par > 0);
+    qos = dds_create_qos();
+    dds_qset_reliability(qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+    dds_qset_history(qos, DDS_HISTORY_KEEP_LAST, 1);
+    for (uint32_t i = 0; i < MT_BENCH_MAX_THREADS; i++)
+    {
+        snprintf(name, sizeof(name), "MTWriteTakeBench%u", i);
+        dds_entity_t top = dds_create_topic(par, &Space_Type1_desc, name, NULL, NULL);
+        CU_ASSERT_FATAL(top > 0);
+        args[i].wri = dds_create_writer(par, top, qos, NULL);
+        CU_ASSERT_FATAL(args[i].wri > 0);
+        args[i].rd = dds_create_reader(par, top, qos, NULL);
+        CU_ASSERT_FATAL(args[i].rd > 0);
+        args[i].start = &start;
+        args[i].id = i;
+    }
+    dds_delete_qos(qos);
+
+    ddsrt_threadattr_init(&tattr);
+    for (uint32_t nthreads = 1; nthreads <= MT_BENCH_MAX_THREADS; nthreads *= 2)
+    {
+        ddsrt_atomic_st32(&start, 0);
+        for (uint32_t i = 0; i < nthreads; i++)
+            CU_ASSERT_EQUAL_FATAL(ddsrt_thread_create(&tids[i], "mt_bench", &tattr, mt_bench_thread, &args[i]), DDS_RETCODE_OK);
+        const dds_time_t t0 = dds_time();
+        ddsrt_atomic_st32(&start, 1);
+        for (uint32_t i = 0; i < nthreads; i++)
+        {
+            uint32_t errs;
+            CU_ASSERT_EQUAL_FATAL(ddsrt_thread_join(tids[i], &errs), DDS_RETCODE_OK);
+            CU_ASSERT_EQUAL(errs, 0);
+        }
+        const dds_time_t t1 = dds_time();
+        const double nops = 2.0 * nthreads * MT_BENCH_ITERATIONS;
+        printf("%2u threads: %.0f write+take operations/s\n", nthreads, nops / ((double) (t1 - t0) / 1e9));
+    }
+
+    dds_delete(par);
+}
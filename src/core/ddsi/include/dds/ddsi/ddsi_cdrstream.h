@@ -12,6 +12,9 @@
 #ifndef DDSI_CDRSTREAM_H
 #define DDSI_CDRSTREAM_H
 
+#include <assert.h>
+#include <string.h>
+
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds/ddsi/ddsi_serdata_default.h"
 
@@ -39,27 +42,254 @@ DDS_EXPORT void dds_ostream_init (dds_ostream_t * __restrict st, uint32_t size);
 DDS_EXPORT void dds_ostream_fini (dds_ostream_t * __restrict st);
 DDS_EXPORT void dds_ostreamBE_init (dds_ostreamBE_t * __restrict st, uint32_t size);
 DDS_EXPORT void dds_ostreamBE_fini (dds_ostreamBE_t * __restrict st);
+DDS_EXPORT void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size);
+
+/* Primitives for reading and writing (native-endian) CDR, these are used by
+   the interpreter below as well as by the type-specific (de)serializers that
+   idlc generates with the -genmarshal option */
+
+DDS_EXPORT inline void dds_cdr_resize (dds_ostream_t * __restrict s, uint32_t l)
+{
+  if (s->m_size < l + s->m_index)
+    dds_ostream_grow (s, l);
+}
+
+DDS_EXPORT inline void dds_cdr_alignto (dds_istream_t * __restrict s, uint32_t a)
+{
+  s->m_index = (s->m_index + a - 1) & ~(a - 1);
+  assert (s->m_index < s->m_size);
+}
+
+DDS_EXPORT inline uint32_t dds_cdr_alignto_clear_and_resize (dds_ostream_t * __restrict s, uint32_t a, uint32_t extra)
+{
+  const uint32_t m = s->m_index % a;
+  if (m == 0)
+  {
+    dds_cdr_resize (s, extra);
+    return 0;
+  }
+  else
+  {
+    const uint32_t pad = a - m;
+    dds_cdr_resize (s, pad + extra);
+    for (uint32_t i = 0; i < pad; i++)
+      s->m_buffer[s->m_index++] = 0;
+    return pad;
+  }
+}
+
+DDS_EXPORT inline uint8_t dds_is_get1 (dds_istream_t * __restrict s)
+{
+  assert (s->m_index < s->m_size);
+  uint8_t v = *(s->m_buffer + s->m_index);
+  s->m_index++;
+  return v;
+}
+
+DDS_EXPORT inline uint16_t dds_is_get2 (dds_istream_t * __restrict s)
+{
+  dds_cdr_alignto (s, 2);
+  uint16_t v = * ((uint16_t *) (s->m_buffer + s->m_index));
+  s->m_index += 2;
+  return v;
+}
 
-bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, const struct ddsi_sertopic_default * __restrict topic, bool just_key);
+DDS_EXPORT inline uint32_t dds_is_get4 (dds_istream_t * __restrict s)
+{
+  dds_cdr_alignto (s, 4);
+  uint32_t v = * ((uint32_t *) (s->m_buffer + s->m_index));
+  s->m_index += 4;
+  return v;
+}
+
+DDS_EXPORT inline uint64_t dds_is_get8 (dds_istream_t * __restrict s)
+{
+  dds_cdr_alignto (s, 8);
+  uint64_t v = * ((uint64_t *) (s->m_buffer + s->m_index));
+  s->m_index += 8;
+  return v;
+}
+
+DDS_EXPORT inline void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size)
+{
+  dds_cdr_alignto (s, elem_size);
+  memcpy (b, s->m_buffer + s->m_index, num * elem_size);
+  s->m_index += num * elem_size;
+}
+
+DDS_EXPORT inline void dds_os_put1 (dds_ostream_t * __restrict s, uint8_t v)
+{
+  dds_cdr_resize (s, 1);
+  *((uint8_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 1;
+}
+
+DDS_EXPORT inline void dds_os_put2 (dds_ostream_t * __restrict s, uint16_t v)
+{
+  dds_cdr_alignto_clear_and_resize (s, 2, 2);
+  *((uint16_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 2;
+}
 
-void dds_stream_write_sample (dds_ostream_t * __restrict os, const void * __restrict data, const struct ddsi_sertopic_default * __restrict topic);
-void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict data, const struct ddsi_sertopic_default * __restrict topic);
+DDS_EXPORT inline void dds_os_put4 (dds_ostream_t * __restrict s, uint32_t v)
+{
+  dds_cdr_alignto_clear_and_resize (s, 4, 4);
+  *((uint32_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 4;
+}
+
+DDS_EXPORT inline void dds_os_put8 (dds_ostream_t * __restrict s, uint64_t v)
+{
+  dds_cdr_alignto_clear_and_resize (s, 8, 8);
+  *((uint64_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 8;
+}
+
+DDS_EXPORT inline void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l)
+{
+  dds_cdr_resize (s, l);
+  memcpy (s->m_buffer + s->m_index, b, l);
+  s->m_index += l;
+}
+
+DDS_EXPORT inline void dds_os_put_bytes_aligned (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a)
+{
+  const uint32_t l = n * a;
+  dds_cdr_alignto_clear_and_resize (s, a, l);
+  memcpy (s->m_buffer + s->m_index, b, l);
+  s->m_index += l;
+}
+
+/* Variants of the above for writing into space reserved in advance using
+   dds_cdr_resize, these only clear the alignment padding and store */
+DDS_EXPORT inline void dds_cdr_alignto_clear (dds_ostream_t * __restrict s, uint32_t a)
+{
+  while (s->m_index % a)
+    s->m_buffer[s->m_index++] = 0;
+}
+
+DDS_EXPORT inline void dds_os_put1_reserved (dds_ostream_t * __restrict s, uint8_t v)
+{
+  assert (s->m_index + 1 <= s->m_size);
+  s->m_buffer[s->m_index++] = v;
+}
+
+DDS_EXPORT inline void dds_os_put2_reserved (dds_ostream_t * __restrict s, uint16_t v)
+{
+  dds_cdr_alignto_clear (s, 2);
+  assert (s->m_index + 2 <= s->m_size);
+  *((uint16_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 2;
+}
+
+DDS_EXPORT inline void dds_os_put4_reserved (dds_ostream_t * __restrict s, uint32_t v)
+{
+  dds_cdr_alignto_clear (s, 4);
+  assert (s->m_index + 4 <= s->m_size);
+  *((uint32_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 4;
+}
+
+DDS_EXPORT inline void dds_os_put8_reserved (dds_ostream_t * __restrict s, uint64_t v)
+{
+  dds_cdr_alignto_clear (s, 8);
+  assert (s->m_index + 8 <= s->m_size);
+  *((uint64_t *) (s->m_buffer + s->m_index)) = v;
+  s->m_index += 8;
+}
+
+DDS_EXPORT inline void dds_os_put_bytes_aligned_reserved (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a)
+{
+  const uint32_t l = n * a;
+  dds_cdr_alignto_clear (s, a);
+  assert (s->m_index + l <= s->m_size);
+  memcpy (s->m_buffer + s->m_index, b, l);
+  s->m_index += l;
+}
+
+/* Non-primitive building blocks for generated (de)serializers, with the same
+   semantics as the interpreter.  Sequences are limited to sequences of
+   primitive types, "elem_size" is 1, 2, 4 or 8. */
+DDS_EXPORT void dds_stream_write_string (dds_ostream_t * __restrict os, const char * __restrict val);
+DDS_EXPORT void dds_stream_write_primseq (dds_ostream_t * __restrict os, const dds_sequence_t * __restrict seq, uint32_t elem_size);
+DDS_EXPORT char *dds_stream_reuse_string (dds_istream_t * __restrict is, char * __restrict str);
+DDS_EXPORT void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char * __restrict str, const uint32_t bound);
+DDS_EXPORT void dds_stream_read_primseq (dds_istream_t * __restrict is, dds_sequence_t * __restrict seq, uint32_t elem_size);
+DDS_EXPORT void dds_stream_skip_string (dds_istream_t * __restrict is);
+DDS_EXPORT void dds_stream_skip_primarray (dds_istream_t * __restrict is, uint32_t num, uint32_t elem_size);
+DDS_EXPORT void dds_stream_skip_primseq (dds_istream_t * __restrict is, uint32_t elem_size);
+DDS_EXPORT void dds_stream_extract_key_string (dds_istream_t * __restrict is, dds_ostream_t * __restrict os);
+DDS_EXPORT void dds_stream_extract_key_primarray (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, uint32_t num, uint32_t elem_size);
+DDS_EXPORT bool dds_stream_normalize_uint8 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap);
+DDS_EXPORT bool dds_stream_normalize_uint16 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap);
+DDS_EXPORT bool dds_stream_normalize_uint32 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap);
+DDS_EXPORT bool dds_stream_normalize_uint64 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap);
+DDS_EXPORT bool dds_stream_normalize_string (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, size_t maxsz);
+DDS_EXPORT bool dds_stream_normalize_primarray (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, uint32_t num, enum dds_stream_typecode type);
+DDS_EXPORT bool dds_stream_normalize_primseq (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, enum dds_stream_typecode type);
+
+DDS_EXPORT bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, const struct ddsi_sertopic_default * __restrict topic, bool just_key);
+
+DDS_EXPORT void dds_stream_write_sample (dds_ostream_t * __restrict os, const void * __restrict data, const struct ddsi_sertopic_default * __restrict topic);
+/* Exact size of the CDR representation of a sample or of its key, as written
+   by dds_stream_write_sample/dds_stream_write_key starting at an offset that
+   is a multiple of 8.  Allows allocating the output buffer once. */
+DDS_EXPORT uint32_t dds_stream_getsize_sample (const void * __restrict data, const struct ddsi_sertopic_default * __restrict topic);
+DDS_EXPORT uint32_t dds_stream_getsize_key (const char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic);
+DDS_EXPORT void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict data, const struct ddsi_sertopic_default * __restrict topic);
 void dds_stream_free_sample (void *data, const uint32_t * ops);
 
-uint32_t dds_stream_countops (const uint32_t * __restrict ops);
-size_t dds_stream_check_optimize (const struct ddsi_sertopic_default_desc * __restrict desc);
+DDS_EXPORT uint32_t dds_stream_countops (const uint32_t * __restrict ops);
+DDS_EXPORT size_t dds_stream_check_optimize (const struct ddsi_sertopic_default_desc * __restrict desc);
+DDS_EXPORT uint32_t dds_stream_cdr_align (const struct ddsi_sertopic_default_desc * __restrict desc);
 void dds_istream_from_serdata_default (dds_istream_t * __restrict s, const struct ddsi_serdata_default * __restrict d);
 void dds_ostream_from_serdata_default (dds_ostream_t * __restrict s, struct ddsi_serdata_default * __restrict d);
 void dds_ostream_add_to_serdata_default (dds_ostream_t * __restrict s, struct ddsi_serdata_default ** __restrict d);
 void dds_ostreamBE_from_serdata_default (dds_ostreamBE_t * __restrict s, struct ddsi_serdata_default * __restrict d);
 void dds_ostreamBE_add_to_serdata_default (dds_ostreamBE_t * __restrict s, struct ddsi_serdata_default ** __restrict d);
 
-void dds_stream_write_key (dds_ostream_t * __restrict os, const char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic);
+DDS_EXPORT void dds_stream_write_key (dds_ostream_t * __restrict os, const char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic);
 void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic);
-void dds_stream_extract_key_from_data (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const struct ddsi_sertopic_default * __restrict topic);
+DDS_EXPORT void dds_stream_extract_key_from_data (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const struct ddsi_sertopic_default * __restrict topic);
 void dds_stream_extract_keyBE_from_data (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const struct ddsi_sertopic_default * __restrict topic);
 void dds_stream_extract_keyhash (dds_istream_t * __restrict is, dds_keyhash_t * __restrict kh, const struct ddsi_sertopic_default * __restrict topic, const bool just_key);
 
+/* Location of a primitive member of the top-level type in the CDR, for
+   evaluating predicates on the serialised form of a sample. The member is
+   identified by its offset in the in-memory representation; if all members
+   preceding it have a fixed size, so does its position in the CDR */
+struct dds_stream_fieldref {
+  uint32_t op_index; /* index of the ADR instruction in the ops */
+  uint32_t cdroff;   /* offset in the CDR or UINT32_MAX if it varies */
+  uint32_t insn;     /* the ADR instruction (for type and flags) */
+};
+
+/* A term "field cmp value" of a conjunctive filter on serialised samples, the
+   comparison operators are the same as those of dds_field_filter_cmp_t. The
+   member of value used depends on the type of the field: "d" for floating
+   point types, "i" for signed integers and "u" for all others. */
+enum dds_stream_field_cmp {
+  DDS_STREAM_FIELD_EQ,
+  DDS_STREAM_FIELD_NE,
+  DDS_STREAM_FIELD_LT,
+  DDS_STREAM_FIELD_LE,
+  DDS_STREAM_FIELD_GT,
+  DDS_STREAM_FIELD_GE
+};
+
+struct dds_stream_field_term {
+  struct dds_stream_fieldref ref;
+  enum dds_stream_field_cmp cmp;
+  union { int64_t i; uint64_t u; double d; } value;
+};
+
+DDS_EXPORT bool dds_stream_fieldref_init (struct dds_stream_fieldref * __restrict f, const struct ddsi_sertopic_default_desc * __restrict desc, uint32_t offset);
+DDS_EXPORT bool dds_stream_fieldref_init_index (struct dds_stream_fieldref * __restrict f, const struct ddsi_sertopic_default_desc * __restrict desc, uint32_t op_index);
+/* Identifies the type in which instruction indices of field references are interpreted */
+DDS_EXPORT uint32_t dds_stream_fieldref_type_hash (const struct ddsi_sertopic_default_desc * __restrict desc);
+DDS_EXPORT bool dds_stream_read_field (dds_istream_t * __restrict is, const struct ddsi_sertopic_default_desc * __restrict desc, const struct dds_stream_fieldref * __restrict f, void * __restrict value);
+DDS_EXPORT bool dds_stream_field_terms_hold (const struct ddsi_serdata_default * __restrict d, const struct ddsi_sertopic_default_desc * __restrict desc, uint32_t nterms, const struct dds_stream_field_term * __restrict terms);
+
 void dds_stream_read_key (dds_istream_t * __restrict is, char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic);
 
 size_t dds_stream_print_key (dds_istream_t * __restrict is, const struct ddsi_sertopic_default * __restrict topic, char * __restrict buf, size_t size);
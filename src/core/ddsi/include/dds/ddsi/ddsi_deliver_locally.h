@@ -55,6 +55,14 @@ dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common
 
 dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo);
 
+/** Maximum number of samples deliver_locally_allinsync_batch accepts at once */
+#define DELIVER_LOCALLY_MAX_BATCH 128
+
+/** Delivers n samples (with writer info wrinfo[i] and source info vsourceinfo[i])
+    in order to all in-sync readers, storing each run of samples in a reader history
+    cache in a single operation */
+dds_return_t deliver_locally_allinsync_batch (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, uint32_t n, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void * const *vsourceinfo);
+
 #if defined (__cplusplus)
 }
 #endif
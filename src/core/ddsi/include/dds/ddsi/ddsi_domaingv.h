@@ -46,6 +46,7 @@ struct ddsi_tran_factory;
 struct ddsrt_thread_pool_s;
 struct debug_monitor;
 struct ddsi_tkmap;
+struct ddsi_lwregs;
 struct dds_security_context;
 struct dds_security_match_index;
 struct ddsi_hsadmin;
@@ -94,6 +95,7 @@ struct ddsi_domaingv {
   struct config config;
 
   struct ddsi_tkmap * m_tkmap;
+  struct ddsi_lwregs * m_lwregs;
 
   /* Hash tables for participants, readers, writers, proxy
      participants, proxy readers and proxy writers by GUID. */
@@ -238,6 +240,11 @@ struct ddsi_domaingv {
   /* Listener thread for connection based transports */
   struct thread_state1 *listen_ts;
 
+  /* Number of packets received and of system calls it took to receive
+     them, summed over all receive threads */
+  ddsrt_atomic_uint64_t recv_packets;
+  ddsrt_atomic_uint64_t recv_syscalls;
+
   /* Flag cleared when stopping (receive threads). FIXME. */
   ddsrt_atomic_uint32_t rtps_keepgoing;
 
@@ -286,8 +293,10 @@ struct ddsi_domaingv {
   uint32_t networkQueueId;
   struct thread_state1 *channel_reader_ts;
 
-  /* Application data gets its own delivery queue */
-  struct nn_dqueue *user_dqueue;
+  /* Application data gets its own delivery queues, proxy writers are
+     distributed over them by GUID (see DeliveryQueueThreads) */
+  uint32_t n_user_dqueues;
+  struct nn_dqueue **user_dqueues;
 #endif
 
   /* Transmit side: pools for the serializer & transmit messages and a
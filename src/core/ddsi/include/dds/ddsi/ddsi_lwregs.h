@@ -0,0 +1,55 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSI_LWREGS_H
+#define DDSI_LWREGS_H
+
+#include <stdint.h>
+#include "dds/export.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_lwregs;
+struct ddsi_domaingv;
+
+/* Domain-wide table of <reader,instance,writer> registrations for the reader
+   history caches.  Readers are identified by a small integer "slot" allocated from
+   the table, and each <instance,writer> pair has a single entry with a bitmap of the
+   slots that have the writer registered for the instance, so that readers sharing
+   instances and writers also share the registration records.
+
+   Lookups and updates of an existing entry are lock-free, creating and removing an
+   entry requires a lock.  The caller must be awake (see thread_state_awake), entries
+   are freed via the garbage collector.  Operations for a given slot must be
+   serialised by the caller (the RHC does that with its lock). */
+DDS_EXPORT struct ddsi_lwregs *ddsi_lwregs_new (struct ddsi_domaingv *gv);
+DDS_EXPORT void ddsi_lwregs_free (struct ddsi_lwregs *regs);
+
+DDS_EXPORT uint32_t ddsi_lwregs_alloc_slot (struct ddsi_lwregs *regs);
+
+/* Removes the remaining NREGS registrations for the slot and makes it available for
+   reuse; NREGS > 0 requires scanning the table */
+DDS_EXPORT void ddsi_lwregs_free_slot (struct ddsi_lwregs *regs, uint32_t slot, uint32_t nregs);
+
+DDS_EXPORT int ddsi_lwregs_contains (struct ddsi_lwregs *regs, uint32_t slot, uint64_t iid, uint64_t wr_iid);
+
+/* Returns 1 if registration was added, 0 if it already existed */
+DDS_EXPORT int ddsi_lwregs_add (struct ddsi_lwregs *regs, uint32_t slot, uint64_t iid, uint64_t wr_iid);
+
+/* Returns 1 if registration was deleted, 0 if it didn't exist */
+DDS_EXPORT int ddsi_lwregs_delete (struct ddsi_lwregs *regs, uint32_t slot, uint64_t iid, uint64_t wr_iid);
+
+#if defined (__cplusplus)
+}
+#endif
+#endif
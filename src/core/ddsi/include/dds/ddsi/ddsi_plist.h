@@ -61,6 +61,7 @@ extern "C" {
 #define PP_PARTICIPANT_SECURITY_INFO            ((uint64_t)1 << 35)
 #define PP_IDENTITY_STATUS_TOKEN                ((uint64_t)1 << 36)
 #define PP_DATA_TAGS                            ((uint64_t)1 << 37)
+#define PP_CYCLONE_FIELD_FILTER                 ((uint64_t)1 << 38)
 /* Set for unrecognized parameters that are in the reserved space or
    in our own vendor-specific space that have the
    PID_UNRECOGNIZED_INCOMPATIBLE_FLAG set (see DDSI 2.1 9.6.2.2.1) */
@@ -171,6 +172,21 @@ struct nn_security_info;
 typedef struct nn_security_info nn_security_info_t;
 #endif
 
+/* A term "field cmp value" of a reader's field filter: the field is the index
+   of its ADR instruction in the reader type's ops, cmp is a dds_field_filter_cmp_t
+   and value the bit pattern of the comparand as a 64-bit integer or double */
+typedef struct nn_field_filter_term {
+  uint32_t op_index;
+  uint32_t cmp;
+  int64_t value;
+} nn_field_filter_term_t;
+
+typedef struct nn_field_filter {
+  uint32_t n;
+  nn_field_filter_term_t *terms;
+  uint32_t type_hash; /* hash of the ops the op_index refers to, see dds_stream_fieldref_type_hash */
+} nn_field_filter_t;
+
 typedef struct nn_adlink_participant_version_info
 {
   uint32_t version;
@@ -227,6 +243,7 @@ typedef struct ddsi_plist {
 #endif
   uint32_t domain_id;
   char *domain_tag;
+  nn_field_filter_t field_filter;
 } ddsi_plist_t;
 
 
@@ -139,6 +139,14 @@ typedef size_t (*ddsi_serdata_print_t) (const struct ddsi_sertopic *topic, const
    - buf needs to be at least 16 bytes large */
 typedef void (*ddsi_serdata_get_keyhash_t) (const struct ddsi_serdata *d, struct ddsi_keyhash *buf, bool force_md5);
 
+/* Return a reference to a serdata equivalent to "d" that may be kept indefinitely,
+   which is "d" itself unless it references memory that should be released once
+   the sample has been delivered (such as a receive buffer), in which case it is a
+   copy.  Called before storing the sample in a reader or writer history cache, by
+   the thread delivering it.  Returns NULL if the copy can't be allocated, the
+   sample must then be rejected.  Optional: if absent, "d" is stored as is. */
+typedef struct ddsi_serdata * (*ddsi_serdata_detach_t) (const struct ddsi_serdata *d);
+
 struct ddsi_serdata_ops {
   ddsi_serdata_eqkey_t eqkey;
   ddsi_serdata_size_t get_size;
@@ -155,11 +163,13 @@ struct ddsi_serdata_ops {
   ddsi_serdata_free_t free;
   ddsi_serdata_print_t print;
   ddsi_serdata_get_keyhash_t get_keyhash;
+  ddsi_serdata_detach_t detach;
 };
 
 #define DDSI_SERDATA_HAS_PRINT 1
 #define DDSI_SERDATA_HAS_FROM_SER_IOV 1
 #define DDSI_SERDATA_HAS_GET_KEYHASH 1
+#define DDSI_SERDATA_HAS_DETACH 1
 
 DDS_EXPORT void ddsi_serdata_init (struct ddsi_serdata *d, const struct ddsi_sertopic *tp, enum ddsi_serdata_kind kind);
 
@@ -256,6 +266,13 @@ DDS_EXPORT inline void ddsi_serdata_get_keyhash (const struct ddsi_serdata *d, s
   d->ops->get_keyhash (d, buf, force_md5);
 }
 
+DDS_EXPORT inline struct ddsi_serdata *ddsi_serdata_ref_detached (const struct ddsi_serdata *d) {
+  if (d->ops->detach)
+    return d->ops->detach (d);
+  else
+    return ddsi_serdata_ref (d);
+}
+
 #if defined (__cplusplus)
 }
 #endif
@@ -13,6 +13,8 @@
 #define DDSI_SERDATA_DEFAULT_H
 
 #include "dds/ddsrt/endian.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/threads.h"
 #include "dds/ddsi/q_protocol.h" /* for nn_parameterid_t */
 #include "dds/ddsi/q_freelist.h"
 #include "dds/ddsrt/avl.h"
@@ -34,13 +36,37 @@ extern "C" {
 #define CDR_LE 0x0001
 #endif
 
+struct nn_rmsg;
+
 struct CDRHeader {
   unsigned short identifier;
   unsigned short options;
 };
 
+/* Serdata are pooled in size classes of powers of two, starting at 128 bytes
+   (2^SERDATAPOOL_MIN_CLASS_LG2) and going up to a configurable maximum. A
+   freed serdata goes back to the largest class not exceeding its size, so
+   anything taken from a class is always large enough for a request rounded
+   up to that class. */
+#define SERDATAPOOL_MIN_CLASS_LG2 7
+#define SERDATAPOOL_MAX_CLASS_LG2 20
+
 struct serdatapool {
-  struct nn_freelist freelist;
+  /* Allocations of at most this size come from the pool */
+  uint32_t max_pooled_size;
+  uint32_t nclasses;
+  /* Allocations satisfied by resp. missed in the pool */
+  ddsrt_atomic_uint32_t hits;
+  ddsrt_atomic_uint32_t misses;
+  /* Samples received over the network that reference the receive buffer
+     resp. that were copied out of it, and of those referencing it, the
+     ones that had to be copied after all because they got stored */
+  ddsrt_atomic_uint32_t from_ser_zerocopy;
+  ddsrt_atomic_uint32_t from_ser_copy;
+  ddsrt_atomic_uint32_t from_ser_detached;
+  /* Serdata referencing the receive buffer have no room for data */
+  struct nn_freelist hdr_freelist;
+  struct nn_freelist freelist[SERDATAPOOL_MAX_CLASS_LG2 - SERDATAPOOL_MIN_CLASS_LG2 + 1];
 };
 
 typedef struct dds_keyhash {
@@ -53,7 +79,8 @@ typedef struct dds_keyhash {
 /* Debug builds may want to keep some additional state */
 #ifndef NDEBUG
 #define DDSI_SERDATA_DEFAULT_DEBUG_FIELDS \
-  bool fixed;
+  bool fixed;                             \
+  ddsrt_thread_t owner; /* if rmsg != NULL */
 #else
 #define DDSI_SERDATA_DEFAULT_DEBUG_FIELDS
 #endif
@@ -61,7 +88,15 @@ typedef struct dds_keyhash {
 /* There is an alignment requirement on the raw data (it must be at
    offset mod 8 for the conversion to/from a dds_stream to work).
    So we define two types: one without any additional padding, and
-   one where the appropriate amount of padding is inserted */
+   one where the appropriate amount of padding is inserted.
+
+   Samples received over the network may instead reference the receive
+   buffer: then rmsg is non-NULL and the serdata holds a reference to it,
+   rmsg_payload points to the CDR header in it and data[] is unused (hdr
+   still contains a copy of the header).  Such a serdata only lives for
+   the duration of the delivery: anything that stores the sample stores
+   "copy" instead (see ddsi_serdata_ref_detached).  Next is the link in
+   the freelist of the pool. */
 #define DDSI_SERDATA_DEFAULT_PREPAD   \
   struct ddsi_serdata c;              \
   uint32_t pos;                       \
@@ -69,7 +104,10 @@ typedef struct dds_keyhash {
   DDSI_SERDATA_DEFAULT_DEBUG_FIELDS   \
   dds_keyhash_t keyhash;              \
   struct serdatapool *serpool;        \
-  struct ddsi_serdata_default *next /* in pool->freelist */
+  struct ddsi_serdata_default *next;  \
+  struct nn_rmsg *rmsg;               \
+  const char *rmsg_payload;           \
+  struct ddsi_serdata_default *copy
 #define DDSI_SERDATA_DEFAULT_POSTPAD  \
   struct CDRHeader hdr;               \
   char data[]
@@ -110,6 +148,7 @@ struct ddsi_sertopic_default_desc {
   uint32_t *m_keys;   /* Key descriptors (NULL iff m_nkeys 0) */
   uint32_t m_nops;    /* Number of words in m_ops (which >= number of ops stored in preproc output) */
   uint32_t *m_ops;    /* Marshalling meta data */
+  const struct dds_topic_marshal_ops *m_marshal; /* Generated (de)serializers, used instead of m_ops if non-NULL */
 };
 
 struct ddsi_sertopic_default {
@@ -118,6 +157,7 @@ struct ddsi_sertopic_default {
   struct serdatapool *serpool;
   struct ddsi_sertopic_default_desc type;
   size_t opt_size;
+  uint32_t cdr_align; /* alignment needed for the serialised form (4 or 8, 0 = unknown) */
 };
 
 struct ddsi_plist_sample {
@@ -133,12 +173,18 @@ struct ddsi_rawcdr_sample {
   size_t keysize;
 };
 
+/* Serialised data following the CDR header, either stored in the serdata itself or in
+   the receive buffer it references */
+DDS_EXPORT inline const char *ddsi_serdata_default_data (const struct ddsi_serdata_default *d) {
+  return d->rmsg ? d->rmsg_payload + sizeof (struct CDRHeader) : d->data;
+}
+
 extern DDS_EXPORT const struct ddsi_sertopic_ops ddsi_sertopic_ops_default;
 
 extern DDS_EXPORT const struct ddsi_serdata_ops ddsi_serdata_ops_cdr;
 extern DDS_EXPORT const struct ddsi_serdata_ops ddsi_serdata_ops_cdr_nokey;
 
-struct serdatapool * ddsi_serdatapool_new (void);
+struct serdatapool * ddsi_serdatapool_new (uint32_t max_pooled_size);
 void ddsi_serdatapool_free (struct serdatapool * pool);
 
 #if defined (__cplusplus)
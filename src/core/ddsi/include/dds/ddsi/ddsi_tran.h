@@ -34,6 +34,16 @@ struct nn_interface;
 
 #define DDSI_TRAN_ON_CONNECT 0x0001
 
+/* Maximum number of destinations in a single ddsi_conn_write_multi call */
+
+#define DDSI_MAX_WRITE_MULTI 64
+
+/* Segmentation offload limits: maximum number of segments and total size
+   of a segmented message */
+
+#define DDSI_MAX_GSO_SEGMENTS 64
+#define DDSI_MAX_GSO_SIZE 65507u
+
 #if DDSRT_HAVE_IPV6 == 1
 # define DDSI_LOCATORSTRLEN INET6_ADDRSTRLEN_EXTENDED
 #else
@@ -51,7 +61,9 @@ typedef struct ddsi_tran_qos ddsi_tran_qos_t;
 /* Function pointer types */
 
 typedef ssize_t (*ddsi_tran_read_fn_t) (ddsi_tran_conn_t, unsigned char *, size_t, bool, nn_locator_t *);
+typedef int (*ddsi_tran_read_batch_fn_t) (ddsi_tran_conn_t, uint32_t, unsigned char * const *, size_t, size_t *, uint32_t *, nn_locator_t *);
 typedef ssize_t (*ddsi_tran_write_fn_t) (ddsi_tran_conn_t, const nn_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
+typedef int (*ddsi_tran_write_multi_fn_t) (ddsi_tran_conn_t, uint32_t, const nn_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t, uint32_t);
 typedef int (*ddsi_tran_locator_fn_t) (ddsi_tran_factory_t, ddsi_tran_base_t, nn_locator_t *);
 typedef bool (*ddsi_tran_supports_fn_t) (const struct ddsi_tran_factory *, int32_t);
 typedef ddsrt_socket_t (*ddsi_tran_handle_fn_t) (ddsi_tran_base_t);
@@ -116,7 +128,9 @@ struct ddsi_tran_conn
   /* Functions */
 
   ddsi_tran_read_fn_t m_read_fn;
+  ddsi_tran_read_batch_fn_t m_read_batch_fn; /* optional, NULL if not supported */
   ddsi_tran_write_fn_t m_write_fn;
+  ddsi_tran_write_multi_fn_t m_write_multi_fn; /* optional, NULL if not supported */
   ddsi_tran_peer_locator_fn_t m_peer_locator_fn;
   ddsi_tran_disable_multiplexing_fn_t m_disable_multiplexing_fn;
   ddsi_tran_locator_fn_t m_locator_fn;
@@ -127,6 +141,8 @@ struct ddsi_tran_conn
   bool m_connless;
   bool m_stream;
   bool m_closed;
+  bool m_gso; /* write_multi accepts segmented messages */
+  bool m_gro; /* read_batch may return coalesced messages */
   ddsrt_atomic_uint32_t m_count;
 
   /* Relationships */
@@ -246,9 +262,28 @@ inline int ddsi_conn_locator (ddsi_tran_conn_t conn, nn_locator_t * loc) {
 inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags) {
   return conn->m_closed ? -1 : (conn->m_write_fn) (conn, dst, niov, iov, flags);
 }
+/* Sends the same message to n destinations, n at most DDSI_MAX_WRITE_MULTI,
+   using as few system calls as possible.  If segsize is not 0, the message
+   is a sequence of segsize-sized packets (the last one possibly shorter)
+   that is to be sent as separate datagrams, this requires m_gso.  Returns
+   the number of destinations it was sent to, or -1 if it failed for all.
+   Only available if m_write_multi_fn is set. */
+inline int ddsi_conn_write_multi (ddsi_tran_conn_t conn, uint32_t n, const nn_locator_t *dsts, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags) {
+  return conn->m_closed ? -1 : (conn->m_write_multi_fn) (conn, n, dsts, niov, iov, segsize, flags);
+}
 inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc) {
   return conn->m_closed ? -1 : conn->m_read_fn (conn, buf, len, allow_spurious, srcloc);
 }
+/* Reads up to n messages of at most len bytes each into bufs[0..n-1],
+   storing their sizes and source addresses, blocking until at least one
+   is available.  If m_gro is set, a message may consist of several
+   datagrams coalesced by the kernel, each of segsizes[i] bytes (the last
+   one possibly shorter); segsizes[i] is 0 for an ordinary message.
+   Returns the number of messages read, 0 on a spurious wakeup and -1 on
+   error.  Only available if m_read_batch_fn is set. */
+inline int ddsi_conn_read_batch (ddsi_tran_conn_t conn, uint32_t n, unsigned char * const *bufs, size_t len, size_t *sizes, uint32_t *segsizes, nn_locator_t *srclocs) {
+  return conn->m_closed ? -1 : conn->m_read_batch_fn (conn, n, bufs, len, sizes, segsizes, srclocs);
+}
 bool ddsi_conn_peer_locator (ddsi_tran_conn_t conn, nn_locator_t * loc);
 void ddsi_conn_disable_multiplexing (ddsi_tran_conn_t conn);
 void ddsi_conn_add_ref (ddsi_tran_conn_t conn);
@@ -43,6 +43,11 @@ enum retransmit_merging {
   REXMIT_MERGE_ALWAYS
 };
 
+enum timed_event_queue {
+  TEVQ_FIBHEAP,
+  TEVQ_TIMING_WHEEL
+};
+
 enum boolean_default {
   BOOLDEF_DEFAULT,
   BOOLDEF_FALSE,
@@ -52,6 +57,9 @@ enum boolean_default {
 #define PARTICIPANT_INDEX_AUTO -1
 #define PARTICIPANT_INDEX_NONE -2
 
+/* Maximum number of packets retrieved in one go by a receive thread */
+#define DDSI_MAX_RECV_BATCH 64
+
 /* config_listelem must be an overlay for all used listelem types */
 struct config_listelem {
   struct config_listelem *next;
@@ -152,7 +160,8 @@ enum transport_selector {
   TRANS_UDP6,
   TRANS_TCP,
   TRANS_TCP6,
-  TRANS_RAWETH
+  TRANS_RAWETH,
+  TRANS_SHM
 };
 
 enum many_sockets_mode {
@@ -247,6 +256,7 @@ struct config
   int64_t const_hb_intv_sched_max;
   int64_t const_hb_intv_min;
   enum retransmit_merging retransmit_merging;
+  enum timed_event_queue timed_event_queue;
   int64_t retransmit_merging_period;
   int squash_participants;
   int liveliness_monitoring;
@@ -256,11 +266,15 @@ struct config
   int xpack_send_async;
   enum boolean_default multiple_recv_threads;
   unsigned recv_thread_stop_maxretries;
+  int recv_batch_size;
+  int recv_gro;
+  int xmit_gso;
 
   unsigned primary_reorder_maxsamples;
   unsigned secondary_reorder_maxsamples;
 
   unsigned delivery_queue_maxsamples;
+  unsigned delivery_queue_threads;
 
   uint32_t max_msg_size;
   uint32_t fragment_size;
@@ -274,6 +288,7 @@ struct config
   int64_t tcp_read_timeout;
   int64_t tcp_write_timeout;
   int tcp_use_peeraddr_for_unicast;
+  uint32_t shm_ring_size;
 
 #ifdef DDSI_INCLUDE_SSL
   /* SSL support for TCP */
@@ -320,6 +335,7 @@ struct config
   /* Write cache */
 
   int whc_batch;
+  int whc_ring;
   uint32_t whc_lowwater_mark;
   uint32_t whc_highwater_mark;
   struct config_maybe_uint32 whc_init_highwater_mark;
@@ -349,6 +365,7 @@ struct config
   int retry_on_reject_besteffort;
   int generate_keyhash;
   uint32_t max_sample_size;
+  uint32_t serdata_pool_max_size;
 
   /* compability options */
   enum nn_standards_conformance standards_conformance;
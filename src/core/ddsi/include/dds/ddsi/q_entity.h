@@ -41,6 +41,7 @@ struct nn_rsample_info;
 struct nn_rdata;
 struct addrset;
 struct ddsi_sertopic;
+struct dds_stream_field_term;
 struct whc;
 struct dds_qos;
 struct ddsi_plist;
@@ -138,6 +139,9 @@ struct wr_prd_match {
   ddsrt_wctime_t hb_to_ack_latency_tlastlog;
   uint32_t non_responsive_count;
   uint32_t rexmit_requests;
+  uint32_t field_filter_gen; /* generation of the proxy reader's field filter that was compiled */
+  uint32_t field_filter_nterms; /* number of terms in field_filter */
+  struct dds_stream_field_term *field_filter; /* reader's field filter compiled for the writer's type, or NULL */
 #ifdef DDSI_INCLUDE_SECURITY
   int64_t crypto_handle;
 #endif
@@ -302,6 +306,7 @@ struct writer
   ddsrt_etime_t t_whc_high_upd; /* time "whc_high" was last updated for controlled ramp-up of throughput */
   uint32_t num_readers; /* total number of matching PROXY readers */
   int32_t num_reliable_readers; /* number of matching reliable PROXY readers */
+  int32_t num_filtered_readers; /* number of matching PROXY readers with a field filter we can evaluate */
   ddsrt_avl_tree_t readers; /* all matching PROXY readers, see struct wr_prd_match */
   ddsrt_avl_tree_t local_readers; /* all matching LOCAL readers, see struct wr_rd_match */
 #ifdef DDSI_INCLUDE_NETWORK_PARTITIONS
@@ -351,6 +356,7 @@ struct reader
   struct addrset *as;
 #endif
   const struct ddsi_sertopic * topic; /* topic */
+  nn_field_filter_t field_filter; /* field filter advertised in discovery (n = 0 if none) */
   uint32_t num_writers; /* total number of matching PROXY writers */
   ddsrt_avl_tree_t writers; /* all matching PROXY writers, see struct rd_pwr_match */
   ddsrt_avl_tree_t local_writers; /* all matching LOCAL writers, see struct rd_wr_match */
@@ -470,6 +476,8 @@ struct proxy_reader {
 #endif
   ddsrt_avl_tree_t writers; /* matching LOCAL writers */
   filter_fn_t filter;
+  nn_field_filter_t field_filter; /* field filter from discovery (n = 0 if none) */
+  uint32_t field_filter_gen; /* incremented whenever field_filter changes */
 };
 
 DDS_EXPORT extern const ddsrt_avl_treedef_t wr_readers_treedef;
@@ -643,9 +651,10 @@ DDS_EXPORT struct writer *get_builtin_writer (const struct participant *pp, unsi
    writer/reader already known. */
 
 dds_return_t new_writer (struct writer **wr_out, struct ddsi_guid *wrguid, const struct ddsi_guid *group_guid, struct participant *pp, const struct ddsi_sertopic *topic, const struct dds_qos *xqos, struct whc * whc, status_cb_t status_cb, void *status_cb_arg);
-dds_return_t new_reader (struct reader **rd_out, struct ddsi_guid *rdguid, const struct ddsi_guid *group_guid, struct participant *pp, const struct ddsi_sertopic *topic, const struct dds_qos *xqos, struct ddsi_rhc * rhc, status_cb_t status_cb, void *status_cb_arg);
+dds_return_t new_reader (struct reader **rd_out, struct ddsi_guid *rdguid, const struct ddsi_guid *group_guid, struct participant *pp, const struct ddsi_sertopic *topic, const struct dds_qos *xqos, const nn_field_filter_t *field_filter, struct ddsi_rhc * rhc, status_cb_t status_cb, void *status_cb_arg);
 
 void update_reader_qos (struct reader *rd, const struct dds_qos *xqos);
+void update_reader_field_filter (struct reader *rd, const nn_field_filter_t *field_filter);
 void update_writer_qos (struct writer *wr, const struct dds_qos *xqos);
 
 struct whc_node;
@@ -722,7 +731,7 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
 int delete_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *guid, ddsrt_wctime_t timestamp, int isimplicit);
 int delete_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *guid, ddsrt_wctime_t timestamp, int isimplicit);
 
-void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp);
+void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, const nn_field_filter_t *field_filter, ddsrt_wctime_t timestamp);
 void update_proxy_writer (struct proxy_writer *pwr, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp);
 
 void proxy_writer_set_alive_may_unlock (struct proxy_writer *pwr, bool notify);
@@ -112,6 +112,7 @@ typedef struct {
 #define NN_LOCATOR_KIND_TCPv4 4
 #define NN_LOCATOR_KIND_TCPv6 8
 #define NN_LOCATOR_KIND_RAWETH 0x8000 /* proposed vendor-specific */
+#define NN_LOCATOR_KIND_SHM 0x8001 /* vendor-specific, same-host shared memory */
 #define NN_LOCATOR_KIND_UDPv4MCGEN 0x4fff0000
 #define NN_LOCATOR_PORT_INVALID 0
 
@@ -451,6 +452,10 @@ typedef union Submessage {
 #define PID_ADLINK_PART_CERT_NAME               (PID_VENDORSPECIFIC_FLAG | 0x17u);
 #define PID_ADLINK_LAN_CERT_NAME                (PID_VENDORSPECIFIC_FLAG | 0x18u);
 
+/* Field filter of a reader, which writers may use to avoid sending samples
+   the reader would drop anyway */
+#define PID_CYCLONE_FIELD_FILTER                (PID_VENDORSPECIFIC_FLAG | 0x19u)
+
 #if defined (__cplusplus)
 }
 #endif
@@ -39,6 +39,10 @@ struct nn_sequence_number_set;
 
 typedef int (*nn_dqueue_handler_t) (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const struct ddsi_guid *rdguid, void *qarg);
 
+/* Optional handler for a run of consecutive data samples and gaps not addressed to
+   a specific reader, it consumes the chain, including the fragchain references */
+typedef void (*nn_dqueue_chain_handler_t) (struct nn_rsample_chain *sc, void *qarg);
+
 struct nn_rmsg_chunk {
   struct nn_rbuf *rbuf;
   struct nn_rmsg_chunk *next;
@@ -209,10 +213,14 @@ void nn_rbufpool_setowner (struct nn_rbufpool *rbp, ddsrt_thread_t tid);
 void nn_rbufpool_free (struct nn_rbufpool *rbp);
 
 struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbufpool);
+uint32_t nn_rmsg_new_batch (struct nn_rbufpool *rbufpool, uint32_t n, struct nn_rmsg **rmsgs);
+void nn_rbufpool_end_batch (struct nn_rbufpool *rbufpool);
 void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size);
 void nn_rmsg_commit (struct nn_rmsg *rmsg);
 void nn_rmsg_free (struct nn_rmsg *rmsg);
 void *nn_rmsg_alloc (struct nn_rmsg *rmsg, uint32_t size);
+void nn_rmsg_ref (struct nn_rmsg *rmsg);
+void nn_rmsg_unref (struct nn_rmsg *rmsg);
 
 struct nn_rdata *nn_rdata_new (struct nn_rmsg *rmsg, uint32_t start, uint32_t endp1, uint32_t submsg_offset, uint32_t payload_offset);
 struct nn_rdata *nn_rdata_newgap (struct nn_rmsg *rmsg);
@@ -237,7 +245,16 @@ unsigned nn_reorder_nackmap (struct nn_reorder *reorder, seqno_t base, seqno_t m
 seqno_t nn_reorder_next_seq (const struct nn_reorder *reorder);
 void nn_reorder_set_next_seq (struct nn_reorder *reorder, seqno_t seq);
 
-struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, void *arg);
+struct nn_dqueue_stats {
+  const char *name;
+  uint32_t max_samples;     /* configured limit (DeliveryQueueMaxSamples) */
+  uint32_t nof_samples;     /* current depth, including control entries */
+  uint32_t max_nof_samples; /* maximum depth seen */
+  uint32_t nof_full;        /* number of times incoming samples were refused because the queue was full */
+  uint32_t nof_throttled;   /* number of times a receive thread waited for the queue to drain */
+};
+
+struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, nn_dqueue_chain_handler_t chain_handler, void *arg);
 void nn_dqueue_free (struct nn_dqueue *q);
 bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres);
 void dd_dqueue_enqueue_trigger (struct nn_dqueue *q);
@@ -246,6 +263,7 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg);
 int  nn_dqueue_is_full (struct nn_dqueue *q);
 void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q);
+void nn_dqueue_get_stats (struct nn_dqueue *q, struct nn_dqueue_stats *st);
 
 #if defined (__cplusplus)
 }
@@ -18,6 +18,7 @@ extern "C" {
 
 struct nn_rbufpool;
 struct nn_rsample_info;
+struct nn_rsample_chain;
 struct nn_rdata;
 struct ddsi_tran_listener;
 struct recv_thread_arg;
@@ -39,6 +40,7 @@ void trigger_recv_threads (const struct ddsi_domaingv *gv);
 uint32_t recv_thread (void *vrecv_thread_arg);
 uint32_t listen_thread (struct ddsi_tran_listener * listener);
 int user_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, void *qarg);
+void user_dqueue_chain_handler (struct nn_rsample_chain *sc, void *qarg);
 int add_Gap (struct nn_xmsg *msg, struct writer *wr, struct proxy_reader *prd, seqno_t start, seqno_t base, uint32_t numbits, const uint32_t *bits);
 
 #if defined (__cplusplus)
@@ -23,6 +23,7 @@ struct nn_xmsg;
 struct writer;
 struct whc_state;
 struct proxy_reader;
+struct wr_prd_match;
 struct ddsi_serdata;
 struct ddsi_tkmap_instance;
 struct thread_state1;
@@ -44,6 +45,7 @@ dds_return_t create_fragment_message (struct writer *wr, seqno_t seq, const stru
 int enqueue_sample_wrlock_held (struct writer *wr, seqno_t seq, const struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct proxy_reader *prd, int isnew);
 void add_Heartbeat (struct nn_xmsg *msg, struct writer *wr, const struct whc_state *whcst, int hbansreq, int hbliveliness, ddsi_entityid_t dst, int issync);
 dds_return_t write_hb_liveliness (struct ddsi_domaingv * const gv, struct ddsi_guid *wr_guid, struct nn_xpack *xp);
+int wr_prd_match_accepts_sample (const struct writer *wr, const struct wr_prd_match *m, const struct ddsi_serdata *serdata);
 int write_sample_p2p_wrlock_held(struct writer *wr, seqno_t seq, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk, struct proxy_reader *prd);
 
 #if defined (__cplusplus)
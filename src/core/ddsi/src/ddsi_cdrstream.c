@@ -15,6 +15,7 @@
 
 #include "dds/ddsrt/endian.h"
 #include "dds/ddsrt/md5.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsi/q_bswap.h"
 #include "dds/ddsi/q_config.h"
@@ -27,10 +28,31 @@
 #define DDS_ENDIAN false
 #endif
 
+extern inline void dds_cdr_resize (dds_ostream_t * __restrict s, uint32_t l);
+extern inline void dds_cdr_alignto (dds_istream_t * __restrict s, uint32_t a);
+extern inline uint32_t dds_cdr_alignto_clear_and_resize (dds_ostream_t * __restrict s, uint32_t a, uint32_t extra);
+extern inline uint8_t dds_is_get1 (dds_istream_t * __restrict s);
+extern inline uint16_t dds_is_get2 (dds_istream_t * __restrict s);
+extern inline uint32_t dds_is_get4 (dds_istream_t * __restrict s);
+extern inline uint64_t dds_is_get8 (dds_istream_t * __restrict s);
+extern inline void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size);
+extern inline void dds_os_put1 (dds_ostream_t * __restrict s, uint8_t v);
+extern inline void dds_os_put2 (dds_ostream_t * __restrict s, uint16_t v);
+extern inline void dds_os_put4 (dds_ostream_t * __restrict s, uint32_t v);
+extern inline void dds_os_put8 (dds_ostream_t * __restrict s, uint64_t v);
+extern inline void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l);
+extern inline void dds_os_put_bytes_aligned (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a);
+extern inline void dds_cdr_alignto_clear (dds_ostream_t * __restrict s, uint32_t a);
+extern inline void dds_os_put1_reserved (dds_ostream_t * __restrict s, uint8_t v);
+extern inline void dds_os_put2_reserved (dds_ostream_t * __restrict s, uint16_t v);
+extern inline void dds_os_put4_reserved (dds_ostream_t * __restrict s, uint32_t v);
+extern inline void dds_os_put8_reserved (dds_ostream_t * __restrict s, uint64_t v);
+extern inline void dds_os_put_bytes_aligned_reserved (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a);
+
 static void dds_stream_write (dds_ostream_t * __restrict os, const char * __restrict data, const uint32_t * __restrict ops);
 static void dds_stream_read (dds_istream_t * __restrict is, char * __restrict data, const uint32_t * __restrict ops);
 
-static void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size)
+void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size)
 {
   uint32_t needed = size + st->m_index;
 
@@ -43,12 +65,6 @@ static void dds_ostream_grow (dds_ostream_t * __restrict st, uint32_t size)
   st->m_size = newSize;
 }
 
-static void dds_cdr_resize (dds_ostream_t * __restrict s, uint32_t l)
-{
-  if (s->m_size < l + s->m_index)
-    dds_ostream_grow (s, l);
-}
-
 void dds_ostream_init (dds_ostream_t * __restrict st, uint32_t size)
 {
   memset (st, 0, sizeof (*st));
@@ -72,102 +88,11 @@ void dds_ostreamBE_fini (dds_ostreamBE_t * __restrict st)
   dds_ostream_fini (&st->x);
 }
 
-static void dds_cdr_alignto (dds_istream_t * __restrict s, uint32_t a)
-{
-  s->m_index = (s->m_index + a - 1) & ~(a - 1);
-  assert (s->m_index < s->m_size);
-}
-
-static uint32_t dds_cdr_alignto_clear_and_resize (dds_ostream_t * __restrict s, uint32_t a, uint32_t extra)
-{
-  const uint32_t m = s->m_index % a;
-  if (m == 0)
-  {
-    dds_cdr_resize (s, extra);
-    return 0;
-  }
-  else
-  {
-    const uint32_t pad = a - m;
-    dds_cdr_resize (s, pad + extra);
-    for (uint32_t i = 0; i < pad; i++)
-      s->m_buffer[s->m_index++] = 0;
-    return pad;
-  }
-}
-
 static uint32_t dds_cdr_alignto_clear_and_resize_be (dds_ostreamBE_t * __restrict s, uint32_t a, uint32_t extra)
 {
   return dds_cdr_alignto_clear_and_resize (&s->x, a, extra);
 }
 
-static uint8_t dds_is_get1 (dds_istream_t * __restrict s)
-{
-  assert (s->m_index < s->m_size);
-  uint8_t v = *(s->m_buffer + s->m_index);
-  s->m_index++;
-  return v;
-}
-
-static uint16_t dds_is_get2 (dds_istream_t * __restrict s)
-{
-  dds_cdr_alignto (s, 2);
-  uint16_t v = * ((uint16_t *) (s->m_buffer + s->m_index));
-  s->m_index += 2;
-  return v;
-}
-
-static uint32_t dds_is_get4 (dds_istream_t * __restrict s)
-{
-  dds_cdr_alignto (s, 4);
-  uint32_t v = * ((uint32_t *) (s->m_buffer + s->m_index));
-  s->m_index += 4;
-  return v;
-}
-
-static uint64_t dds_is_get8 (dds_istream_t * __restrict s)
-{
-  dds_cdr_alignto (s, 8);
-  uint64_t v = * ((uint64_t *) (s->m_buffer + s->m_index));
-  s->m_index += 8;
-  return v;
-}
-
-static void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size)
-{
-  dds_cdr_alignto (s, elem_size);
-  memcpy (b, s->m_buffer + s->m_index, num * elem_size);
-  s->m_index += num * elem_size;
-}
-
-static void dds_os_put1 (dds_ostream_t * __restrict s, uint8_t v)
-{
-  dds_cdr_resize (s, 1);
-  *((uint8_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 1;
-}
-
-static void dds_os_put2 (dds_ostream_t * __restrict s, uint16_t v)
-{
-  dds_cdr_alignto_clear_and_resize (s, 2, 2);
-  *((uint16_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 2;
-}
-
-static void dds_os_put4 (dds_ostream_t * __restrict s, uint32_t v)
-{
-  dds_cdr_alignto_clear_and_resize (s, 4, 4);
-  *((uint32_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 4;
-}
-
-static void dds_os_put8 (dds_ostream_t * __restrict s, uint64_t v)
-{
-  dds_cdr_alignto_clear_and_resize (s, 8, 8);
-  *((uint64_t *) (s->m_buffer + s->m_index)) = v;
-  s->m_index += 8;
-}
-
 static void dds_os_put1be (dds_ostreamBE_t * __restrict s, uint8_t v)
 {
   dds_os_put1 (&s->x, v);
@@ -188,21 +113,6 @@ static void dds_os_put8be (dds_ostreamBE_t * __restrict s, uint64_t v)
   dds_os_put8 (&s->x, ddsrt_toBE8u (v));
 }
 
-static void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l)
-{
-  dds_cdr_resize (s, l);
-  memcpy (s->m_buffer + s->m_index, b, l);
-  s->m_index += l;
-}
-
-static void dds_os_put_bytes_aligned (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t n, uint32_t a)
-{
-  const uint32_t l = n * a;
-  dds_cdr_alignto_clear_and_resize (s, a, l);
-  memcpy (s->m_buffer + s->m_index, b, l);
-  s->m_index += l;
-}
-
 static uint32_t get_type_size (enum dds_stream_typecode type)
 {
   DDSRT_STATIC_ASSERT (DDS_OP_VAL_1BY == 1 && DDS_OP_VAL_2BY == 2 && DDS_OP_VAL_4BY == 3 && DDS_OP_VAL_8BY == 4);
@@ -210,50 +120,115 @@ static uint32_t get_type_size (enum dds_stream_typecode type)
   return (uint32_t)1 << ((uint32_t) type - 1);
 }
 
-static size_t dds_stream_check_optimize1 (const struct ddsi_sertopic_default_desc * __restrict desc)
+/* Checks whether the CDR representation of the (sub)type described by "ops"
+   is identical to its in-memory representation, given that the CDR stream
+   is at offset "base" relative to the start of the (sub)type in memory.
+   For this, all members must be primitives or arrays of primitives or of
+   such structs (nested structs are inlined in the ops), and the memory
+   layout must not contain any padding not also present in CDR.  That
+   excludes, e.g., a struct containing a struct starting with a 1-byte
+   field and aligned to 4 bytes.  Trailing padding is allowed, it simply
+   is not part of the CDR representation.
+
+   On success returns true, *cdrsize the offset in CDR at the end of the
+   last member and *align the largest alignment of any member. */
+static bool dds_stream_check_optimize1 (const uint32_t * __restrict ops, uint32_t * __restrict cdrsize, uint32_t * __restrict align)
 {
-  const uint32_t *ops = desc->m_ops;
-  uint32_t insn;
+  uint32_t off = 0, insn;
   while ((insn = *ops) != DDS_OP_RTS)
   {
+    uint32_t elem_size, num, elem_align;
     if (DDS_OP (insn) != DDS_OP_ADR)
-      return 0;
-
+      return false;
     switch (DDS_OP_TYPE (insn))
     {
-      case DDS_OP_VAL_1BY:
-      case DDS_OP_VAL_2BY:
-      case DDS_OP_VAL_4BY:
-      case DDS_OP_VAL_8BY:
-        if ((ops[1] % get_type_size (DDS_OP_TYPE (insn))) != 0)
-          return 0;
-        ops += 2;
+      case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+        elem_size = elem_align = get_type_size (DDS_OP_TYPE (insn));
+        num = 1;
         break;
-
       case DDS_OP_VAL_ARR:
+        num = ops[2];
         switch (DDS_OP_SUBTYPE (insn))
         {
           case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
-            if ((ops[1] % get_type_size (DDS_OP_SUBTYPE (insn))) != 0)
-              return 0;
-            ops += 3;
+            elem_size = elem_align = get_type_size (DDS_OP_SUBTYPE (insn));
+            break;
+          case DDS_OP_VAL_STU: {
+            /* an element must be contiguous in CDR, i.e., start at an offset
+               aligned to the strictest alignment inside it and have no
+               trailing padding, so that all elements are laid out alike */
+            uint32_t elem_cdrsize;
+            elem_size = ops[4];
+            elem_align = 1;
+            if (!dds_stream_check_optimize1 (ops + DDS_OP_ADR_JSR (ops[3]), &elem_cdrsize, &elem_align))
+              return false;
+            if (elem_cdrsize != elem_size || (ops[1] % elem_align) != 0)
+              return false;
             break;
+          }
           default:
-            return 0;
+            return false;
         }
         break;
-
       default:
-        return 0;
+        return false;
+    }
+    /* CDR aligns to the element size (at most 8 for XCDR1), the member
+       must be at exactly that position in memory as well */
+    off = (off + elem_align - 1) & ~(elem_align - 1);
+    if (ops[1] != off)
+      return false;
+    if (elem_align > *align)
+      *align = elem_align;
+    off += num * elem_size;
+    switch (DDS_OP_TYPE (insn))
+    {
+      case DDS_OP_VAL_ARR:
+        if (DDS_OP_SUBTYPE (insn) == DDS_OP_VAL_STU)
+          ops += DDS_OP_ADR_JMP (ops[3]) ? DDS_OP_ADR_JMP (ops[3]) : 5;
+        else
+          ops += 3;
+        break;
+      default:
+        ops += 2;
+        break;
     }
   }
-
-  return desc->m_size;
+  *cdrsize = off;
+  return true;
 }
 
 size_t dds_stream_check_optimize (const struct ddsi_sertopic_default_desc * __restrict desc)
 {
-  return dds_stream_check_optimize1 (desc);
+  uint32_t cdrsize, align = 1;
+  if (!dds_stream_check_optimize1 (desc->m_ops, &cdrsize, &align))
+    return 0;
+  assert (cdrsize <= desc->m_size);
+  return cdrsize;
+}
+
+uint32_t dds_stream_cdr_align (const struct ddsi_sertopic_default_desc * __restrict desc)
+{
+  /* Conservative: any word that looks like an instruction involving an
+     8-byte value counts, even if it is really an operand of another one */
+  for (uint32_t i = 0; i < desc->m_nops; i++)
+  {
+    const uint32_t insn = desc->m_ops[i];
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR:
+        if (DDS_OP_TYPE (insn) == DDS_OP_VAL_8BY || DDS_OP_SUBTYPE (insn) == DDS_OP_VAL_8BY)
+          return 8;
+        break;
+      case DDS_OP_JEQ:
+        if (DDS_JEQ_TYPE (insn) == DDS_OP_VAL_8BY)
+          return 8;
+        break;
+      default:
+        break;
+    }
+  }
+  return 4;
 }
 
 static void dds_stream_countops1 (const uint32_t * __restrict ops, const uint32_t **ops_end);
@@ -387,7 +362,7 @@ uint32_t dds_stream_countops (const uint32_t * __restrict ops)
   return (uint32_t) (ops_end - ops);
 }
 
-static void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char * __restrict str, const uint32_t bound)
+void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char * __restrict str, const uint32_t bound)
 {
   const uint32_t length = dds_is_get4 (is);
   const void *src = is->m_buffer + is->m_index;
@@ -399,7 +374,7 @@ static void dds_stream_reuse_string_bound (dds_istream_t * __restrict is, char *
   is->m_index += length;
 }
 
-static char *dds_stream_reuse_string (dds_istream_t * __restrict is, char * __restrict str)
+char *dds_stream_reuse_string (dds_istream_t * __restrict is, char * __restrict str)
 {
   const uint32_t length = dds_is_get4 (is);
   const void *src = is->m_buffer + is->m_index;
@@ -416,13 +391,26 @@ static void dds_stream_skip_forward (dds_istream_t * __restrict is, uint32_t len
     is->m_index += len * elem_size;
 }
 
-static void dds_stream_skip_string (dds_istream_t * __restrict is)
+void dds_stream_skip_string (dds_istream_t * __restrict is)
 {
   const uint32_t length = dds_is_get4 (is);
   dds_stream_skip_forward (is, length, 1);
 }
 
-static void dds_stream_write_string (dds_ostream_t * __restrict os, const char * __restrict val)
+void dds_stream_skip_primarray (dds_istream_t * __restrict is, uint32_t num, uint32_t elem_size)
+{
+  dds_cdr_alignto (is, elem_size);
+  is->m_index += num * elem_size;
+}
+
+void dds_stream_skip_primseq (dds_istream_t * __restrict is, uint32_t elem_size)
+{
+  const uint32_t num = dds_is_get4 (is);
+  if (num > 0)
+    dds_stream_skip_primarray (is, num, elem_size);
+}
+
+void dds_stream_write_string (dds_ostream_t * __restrict os, const char * __restrict val)
 {
   uint32_t size = 1;
 
@@ -444,6 +432,13 @@ static void dds_stream_write_string (dds_ostream_t * __restrict os, const char *
   }
 }
 
+void dds_stream_write_primseq (dds_ostream_t * __restrict os, const dds_sequence_t * __restrict seq, uint32_t elem_size)
+{
+  dds_os_put4 (os, seq->_length);
+  if (seq->_length > 0)
+    dds_os_put_bytes_aligned (os, seq->_buffer, seq->_length, elem_size);
+}
+
 static void dds_streamBE_write_string (dds_ostreamBE_t * __restrict os, const char * __restrict val)
 {
   uint32_t size = 1;
@@ -673,6 +668,171 @@ static void dds_stream_write (dds_ostream_t * __restrict os, const char * __rest
   }
 }
 
+/* Size computation: mirrors dds_stream_write, but only advances the offset.
+   Offsets are relative to a stream position that is 8-byte aligned. */
+static uint32_t dds_stream_getsize (uint32_t off, const char * __restrict data, const uint32_t * __restrict ops);
+
+static uint32_t getsize_align (uint32_t off, uint32_t a)
+{
+  return (off + a - 1) & ~(a - 1);
+}
+
+static uint32_t getsize_prim (uint32_t off, uint32_t size)
+{
+  return getsize_align (off, size) + size;
+}
+
+static uint32_t getsize_string (uint32_t off, const char * __restrict val)
+{
+  return getsize_align (off, 4) + 4 + (val ? (uint32_t) strlen (val) + 1 : 1);
+}
+
+static const uint32_t *dds_stream_getsize_seq (uint32_t * __restrict off, const char * __restrict addr, const uint32_t * __restrict ops, uint32_t insn)
+{
+  const dds_sequence_t * const seq = (const dds_sequence_t *) addr;
+  const uint32_t num = seq->_length;
+
+  *off = getsize_prim (*off, 4);
+  if (num == 0)
+    return skip_sequence_insns (ops, insn);
+
+  const enum dds_stream_typecode subtype = DDS_OP_SUBTYPE (insn);
+  switch (subtype)
+  {
+    case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
+      const uint32_t elem_size = get_type_size (subtype);
+      *off = getsize_align (*off, elem_size) + num * elem_size;
+      return ops + 2;
+    }
+    case DDS_OP_VAL_STR: {
+      const char **ptr = (const char **) seq->_buffer;
+      for (uint32_t i = 0; i < num; i++)
+        *off = getsize_string (*off, ptr[i]);
+      return ops + 2;
+    }
+    case DDS_OP_VAL_BST: {
+      const char *ptr = (const char *) seq->_buffer;
+      const uint32_t elem_size = ops[2];
+      for (uint32_t i = 0; i < num; i++)
+        *off = getsize_string (*off, ptr + i * elem_size);
+      return ops + 3;
+    }
+    case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: {
+      const uint32_t elem_size = ops[2];
+      const uint32_t jmp = DDS_OP_ADR_JMP (ops[3]);
+      uint32_t const * const jsr_ops = ops + DDS_OP_ADR_JSR (ops[3]);
+      const char *ptr = (const char *) seq->_buffer;
+      for (uint32_t i = 0; i < num; i++)
+        *off = dds_stream_getsize (*off, ptr + i * elem_size, jsr_ops);
+      return ops + (jmp ? jmp : 4);
+    }
+  }
+  return NULL;
+}
+
+static const uint32_t *dds_stream_getsize_arr (uint32_t * __restrict off, const char * __restrict addr, const uint32_t * __restrict ops, uint32_t insn)
+{
+  const enum dds_stream_typecode subtype = DDS_OP_SUBTYPE (insn);
+  const uint32_t num = ops[2];
+  switch (subtype)
+  {
+    case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
+      const uint32_t elem_size = get_type_size (subtype);
+      *off = getsize_align (*off, elem_size) + num * elem_size;
+      return ops + 3;
+    }
+    case DDS_OP_VAL_STR: {
+      const char **ptr = (const char **) addr;
+      for (uint32_t i = 0; i < num; i++)
+        *off = getsize_string (*off, ptr[i]);
+      return ops + 3;
+    }
+    case DDS_OP_VAL_BST: {
+      const char *ptr = (const char *) addr;
+      const uint32_t elem_size = ops[4];
+      for (uint32_t i = 0; i < num; i++)
+        *off = getsize_string (*off, ptr + i * elem_size);
+      return ops + 5;
+    }
+    case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: {
+      const uint32_t *jsr_ops = ops + DDS_OP_ADR_JSR (ops[3]);
+      const uint32_t jmp = DDS_OP_ADR_JMP (ops[3]);
+      const uint32_t elem_size = ops[4];
+      for (uint32_t i = 0; i < num; i++)
+        *off = dds_stream_getsize (*off, addr + i * elem_size, jsr_ops);
+      return ops + (jmp ? jmp : 5);
+    }
+  }
+  return NULL;
+}
+
+static const uint32_t *dds_stream_getsize_uni (uint32_t * __restrict off, const char * __restrict discaddr, const char * __restrict baseaddr, const uint32_t * __restrict ops, uint32_t insn)
+{
+  uint32_t disc;
+  switch (DDS_OP_SUBTYPE (insn))
+  {
+    case DDS_OP_VAL_1BY: disc = *((const uint8_t *) discaddr); *off = getsize_prim (*off, 1); break;
+    case DDS_OP_VAL_2BY: disc = *((const uint16_t *) discaddr); *off = getsize_prim (*off, 2); break;
+    case DDS_OP_VAL_4BY: disc = *((const uint32_t *) discaddr); *off = getsize_prim (*off, 4); break;
+    default: disc = 0; break;
+  }
+  uint32_t const * const jeq_op = find_union_case (ops, disc);
+  ops += DDS_OP_ADR_JMP (ops[3]);
+  if (jeq_op)
+  {
+    const enum dds_stream_typecode valtype = DDS_JEQ_TYPE (jeq_op[0]);
+    const char *valaddr = baseaddr + jeq_op[2];
+    switch (valtype)
+    {
+      case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+        *off = getsize_prim (*off, get_type_size (valtype));
+        break;
+      case DDS_OP_VAL_STR: *off = getsize_string (*off, *(const char **) valaddr); break;
+      case DDS_OP_VAL_BST: *off = getsize_string (*off, valaddr); break;
+      case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU:
+        *off = dds_stream_getsize (*off, valaddr, jeq_op + DDS_OP_ADR_JSR (jeq_op[0]));
+        break;
+    }
+  }
+  return ops;
+}
+
+static uint32_t dds_stream_getsize (uint32_t off, const char * __restrict data, const uint32_t * __restrict ops)
+{
+  uint32_t insn;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR: {
+        const char *addr = data + ops[1];
+        switch (DDS_OP_TYPE (insn))
+        {
+          case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+            off = getsize_prim (off, get_type_size (DDS_OP_TYPE (insn))); ops += 2; break;
+          case DDS_OP_VAL_STR: off = getsize_string (off, *((const char **) addr)); ops += 2; break;
+          case DDS_OP_VAL_BST: off = getsize_string (off, addr); ops += 3; break;
+          case DDS_OP_VAL_SEQ: ops = dds_stream_getsize_seq (&off, addr, ops, insn); break;
+          case DDS_OP_VAL_ARR: ops = dds_stream_getsize_arr (&off, addr, ops, insn); break;
+          case DDS_OP_VAL_UNI: ops = dds_stream_getsize_uni (&off, addr, data, ops, insn); break;
+          case DDS_OP_VAL_STU: abort (); break;
+        }
+        break;
+      }
+      case DDS_OP_JSR: {
+        off = dds_stream_getsize (off, data, ops + DDS_OP_JUMP (insn));
+        ops++;
+        break;
+      }
+      case DDS_OP_RTS: case DDS_OP_JEQ: {
+        abort ();
+        break;
+      }
+    }
+  }
+  return off;
+}
+
 static void realloc_sequence_buffer_if_needed (dds_sequence_t * __restrict seq, uint32_t num, uint32_t elem_size, bool init)
 {
   const uint32_t size = num * elem_size;
@@ -701,6 +861,24 @@ static void realloc_sequence_buffer_if_needed (dds_sequence_t * __restrict seq,
   }
 }
 
+static void read_primseq_elems (dds_istream_t * __restrict is, dds_sequence_t * __restrict seq, uint32_t num, uint32_t elem_size)
+{
+  realloc_sequence_buffer_if_needed (seq, num, elem_size, false);
+  seq->_length = (num <= seq->_maximum) ? num : seq->_maximum;
+  dds_is_get_bytes (is, seq->_buffer, seq->_length, elem_size);
+  if (seq->_length < num)
+    dds_stream_skip_forward (is, num - seq->_length, elem_size);
+}
+
+void dds_stream_read_primseq (dds_istream_t * __restrict is, dds_sequence_t * __restrict seq, uint32_t elem_size)
+{
+  const uint32_t num = dds_is_get4 (is);
+  if (num == 0)
+    seq->_length = 0;
+  else
+    read_primseq_elems (is, seq, num, elem_size);
+}
+
 static const uint32_t *dds_stream_read_seq (dds_istream_t * __restrict is, char * __restrict addr, const uint32_t * __restrict ops, uint32_t insn)
 {
   dds_sequence_t * const seq = (dds_sequence_t *) addr;
@@ -715,12 +893,7 @@ static const uint32_t *dds_stream_read_seq (dds_istream_t * __restrict is, char
   switch (subtype)
   {
     case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
-      const uint32_t elem_size = get_type_size (subtype);
-      realloc_sequence_buffer_if_needed (seq, num, elem_size, false);
-      seq->_length = (num <= seq->_maximum) ? num : seq->_maximum;
-      dds_is_get_bytes (is, seq->_buffer, seq->_length, elem_size);
-      if (seq->_length < num)
-        dds_stream_skip_forward (is, num - seq->_length, elem_size);
+      read_primseq_elems (is, seq, num, get_type_size (subtype));
       return ops + 2;
     }
     case DDS_OP_VAL_STR: {
@@ -978,8 +1151,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if (bswap)
       {
         uint16_t *xs = (uint16_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap2u (xs[i]);
+        ddsrt_bswap2u_array (xs, xs, num);
       }
       *off += 2 * num;
       return true;
@@ -989,8 +1161,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if (bswap)
       {
         uint32_t *xs = (uint32_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap4u (xs[i]);
+        ddsrt_bswap4u_array (xs, xs, num);
       }
       *off += 4 * num;
       return true;
@@ -1000,8 +1171,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if (bswap)
       {
         uint64_t *xs = (uint64_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap8u (xs[i]);
+        ddsrt_bswap8u_array (xs, xs, num);
       }
       *off += 8 * num;
       return true;
@@ -1194,15 +1364,62 @@ static bool stream_normalize_key (void * __restrict data, uint32_t size, bool bs
   return true;
 }
 
+bool dds_stream_normalize_uint8 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap)
+{
+  (void) data; (void) bswap;
+  return normalize_uint8 (off, size);
+}
+
+bool dds_stream_normalize_uint16 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap)
+{
+  return normalize_uint16 (data, off, size, bswap);
+}
+
+bool dds_stream_normalize_uint32 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap)
+{
+  return normalize_uint32 (data, off, size, bswap);
+}
+
+bool dds_stream_normalize_uint64 (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap)
+{
+  return normalize_uint64 (data, off, size, bswap);
+}
+
+bool dds_stream_normalize_string (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, size_t maxsz)
+{
+  return normalize_string (data, off, size, bswap, maxsz);
+}
+
+bool dds_stream_normalize_primarray (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, uint32_t num, enum dds_stream_typecode type)
+{
+  return normalize_primarray (data, off, size, bswap, num, type);
+}
+
+bool dds_stream_normalize_primseq (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap, enum dds_stream_typecode type)
+{
+  uint32_t num;
+  if (!read_and_normalize_uint32 (&num, data, off, size, bswap))
+    return false;
+  return (num == 0) || normalize_primarray (data, off, size, bswap, num, type);
+}
+
 bool dds_stream_normalize (void * __restrict data, uint32_t size, bool bswap, const struct ddsi_sertopic_default * __restrict topic, bool just_key)
 {
   if (size > CDR_SIZE_MAX)
     return false;
   if (just_key)
     return stream_normalize_key (data, size, bswap, &topic->type);
+  else if (topic->opt_size && !bswap)
+  {
+    /* the memory layout is that of CDR, so there is nothing to check but
+       the size (booleans are never checked) */
+    return size >= topic->opt_size;
+  }
   else
   {
     uint32_t off = 0;
+    if (topic->type.m_marshal)
+      return topic->type.m_marshal->m_normalize (data, &off, size, bswap);
     return stream_normalize (data, &off, size, bswap, topic->type.m_ops);
   }
 }
@@ -1414,7 +1631,7 @@ void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict da
 {
   const struct ddsi_sertopic_default_desc *desc = &topic->type;
   if (topic->opt_size)
-    dds_is_get_bytes (is, data, desc->m_size, 1);
+    dds_is_get_bytes (is, data, (uint32_t) topic->opt_size, 1);
   else
   {
     if (desc->m_flagset & DDS_TOPIC_CONTAINS_UNION)
@@ -1428,7 +1645,10 @@ void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict da
       dds_stream_free_sample (data, desc->m_ops);
       memset (data, 0, desc->m_size);
     }
-    dds_stream_read (is, data, desc->m_ops);
+    if (desc->m_marshal)
+      desc->m_marshal->m_read (is, data);
+    else
+      dds_stream_read (is, data, desc->m_ops);
   }
 }
 
@@ -1436,11 +1656,51 @@ void dds_stream_write_sample (dds_ostream_t * __restrict os, const void * __rest
 {
   const struct ddsi_sertopic_default_desc *desc = &topic->type;
   if (topic->opt_size && desc->m_align && (os->m_index % desc->m_align) == 0)
-    dds_os_put_bytes (os, data, desc->m_size);
+    dds_os_put_bytes (os, data, (uint32_t) topic->opt_size);
+  else if (desc->m_marshal)
+    desc->m_marshal->m_write (os, data);
   else
     dds_stream_write (os, data, desc->m_ops);
 }
 
+uint32_t dds_stream_getsize_sample (const void * __restrict data, const struct ddsi_sertopic_default * __restrict topic)
+{
+  if (topic->opt_size)
+    return (uint32_t) topic->opt_size;
+  else
+    return dds_stream_getsize (0, data, topic->type.m_ops);
+}
+
+uint32_t dds_stream_getsize_key (const char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic)
+{
+  const struct ddsi_sertopic_default_desc *desc = &topic->type;
+  uint32_t off = 0;
+  for (uint32_t i = 0; i < desc->m_nkeys; i++)
+  {
+    const uint32_t *insnp = desc->m_ops + desc->m_keys[i];
+    const char *src = sample + insnp[1];
+    assert (insn_key_ok_p (*insnp));
+    switch (DDS_OP_TYPE (*insnp))
+    {
+      case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+        off = getsize_prim (off, get_type_size (DDS_OP_TYPE (*insnp)));
+        break;
+      case DDS_OP_VAL_STR: off = getsize_string (off, *(const char **) src); break;
+      case DDS_OP_VAL_BST: off = getsize_string (off, src); break;
+      case DDS_OP_VAL_ARR: {
+        const uint32_t elem_size = get_type_size (DDS_OP_SUBTYPE (*insnp));
+        off = getsize_align (off, elem_size) + insnp[2] * elem_size;
+        break;
+      }
+      case DDS_OP_VAL_SEQ: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: {
+        abort ();
+        break;
+      }
+    }
+  }
+  return off;
+}
+
 void dds_stream_read_key (dds_istream_t * __restrict is, char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic)
 {
   const struct ddsi_sertopic_default_desc *desc = &topic->type;
@@ -1470,6 +1730,11 @@ void dds_stream_read_key (dds_istream_t * __restrict is, char * __restrict sampl
 void dds_stream_write_key (dds_ostream_t * __restrict os, const char * __restrict sample, const struct ddsi_sertopic_default * __restrict topic)
 {
   const struct ddsi_sertopic_default_desc *desc = &topic->type;
+  if (desc->m_marshal)
+  {
+    desc->m_marshal->m_write_key (os, sample);
+    return;
+  }
   for (uint32_t i = 0; i < desc->m_nkeys; i++)
   {
     const uint32_t *insnp = desc->m_ops + desc->m_keys[i];
@@ -1504,26 +1769,10 @@ static void dds_stream_swap_insitu (void * __restrict vbuf, uint32_t size, uint3
   assert (size == 1 || size == 2 || size == 4 || size == 8);
   switch (size)
   {
-    case 1:
-      break;
-    case 2: {
-      uint16_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap2u (buf[i]);
-      break;
-    }
-    case 4: {
-      uint32_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap4u (buf[i]);
-      break;
-    }
-    case 8: {
-      uint64_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap8u (buf[i]);
-      break;
-    }
+    case 1: break;
+    case 2: ddsrt_bswap2u_array (vbuf, vbuf, num); break;
+    case 4: ddsrt_bswap4u_array (vbuf, vbuf, num); break;
+    case 8: ddsrt_bswap8u_array (vbuf, vbuf, num); break;
   }
 }
 
@@ -1578,6 +1827,22 @@ void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __res
 
 static void dds_stream_extract_key_from_data1 (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const uint32_t * __restrict ops, uint32_t * __restrict keys_remaining);
 
+void dds_stream_extract_key_string (dds_istream_t * __restrict is, dds_ostream_t * __restrict os)
+{
+  uint32_t sz = dds_is_get4 (is);
+  dds_os_put4 (os, sz);
+  dds_os_put_bytes (os, is->m_buffer + is->m_index, sz);
+  is->m_index += sz;
+}
+
+void dds_stream_extract_key_primarray (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, uint32_t num, uint32_t elem_size)
+{
+  dds_cdr_alignto_clear_and_resize (os, elem_size, num * elem_size);
+  void * const dst = os->m_buffer + os->m_index;
+  dds_is_get_bytes (is, dst, num, elem_size);
+  os->m_index += num * elem_size;
+}
+
 static void dds_stream_extract_key_from_key_prim_op (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const uint32_t * __restrict op)
 {
   assert ((*op & DDS_OP_FLAG_KEY) && ((DDS_OP (*op)) == DDS_OP_ADR));
@@ -1588,22 +1853,13 @@ static void dds_stream_extract_key_from_key_prim_op (dds_istream_t * __restrict
     case DDS_OP_VAL_4BY: dds_os_put4 (os, dds_is_get4 (is)); break;
     case DDS_OP_VAL_8BY: dds_os_put8 (os, dds_is_get8 (is)); break;
     case DDS_OP_VAL_STR: case DDS_OP_VAL_BST: {
-      uint32_t sz = dds_is_get4 (is);
-      dds_os_put4 (os, sz);
-      dds_os_put_bytes (os, is->m_buffer + is->m_index, sz);
-      is->m_index += sz;
+      dds_stream_extract_key_string (is, os);
       break;
     }
     case DDS_OP_VAL_ARR: {
       const uint32_t subtype = DDS_OP_SUBTYPE (*op);
       assert (subtype <= DDS_OP_VAL_8BY);
-      const uint32_t align = get_type_size (subtype);
-      const uint32_t num = op[2];
-      dds_cdr_alignto_clear_and_resize (os, align, num * align);
-      void * const dst = os->m_buffer + os->m_index;
-      dds_is_get_bytes (is, dst, num, align);
-      os->m_index += num * align;
-      is->m_index += num * align;
+      dds_stream_extract_key_primarray (is, os, op[2], get_type_size (subtype));
       break;
     }
     case DDS_OP_VAL_SEQ: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: {
@@ -1619,30 +1875,10 @@ static void dds_stream_swap_copy (void * __restrict vdst, const void * __restric
   assert (size == 1 || size == 2 || size == 4 || size == 8);
   switch (size)
   {
-    case 1:
-      memcpy (vdst, vsrc, num);
-      break;
-    case 2: {
-      const uint16_t *src = vsrc;
-      uint16_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap2u (src[i]);
-      break;
-    }
-    case 4: {
-      const uint32_t *src = vsrc;
-      uint32_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap4u (src[i]);
-      break;
-    }
-    case 8: {
-      const uint64_t *src = vsrc;
-      uint64_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap8u (src[i]);
-      break;
-    }
+    case 1: memcpy (vdst, vsrc, num); break;
+    case 2: ddsrt_bswap2u_array (vdst, vsrc, num); break;
+    case 4: ddsrt_bswap4u_array (vdst, vsrc, num); break;
+    case 8: ddsrt_bswap8u_array (vdst, vsrc, num); break;
   }
 }
 #endif
@@ -1894,8 +2130,13 @@ static void dds_stream_extract_keyBE_from_data1 (dds_istream_t * __restrict is,
 void dds_stream_extract_key_from_data (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const struct ddsi_sertopic_default * __restrict topic)
 {
   const struct ddsi_sertopic_default_desc *desc = &topic->type;
-  uint32_t keys_remaining = desc->m_nkeys;
-  dds_stream_extract_key_from_data1 (is, os, desc->m_ops, &keys_remaining);
+  if (desc->m_marshal)
+    desc->m_marshal->m_extract_key (is, os);
+  else
+  {
+    uint32_t keys_remaining = desc->m_nkeys;
+    dds_stream_extract_key_from_data1 (is, os, desc->m_ops, &keys_remaining);
+  }
 }
 
 void dds_stream_extract_keyBE_from_data (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const struct ddsi_sertopic_default * __restrict topic)
@@ -1946,6 +2187,196 @@ void dds_stream_extract_keyhash (dds_istream_t * __restrict is, dds_keyhash_t *
   }
 }
 
+/*******************************************************************************************
+ **
+ **  Field access
+ **
+ *******************************************************************************************/
+
+static const uint32_t *skip_adr_insns (const uint32_t * __restrict ops, uint32_t insn)
+{
+  switch (DDS_OP_TYPE (insn))
+  {
+    case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: case DDS_OP_VAL_STR:
+      return ops + 2;
+    case DDS_OP_VAL_BST:
+      return ops + 3;
+    case DDS_OP_VAL_SEQ:
+      return skip_sequence_insns (ops, insn);
+    case DDS_OP_VAL_ARR:
+      if (DDS_OP_SUBTYPE (insn) > DDS_OP_VAL_BST)
+        return ops + (DDS_OP_ADR_JMP (ops[3]) ? DDS_OP_ADR_JMP (ops[3]) : 5);
+      return ops + 3;
+    case DDS_OP_VAL_UNI:
+      return ops + DDS_OP_ADR_JMP (ops[3]);
+    case DDS_OP_VAL_STU:
+      break;
+  }
+  return NULL;
+}
+
+static bool fieldref_init (struct dds_stream_fieldref * __restrict f, const struct ddsi_sertopic_default_desc * __restrict desc, bool by_index, uint32_t offset_or_index)
+{
+  const uint32_t *ops = desc->m_ops;
+  uint32_t insn, cdroff = 0;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    if (DDS_OP (insn) != DDS_OP_ADR)
+      return false;
+    const enum dds_stream_typecode type = DDS_OP_TYPE (insn);
+    switch (type)
+    {
+      case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
+        const uint32_t sz = get_type_size (type);
+        if (cdroff != UINT32_MAX)
+          cdroff = (cdroff + sz - 1) & ~(sz - 1);
+        if ((by_index ? (uint32_t) (ops - desc->m_ops) : ops[1]) == offset_or_index)
+        {
+          f->op_index = (uint32_t) (ops - desc->m_ops);
+          f->cdroff = cdroff;
+          f->insn = insn;
+          return true;
+        }
+        if (cdroff != UINT32_MAX)
+          cdroff += sz;
+        break;
+      }
+      case DDS_OP_VAL_ARR:
+        if (DDS_OP_SUBTYPE (insn) <= DDS_OP_VAL_8BY && cdroff != UINT32_MAX)
+        {
+          const uint32_t sz = get_type_size (DDS_OP_SUBTYPE (insn));
+          cdroff = ((cdroff + sz - 1) & ~(sz - 1)) + ops[2] * sz;
+        }
+        else
+        {
+          cdroff = UINT32_MAX;
+        }
+        break;
+      default:
+        cdroff = UINT32_MAX;
+        break;
+    }
+    if ((ops = skip_adr_insns (ops, insn)) == NULL)
+      return false;
+  }
+  return false;
+}
+
+bool dds_stream_fieldref_init (struct dds_stream_fieldref * __restrict f, const struct ddsi_sertopic_default_desc * __restrict desc, uint32_t offset)
+{
+  return fieldref_init (f, desc, false, offset);
+}
+
+bool dds_stream_fieldref_init_index (struct dds_stream_fieldref * __restrict f, const struct ddsi_sertopic_default_desc * __restrict desc, uint32_t op_index)
+{
+  return fieldref_init (f, desc, true, op_index);
+}
+
+uint32_t dds_stream_fieldref_type_hash (const struct ddsi_sertopic_default_desc * __restrict desc)
+{
+  /* the ops include the offsets in the in-memory representation, so the hash can
+     differ for the same type on different platforms, that's merely conservative */
+  return ddsrt_mh3 (desc->m_ops, desc->m_nops * sizeof (*desc->m_ops), 0);
+}
+
+bool dds_stream_read_field (dds_istream_t * __restrict is, const struct ddsi_sertopic_default_desc * __restrict desc, const struct dds_stream_fieldref * __restrict f, void * __restrict value)
+{
+  const uint32_t sz = get_type_size (DDS_OP_TYPE (f->insn));
+  uint32_t off;
+  if (f->cdroff != UINT32_MAX)
+    off = f->cdroff;
+  else
+  {
+    /* skip the preceding members, the way key extraction does */
+    const uint32_t *ops = desc->m_ops;
+    const uint32_t * const target = desc->m_ops + f->op_index;
+    while (ops < target)
+    {
+      const uint32_t insn = *ops;
+      const enum dds_stream_typecode type = DDS_OP_TYPE (insn);
+      assert (DDS_OP (insn) == DDS_OP_ADR);
+      switch (type)
+      {
+        case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: case DDS_OP_VAL_STR: case DDS_OP_VAL_BST:
+          dds_stream_extract_key_from_data_skip_subtype (is, 1, type, NULL);
+          ops += 2 + (type == DDS_OP_VAL_BST);
+          break;
+        case DDS_OP_VAL_SEQ:
+          ops = dds_stream_extract_key_from_data_skip_sequence (is, ops);
+          break;
+        case DDS_OP_VAL_ARR:
+          ops = dds_stream_extract_key_from_data_skip_array (is, ops);
+          break;
+        case DDS_OP_VAL_UNI:
+          ops = dds_stream_extract_key_from_data_skip_union (is, ops);
+          break;
+        case DDS_OP_VAL_STU:
+          abort ();
+      }
+    }
+    off = (is->m_index + sz - 1) & ~(sz - 1);
+  }
+  if (off > is->m_size || sz > is->m_size - off)
+    return false;
+  memcpy (value, is->m_buffer + off, sz);
+  is->m_index = off + sz;
+  return true;
+}
+
+#define FIELD_CMP(a, cmp, b) \
+  ((cmp) == DDS_STREAM_FIELD_EQ ? (a) == (b) : \
+   (cmp) == DDS_STREAM_FIELD_NE ? (a) != (b) : \
+   (cmp) == DDS_STREAM_FIELD_LT ? (a) < (b) : \
+   (cmp) == DDS_STREAM_FIELD_LE ? (a) <= (b) : \
+   (cmp) == DDS_STREAM_FIELD_GT ? (a) > (b) : \
+   (a) >= (b))
+
+static bool field_term_holds (const struct dds_stream_field_term *t, const void *v)
+{
+  const uint32_t insn = t->ref.insn;
+  switch (DDS_OP_TYPE (insn))
+  {
+    case DDS_OP_VAL_1BY:
+      if (insn & DDS_OP_FLAG_SGN)
+        return FIELD_CMP ((int64_t) *(const int8_t *) v, t->cmp, t->value.i);
+      return FIELD_CMP ((uint64_t) *(const uint8_t *) v, t->cmp, t->value.u);
+    case DDS_OP_VAL_2BY:
+      if (insn & DDS_OP_FLAG_SGN)
+        return FIELD_CMP ((int64_t) *(const int16_t *) v, t->cmp, t->value.i);
+      return FIELD_CMP ((uint64_t) *(const uint16_t *) v, t->cmp, t->value.u);
+    case DDS_OP_VAL_4BY:
+      if (insn & DDS_OP_FLAG_FP)
+        return FIELD_CMP ((double) *(const float *) v, t->cmp, t->value.d);
+      else if (insn & DDS_OP_FLAG_SGN)
+        return FIELD_CMP ((int64_t) *(const int32_t *) v, t->cmp, t->value.i);
+      return FIELD_CMP ((uint64_t) *(const uint32_t *) v, t->cmp, t->value.u);
+    case DDS_OP_VAL_8BY:
+      if (insn & DDS_OP_FLAG_FP)
+        return FIELD_CMP (*(const double *) v, t->cmp, t->value.d);
+      else if (insn & DDS_OP_FLAG_SGN)
+        return FIELD_CMP (*(const int64_t *) v, t->cmp, t->value.i);
+      return FIELD_CMP (*(const uint64_t *) v, t->cmp, t->value.u);
+    default:
+      assert (0);
+      return false;
+  }
+}
+
+#undef FIELD_CMP
+
+bool dds_stream_field_terms_hold (const struct ddsi_serdata_default * __restrict d, const struct ddsi_sertopic_default_desc * __restrict desc, uint32_t nterms, const struct dds_stream_field_term * __restrict terms)
+{
+  for (uint32_t i = 0; i < nterms; i++)
+  {
+    union { uint64_t u; double d; unsigned char b[8]; } v;
+    dds_istream_t is;
+    dds_istream_from_serdata_default (&is, d);
+    if (!dds_stream_read_field (&is, desc, &terms[i].ref, v.b) || !field_term_holds (&terms[i], v.b))
+      return false;
+  }
+  return true;
+}
+
 /*******************************************************************************************
  **
  **  Pretty-printing
@@ -2270,9 +2701,11 @@ DDSRT_STATIC_ASSERT ((offsetof (struct ddsi_serdata_default, data) % 8) == 0);
 
 void dds_istream_from_serdata_default (dds_istream_t * __restrict s, const struct ddsi_serdata_default * __restrict d)
 {
-  s->m_buffer = (const unsigned char *) d;
-  s->m_index = (uint32_t) offsetof (struct ddsi_serdata_default, data);
-  s->m_size = d->size + s->m_index;
+  /* The data may be in the receive buffer instead of in the serdata, the
+     stream therefore starts at the data */
+  s->m_buffer = (const unsigned char *) ddsi_serdata_default_data (d);
+  s->m_index = 0;
+  s->m_size = d->rmsg ? d->pos : d->size;
 #if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
   assert (d->hdr.identifier == CDR_LE);
 #elif DDSRT_ENDIAN == DDSRT_BIG_ENDIAN
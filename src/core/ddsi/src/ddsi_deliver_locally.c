@@ -24,6 +24,7 @@
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_misc.h"
 
 #define TOPIC_SAMPLE_CACHE_SIZE 4
 
@@ -166,7 +167,39 @@ dds_return_t deliver_locally_one (struct ddsi_domaingv *gv, struct entity_common
   return DDS_RETCODE_OK;
 }
 
-static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo)
+/* Progress of a batch delivery that had to be restarted: for each reader, the index
+   in the batch of the first sample it has not yet stored.  Only allocated when a
+   reliable sample is rejected, which is hopefully rare. */
+struct batch_progress {
+  ddsi_guid_t rdguid;
+  uint32_t next;
+};
+
+static uint32_t batch_progress_lookup (const struct batch_progress *progress, uint32_t nprogress, const ddsi_guid_t *rdguid)
+{
+  for (uint32_t i = 0; i < nprogress; i++)
+    if (guid_eq (&progress[i].rdguid, rdguid))
+      return progress[i].next;
+  return 0;
+}
+
+static void batch_progress_update (struct batch_progress **progress, uint32_t *nprogress, const ddsi_guid_t *rdguid, uint32_t next)
+{
+  for (uint32_t i = 0; i < *nprogress; i++)
+  {
+    if (guid_eq (&(*progress)[i].rdguid, rdguid))
+    {
+      (*progress)[i].next = next;
+      return;
+    }
+  }
+  *progress = ddsrt_realloc (*progress, (*nprogress + 1) * sizeof (**progress));
+  (*progress)[*nprogress].rdguid = *rdguid;
+  (*progress)[*nprogress].next = next;
+  (*nprogress)++;
+}
+
+static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void *vsourceinfo, const struct batch_progress *progress, uint32_t nprogress, uint32_t batchidx)
 {
   /* When deleting, pwr is no longer accessible via the hash
      tables, and consequently, a reader may be deleted without
@@ -194,8 +227,9 @@ static dds_return_t deliver_locally_slowpath (struct ddsi_domaingv *gv, struct e
       payload = ops->makesample (&tk, gv, rd->topic, vsourceinfo);
       topic_sample_cache_store (&tsc, rd->topic, payload, tk);
     }
-    /* check payload to allow for deserialisation failures */
-    if (payload)
+    /* check payload to allow for deserialisation failures, and skip readers that
+       already got this sample in a partially completed batch delivery */
+    if (payload && batch_progress_lookup (progress, nprogress, &rd->e.guid) <= batchidx)
     {
       EETRACE (source_entity, " "PGUIDFMT, PGUID (rd->e.guid));
       (void) ddsi_rhc_store (rd->rhc, wrinfo, payload, tk);
@@ -262,8 +296,86 @@ dds_return_t deliver_locally_allinsync (struct ddsi_domaingv *gv, struct entity_
     else
     {
       ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
-      rc = deliver_locally_slowpath (gv, source_entity, source_entity_locked, wrinfo, ops, vsourceinfo);
+      rc = deliver_locally_slowpath (gv, source_entity, source_entity_locked, wrinfo, ops, vsourceinfo, NULL, 0, 0);
+    }
+  } while (rc == DDS_RETCODE_TRY_AGAIN);
+  return rc;
+}
+
+static dds_return_t deliver_locally_fastpath_batch (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, uint32_t n, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void * const *vsourceinfo, struct batch_progress **progress, uint32_t *nprogress)
+{
+  struct reader ** const rdary = fastpath_rdary->rdary;
+  struct ddsi_rhc_store_elem elems[DELIVER_LOCALLY_MAX_BATCH];
+  uint32_t idx[DELIVER_LOCALLY_MAX_BATCH];
+  uint32_t i = 0;
+  assert (n <= DELIVER_LOCALLY_MAX_BATCH);
+  while (rdary[i])
+  {
+    struct ddsi_sertopic const * const topic = rdary[i]->topic;
+    uint32_t m = 0;
+    for (uint32_t k = 0; k < n; k++)
+    {
+      /* malformed payloads are skipped for all readers with this topic */
+      struct ddsi_tkmap_instance *tk;
+      struct ddsi_serdata *payload;
+      if ((payload = ops->makesample (&tk, gv, topic, vsourceinfo[k])) != NULL)
+      {
+        elems[m] = (struct ddsi_rhc_store_elem) { .wrinfo = &wrinfo[k], .sample = payload, .tk = tk };
+        idx[m++] = k;
+      }
+    }
+    do {
+      struct reader * const rd = rdary[i];
+      const uint32_t next = batch_progress_lookup (*progress, *nprogress, &rd->e.guid);
+      uint32_t j = 0;
+      while (j < m && idx[j] < next)
+        j++;
+      while (j < m && (j += ddsi_rhc_store_batch (rd->rhc, m - j, elems + j)) < m)
+      {
+        /* record what has been stored so far: on restart, the readers may be
+           in a different order or a different set */
+        dds_return_t rc;
+        for (uint32_t r = 0; r < i; r++)
+          batch_progress_update (progress, nprogress, &rdary[r]->e.guid, n);
+        batch_progress_update (progress, nprogress, &rd->e.guid, idx[j]);
+        if ((rc = ops->on_failure_fastpath (source_entity, source_entity_locked, fastpath_rdary, vsourceinfo[idx[j]])) != DDS_RETCODE_OK)
+        {
+          for (uint32_t k = 0; k < m; k++)
+            free_sample_after_store (gv, elems[k].sample, elems[k].tk);
+          return rc;
+        }
+      }
+    } while (rdary[++i] && rdary[i]->topic == topic);
+    for (uint32_t k = 0; k < m; k++)
+      free_sample_after_store (gv, elems[k].sample, elems[k].tk);
+  }
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t deliver_locally_allinsync_batch (struct ddsi_domaingv *gv, struct entity_common *source_entity, bool source_entity_locked, struct local_reader_ary *fastpath_rdary, uint32_t n, const struct ddsi_writer_info *wrinfo, const struct deliver_locally_ops * __restrict ops, void * const *vsourceinfo)
+{
+  struct batch_progress *progress = NULL;
+  uint32_t nprogress = 0;
+  dds_return_t rc;
+  do {
+    ddsrt_mutex_lock (&fastpath_rdary->rdary_lock);
+    if (fastpath_rdary->fastpath_ok)
+    {
+      EETRACE (source_entity, " => EVERYONE (batch of %"PRIu32")\n", n);
+      if (fastpath_rdary->rdary[0])
+        rc = deliver_locally_fastpath_batch (gv, source_entity, source_entity_locked, fastpath_rdary, n, wrinfo, ops, vsourceinfo, &progress, &nprogress);
+      else
+        rc = DDS_RETCODE_OK;
+      ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
+    }
+    else
+    {
+      ddsrt_mutex_unlock (&fastpath_rdary->rdary_lock);
+      rc = DDS_RETCODE_OK;
+      for (uint32_t k = 0; k < n && rc == DDS_RETCODE_OK; k++)
+        rc = deliver_locally_slowpath (gv, source_entity, source_entity_locked, &wrinfo[k], ops, vsourceinfo[k], progress, nprogress, k);
     }
   } while (rc == DDS_RETCODE_TRY_AGAIN);
+  ddsrt_free (progress);
   return rc;
 }
@@ -0,0 +1,249 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_unused.h"
+#include "dds/ddsi/q_gc.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_lwregs.h"
+
+/* Slots are grouped, each group has its own entry for an <instance,writer> pair; the
+   top bit of the bitmap marks an entry that has been removed from the table (and so
+   may not be updated anymore) */
+#define LWREGS_GROUP_SIZE 31u
+#define LWREGS_DEAD       0x80000000u
+
+struct ddsi_lwregs_entry {
+  uint64_t iid;
+  uint64_t wr_iid;
+  uint32_t group;
+  ddsrt_atomic_uint32_t slots;
+};
+
+struct ddsi_lwregs {
+  struct ddsrt_chh *hh;
+  struct ddsi_domaingv *gv;
+  ddsrt_mutex_t lock; /* for adding/removing entries and allocating slots */
+  uint32_t nslots;    /* slots allocated in "inuse" (a multiple of 32) */
+  uint32_t *inuse;
+};
+
+static void gc_buckets_impl (struct gcreq *gcreq)
+{
+  ddsrt_free (gcreq->arg);
+  gcreq_free (gcreq);
+}
+
+static void gc_buckets (void *a, void *arg)
+{
+  const struct ddsi_lwregs *regs = arg;
+  struct gcreq *gcreq = gcreq_new (regs->gv->gcreq_queue, gc_buckets_impl);
+  gcreq->arg = a;
+  gcreq_enqueue (gcreq);
+}
+
+static void gc_entry_impl (struct gcreq *gcreq)
+{
+  ddsrt_free (gcreq->arg);
+  gcreq_free (gcreq);
+}
+
+static void gc_entry (struct ddsi_lwregs *regs, struct ddsi_lwregs_entry *e)
+{
+  struct gcreq *gcreq = gcreq_new (regs->gv->gcreq_queue, gc_entry_impl);
+  gcreq->arg = e;
+  gcreq_enqueue (gcreq);
+}
+
+static uint32_t lwregs_entry_hash (const void *va)
+{
+  const struct ddsi_lwregs_entry *a = va;
+  return (uint32_t) (a->iid ^ a->wr_iid) ^ a->group;
+}
+
+static int lwregs_entry_equals (const void *va, const void *vb)
+{
+  const struct ddsi_lwregs_entry *a = va, *b = vb;
+  return a->iid == b->iid && a->wr_iid == b->wr_iid && a->group == b->group;
+}
+
+struct ddsi_lwregs *ddsi_lwregs_new (struct ddsi_domaingv *gv)
+{
+  struct ddsi_lwregs *regs = ddsrt_malloc (sizeof (*regs));
+  regs->hh = ddsrt_chh_new (1, lwregs_entry_hash, lwregs_entry_equals, gc_buckets, regs);
+  regs->gv = gv;
+  ddsrt_mutex_init (&regs->lock);
+  regs->nslots = 0;
+  regs->inuse = NULL;
+  return regs;
+}
+
+static void free_entry (void *ve, UNUSED_ARG (void *f_arg))
+{
+  ddsrt_free (ve);
+}
+
+void ddsi_lwregs_free (struct ddsi_lwregs *regs)
+{
+  /* all readers are gone by now, and with them all registrations */
+  ddsrt_chh_enum_unsafe (regs->hh, free_entry, NULL);
+  ddsrt_chh_free (regs->hh);
+  ddsrt_mutex_destroy (&regs->lock);
+  ddsrt_free (regs->inuse);
+  ddsrt_free (regs);
+}
+
+uint32_t ddsi_lwregs_alloc_slot (struct ddsi_lwregs *regs)
+{
+  uint32_t slot;
+  ddsrt_mutex_lock (&regs->lock);
+  for (slot = 0; slot < regs->nslots; slot++)
+    if (!(regs->inuse[slot / 32] & (1u << (slot % 32))))
+      break;
+  if (slot == regs->nslots)
+  {
+    const uint32_t nslots1 = (regs->nslots == 0) ? 32 : 2 * regs->nslots;
+    regs->inuse = ddsrt_realloc (regs->inuse, nslots1 / 32 * sizeof (*regs->inuse));
+    memset (regs->inuse + regs->nslots / 32, 0, (nslots1 - regs->nslots) / 32 * sizeof (*regs->inuse));
+    regs->nslots = nslots1;
+  }
+  regs->inuse[slot / 32] |= 1u << (slot % 32);
+  ddsrt_mutex_unlock (&regs->lock);
+  return slot;
+}
+
+static void remove_if_unused_locked (struct ddsi_lwregs *regs, struct ddsi_lwregs_entry *e)
+{
+  /* Lock-free updates to "slots" fail once it is marked dead, entries are only
+     removed with the lock held and so any entry found in the table while holding
+     the lock is not dead */
+  if (ddsrt_atomic_cas32 (&e->slots, 0, LWREGS_DEAD))
+  {
+    int x = ddsrt_chh_remove (regs->hh, e);
+    assert (x);
+    (void) x;
+    gc_entry (regs, e);
+  }
+}
+
+void ddsi_lwregs_free_slot (struct ddsi_lwregs *regs, uint32_t slot, uint32_t nregs)
+{
+  const uint32_t group = slot / LWREGS_GROUP_SIZE, bit = 1u << (slot % LWREGS_GROUP_SIZE);
+  ddsrt_mutex_lock (&regs->lock);
+  if (nregs > 0)
+  {
+    /* Iterating over the table is safe because nothing gets added or removed
+       while we hold the lock */
+    struct ddsrt_chh_iter it;
+    for (struct ddsi_lwregs_entry *e = ddsrt_chh_iter_first (regs->hh, &it); e != NULL && nregs > 0; e = ddsrt_chh_iter_next (&it))
+    {
+      if (e->group == group && (ddsrt_atomic_and32_ov (&e->slots, ~bit) & bit))
+      {
+        nregs--;
+        remove_if_unused_locked (regs, e);
+      }
+    }
+    assert (nregs == 0);
+  }
+  assert (slot < regs->nslots && (regs->inuse[slot / 32] & (1u << (slot % 32))));
+  regs->inuse[slot / 32] &= ~(1u << (slot % 32));
+  ddsrt_mutex_unlock (&regs->lock);
+}
+
+static struct ddsi_lwregs_entry *lookup (struct ddsi_lwregs *regs, uint32_t group, uint64_t iid, uint64_t wr_iid)
+{
+  struct ddsi_lwregs_entry dummy = { .iid = iid, .wr_iid = wr_iid, .group = group };
+  return ddsrt_chh_lookup (regs->hh, &dummy);
+}
+
+int ddsi_lwregs_contains (struct ddsi_lwregs *regs, uint32_t slot, uint64_t iid, uint64_t wr_iid)
+{
+  struct ddsi_lwregs_entry *e;
+  assert (thread_is_awake ());
+  if ((e = lookup (regs, slot / LWREGS_GROUP_SIZE, iid, wr_iid)) == NULL)
+    return 0;
+  return (ddsrt_atomic_ld32 (&e->slots) & (1u << (slot % LWREGS_GROUP_SIZE))) != 0;
+}
+
+int ddsi_lwregs_add (struct ddsi_lwregs *regs, uint32_t slot, uint64_t iid, uint64_t wr_iid)
+{
+  const uint32_t group = slot / LWREGS_GROUP_SIZE, bit = 1u << (slot % LWREGS_GROUP_SIZE);
+  struct ddsi_lwregs_entry *e;
+  uint32_t old;
+  assert (thread_is_awake ());
+  if ((e = lookup (regs, group, iid, wr_iid)) != NULL)
+  {
+    do {
+      old = ddsrt_atomic_ld32 (&e->slots);
+      if (old & bit)
+        return 0;
+      else if (old & LWREGS_DEAD)
+        break;
+    } while (!ddsrt_atomic_cas32 (&e->slots, old, old | bit));
+    if (!(old & LWREGS_DEAD))
+      return 1;
+  }
+
+  /* Not present or being removed: (re)create it with the lock held, which also
+     guarantees the entry we may find now isn't dead */
+  ddsrt_mutex_lock (&regs->lock);
+  if ((e = lookup (regs, group, iid, wr_iid)) != NULL)
+  {
+    old = ddsrt_atomic_or32_ov (&e->slots, bit);
+    assert (!(old & LWREGS_DEAD));
+  }
+  else
+  {
+    e = ddsrt_malloc (sizeof (*e));
+    e->iid = iid;
+    e->wr_iid = wr_iid;
+    e->group = group;
+    ddsrt_atomic_st32 (&e->slots, bit);
+    int x = ddsrt_chh_add (regs->hh, e);
+    assert (x);
+    (void) x;
+    old = 0;
+  }
+  ddsrt_mutex_unlock (&regs->lock);
+  return !(old & bit);
+}
+
+int ddsi_lwregs_delete (struct ddsi_lwregs *regs, uint32_t slot, uint64_t iid, uint64_t wr_iid)
+{
+  const uint32_t bit = 1u << (slot % LWREGS_GROUP_SIZE);
+  struct ddsi_lwregs_entry *e;
+  uint32_t old;
+  assert (thread_is_awake ());
+  if ((e = lookup (regs, slot / LWREGS_GROUP_SIZE, iid, wr_iid)) == NULL)
+    return 0;
+  do {
+    old = ddsrt_atomic_ld32 (&e->slots);
+    if (!(old & bit))
+      return 0;
+  } while (!ddsrt_atomic_cas32 (&e->slots, old, old & ~bit));
+  if ((old & ~bit) == 0)
+  {
+    /* Someone else may register in the meantime, or also remove it, but it
+       won't be freed while we're awake */
+    ddsrt_mutex_lock (&regs->lock);
+    if (ddsrt_atomic_ld32 (&e->slots) == 0)
+      remove_if_unused_locked (regs, e);
+    ddsrt_mutex_unlock (&regs->lock);
+  }
+  return 1;
+}
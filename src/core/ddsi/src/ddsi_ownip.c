@@ -52,6 +52,7 @@ static int multicast_override(const char *ifname, const struct config *config)
 #ifdef __linux
 /* FIMXE: HACK HACK */
 #include <linux/if_packet.h>
+#include <sys/un.h>
 #endif
 
 int find_own_ip (struct ddsi_domaingv *gv, const char *requested_address)
@@ -122,6 +123,14 @@ int find_own_ip (struct ddsi_domaingv *gv, const char *requested_address)
       memset(l->address, 0, 10);
       memcpy(l->address + 10, ((struct sockaddr_ll *)ifa->addr)->sll_addr, 6);
     }
+    else if (ifa->addr->sa_family == AF_UNIX)
+    {
+      /* host-local transport: the pseudo-interface has the address as a string */
+      enum ddsi_locator_from_string_result res;
+      res = ddsi_locator_from_string(gv, &gv->interfaces[gv->n_interfaces].loc, ((struct sockaddr_un *)ifa->addr)->sun_path, gv->m_factory);
+      assert (res == AFSR_OK);
+      (void) res;
+    }
     else
 #endif
     {
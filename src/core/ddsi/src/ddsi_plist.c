@@ -1640,6 +1640,7 @@ static const struct piddesc piddesc_eclipse[] = {
     { .desc = { XE2, XSTOP } }, 0 },
   PP  (ADLINK_PARTICIPANT_VERSION_INFO,  adlink_participant_version_info, Xux5, XS),
   PP  (ADLINK_TYPE_DESCRIPTION,          type_description, XS),
+  PP  (CYCLONE_FIELD_FILTER,             field_filter, XQ, Xux2, Xl, XSTOP, Xu),
   { PID_SENTINEL, 0, 0, NULL, 0, 0, { .desc = { XSTOP } }, 0 }
 };
 
@@ -1714,7 +1715,7 @@ struct piddesc_index {
 #endif
 
 static const struct piddesc *piddesc_omg_index[DEFAULT_OMG_PIDS_ARRAY_SIZE + SECURITY_OMG_PIDS_ARRAY_SIZE];
-static const struct piddesc *piddesc_eclipse_index[19];
+static const struct piddesc *piddesc_eclipse_index[26];
 static const struct piddesc *piddesc_adlink_index[19];
 
 #define INDEX_ANY(vendorid_, tab_) [vendorid_] = { \
@@ -1739,8 +1740,8 @@ static const struct piddesc_index piddesc_vendor_index[] = {
 /* List of entries that require unalias, fini processing;
    initialized by ddsi_plist_init_tables; will assert when
    table too small or too large */
-static const struct piddesc *piddesc_unalias[18 + SECURITY_PROC_ARRAY_SIZE];
-static const struct piddesc *piddesc_fini[18 + SECURITY_PROC_ARRAY_SIZE];
+static const struct piddesc *piddesc_unalias[19 + SECURITY_PROC_ARRAY_SIZE];
+static const struct piddesc *piddesc_fini[19 + SECURITY_PROC_ARRAY_SIZE];
 static uint64_t plist_fini_mask, qos_fini_mask;
 static ddsrt_once_t table_init_control = DDSRT_ONCE_INIT;
 
@@ -2387,6 +2388,14 @@ static dds_return_t do_locator (nn_locators_t *ls, uint64_t *present, uint64_t w
         return DDS_RETCODE_BAD_PARAMETER;
       break;
     }
+    case NN_LOCATOR_KIND_SHM:
+      if (!ddsi_factory_supports (factory, NN_LOCATOR_KIND_SHM))
+        return 0;
+      if (loc.port <= 0 || loc.port > 65535)
+        return DDS_RETCODE_BAD_PARAMETER;
+      if (!locator_address_prefix12_zero (&loc))
+        return DDS_RETCODE_BAD_PARAMETER;
+      break;
     case NN_LOCATOR_KIND_INVALID:
       if (!locator_address_zero (&loc))
         return DDS_RETCODE_BAD_PARAMETER;
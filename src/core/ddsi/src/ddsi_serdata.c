@@ -70,3 +70,4 @@ extern inline bool ddsi_serdata_eqkey (const struct ddsi_serdata *a, const struc
 extern inline bool ddsi_serdata_print (const struct ddsi_serdata *d, char *buf, size_t size);
 extern inline bool ddsi_serdata_print_topicless (const struct ddsi_sertopic *topic, const struct ddsi_serdata *d, char *buf, size_t size);
 extern inline void ddsi_serdata_get_keyhash (const struct ddsi_serdata *d, struct ddsi_keyhash *buf, bool force_md5);
+extern inline struct ddsi_serdata *ddsi_serdata_ref_detached (const struct ddsi_serdata *d);
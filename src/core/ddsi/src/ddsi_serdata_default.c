@@ -40,9 +40,11 @@
 /* 8k entries in the freelist seems to be roughly the amount needed to send
    minimum-size (well, 4 bytes) samples as fast as possible over loopback
    while using large messages -- actually, it stands to reason that this would
-   be the same as the WHC node pool size */
+   be the same as the WHC node pool size. That is for the smallest size class,
+   the larger classes get the same amount of memory but fewer entries, with a
+   lower bound of a single magazine */
 #define MAX_POOL_SIZE 8192
-#define MAX_SIZE_FOR_POOL 256
+#define MIN_POOL_SIZE 256
 #define DEFAULT_NEW_SIZE 128
 #define CHUNK_SIZE 128
 
@@ -55,11 +57,28 @@ static int ispowerof2_size (size_t x)
 
 static size_t alignup_size (size_t x, size_t a);
 
-struct serdatapool * ddsi_serdatapool_new (void)
+extern inline const char *ddsi_serdata_default_data (const struct ddsi_serdata_default *d);
+
+struct serdatapool * ddsi_serdatapool_new (uint32_t max_pooled_size)
 {
   struct serdatapool * pool;
+  uint32_t n = 0;
+  while (n <= SERDATAPOOL_MAX_CLASS_LG2 - SERDATAPOOL_MIN_CLASS_LG2 && (UINT32_C (1) << (SERDATAPOOL_MIN_CLASS_LG2 + n)) <= max_pooled_size)
+    n++;
   pool = ddsrt_malloc (sizeof (*pool));
-  nn_freelist_init (&pool->freelist, MAX_POOL_SIZE, offsetof (struct ddsi_serdata_default, next));
+  pool->nclasses = n;
+  pool->max_pooled_size = (n == 0) ? 0 : UINT32_C (1) << (SERDATAPOOL_MIN_CLASS_LG2 + n - 1);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    const uint32_t max = MAX_POOL_SIZE >> i;
+    nn_freelist_init (&pool->freelist[i], (max < MIN_POOL_SIZE) ? MIN_POOL_SIZE : max, offsetof (struct ddsi_serdata_default, next));
+  }
+  ddsrt_atomic_st32 (&pool->hits, 0);
+  ddsrt_atomic_st32 (&pool->misses, 0);
+  ddsrt_atomic_st32 (&pool->from_ser_zerocopy, 0);
+  ddsrt_atomic_st32 (&pool->from_ser_copy, 0);
+  ddsrt_atomic_st32 (&pool->from_ser_detached, 0);
+  nn_freelist_init (&pool->hdr_freelist, MIN_POOL_SIZE, offsetof (struct ddsi_serdata_default, next));
   return pool;
 }
 
@@ -74,10 +93,32 @@ static void serdata_free_wrap (void *elem)
 
 void ddsi_serdatapool_free (struct serdatapool * pool)
 {
-  nn_freelist_fini (&pool->freelist, serdata_free_wrap);
+  for (uint32_t i = 0; i < pool->nclasses; i++)
+    nn_freelist_fini (&pool->freelist[i], serdata_free_wrap);
+  nn_freelist_fini (&pool->hdr_freelist, serdata_free_wrap);
   ddsrt_free (pool);
 }
 
+/* Smallest size class that can hold "size" bytes, caller must ensure size
+   does not exceed max_pooled_size */
+static uint32_t serdatapool_alloc_class (uint32_t size)
+{
+  uint32_t k = 0;
+  while ((UINT32_C (1) << (SERDATAPOOL_MIN_CLASS_LG2 + k)) < size)
+    k++;
+  return k;
+}
+
+/* Largest size class not exceeding "size" bytes, caller must ensure size is
+   at least that of the smallest class */
+static uint32_t serdatapool_free_class (uint32_t size)
+{
+  uint32_t k = 0;
+  while ((UINT32_C (1) << (SERDATAPOOL_MIN_CLASS_LG2 + k + 1)) <= size)
+    k++;
+  return k;
+}
+
 static size_t alignup_size (size_t x, size_t a)
 {
   size_t m = a-1;
@@ -167,7 +208,19 @@ static void serdata_default_free(struct ddsi_serdata *dcmn)
 {
   struct ddsi_serdata_default *d = (struct ddsi_serdata_default *)dcmn;
   assert(ddsrt_atomic_ld32(&d->c.refc) == 0);
-  if (d->size > MAX_SIZE_FOR_POOL || !nn_freelist_push (&d->serpool->freelist, d))
+  struct serdatapool * const pool = d->serpool;
+  if (d->rmsg)
+  {
+    nn_rmsg_unref (d->rmsg);
+    d->rmsg = NULL;
+    if (d->copy)
+      ddsi_serdata_unref (&d->copy->c);
+    assert (d->size == 0);
+    if (!nn_freelist_push (&pool->hdr_freelist, d))
+      dds_free (d);
+  }
+  else if (d->size < (UINT32_C (1) << SERDATAPOOL_MIN_CLASS_LG2) || d->size > pool->max_pooled_size ||
+           !nn_freelist_push (&pool->freelist[serdatapool_free_class (d->size)], d))
     dds_free (d);
 }
 
@@ -184,6 +237,8 @@ static void serdata_default_init(struct ddsi_serdata_default *d, const struct dd
   d->keyhash.m_set = 0;
   d->keyhash.m_iskey = 0;
   d->keyhash.m_keysize = 0;
+  d->rmsg = NULL;
+  d->copy = NULL;
 }
 
 static struct ddsi_serdata_default *serdata_default_allocnew (struct serdatapool *serpool, uint32_t init_size)
@@ -196,11 +251,30 @@ static struct ddsi_serdata_default *serdata_default_allocnew (struct serdatapool
 
 static struct ddsi_serdata_default *serdata_default_new_size (const struct ddsi_sertopic_default *tp, enum ddsi_serdata_kind kind, uint32_t size)
 {
+  struct serdatapool * const pool = tp->serpool;
   struct ddsi_serdata_default *d;
-  if (size <= MAX_SIZE_FOR_POOL && (d = nn_freelist_pop (&tp->serpool->freelist)) != NULL)
-    ddsrt_atomic_st32 (&d->c.refc, 1);
-  else if ((d = serdata_default_allocnew (tp->serpool, size)) == NULL)
-    return NULL;
+  if (size > pool->max_pooled_size)
+  {
+    if ((d = serdata_default_allocnew (pool, size)) == NULL)
+      return NULL;
+  }
+  else
+  {
+    const uint32_t k = serdatapool_alloc_class (size);
+    if ((d = nn_freelist_pop (&pool->freelist[k])) != NULL)
+    {
+      ddsrt_atomic_inc32 (&pool->hits);
+      ddsrt_atomic_st32 (&d->c.refc, 1);
+      assert (d->size >= size);
+    }
+    else
+    {
+      /* allocate the full class size, so it can go back into this class */
+      ddsrt_atomic_inc32 (&pool->misses);
+      if ((d = serdata_default_allocnew (pool, UINT32_C (1) << (SERDATAPOOL_MIN_CLASS_LG2 + k))) == NULL)
+        return NULL;
+    }
+  }
   serdata_default_init (d, tp, kind);
   return d;
 }
@@ -210,6 +284,69 @@ static struct ddsi_serdata_default *serdata_default_new (const struct ddsi_serto
   return serdata_default_new_size (tp, kind, DEFAULT_NEW_SIZE);
 }
 
+static bool serdata_default_normalize_and_keyhash (struct ddsi_serdata_default *d, char *data, bool needs_bswap, enum ddsi_serdata_kind kind)
+{
+  const struct ddsi_sertopic_default *tp = (const struct ddsi_sertopic_default *) d->c.topic;
+  const uint32_t pad = ddsrt_fromBE2u (d->hdr.options) & 2;
+  if (d->pos < pad)
+    return false;
+  else if (!dds_stream_normalize (data, d->pos - pad, needs_bswap, tp, kind == SDK_KEY))
+    return false;
+  else
+  {
+    dds_istream_t is;
+    dds_istream_from_serdata_default (&is, d);
+    dds_stream_extract_keyhash (&is, &d->keyhash, tp, kind == SDK_KEY);
+    return true;
+  }
+}
+
+static bool serdata_default_can_reference (const struct ddsi_sertopic_default *tp, const struct nn_rdata *fragchain, size_t size)
+{
+  /* The payload can be used in place if it is a single, complete fragment in
+     native byte order (normalizing must not modify it, as the same payload may
+     be converted for multiple topics) that is sufficiently aligned for reading
+     it directly */
+  if (fragchain->nextfrag != NULL || fragchain->maxp1 != size || size < sizeof (struct CDRHeader))
+    return false;
+  const unsigned char *payload = NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_PAYLOAD_OFF (fragchain));
+  const uintptr_t data_addr = (uintptr_t) (payload + sizeof (struct CDRHeader));
+  struct CDRHeader hdr;
+  memcpy (&hdr, payload, sizeof (hdr));
+  if (hdr.identifier != NATIVE_ENCODING)
+    return false;
+  return (data_addr % 8) == 0 || ((data_addr % 4) == 0 && tp->cdr_align == 4);
+}
+
+/* Construct a serdata that references the payload in the receive buffer, it needs
+   no room for the data itself */
+static struct ddsi_serdata_default *serdata_default_from_ser_ref (const struct ddsi_sertopic_default *tp, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
+{
+  struct serdatapool * const pool = tp->serpool;
+  struct ddsi_serdata_default *d;
+  if ((d = nn_freelist_pop (&pool->hdr_freelist)) != NULL)
+    ddsrt_atomic_st32 (&d->c.refc, 1);
+  else if ((d = serdata_default_allocnew (pool, 0)) == NULL)
+    return NULL;
+  serdata_default_init (d, tp, kind);
+  unsigned char *payload = NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_PAYLOAD_OFF (fragchain));
+  nn_rmsg_ref (fragchain->rmsg);
+  d->rmsg = fragchain->rmsg;
+#ifndef NDEBUG
+  d->owner = ddsrt_thread_self ();
+#endif
+  d->rmsg_payload = (const char *) payload;
+  memcpy (&d->hdr, payload, sizeof (d->hdr));
+  d->pos = (uint32_t) size - (uint32_t) sizeof (struct CDRHeader);
+  if (!serdata_default_normalize_and_keyhash (d, (char *) payload + sizeof (struct CDRHeader), false, kind))
+  {
+    ddsi_serdata_unref (&d->c);
+    return NULL;
+  }
+  ddsrt_atomic_inc32 (&tp->serpool->from_ser_zerocopy);
+  return d;
+}
+
 /* Construct a serdata from a fragchain received over the network */
 static struct ddsi_serdata_default *serdata_default_from_ser_common (const struct ddsi_sertopic *tpcmn, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
 {
@@ -221,9 +358,14 @@ static struct ddsi_serdata_default *serdata_default_from_ser_common (const struc
      serdata */
   if (size > UINT32_MAX - offsetof (struct ddsi_serdata_default, hdr))
     return NULL;
+
+  if (serdata_default_can_reference (tp, fragchain, size))
+    return serdata_default_from_ser_ref (tp, kind, fragchain, size);
+
   struct ddsi_serdata_default *d = serdata_default_new_size (tp, kind, (uint32_t) size);
   if (d == NULL)
     return NULL;
+  ddsrt_atomic_inc32 (&tp->serpool->from_ser_copy);
 
   uint32_t off = 4; /* must skip the CDR header */
 
@@ -249,24 +391,12 @@ static struct ddsi_serdata_default *serdata_default_from_ser_common (const struc
 
   const bool needs_bswap = (d->hdr.identifier != NATIVE_ENCODING);
   d->hdr.identifier = NATIVE_ENCODING;
-  const uint32_t pad = ddsrt_fromBE2u (d->hdr.options) & 2;
-  if (d->pos < pad)
-  {
-    ddsi_serdata_unref (&d->c);
-    return NULL;
-  }
-  else if (!dds_stream_normalize (d->data, d->pos - pad, needs_bswap, tp, kind == SDK_KEY))
+  if (!serdata_default_normalize_and_keyhash (d, d->data, needs_bswap, kind))
   {
     ddsi_serdata_unref (&d->c);
     return NULL;
   }
-  else
-  {
-    dds_istream_t is;
-    dds_istream_from_serdata_default (&is, d);
-    dds_stream_extract_keyhash (&is, &d->keyhash, tp, kind == SDK_KEY);
-    return d;
-  }
+  return d;
 }
 
 static struct ddsi_serdata_default *serdata_default_from_ser_iov_common (const struct ddsi_sertopic *tpcmn, enum ddsi_serdata_kind kind, ddsrt_msg_iovlen_t niov, const ddsrt_iovec_t *iov, size_t size)
@@ -294,24 +424,12 @@ static struct ddsi_serdata_default *serdata_default_from_ser_iov_common (const s
 
   const bool needs_bswap = (d->hdr.identifier != NATIVE_ENCODING);
   d->hdr.identifier = NATIVE_ENCODING;
-  const uint32_t pad = ddsrt_fromBE2u (d->hdr.options) & 2;
-  if (d->pos < pad)
+  if (!serdata_default_normalize_and_keyhash (d, d->data, needs_bswap, kind))
   {
     ddsi_serdata_unref (&d->c);
     return NULL;
   }
-  else if (!dds_stream_normalize (d->data, d->pos - pad, needs_bswap, tp, kind == SDK_KEY))
-  {
-    ddsi_serdata_unref (&d->c);
-    return NULL;
-  }
-  else
-  {
-    dds_istream_t is;
-    dds_istream_from_serdata_default (&is, d);
-    dds_stream_extract_keyhash (&is, &d->keyhash, tp, kind == SDK_KEY);
-    return d;
-  }
+  return d;
 }
 
 static struct ddsi_serdata *serdata_default_from_ser (const struct ddsi_sertopic *tpcmn, enum ddsi_serdata_kind kind, const struct nn_rdata *fragchain, size_t size)
@@ -424,7 +542,16 @@ static void gen_keyhash_from_sample (const struct ddsi_sertopic_default *topic,
 static struct ddsi_serdata_default *serdata_default_from_sample_cdr_common (const struct ddsi_sertopic *tpcmn, enum ddsi_serdata_kind kind, const void *sample)
 {
   const struct ddsi_sertopic_default *tp = (const struct ddsi_sertopic_default *)tpcmn;
-  struct ddsi_serdata_default *d = serdata_default_new(tp, kind);
+  /* allocate exactly what is needed, including the padding to a multiple of 4
+     that dds_ostream_add_to_serdata_default adds */
+  uint32_t size = 0;
+  switch (kind)
+  {
+    case SDK_EMPTY: break;
+    case SDK_KEY: size = dds_stream_getsize_key (sample, tp); break;
+    case SDK_DATA: size = dds_stream_getsize_sample (sample, tp); break;
+  }
+  struct ddsi_serdata_default *d = serdata_default_new_size (tp, kind, (size + 3) & ~3u);
   if (d == NULL)
     return NULL;
   dds_ostream_t os;
@@ -480,7 +607,7 @@ static struct ddsi_serdata *serdata_default_to_topicless (const struct ddsi_serd
   {
     assert (d->hdr.identifier == NATIVE_ENCODING);
     if (d->c.kind == SDK_KEY)
-      serdata_default_append_blob (&d_tl, 1, d->pos, d->data);
+      serdata_default_append_blob (&d_tl, 1, d->pos, ddsi_serdata_default_data (d));
     else if (d->keyhash.m_iskey)
     {
       serdata_default_append_blob (&d_tl, 1, sizeof (d->keyhash.m_hash), d->keyhash.m_hash);
@@ -508,13 +635,20 @@ static struct ddsi_serdata *serdata_default_to_topicless (const struct ddsi_serd
   return (struct ddsi_serdata *)d_tl;
 }
 
+/* CDR header followed by the data, the header in the receive buffer equals the one
+   in the serdata because only data in native byte order is used in place */
+static const char *serdata_default_cdr (const struct ddsi_serdata_default *d)
+{
+  return d->rmsg ? d->rmsg_payload : (const char *) &d->hdr;
+}
+
 /* Fill buffer with 'size' bytes of serialised data, starting from 'off'; 0 <= off < off+sz <= alignup4(size(d)) */
 static void serdata_default_to_ser (const struct ddsi_serdata *serdata_common, size_t off, size_t sz, void *buf)
 {
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
   assert (off < d->pos + sizeof(struct CDRHeader));
   assert (sz <= alignup_size (d->pos + sizeof(struct CDRHeader), 4) - off);
-  memcpy (buf, (char *)&d->hdr + off, sz);
+  memcpy (buf, serdata_default_cdr (d) + off, sz);
 }
 
 static struct ddsi_serdata *serdata_default_to_ser_ref (const struct ddsi_serdata *serdata_common, size_t off, size_t sz, ddsrt_iovec_t *ref)
@@ -522,7 +656,7 @@ static struct ddsi_serdata *serdata_default_to_ser_ref (const struct ddsi_serdat
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
   assert (off < d->pos + sizeof(struct CDRHeader));
   assert (sz <= alignup_size (d->pos + sizeof(struct CDRHeader), 4) - off);
-  ref->iov_base = (char *)&d->hdr + off;
+  ref->iov_base = (char *) serdata_default_cdr (d) + off;
   ref->iov_len = (ddsrt_iov_len_t)sz;
   return ddsi_serdata_ref(serdata_common);
 }
@@ -533,6 +667,38 @@ static void serdata_default_to_ser_unref (struct ddsi_serdata *serdata_common, c
   ddsi_serdata_unref(serdata_common);
 }
 
+static struct ddsi_serdata *serdata_default_detach (const struct ddsi_serdata *serdata_common)
+{
+  /* A serdata referencing the receive buffer never gets stored itself, else a single
+     sample could keep an entire receive buffer alive for an indefinite amount of
+     time.  It is created by the receive or delivery queue thread handling the
+     DATA/DATAFRAG and only that thread ever has a pointer to it: delivery to the
+     local readers is sequential and stores only the copy.  Hence "copy" needs no
+     lock and can simply be remembered for the next reader that stores it. */
+  struct ddsi_serdata_default *d = (struct ddsi_serdata_default *) serdata_common;
+  if (d->rmsg == NULL)
+    return ddsi_serdata_ref (&d->c);
+  assert (ddsrt_thread_equal (d->owner, ddsrt_thread_self ()));
+  if (d->copy == NULL)
+  {
+    const struct ddsi_sertopic_default *tp = (const struct ddsi_sertopic_default *) d->c.topic;
+    struct ddsi_serdata_default * const copy = serdata_default_new_size (tp, d->c.kind, d->pos);
+    if (copy == NULL)
+      return NULL;
+    copy->c.hash = d->c.hash;
+    copy->c.timestamp = d->c.timestamp;
+    copy->c.statusinfo = d->c.statusinfo;
+    copy->c.twrite = d->c.twrite;
+    copy->hdr = d->hdr;
+    memcpy (copy->data, ddsi_serdata_default_data (d), d->pos);
+    copy->pos = d->pos;
+    copy->keyhash = d->keyhash;
+    d->copy = copy;
+    ddsrt_atomic_inc32 (&tp->serpool->from_ser_detached);
+  }
+  return ddsi_serdata_ref (&d->copy->c);
+}
+
 static bool serdata_default_to_sample_cdr (const struct ddsi_serdata *serdata_common, void *sample, void **bufptr, void *buflim)
 {
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
@@ -540,6 +706,14 @@ static bool serdata_default_to_sample_cdr (const struct ddsi_serdata *serdata_co
   dds_istream_t is;
   if (bufptr) abort(); else { (void)buflim; } /* FIXME: haven't implemented that bit yet! */
   assert (d->hdr.identifier == NATIVE_ENCODING);
+  if (d->c.kind == SDK_DATA && tp->opt_size)
+  {
+    /* native endianness and validated on construction: the payload is the
+       sample, and there is no point in going through the stream */
+    assert (d->pos >= tp->opt_size);
+    memcpy (sample, ddsi_serdata_default_data (d), tp->opt_size);
+    return true;
+  }
   dds_istream_from_serdata_default(&is, d);
   if (d->c.kind == SDK_KEY)
     dds_stream_read_key (&is, sample, tp);
@@ -616,7 +790,8 @@ const struct ddsi_serdata_ops ddsi_serdata_ops_cdr = {
   .to_topicless = serdata_default_to_topicless,
   .topicless_to_sample = serdata_default_topicless_to_sample_cdr,
   .print = serdata_default_print_cdr,
-  .get_keyhash = serdata_default_get_keyhash
+  .get_keyhash = serdata_default_get_keyhash,
+  .detach = serdata_default_detach
 };
 
 const struct ddsi_serdata_ops ddsi_serdata_ops_cdr_nokey = {
@@ -634,5 +809,6 @@ const struct ddsi_serdata_ops ddsi_serdata_ops_cdr_nokey = {
   .to_topicless = serdata_default_to_topicless,
   .topicless_to_sample = serdata_default_topicless_to_sample_cdr_nokey,
   .print = serdata_default_print_cdr,
-  .get_keyhash = serdata_default_get_keyhash
+  .get_keyhash = serdata_default_get_keyhash,
+  .detach = serdata_default_detach
 };
@@ -49,6 +49,7 @@ static bool sertopic_default_equal (const struct ddsi_sertopic *acmn, const stru
     memcmp (a->type.m_ops, b->type.m_ops, a->type.m_nops * sizeof (*a->type.m_ops)) != 0)
     return false;
   assert (a->opt_size == b->opt_size);
+  assert (a->cdr_align == b->cdr_align);
   return true;
 }
 
@@ -0,0 +1,878 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_shm.h"
+#include "dds/ddsi/q_config.h"
+#include "dds/ddsi/q_log.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_gc.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/log.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/time.h"
+
+#if defined(__linux) && !LWIP_SOCKET
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <assert.h>
+
+/* Every receiving connection owns a ring buffer in a POSIX shared memory
+   object named after the user and the port number, into which senders copy
+   complete RTPS messages.  A named pipe next to it is the doorbell: it is
+   what the receive thread waits on, and a sender only writes a byte into it
+   if the receiver has said it is about to go to sleep.
+
+   Senders serialise on a process-shared mutex in the ring; there is only a
+   single receiver.  A message that doesn't fit is dropped, just like a UDP
+   datagram that doesn't fit in the socket receive buffer, and for the same
+   reason that is fine: reliability is handled by DDSI. */
+
+#define SHM_MAGIC 0x43444d53u
+#define SHM_LINE 64
+#define SHM_PAD(n) (SHM_LINE - ((n) % SHM_LINE))
+#define SHM_MIN_RING_SIZE (128u * 1024u)
+#define SHM_REC_WRAP 0xffffffffu
+#define SHM_BROADCAST_HOSTID 0xffffffffu
+#define SHM_REVALIDATE_INTERVAL DDS_SECS (1)
+#define SHM_DYNAMIC_PORT_BASE 49152u
+#define SHM_DYNAMIC_PORT_COUNT 16384u
+
+struct shm_ring {
+  uint32_t magic; /* set last, once the ring has been initialised */
+  uint32_t size; /* of data[], a power of 2 */
+  ddsrt_atomic_uint32_t closed; /* set when the receiver deletes it */
+  ddsrt_atomic_uint32_t sleeping; /* receiver wants a doorbell byte */
+  pthread_mutex_t lock; /* serialises senders */
+  char pad0[SHM_PAD (4 * sizeof (uint32_t) + sizeof (pthread_mutex_t))];
+  ddsrt_atomic_uint32_t head; /* free-running write offset */
+  char pad1[SHM_PAD (sizeof (uint32_t))];
+  ddsrt_atomic_uint32_t tail; /* free-running read offset */
+  char pad2[SHM_PAD (sizeof (uint32_t))];
+  unsigned char data[];
+};
+
+/* Messages are stored as a header followed by the payload, padded to a
+   multiple of 8 bytes; a message never wraps around the end of the ring,
+   instead a record with length SHM_REC_WRAP says to continue at the
+   start */
+struct shm_rec {
+  uint32_t len;
+  uint32_t srcport;
+};
+
+/* Senders map the rings of the receivers they send to and keep them
+   mapped, checking now and then that the receiver still exists.  Looking
+   up a destination doesn't involve a lock: senders are awake while they
+   use it, and one that has been removed is only unmapped by the garbage
+   collector once they have all moved on. */
+struct shm_dest {
+  uint32_t port;
+  struct shm_ring *ring;
+  size_t mapsize;
+  int fifo_fd;
+  ino_t ino;
+  ddsrt_atomic_uint64_t tcheck; /* monotonic time of next check */
+};
+
+/* The garbage collector is stopped before the last messages are sent when
+   the domain is shut down, from then on removed destinations and hash table
+   buckets are kept until the transport is deinitialised */
+struct shm_retired {
+  struct shm_retired *next;
+  struct shm_dest *dest; /* either dest or buckets is set */
+  void *buckets;
+};
+
+typedef struct ddsi_shm_tran_factory {
+  struct ddsi_tran_factory fact;
+  uint32_t hostid;
+  uint32_t ring_size;
+  ddsrt_mutex_t lock; /* for adding/removing destinations */
+  struct ddsrt_chh *dests;
+  struct shm_retired *retired;
+} *ddsi_shm_tran_factory_t;
+
+typedef struct ddsi_shm_conn {
+  struct ddsi_tran_conn m_base;
+  struct shm_ring *m_ring; /* NULL if transmit-only */
+  size_t m_mapsize;
+  int m_shm_fd;
+  int m_fifo_fd;
+  bool m_blocking;
+} *ddsi_shm_conn_t;
+
+static void shm_ring_name (char *dst, size_t sizeof_dst, uint32_t port)
+{
+  (void) snprintf (dst, sizeof_dst, "/cyclonedds.%u.%"PRIu32, (unsigned) getuid (), port);
+}
+
+static void shm_fifo_name (char *dst, size_t sizeof_dst, uint32_t port)
+{
+  (void) snprintf (dst, sizeof_dst, "/dev/shm/cyclonedds.%u.%"PRIu32".fifo", (unsigned) getuid (), port);
+}
+
+static uint32_t shm_locator_hostid (const nn_locator_t *loc)
+{
+  return ((uint32_t) loc->address[12] << 24) | ((uint32_t) loc->address[13] << 16) | ((uint32_t) loc->address[14] << 8) | loc->address[15];
+}
+
+static void shm_set_locator (const struct ddsi_shm_tran_factory *fact, nn_locator_t *loc, uint32_t hostid, uint32_t port)
+{
+  loc->tran = (struct ddsi_tran_factory *) &fact->fact;
+  loc->kind = NN_LOCATOR_KIND_SHM;
+  loc->port = port;
+  memset (loc->address, 0, 12);
+  loc->address[12] = (unsigned char) (hostid >> 24);
+  loc->address[13] = (unsigned char) (hostid >> 16);
+  loc->address[14] = (unsigned char) (hostid >> 8);
+  loc->address[15] = (unsigned char) hostid;
+}
+
+static int shm_ring_lock (struct shm_ring *ring)
+{
+  int rc = pthread_mutex_lock (&ring->lock);
+  if (rc == EOWNERDEAD)
+  {
+    /* A sender died while holding the lock, but a message only becomes
+       visible when the head is updated, so the ring itself is fine */
+    rc = pthread_mutex_consistent (&ring->lock);
+  }
+  return rc;
+}
+
+static bool shm_ring_put (struct shm_ring *ring, uint32_t srcport, size_t niov, const ddsrt_iovec_t *iov, size_t len)
+{
+  const uint32_t mask = ring->size - 1;
+  uint32_t need, head, tail, avail, off;
+  struct shm_rec *rec;
+  unsigned char *p;
+
+  if (len > ring->size / 2)
+    return false;
+  need = (uint32_t) (sizeof (*rec) + ((len + 7) & ~(size_t) 7));
+  if (shm_ring_lock (ring) != 0)
+    return false;
+  head = ddsrt_atomic_ld32 (&ring->head);
+  tail = ddsrt_atomic_ld32 (&ring->tail);
+  ddsrt_atomic_fence_acq ();
+  avail = ring->size - (head - tail);
+  off = head & mask;
+  if (ring->size - off < need)
+  {
+    /* Offsets are multiples of 8 and so is the size, so there is always
+       room for the wrap record */
+    if (avail < (ring->size - off) + need)
+      goto full;
+    rec = (struct shm_rec *) (ring->data + off);
+    rec->len = SHM_REC_WRAP;
+    head += ring->size - off;
+    off = 0;
+  }
+  else if (avail < need)
+  {
+    goto full;
+  }
+  rec = (struct shm_rec *) (ring->data + off);
+  rec->len = (uint32_t) len;
+  rec->srcport = srcport;
+  p = (unsigned char *) (rec + 1);
+  for (size_t i = 0; i < niov; i++)
+  {
+    memcpy (p, iov[i].iov_base, iov[i].iov_len);
+    p += iov[i].iov_len;
+  }
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&ring->head, head + need);
+  (void) pthread_mutex_unlock (&ring->lock);
+  return true;
+
+full:
+  (void) pthread_mutex_unlock (&ring->lock);
+  return false;
+}
+
+static bool shm_ring_empty (const struct shm_ring *ring)
+{
+  return ddsrt_atomic_ld32 (&ring->tail) == ddsrt_atomic_ld32 (&ring->head);
+}
+
+static bool shm_ring_get (struct shm_ring *ring, unsigned char *buf, size_t len, uint32_t *msglen, uint32_t *srcport)
+{
+  const uint32_t mask = ring->size - 1;
+  uint32_t tail = ddsrt_atomic_ld32 (&ring->tail);
+  const uint32_t head = ddsrt_atomic_ld32 (&ring->head);
+  const struct shm_rec *rec;
+  uint32_t n, off, used;
+
+  if (tail == head)
+    return false;
+  ddsrt_atomic_fence_acq ();
+  /* Anything a sender wrote may be garbage, so a record must lie entirely
+     between tail and head and must not extend past the end of the ring */
+  off = tail & mask;
+  if ((used = head - tail) > ring->size || off + sizeof (*rec) > ring->size)
+    goto garbage;
+  rec = (const struct shm_rec *) (ring->data + off);
+  if (rec->len == SHM_REC_WRAP)
+  {
+    const uint32_t skip = ring->size - off;
+    if (used < skip + sizeof (*rec))
+      goto garbage;
+    tail += skip;
+    used -= skip;
+    off = 0;
+    rec = (const struct shm_rec *) ring->data;
+  }
+  if ((n = rec->len) > ring->size / 2 ||
+      sizeof (*rec) + ((n + 7) & ~7u) > used ||
+      off + sizeof (*rec) + n > ring->size)
+    goto garbage;
+  *msglen = n;
+  *srcport = rec->srcport;
+  memcpy (buf, rec + 1, (n < len) ? n : len);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&ring->tail, tail + (uint32_t) sizeof (*rec) + ((n + 7) & ~7u));
+  return true;
+
+garbage:
+  /* Can only be written by a misbehaving sender: skip whatever is in the
+     ring */
+  ddsrt_atomic_st32 (&ring->tail, head);
+  return false;
+}
+
+static void shm_ring_doorbell (struct shm_ring *ring, int fifo_fd)
+{
+  /* Either the receiver sees the new head when it checks again after
+     setting "sleeping", or we see "sleeping" set here; exactly one of the
+     two clears it and writes the byte that wakes up the receiver */
+  ddsrt_atomic_fence ();
+  if (ddsrt_atomic_ld32 (&ring->sleeping) && ddsrt_atomic_and32_ov (&ring->sleeping, 0))
+  {
+    const char b = 0;
+    ssize_t r = write (fifo_fd, &b, 1);
+    (void) r;
+  }
+}
+
+static void shm_conn_prepare_sleep (ddsi_shm_conn_t uc)
+{
+  /* Ring is empty: drain the doorbell so the receive thread blocks, and
+     have the next sender ring it again */
+  char buf[16];
+  while (read (uc->m_fifo_fd, buf, sizeof (buf)) > 0)
+    ;
+  ddsrt_atomic_st32 (&uc->m_ring->sleeping, 1);
+  if (!shm_ring_empty (uc->m_ring))
+    shm_ring_doorbell (uc->m_ring, uc->m_fifo_fd);
+}
+
+static char *ddsi_shm_to_string (char *dst, size_t sizeof_dst, const nn_locator_t *loc, int with_port)
+{
+  if (with_port)
+    (void) snprintf (dst, sizeof_dst, "%08"PRIx32":%"PRIu32, shm_locator_hostid (loc), loc->port);
+  else
+    (void) snprintf (dst, sizeof_dst, "%08"PRIx32, shm_locator_hostid (loc));
+  return dst;
+}
+
+static ssize_t ddsi_shm_conn_read (ddsi_tran_conn_t conn, unsigned char *buf, size_t len, bool allow_spurious, nn_locator_t *srcloc)
+{
+  ddsi_shm_conn_t uc = (ddsi_shm_conn_t) conn;
+  const struct ddsi_shm_tran_factory *fact = (const struct ddsi_shm_tran_factory *) conn->m_factory;
+  uint32_t msglen, srcport;
+  (void) allow_spurious;
+
+  if (uc->m_ring == NULL)
+    return -1;
+  while (!shm_ring_get (uc->m_ring, buf, len, &msglen, &srcport))
+  {
+    struct pollfd pfd;
+    shm_conn_prepare_sleep (uc);
+    if (!uc->m_blocking)
+      return 0;
+    pfd.fd = uc->m_fifo_fd;
+    pfd.events = POLLIN;
+    (void) poll (&pfd, 1, -1);
+  }
+  if (shm_ring_empty (uc->m_ring))
+    shm_conn_prepare_sleep (uc);
+
+  if (srcloc)
+    shm_set_locator (fact, srcloc, fact->hostid, srcport);
+  if (msglen > len)
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    nn_locator_t tmp;
+    shm_set_locator (fact, &tmp, fact->hostid, srcport);
+    ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
+    DDS_CWARNING (&conn->m_base.gv->logconfig, "%s => %"PRIu32" truncated to %d\n", addrbuf, msglen, (int) len);
+    return (ssize_t) len;
+  }
+  return (ssize_t) msglen;
+}
+
+static uint32_t shm_dest_hash (const void *va)
+{
+  const struct shm_dest *a = va;
+  return a->port * UINT32_C (2654435761);
+}
+
+static int shm_dest_equal (const void *va, const void *vb)
+{
+  const struct shm_dest *a = va;
+  const struct shm_dest *b = vb;
+  return a->port == b->port;
+}
+
+static struct shm_dest *shm_dest_open (uint32_t port)
+{
+  char name[64];
+  struct shm_dest *dest;
+  struct shm_ring *ring;
+  struct stat st;
+  void *map;
+  int fd, fifo_fd;
+
+  shm_ring_name (name, sizeof (name), port);
+  if ((fd = shm_open (name, O_RDWR, 0)) < 0)
+    return NULL;
+  if (fstat (fd, &st) < 0 || (size_t) st.st_size < sizeof (*ring) ||
+      (map = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    close (fd);
+    return NULL;
+  }
+  close (fd);
+  ring = map;
+  if (ring->magic != SHM_MAGIC || (size_t) st.st_size != sizeof (*ring) + ring->size || ddsrt_atomic_ld32 (&ring->closed))
+    goto fail;
+  ddsrt_atomic_fence_acq ();
+  shm_fifo_name (name, sizeof (name), port);
+  if ((fifo_fd = open (name, O_WRONLY | O_NONBLOCK | O_CLOEXEC)) < 0)
+    goto fail;
+
+  dest = ddsrt_malloc (sizeof (*dest));
+  dest->port = port;
+  dest->ring = ring;
+  dest->mapsize = (size_t) st.st_size;
+  dest->fifo_fd = fifo_fd;
+  dest->ino = st.st_ino;
+  ddsrt_atomic_st64 (&dest->tcheck, (uint64_t) (ddsrt_time_monotonic ().v + SHM_REVALIDATE_INTERVAL));
+  return dest;
+
+fail:
+  munmap (map, (size_t) st.st_size);
+  return NULL;
+}
+
+static void shm_dest_free (struct shm_dest *dest)
+{
+  munmap (dest->ring, dest->mapsize);
+  close (dest->fifo_fd);
+  ddsrt_free (dest);
+}
+
+static void gc_dest_impl (struct gcreq *gcreq)
+{
+  shm_dest_free (gcreq->arg);
+  gcreq_free (gcreq);
+}
+
+static void shm_retire (struct ddsi_shm_tran_factory *fact, struct shm_dest *dest, void *buckets)
+{
+  struct shm_retired *r = ddsrt_malloc (sizeof (*r));
+  r->dest = dest;
+  r->buckets = buckets;
+  r->next = fact->retired;
+  fact->retired = r;
+}
+
+static void gc_dest (struct ddsi_shm_tran_factory *fact, struct shm_dest *dest)
+{
+  /* fact->lock held */
+  if (fact->fact.gv->gcreq_queue == NULL)
+    shm_retire (fact, dest, NULL);
+  else
+  {
+    struct gcreq *gcreq = gcreq_new (fact->fact.gv->gcreq_queue, gc_dest_impl);
+    gcreq->arg = dest;
+    gcreq_enqueue (gcreq);
+  }
+}
+
+static void gc_buckets_impl (struct gcreq *gcreq)
+{
+  ddsrt_free (gcreq->arg);
+  gcreq_free (gcreq);
+}
+
+static void gc_buckets (void *a, void *arg)
+{
+  /* resizing only happens when adding, so fact->lock is held */
+  struct ddsi_shm_tran_factory *fact = arg;
+  if (fact->fact.gv->gcreq_queue == NULL)
+    shm_retire (fact, NULL, a);
+  else
+  {
+    struct gcreq *gcreq = gcreq_new (fact->fact.gv->gcreq_queue, gc_buckets_impl);
+    gcreq->arg = a;
+    gcreq_enqueue (gcreq);
+  }
+}
+
+static bool shm_dest_still_valid (const struct shm_dest *dest)
+{
+  /* A receiver that crashed leaves its ring behind, and the port may have
+     been taken over by a new one since, hence the check on the inode */
+  char name[64];
+  struct stat st;
+  bool valid;
+  int fd;
+  shm_ring_name (name, sizeof (name), dest->port);
+  if ((fd = shm_open (name, O_RDONLY, 0)) < 0)
+    return false;
+  valid = (fstat (fd, &st) == 0 && st.st_ino == dest->ino);
+  close (fd);
+  return valid;
+}
+
+static bool shm_dest_usable (const struct shm_dest *dest, ddsrt_mtime_t tnow)
+{
+  return !ddsrt_atomic_ld32 (&dest->ring->closed) && tnow.v < (int64_t) ddsrt_atomic_ld64 (&dest->tcheck);
+}
+
+static struct shm_dest *shm_dest_lookup (ddsi_shm_tran_factory_t fact, uint32_t port)
+{
+  /* The result remains valid for as long as the calling thread stays awake */
+  struct shm_dest template, *dest;
+  ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  assert (thread_is_awake ());
+  template.port = port;
+  if ((dest = ddsrt_chh_lookup (fact->dests, &template)) != NULL && shm_dest_usable (dest, tnow))
+    return dest;
+
+  /* Unknown, gone or due for a check: only one thread gets to (re)open it */
+  ddsrt_mutex_lock (&fact->lock);
+  if ((dest = ddsrt_chh_lookup (fact->dests, &template)) != NULL && !shm_dest_usable (dest, tnow))
+  {
+    bool valid = !ddsrt_atomic_ld32 (&dest->ring->closed);
+    if (valid)
+    {
+      valid = shm_dest_still_valid (dest);
+      ddsrt_atomic_st64 (&dest->tcheck, (uint64_t) (tnow.v + SHM_REVALIDATE_INTERVAL));
+    }
+    if (!valid)
+    {
+      int x = ddsrt_chh_remove (fact->dests, dest);
+      assert (x);
+      (void) x;
+      gc_dest (fact, dest);
+      dest = NULL;
+    }
+  }
+  if (dest == NULL && (dest = shm_dest_open (port)) != NULL)
+  {
+    int x = ddsrt_chh_add (fact->dests, dest);
+    assert (x);
+    (void) x;
+  }
+  ddsrt_mutex_unlock (&fact->lock);
+  return dest;
+}
+
+static ssize_t ddsi_shm_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_shm_tran_factory_t fact = (ddsi_shm_tran_factory_t) conn->m_factory;
+  struct thread_state1 * const ts1 = lookup_thread_state ();
+  struct shm_dest *dest;
+  size_t len = 0;
+  (void) flags;
+  for (size_t i = 0; i < niov; i++)
+    len += iov[i].iov_len;
+
+  /* Like UDP datagrams, messages for which there is no receiver silently
+     disappear, and that includes those for other hosts and for the pretend
+     broadcast address */
+  if (shm_locator_hostid (dst) != fact->hostid || dst->port == 0 || dst->port > 65535)
+    return (ssize_t) len;
+  thread_state_awake (ts1, fact->fact.gv);
+  if ((dest = shm_dest_lookup (fact, dst->port)) != NULL &&
+      shm_ring_put (dest->ring, conn->m_base.m_port, niov, iov, len))
+    shm_ring_doorbell (dest->ring, dest->fifo_fd);
+  thread_state_asleep (ts1);
+  return (ssize_t) len;
+}
+
+static ddsrt_socket_t ddsi_shm_conn_handle (ddsi_tran_base_t base)
+{
+  ddsi_shm_conn_t uc = (ddsi_shm_conn_t) base;
+  return (uc->m_ring != NULL) ? uc->m_fifo_fd : DDSRT_INVALID_SOCKET;
+}
+
+static void ddsi_shm_disable_multiplexing (ddsi_tran_conn_t conn)
+{
+  ddsi_shm_conn_t uc = (ddsi_shm_conn_t) conn;
+  uc->m_blocking = true;
+}
+
+static bool ddsi_shm_supports (const struct ddsi_tran_factory *fact, int32_t kind)
+{
+  (void) fact;
+  return (kind == NN_LOCATOR_KIND_SHM);
+}
+
+static int ddsi_shm_conn_locator (ddsi_tran_factory_t fact_cmn, ddsi_tran_base_t base, nn_locator_t *loc)
+{
+  const struct ddsi_shm_tran_factory *fact = (const struct ddsi_shm_tran_factory *) fact_cmn;
+  shm_set_locator (fact, loc, fact->hostid, base->m_port);
+  return 0;
+}
+
+static bool shm_remove_stale (const char *name, uint32_t port)
+{
+  /* The owner of a ring holds an exclusive lock on it for as long as it
+     exists, so if the lock can be had, the owner is gone.  Without a size
+     it is a ring that is still being created. */
+  struct stat st;
+  bool stale = false;
+  int fd;
+  if ((fd = shm_open (name, O_RDWR, 0)) < 0)
+    return (errno == ENOENT);
+  if (flock (fd, LOCK_EX | LOCK_NB) == 0 && fstat (fd, &st) == 0 && st.st_size > 0)
+  {
+    if (st.st_nlink > 0)
+    {
+      char fifo_name[64];
+      shm_fifo_name (fifo_name, sizeof (fifo_name), port);
+      (void) shm_unlink (name);
+      (void) unlink (fifo_name);
+    }
+    stale = true;
+  }
+  close (fd);
+  return stale;
+}
+
+static dds_return_t shm_ring_create (ddsi_shm_conn_t uc, const struct ddsi_shm_tran_factory *fact, uint32_t port)
+{
+  struct ddsi_domaingv * const gv = fact->fact.gv;
+  const size_t mapsize = sizeof (struct shm_ring) + fact->ring_size;
+  char name[64], fifo_name[64];
+  pthread_mutexattr_t mattr;
+  struct shm_ring *ring;
+  void *map;
+  int fd, fifo_fd;
+
+  shm_ring_name (name, sizeof (name), port);
+  shm_fifo_name (fifo_name, sizeof (fifo_name), port);
+  while ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR)) < 0)
+  {
+    if (errno != EEXIST)
+    {
+      GVERROR ("ddsi_shm_create_conn: shm_open %s failed: errno %d\n", name, errno);
+      return DDS_RETCODE_ERROR;
+    }
+    else if (!shm_remove_stale (name, port))
+    {
+      return DDS_RETCODE_PRECONDITION_NOT_MET;
+    }
+  }
+  if (flock (fd, LOCK_EX | LOCK_NB) < 0)
+  {
+    /* Someone checking whether it is stale; it'll conclude it is in use */
+    (void) shm_unlink (name);
+    close (fd);
+    return DDS_RETCODE_PRECONDITION_NOT_MET;
+  }
+  if (ftruncate (fd, (off_t) mapsize) < 0 ||
+      (map = mmap (NULL, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    GVERROR ("ddsi_shm_create_conn: failed to map %s (%"PRIuSIZE" bytes): errno %d\n", name, mapsize, errno);
+    goto fail;
+  }
+  ring = map;
+  ring->size = fact->ring_size;
+  ddsrt_atomic_st32 (&ring->closed, 0);
+  ddsrt_atomic_st32 (&ring->sleeping, 1);
+  ddsrt_atomic_st32 (&ring->head, 0);
+  ddsrt_atomic_st32 (&ring->tail, 0);
+  (void) pthread_mutexattr_init (&mattr);
+  (void) pthread_mutexattr_setpshared (&mattr, PTHREAD_PROCESS_SHARED);
+  (void) pthread_mutexattr_setrobust (&mattr, PTHREAD_MUTEX_ROBUST);
+  (void) pthread_mutex_init (&ring->lock, &mattr);
+  (void) pthread_mutexattr_destroy (&mattr);
+
+  (void) unlink (fifo_name);
+  if (mkfifo (fifo_name, S_IRUSR | S_IWUSR) < 0 ||
+      (fifo_fd = open (fifo_name, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0)
+  {
+    GVERROR ("ddsi_shm_create_conn: failed to create %s: errno %d\n", fifo_name, errno);
+    (void) unlink (fifo_name);
+    munmap (map, mapsize);
+    goto fail;
+  }
+  ddsrt_atomic_fence_rel ();
+  ring->magic = SHM_MAGIC;
+
+  uc->m_ring = ring;
+  uc->m_mapsize = mapsize;
+  uc->m_shm_fd = fd;
+  uc->m_fifo_fd = fifo_fd;
+  return DDS_RETCODE_OK;
+
+fail:
+  (void) shm_unlink (name);
+  close (fd);
+  return DDS_RETCODE_ERROR;
+}
+
+static dds_return_t ddsi_shm_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact_cmn, uint32_t port, const struct ddsi_tran_qos *qos)
+{
+  ddsi_shm_tran_factory_t fact = (ddsi_shm_tran_factory_t) fact_cmn;
+  struct ddsi_domaingv * const gv = fact->fact.gv;
+  ddsi_shm_conn_t uc;
+  dds_return_t rc;
+
+  if (qos->m_purpose == DDSI_TRAN_QOS_RECV_MC)
+  {
+    GVERROR ("ddsi_shm_create_conn: multicast not supported\n");
+    return DDS_RETCODE_UNSUPPORTED;
+  }
+
+  uc = ddsrt_malloc (sizeof (*uc));
+  memset (uc, 0, sizeof (*uc));
+  uc->m_shm_fd = -1;
+  uc->m_fifo_fd = -1;
+  if (qos->m_purpose == DDSI_TRAN_QOS_RECV_UC)
+  {
+    if (port != 0)
+      rc = shm_ring_create (uc, fact, port);
+    else
+    {
+      /* Dynamic port: search from a random start in the range that is
+         normally used for ephemeral ports */
+      const uint32_t start = ddsrt_random () % SHM_DYNAMIC_PORT_COUNT;
+      rc = DDS_RETCODE_PRECONDITION_NOT_MET;
+      for (uint32_t i = 0; i < SHM_DYNAMIC_PORT_COUNT && rc == DDS_RETCODE_PRECONDITION_NOT_MET; i++)
+      {
+        port = SHM_DYNAMIC_PORT_BASE + (start + i) % SHM_DYNAMIC_PORT_COUNT;
+        rc = shm_ring_create (uc, fact, port);
+      }
+    }
+    if (rc != DDS_RETCODE_OK)
+    {
+      ddsrt_free (uc);
+      return rc;
+    }
+  }
+
+  ddsi_factory_conn_init (&fact->fact, &uc->m_base);
+  uc->m_base.m_base.m_port = port;
+  uc->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
+  uc->m_base.m_base.m_multicast = false;
+  uc->m_base.m_base.m_handle_fn = ddsi_shm_conn_handle;
+  uc->m_base.m_locator_fn = ddsi_shm_conn_locator;
+  uc->m_base.m_read_fn = ddsi_shm_conn_read;
+  uc->m_base.m_write_fn = ddsi_shm_conn_write;
+  uc->m_base.m_disable_multiplexing_fn = ddsi_shm_disable_multiplexing;
+
+  GVTRACE ("ddsi_shm_create_conn %s port %"PRIu32"\n", (uc->m_ring != NULL) ? "unicast" : "transmit", port);
+  *conn_out = &uc->m_base;
+  return DDS_RETCODE_OK;
+}
+
+static int ddsi_shm_join_mc (ddsi_tran_conn_t conn, const nn_locator_t *srcloc, const nn_locator_t *mcloc, const struct nn_interface *interf)
+{
+  (void) conn;
+  (void) srcloc;
+  (void) mcloc;
+  (void) interf;
+  return 0;
+}
+
+static int ddsi_shm_leave_mc (ddsi_tran_conn_t conn, const nn_locator_t *srcloc, const nn_locator_t *mcloc, const struct nn_interface *interf)
+{
+  (void) conn;
+  (void) srcloc;
+  (void) mcloc;
+  (void) interf;
+  return 0;
+}
+
+static void ddsi_shm_release_conn (ddsi_tran_conn_t conn)
+{
+  ddsi_shm_conn_t uc = (ddsi_shm_conn_t) conn;
+  DDS_CTRACE (&conn->m_base.gv->logconfig, "ddsi_shm_release_conn port %"PRIu32"\n", uc->m_base.m_base.m_port);
+  if (uc->m_ring != NULL)
+  {
+    char name[64];
+    /* Unlink while still holding the lock, so no-one can mistake it for
+       a stale one in the meantime */
+    ddsrt_atomic_st32 (&uc->m_ring->closed, 1);
+    shm_ring_name (name, sizeof (name), uc->m_base.m_base.m_port);
+    (void) shm_unlink (name);
+    shm_fifo_name (name, sizeof (name), uc->m_base.m_base.m_port);
+    (void) unlink (name);
+    munmap (uc->m_ring, uc->m_mapsize);
+    close (uc->m_fifo_fd);
+    close (uc->m_shm_fd);
+  }
+  ddsrt_free (conn);
+}
+
+static int ddsi_shm_is_mcaddr (const ddsi_tran_factory_t tran, const nn_locator_t *loc)
+{
+  (void) tran;
+  assert (loc->kind == NN_LOCATOR_KIND_SHM);
+  return (shm_locator_hostid (loc) == SHM_BROADCAST_HOSTID);
+}
+
+static int ddsi_shm_is_ssm_mcaddr (const ddsi_tran_factory_t tran, const nn_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static enum ddsi_nearby_address_result ddsi_shm_is_nearby_address (const nn_locator_t *loc, const nn_locator_t *ownloc, size_t ninterf, const struct nn_interface interf[])
+{
+  (void) ninterf;
+  (void) interf;
+  return (shm_locator_hostid (loc) == shm_locator_hostid (ownloc)) ? DNAR_SAME : DNAR_DISTANT;
+}
+
+static enum ddsi_locator_from_string_result ddsi_shm_address_from_string (ddsi_tran_factory_t tran, nn_locator_t *loc, const char *str)
+{
+  const struct ddsi_shm_tran_factory *fact = (const struct ddsi_shm_tran_factory *) tran;
+  unsigned hostid;
+  int pos;
+  if (strcmp (str, "localhost") == 0)
+    hostid = fact->hostid;
+  else if (sscanf (str, "%8x%n", &hostid, &pos) != 1 || str[pos] != 0)
+    return AFSR_INVALID;
+  shm_set_locator (fact, loc, hostid, NN_LOCATOR_PORT_INVALID);
+  return AFSR_OK;
+}
+
+static void shm_dest_free_wrapper (void *vdest, void *varg)
+{
+  (void) varg;
+  shm_dest_free (vdest);
+}
+
+static void ddsi_shm_deinit (ddsi_tran_factory_t fact_cmn)
+{
+  ddsi_shm_tran_factory_t fact = (ddsi_shm_tran_factory_t) fact_cmn;
+  DDS_CLOG (DDS_LC_CONFIG, &fact->fact.gv->logconfig, "shm de-initialized\n");
+  ddsrt_chh_enum_unsafe (fact->dests, shm_dest_free_wrapper, NULL);
+  ddsrt_chh_free (fact->dests);
+  while (fact->retired)
+  {
+    struct shm_retired *r = fact->retired;
+    fact->retired = r->next;
+    if (r->dest)
+      shm_dest_free (r->dest);
+    ddsrt_free (r->buckets);
+    ddsrt_free (r);
+  }
+  ddsrt_mutex_destroy (&fact->lock);
+  ddsrt_free (fact);
+}
+
+static int ddsi_shm_enumerate_interfaces (ddsi_tran_factory_t fact_cmn, enum transport_selector transport_selector, ddsrt_ifaddrs_t **ifs)
+{
+  /* There is a single pseudo-interface, its address is the host id in the
+     form accepted by ddsi_shm_address_from_string */
+  const struct ddsi_shm_tran_factory *fact = (const struct ddsi_shm_tran_factory *) fact_cmn;
+  ddsrt_ifaddrs_t *ifa = ddsrt_calloc (1, sizeof (*ifa));
+  struct sockaddr_un *addr = ddsrt_calloc (1, sizeof (*addr));
+  (void) transport_selector;
+  addr->sun_family = AF_UNIX;
+  (void) snprintf (addr->sun_path, sizeof (addr->sun_path), "%08"PRIx32, fact->hostid);
+  ifa->name = ddsrt_strdup ("shm");
+  ifa->flags = IFF_UP | IFF_LOOPBACK;
+  ifa->type = DDSRT_IFTYPE_UNKNOWN;
+  ifa->addr = (struct sockaddr *) addr;
+  *ifs = ifa;
+  return 0;
+}
+
+static int ddsi_shm_is_valid_port (ddsi_tran_factory_t fact, uint32_t port)
+{
+  (void) fact;
+  return (port <= 65535);
+}
+
+int ddsi_shm_init (struct ddsi_domaingv *gv)
+{
+  struct ddsi_shm_tran_factory *fact = ddsrt_malloc (sizeof (*fact));
+  uint32_t ring_size = SHM_MIN_RING_SIZE;
+  while (ring_size < gv->config.shm_ring_size && ring_size < (UINT32_C (1) << 30))
+    ring_size <<= 1;
+  memset (fact, 0, sizeof (*fact));
+  /* The host id distinguishes our locators from those of the other hosts
+     that use this transport, all-ones is reserved for the SPDP "multicast"
+     address */
+  fact->hostid = (uint32_t) gethostid ();
+  if (fact->hostid == SHM_BROADCAST_HOSTID)
+    fact->hostid--;
+  fact->ring_size = ring_size;
+  ddsrt_mutex_init (&fact->lock);
+  fact->dests = ddsrt_chh_new (1, shm_dest_hash, shm_dest_equal, gc_buckets, fact);
+  fact->fact.gv = gv;
+  fact->fact.m_free_fn = ddsi_shm_deinit;
+  fact->fact.m_kind = NN_LOCATOR_KIND_SHM;
+  fact->fact.m_typename = "shm";
+  fact->fact.m_default_spdp_address = "shm/ffffffff";
+  fact->fact.m_connless = 1;
+  fact->fact.m_supports_fn = ddsi_shm_supports;
+  fact->fact.m_create_conn_fn = ddsi_shm_create_conn;
+  fact->fact.m_release_conn_fn = ddsi_shm_release_conn;
+  fact->fact.m_join_mc_fn = ddsi_shm_join_mc;
+  fact->fact.m_leave_mc_fn = ddsi_shm_leave_mc;
+  fact->fact.m_is_mcaddr_fn = ddsi_shm_is_mcaddr;
+  fact->fact.m_is_ssm_mcaddr_fn = ddsi_shm_is_ssm_mcaddr;
+  fact->fact.m_is_nearby_address_fn = ddsi_shm_is_nearby_address;
+  fact->fact.m_locator_from_string_fn = ddsi_shm_address_from_string;
+  fact->fact.m_locator_to_string_fn = ddsi_shm_to_string;
+  fact->fact.m_enumerate_interfaces_fn = ddsi_shm_enumerate_interfaces;
+  fact->fact.m_is_valid_port_fn = ddsi_shm_is_valid_port;
+  ddsi_factory_add (gv, &fact->fact);
+  GVLOG (DDS_LC_CONFIG, "shm initialized (host id %08"PRIx32", ring size %"PRIu32")\n", fact->hostid, ring_size);
+  return 0;
+}
+
+#else
+
+int ddsi_shm_init (struct ddsi_domaingv *gv)
+{
+  GVERROR ("shared memory transport not supported on this platform\n");
+  return -1;
+}
+
+#endif /* defined __linux */
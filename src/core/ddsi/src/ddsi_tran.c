@@ -35,7 +35,9 @@ extern inline int ddsi_listener_locator (ddsi_tran_listener_t listener, nn_locat
 extern inline int ddsi_listener_listen (ddsi_tran_listener_t listener);
 extern inline ddsi_tran_conn_t ddsi_listener_accept (ddsi_tran_listener_t listener);
 extern inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc);
+extern inline int ddsi_conn_read_batch (ddsi_tran_conn_t conn, uint32_t n, unsigned char * const *bufs, size_t len, size_t *sizes, uint32_t *segsizes, nn_locator_t *srclocs);
 extern inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const nn_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags);
+extern inline int ddsi_conn_write_multi (ddsi_tran_conn_t conn, uint32_t n, const nn_locator_t *dsts, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags);
 
 void ddsi_factory_add (struct ddsi_domaingv *gv, ddsi_tran_factory_t factory)
 {
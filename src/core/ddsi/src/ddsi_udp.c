@@ -49,6 +49,40 @@ static void addr_to_loc (const struct ddsi_tran_factory *tran, nn_locator_t *dst
   ddsi_ipaddr_to_loc (tran, dst, &src->a, (src->a.sa_family == AF_INET) ? NN_LOCATOR_KIND_UDPv4 : NN_LOCATOR_KIND_UDPv6);
 }
 
+static void ddsi_udp_conn_received (const struct ddsi_udp_conn *conn, const unsigned char *buf, size_t len, size_t sz, size_t segsize, const ddsrt_msghdr_t *msghdr, const union addr *src)
+{
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  if (gv->pcap_fp)
+  {
+    union addr dest;
+    socklen_t dest_len = sizeof (dest);
+    const ddsrt_wctime_t now = ddsrt_time_wallclock ();
+    if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
+      memset (&dest, 0, sizeof (dest));
+    /* Coalesced datagrams are recorded as the datagrams that were sent */
+    if (segsize == 0)
+      segsize = sz;
+    for (size_t off = 0; off < sz; off += segsize)
+      write_pcap_received (gv, now, &src->x, &dest.x, (unsigned char *) buf + off, (sz - off < segsize) ? sz - off : segsize);
+  }
+
+  /* Check for udp packet truncation */
+#if DDSRT_MSGHDR_FLAGS
+  const bool trunc_flag = (msghdr->msg_flags & MSG_TRUNC) != 0;
+#else
+  const bool trunc_flag = false;
+  (void) msghdr;
+#endif
+  if (sz > len || trunc_flag)
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    nn_locator_t tmp;
+    addr_to_loc (conn->m_base.m_factory, &tmp, src);
+    ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
+    GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) sz, (int) len);
+  }
+}
+
 static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * buf, size_t len, bool allow_spurious, nn_locator_t *srcloc)
 {
   ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
@@ -84,38 +118,96 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   {
     if (srcloc)
       addr_to_loc (conn->m_base.m_factory, srcloc, &src);
+    ddsi_udp_conn_received (conn, buf, len, (size_t) ret, 0, &msghdr, &src);
+  }
+  else if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION)
+  {
+    GVERROR ("UDP recvmsg sock %d: ret %d retcode %"PRId32"\n", (int) conn->m_sock, (int) ret, rc);
+    ret = -1;
+  }
+  return ret;
+}
+
+#if DDSRT_HAVE_RECVMMSG
+static int ddsi_udp_conn_read_batch (ddsi_tran_conn_t conn_cmn, uint32_t n, unsigned char * const *bufs, size_t len, size_t *sizes, uint32_t *segsizes, nn_locator_t *srclocs)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_mmsghdr_t msgs[DDSI_MAX_RECV_BATCH];
+  ddsrt_iovec_t iovs[DDSI_MAX_RECV_BATCH];
+  union addr srcs[DDSI_MAX_RECV_BATCH];
+#if DDSRT_HAVE_UDP_GSO
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } ctrls[DDSI_MAX_RECV_BATCH];
+#endif
+  dds_return_t rc;
+  int nrcvd = 0;
 
-    if (gv->pcap_fp)
+  if (n > DDSI_MAX_RECV_BATCH)
+    n = DDSI_MAX_RECV_BATCH;
+  for (uint32_t i = 0; i < n; i++)
+  {
+    iovs[i].iov_base = (void *) bufs[i];
+    iovs[i].iov_len = (ddsrt_iov_len_t) len;
+    memset (&msgs[i].msg_hdr, 0, sizeof (msgs[i].msg_hdr));
+    msgs[i].msg_hdr.msg_name = &srcs[i].x;
+    msgs[i].msg_hdr.msg_namelen = (socklen_t) sizeof (srcs[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+#if DDSRT_HAVE_UDP_GSO
+    if (conn->m_base.m_gro)
     {
-      union addr dest;
-      socklen_t dest_len = sizeof (dest);
-      if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
-        memset (&dest, 0, sizeof (dest));
-      write_pcap_received (gv, ddsrt_time_wallclock (), &src.x, &dest.x, buf, (size_t) ret);
+      msgs[i].msg_hdr.msg_control = ctrls[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof (ctrls[i].buf);
     }
+#endif
+    msgs[i].msg_len = 0;
+  }
 
-    /* Check for udp packet truncation */
-#if DDSRT_MSGHDR_FLAGS
-    const bool trunc_flag = (msghdr.msg_flags & MSG_TRUNC) != 0;
-#else
-    const bool trunc_flag = false;
+  /* Block for the first one, then take whatever else is available:
+     waiting for a full batch would add latency */
+  do {
+    rc = ddsrt_recvmmsg (conn->m_sock, msgs, n, MSG_WAITFORONE, &nrcvd);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+
+  if (rc != DDS_RETCODE_OK)
+  {
+    if (rc == DDS_RETCODE_BAD_PARAMETER || rc == DDS_RETCODE_NO_CONNECTION)
+      return 0;
+    GVERROR ("UDP recvmmsg sock %d: retcode %"PRId32"\n", (int) conn->m_sock, rc);
+    return -1;
+  }
+
+  for (int i = 0; i < nrcvd; i++)
+  {
+    sizes[i] = msgs[i].msg_len;
+    segsizes[i] = 0;
+#if DDSRT_HAVE_UDP_GSO
+    if (conn->m_base.m_gro)
+    {
+      for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msgs[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR (&msgs[i].msg_hdr, cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+        {
+          int gso_size;
+          memcpy (&gso_size, CMSG_DATA (cmsg), sizeof (gso_size));
+          if (gso_size > 0 && (size_t) gso_size < sizes[i])
+            segsizes[i] = (uint32_t) gso_size;
+        }
+      }
+    }
 #endif
-    if ((size_t) ret > len || trunc_flag)
+    if (msgs[i].msg_len > 0)
     {
-      char addrbuf[DDSI_LOCSTRLEN];
-      nn_locator_t tmp;
-      addr_to_loc (conn->m_base.m_factory, &tmp, &src);
-      ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
-      GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) ret, (int) len);
+      addr_to_loc (conn->m_base.m_factory, &srclocs[i], &srcs[i]);
+      ddsi_udp_conn_received (conn, bufs[i], len, msgs[i].msg_len, segsizes[i], &msgs[i].msg_hdr, &srcs[i]);
     }
   }
-  else if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION)
-  {
-    GVERROR ("UDP recvmsg sock %d: ret %d retcode %"PRId32"\n", (int) conn->m_sock, (int) ret, rc);
-    ret = -1;
-  }
-  return ret;
+  return nrcvd;
 }
+#endif
 
 static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, const ddsrt_iovec_t *iov, size_t iovlen)
 {
@@ -179,6 +271,205 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const nn_locator_
   return (rc == DDS_RETCODE_OK) ? ret : -1;
 }
 
+#if DDSRT_HAVE_SENDMMSG
+#if DDSRT_HAVE_UDP_GSO
+struct segment_iter {
+  const ddsrt_iovec_t *iov;
+  size_t niov;
+  size_t segsize;
+  size_t i, off;
+};
+
+static size_t next_segment (struct segment_iter *it, ddsrt_iovec_t *segiov, size_t *seglen)
+{
+  /* Fills segiov with the iovecs of the next segment of a segmented message,
+     returning the number of iovecs, which is 0 once all have been done;
+     segiov must have room for niov + 1 entries */
+  size_t segniov = 0;
+  *seglen = 0;
+  while (it->i < it->niov && *seglen < it->segsize)
+  {
+    size_t n = it->iov[it->i].iov_len - it->off;
+    if (n > it->segsize - *seglen)
+      n = it->segsize - *seglen;
+    segiov[segniov].iov_base = (char *) it->iov[it->i].iov_base + it->off;
+    segiov[segniov].iov_len = (ddsrt_iov_len_t) n;
+    segniov++;
+    *seglen += n;
+    if ((it->off += n) == it->iov[it->i].iov_len)
+    {
+      it->i++;
+      it->off = 0;
+    }
+  }
+  return segniov;
+}
+
+static bool ddsi_udp_conn_write_segments (ddsi_tran_conn_t conn_cmn, const nn_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags)
+{
+  /* Fallback for when the kernel refuses a segmented message (e.g., because
+     the segments don't fit in the MTU): send the segments one by one */
+  struct segment_iter it = { .iov = iov, .niov = niov, .segsize = segsize, .i = 0, .off = 0 };
+  ddsrt_iovec_t *segiov = ddsrt_malloc ((niov + 1) * sizeof (*segiov));
+  size_t segniov, seglen;
+  bool ok = true;
+  while ((segniov = next_segment (&it, segiov, &seglen)) > 0)
+  {
+    if (ddsi_udp_conn_write (conn_cmn, dst, segniov, segiov, flags) < 0)
+      ok = false;
+  }
+  ddsrt_free (segiov);
+  return ok;
+}
+
+static void write_pcap_sent_segments (struct ddsi_domaingv *gv, ddsrt_wctime_t tstamp, const struct sockaddr_storage *src, const ddsrt_msghdr_t *hdr, uint32_t segsize)
+{
+  struct segment_iter it = { .iov = hdr->msg_iov, .niov = (size_t) hdr->msg_iovlen, .segsize = segsize, .i = 0, .off = 0 };
+  ddsrt_iovec_t *segiov = ddsrt_malloc (((size_t) hdr->msg_iovlen + 1) * sizeof (*segiov));
+  ddsrt_msghdr_t seghdr = *hdr;
+  size_t seglen;
+  while ((seghdr.msg_iovlen = (ddsrt_msg_iovlen_t) next_segment (&it, segiov, &seglen)) > 0)
+  {
+    seghdr.msg_iov = segiov;
+    write_pcap_sent (gv, tstamp, src, &seghdr, seglen);
+  }
+  ddsrt_free (segiov);
+}
+#endif
+
+static int ddsi_udp_conn_write_multi (ddsi_tran_conn_t conn_cmn, uint32_t n, const nn_locator_t *dsts, size_t niov, const ddsrt_iovec_t *iov, uint32_t segsize, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_mmsghdr_t msgs[DDSI_MAX_WRITE_MULTI];
+  union addr dstaddrs[DDSI_MAX_WRITE_MULTI];
+#if DDSRT_HAVE_UDP_GSO
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE (sizeof (uint16_t))];
+  } ctrl;
+#endif
+  dds_return_t rc;
+  unsigned retry = 2;
+  int sendflags = 0;
+  uint32_t i, nsent = 0;
+  assert (niov <= INT_MAX);
+  assert (n <= DDSI_MAX_WRITE_MULTI);
+#if DDSRT_HAVE_UDP_GSO
+  if (segsize > 0 && !conn->m_base.m_gso)
+  {
+    /* Offload failed before, but the message was already constructed */
+    for (i = 0; i < n; i++)
+      if (ddsi_udp_conn_write_segments (conn_cmn, &dsts[i], niov, iov, segsize, flags))
+        nsent++;
+    return (nsent > 0) ? (int) nsent : -1;
+  }
+#else
+  assert (segsize == 0);
+  (void) segsize;
+#endif
+  for (i = 0; i < n; i++)
+  {
+    ddsi_ipaddr_from_loc (&dstaddrs[i].x, &dsts[i]);
+    memset (&msgs[i].msg_hdr, 0, sizeof (msgs[i].msg_hdr));
+    set_msghdr_iov (&msgs[i].msg_hdr, iov, niov);
+    msgs[i].msg_hdr.msg_name = &dstaddrs[i].x;
+    msgs[i].msg_hdr.msg_namelen = (socklen_t) ddsrt_sockaddr_get_size (&dstaddrs[i].a);
+    msgs[i].msg_hdr.msg_flags = (int) flags;
+    msgs[i].msg_len = 0;
+  }
+#if DDSRT_HAVE_UDP_GSO
+  if (segsize > 0)
+  {
+    /* The kernel only reads the control data, so all can share it */
+    struct cmsghdr *cmsg;
+    const uint16_t gso_size = (uint16_t) segsize;
+    memset (&ctrl, 0, sizeof (ctrl));
+    cmsg = (struct cmsghdr *) ctrl.buf;
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (gso_size));
+    memcpy (CMSG_DATA (cmsg), &gso_size, sizeof (gso_size));
+    for (i = 0; i < n; i++)
+    {
+      msgs[i].msg_hdr.msg_control = ctrl.buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof (ctrl.buf);
+    }
+  }
+#endif
+#if MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+
+  /* sendmmsg stops at the first message that fails, reporting the error only
+     if it is the first one; so on error skip the destination it failed for,
+     the same way ddsi_udp_conn_write gives up on it */
+  i = 0;
+  while (i < n)
+  {
+    int nmsgs = 0;
+    rc = ddsrt_sendmmsg (conn->m_sock, &msgs[i], n - i, sendflags, &nmsgs);
+    if (rc == DDS_RETCODE_OK)
+    {
+      i += (uint32_t) nmsgs;
+      nsent += (uint32_t) nmsgs;
+      retry = 2;
+    }
+    else if (rc == DDS_RETCODE_INTERRUPTED || rc == DDS_RETCODE_TRY_AGAIN || (rc == DDS_RETCODE_NOT_ALLOWED && retry-- > 0))
+    {
+      continue;
+    }
+#if DDSRT_HAVE_UDP_GSO
+    else if (segsize > 0 && (rc == DDS_RETCODE_BAD_PARAMETER || rc == DDS_RETCODE_NOT_ENOUGH_SPACE || rc == DDS_RETCODE_ERROR))
+    {
+      /* Segmentation offload not possible for this destination, most likely
+         the segments exceed the MTU: stop using it on this socket */
+      if (conn->m_base.m_gso)
+      {
+        GVWARNING ("ddsi_udp_conn_write_multi: segmentation offload failed with retcode %"PRId32", disabling it\n", rc);
+        conn->m_base.m_gso = false;
+      }
+      if (ddsi_udp_conn_write_segments (conn_cmn, &dsts[i], niov, iov, segsize, flags))
+        nsent++;
+      msgs[i].msg_len = 0;
+      i++;
+    }
+#endif
+    else
+    {
+      if (rc != DDS_RETCODE_NOT_ALLOWED && rc != DDS_RETCODE_NO_CONNECTION)
+        GVERROR ("ddsi_udp_conn_write_multi failed with retcode %"PRId32"\n", rc);
+      msgs[i].msg_len = 0;
+      i++;
+      retry = 2;
+    }
+  }
+
+  if (nsent > 0 && gv->pcap_fp)
+  {
+    union addr sa;
+    socklen_t alen = sizeof (sa);
+    ddsrt_wctime_t now = ddsrt_time_wallclock ();
+    if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+      memset(&sa, 0, sizeof(sa));
+    for (i = 0; i < n; i++)
+    {
+      if (msgs[i].msg_len == 0)
+        continue;
+#if DDSRT_HAVE_UDP_GSO
+      if (segsize > 0)
+      {
+        write_pcap_sent_segments (gv, now, &sa.x, &msgs[i].msg_hdr, segsize);
+        continue;
+      }
+#endif
+      write_pcap_sent (gv, now, &sa.x, &msgs[i].msg_hdr, msgs[i].msg_len);
+    }
+  }
+  return (nsent > 0) ? (int) nsent : -1;
+}
+#endif
+
 static void ddsi_udp_disable_multiplexing (ddsi_tran_conn_t conn_cmn)
 {
 #if defined _WIN32 && !defined WINCE
@@ -414,6 +705,9 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
   dds_return_t rc;
   ddsrt_socket_t sock;
   bool reuse_addr = false, bind_to_any = false, ipv6 = false;
+#if DDSRT_HAVE_UDP_GSO
+  bool gso = false, gro = false;
+#endif
   const char *purpose_str = NULL;
 
   switch (qos->m_purpose)
@@ -516,6 +810,26 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
   }
 #endif
 
+#if DDSRT_HAVE_UDP_GSO
+  if (gv->config.xmit_gso)
+  {
+    /* Only probing for support: the segment size is set per message */
+    int segsize;
+    socklen_t segsize_len = sizeof (segsize);
+    if ((rc = ddsrt_getsockopt (sock, SOL_UDP, UDP_SEGMENT, &segsize, &segsize_len)) == DDS_RETCODE_OK)
+      gso = true;
+    else
+      GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: segmentation offload not supported: %s\n", dds_strretcode (rc));
+  }
+  if (gv->config.recv_gro && qos->m_purpose != DDSI_TRAN_QOS_XMIT)
+  {
+    if ((rc = ddsrt_setsockopt (sock, SOL_UDP, UDP_GRO, &one, sizeof (one))) == DDS_RETCODE_OK)
+      gro = true;
+    else
+      GVLOG (DDS_LC_CONFIG, "ddsi_udp_create_conn: receive offload not supported: %s\n", dds_strretcode (rc));
+  }
+#endif
+
   ddsi_udp_conn_t conn = ddsrt_malloc (sizeof (*conn));
   memset (conn, 0, sizeof (*conn));
 
@@ -533,7 +847,17 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
   conn->m_base.m_base.m_handle_fn = ddsi_udp_conn_handle;
 
   conn->m_base.m_read_fn = ddsi_udp_conn_read;
+#if DDSRT_HAVE_RECVMMSG
+  conn->m_base.m_read_batch_fn = ddsi_udp_conn_read_batch;
+#endif
   conn->m_base.m_write_fn = ddsi_udp_conn_write;
+#if DDSRT_HAVE_SENDMMSG
+  conn->m_base.m_write_multi_fn = ddsi_udp_conn_write_multi;
+#endif
+#if DDSRT_HAVE_UDP_GSO
+  conn->m_base.m_gso = gso;
+  conn->m_base.m_gro = gro;
+#endif
   conn->m_base.m_disable_multiplexing_fn = ddsi_udp_disable_multiplexing;
   conn->m_base.m_locator_fn = ddsi_udp_conn_locator;
 
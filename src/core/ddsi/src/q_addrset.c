@@ -143,7 +143,7 @@ int add_addresses_to_addrset (const struct ddsi_domaingv *gv, struct addrset *as
   {
     int port = 0, pos;
     int mcgen_base = -1, mcgen_count = -1, mcgen_idx = -1;
-    if (gv->config.transport_selector == TRANS_UDP || gv->config.transport_selector == TRANS_TCP)
+    if (gv->config.transport_selector == TRANS_UDP || gv->config.transport_selector == TRANS_TCP || gv->config.transport_selector == TRANS_SHM)
     {
       if (port_mode == -1 && sscanf (a, "%[^:]:%d%n", ip, &port, &pos) == 2 && a[pos] == 0)
         ; /* XYZ:PORT */
@@ -162,6 +162,7 @@ DUPF(uint32);
 #endif
 DU(natint);
 DU(natint_255);
+DU(recv_batch_size);
 DUPF(participantIndex);
 DU(dyn_port);
 DUPF(memsize);
@@ -174,6 +175,7 @@ PF(duration);
 DUPF(standards_conformance);
 DUPF(besmode);
 DUPF(retransmit_merging);
+DUPF(timed_event_queue);
 DUPF(sched_class);
 DUPF(maybe_memsize);
 DUPF(maybe_int32);
@@ -269,7 +271,7 @@ static const struct cfgelem general_cfgelems[] = {
   { LEAF ("UseIPv6"), 1, "default", ABSOFF (compat_use_ipv6), 0, uf_boolean_default, 0, pf_nop,
     BLURB("<p>Deprecated (use Transport instead)</p>") },
   { LEAF ("Transport"), 1, "default", ABSOFF (transport_selector), 0, uf_transport_selector, 0, pf_transport_selector,
-    BLURB("<p>This element allows selecting the transport to be used (udp, udp6, tcp, tcp6, raweth)</p>") },
+    BLURB("<p>This element allows selecting the transport to be used (udp, udp6, tcp, tcp6, raweth, shm)</p>") },
   { LEAF("EnableMulticastLoopback"), 1, "true", ABSOFF(enableMulticastLoopback), 0, uf_boolean, 0, pf_boolean,
     BLURB("<p>This element specifies whether DDSI2E allows IP multicast packets to be visible to all DDSI participants in the same node, including itself. It must be \"true\" for intra-node multicast communications, but if a node runs only a single DDSI2E service and does not host any other DDSI-capable programs, it should be set to \"false\" for improved performance.</p>") },
   { LEAF("MaxMessageSize"), 1, "4096 B", ABSOFF(max_msg_size), 0, uf_memsize, 0, pf_memsize,
@@ -638,6 +640,8 @@ static const struct cfgelem internal_cfgelems[] = {
   { MOVED("FragmentSize", "CycloneDDS/General/FragmentSize") },
   { LEAF("DeliveryQueueMaxSamples"), 1, "256", ABSOFF(delivery_queue_maxsamples), 0, uf_uint, 0, pf_uint,
     BLURB("<p>This element controls the Maximum size of a delivery queue, expressed in samples. Once a delivery queue is full, incoming samples destined for that queue are dropped until space becomes available again.</p>") },
+  { LEAF("DeliveryQueueThreads"), 1, "1", ABSOFF(delivery_queue_threads), 0, uf_uint, 0, pf_uint,
+    BLURB("<p>This element sets the number of delivery queues (each with its own thread) for application data. Each proxy writer is assigned to one of them based on its GUID, so that the data of any one writer is always delivered in order, while data from different writers can be delivered in parallel. The first queue is handled by the thread named \"dq.user\", the others by threads named \"dq.user.N\". The maximum is 16.</p>") },
   { LEAF("PrimaryReorderMaxSamples"), 1, "128", ABSOFF(primary_reorder_maxsamples), 0, uf_uint, 0, pf_uint,
     BLURB("<p>This element sets the maximum size in samples of a primary re-order administration. Each proxy writer has one primary re-order administration to buffer the packet flow in case some packets arrive out of order. Old samples are forwarded to secondary re-order administrations associated with readers in need of historical data.</p>") },
   { LEAF("SecondaryReorderMaxSamples"), 1, "128", ABSOFF(secondary_reorder_maxsamples), 0, uf_uint, 0, pf_uint,
@@ -696,6 +700,10 @@ static const struct cfgelem internal_cfgelems[] = {
     BLURB("<p>This setting controls the delay between the discovering a remote writer and sending a pre-emptive AckNack to discover the range of data available.</p>") },
   { LEAF("ScheduleTimeRounding"), 1, "0 ms", ABSOFF(schedule_time_rounding), 0, uf_duration_ms_1hr, 0, pf_duration,
     BLURB("<p>This setting allows the timing of scheduled events to be rounded up so that more events can be handled in a single cycle of the event queue. The default is 0 and causes no rounding at all, i.e. are scheduled exactly, whereas a value of 10ms would mean that events are rounded up to the nearest 10 milliseconds.</p>") },
+  { LEAF("TimedEventQueue"), 1, "heap", ABSOFF(timed_event_queue), 0, uf_timed_event_queue, 0, pf_timed_event_queue,
+    BLURB("<p>This setting selects the data structure used for the timed events (heartbeats, acknowledgements, discovery and the like). The options are:</p>\n\
+<ul><li><i>heap</i>: a Fibonacci heap, events are handled in the exact order of their scheduled times;</li>\n\
+<li><i>wheel</i>: a hierarchical timing wheel, which makes scheduling and rescheduling events a constant-time operation at the cost of not ordering events scheduled within the same 65us interval. This helps when there are very many writers and proxy readers.</li></ul>") },
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
   { LEAF("AuxiliaryBandwidthLimit"), 1, "inf", ABSOFF(auxiliary_bandwidth_limit), 0, uf_bandwidth, 0, pf_bandwidth,
     BLURB("<p>This element specifies the maximum transmit rate of auxiliary traffic not bound to a specific channel, such as discovery traffic, as well as auxiliary traffic related to a certain channel if that channel has elected to share this global AuxiliaryBandwidthLimit. Bandwidth limiting uses a leaky bucket scheme. The default value \"inf\" means DDSI2E imposes no limitation, the underlying operating system and hardware will likely limit the maimum transmit rate.</p>") },
@@ -714,8 +722,12 @@ static const struct cfgelem internal_cfgelems[] = {
     BLURB("<p>When true, include keyhashes in outgoing data for topics with keys.</p>") },
   { LEAF("MaxSampleSize"), 1, "2147483647 B", ABSOFF(max_sample_size), 0, uf_memsize, 0, pf_memsize,
     BLURB("<p>This setting controls the maximum (CDR) serialised size of samples that DDSI2E will forward in either direction. Samples larger than this are discarded with a warning.</p>") },
+  { LEAF("SerdataPoolMaxSize"), 1, "8 KiB", ABSOFF(serdata_pool_max_size), 0, uf_memsize, 0, pf_memsize,
+    BLURB("<p>This element sets the size of the largest serialised sample buffer that is recycled through the sample buffer pool rather than freed. The pool is organised in size classes of powers of two starting at 128 bytes, buffers are rounded up to the size of their class. The value is rounded down to a power of two, with a maximum of 1 MiB; a value below 128 bytes disables pooling.</p>") },
   { LEAF("WriteBatch"), 1, "false", ABSOFF(whc_batch), 0, uf_boolean, 0, pf_boolean,
     BLURB("<p>This element enables the batching of write operations. By default each write operation writes through the write cache and out onto the transport. Enabling write batching causes multiple small write operations to be aggregated within the write cache into a single larger write. This gives greater throughput at the expense of latency. Currently there is no mechanism for the write cache to automatically flush itself, so that if write batching is enabled, the application may have to use the dds_write_flush function to ensure that all samples are written.</p>") },
+  { LEAF("WhcRing"), 1, "false", ABSOFF(whc_ring), 0, uf_boolean, 0, pf_boolean,
+    BLURB("<p>This element enables an alternative writer history cache for volatile writers without a deadline or lifespan. It stores the samples in a ring buffer indexed directly by sequence number, making retransmits and the dropping of acknowledged samples cheaper than in the default cache. Its memory use is proportional to the range of unacknowledged sequence numbers rather than the number of samples retained, which may be significantly larger for keep-last writers with many instances and slow readers.</p>") },
   { LEAF_W_ATTRS("LivelinessMonitoring", liveliness_monitoring_attrs), 1, "false", ABSOFF(liveliness_monitoring), 0, uf_boolean, 0, pf_boolean,
     BLURB("<p>This element controls whether or not implementation should internally monitor its own liveliness. If liveliness monitoring is enabled, stack traces can be dumped automatically when some thread appears to have stopped making progress.</p>") },
   { LEAF("MonitorPort"), 1, "-1", ABSOFF(monitor_port), 0, uf_int, 0, pf_int,
@@ -732,6 +744,12 @@ static const struct cfgelem internal_cfgelems[] = {
     BLURB("<p>This element controls for how long a remote participant that was previously deleted will remain on a blacklist to prevent rediscovery, giving the software on a node time to perform any cleanup actions it needs to do. To some extent this delay is required internally by DDSI2E, but in the default configuration with the 'enforce' attribute set to false, DDSI2E will reallow rediscovery as soon as it has cleared its internal administration. Setting it to too small a value may result in the entry being pruned from the blacklist before DDSI2E is ready, it is therefore recommended to set it to at least several seconds.</p>") },
   { LEAF_W_ATTRS("MultipleReceiveThreads", multiple_recv_threads_attrs), 1, "default", ABSOFF(multiple_recv_threads), 0, uf_boolean_default, 0, pf_boolean_default,
     BLURB("<p>This element controls whether all traffic is handled by a single receive thread (false) or whether multiple receive threads may be used to improve latency (true). By default it is disabled on Windows because it appears that one cannot count on being able to send packets to oneself, which is necessary to stop the thread during shutdown. Currently multiple receive threads are only used for connectionless transport (e.g., UDP) and ManySocketsMode not set to single (the default).</p>") },
+  { LEAF("ReceiveBatchSize"), 1, "1", ABSOFF(recv_batch_size), 0, uf_recv_batch_size, 0, pf_int,
+    BLURB("<p>This element sets the maximum number of packets a receive thread retrieves from a socket in a single system call and then processes as a batch. Values greater than 1 reduce the system call overhead at high packet rates, but reserve more of the receive buffer while receiving. The maximum is 64. Batched receiving is currently only supported for UDP on Linux, on other platforms and transports it is ignored.</p>") },
+  { LEAF("ReceiveOffload"), 1, "false", ABSOFF(recv_gro), 0, uf_boolean, 0, pf_boolean,
+    BLURB("<p>This element controls whether the kernel may coalesce consecutive UDP datagrams from the same source into a single larger one that is then split again after receiving it (generic receive offload, UDP_GRO), reducing the number of system calls needed for receiving large, fragmented samples. The receive buffer chunks should then be at least 64kB (the default). It is currently only supported on Linux, on other platforms it is ignored.</p>") },
+  { LEAF("SegmentationOffload"), 1, "false", ABSOFF(xmit_gso), 0, uf_boolean, 0, pf_boolean,
+    BLURB("<p>This element controls whether consecutive packets to the same destinations are handed to the kernel in one go as a sequence of equally-sized segments, each of which is then sent as a separate UDP datagram (generic segmentation offload, UDP_SEGMENT), reducing the number of system calls needed for sending large, fragmented samples. Packets are padded as needed to make them the same size. The segments are limited to General/MaxMessageSize, which must then not exceed the network MTU minus the IP and UDP headers. It is currently only supported on Linux, on other platforms it is ignored.</p>") },
   { MGROUP("ControlTopic", control_topic_cfgelems, control_topic_cfgattrs), 1, 0, 0, 0, 0, 0, 0, 0,
     BLURB("<p>The ControlTopic element allows configured whether DDSI2E provides a special control interface via a predefined topic or not.<p>") },
   { GROUP("Test", internal_test_cfgelems),
@@ -772,6 +790,12 @@ static const struct cfgelem discovery_ports_cfgelems[] = {
   END_MARKER
 };
 
+static const struct cfgelem shm_cfgelems[] = {
+  { LEAF("RingSize"), 1, "4 MiB", ABSOFF(shm_ring_size), 0, uf_memsize, 0, pf_memsize,
+    BLURB("<p>This element specifies the size of the shared memory ring buffer in which a process receives the messages sent to it when General/Transport is set to shm. It is rounded up to a power of two of at least 128 kB. Messages that do not fit in the receiving process' ring are dropped, like UDP datagrams that do not fit in a socket receive buffer.</p>") },
+  END_MARKER
+};
+
 static const struct cfgelem tcp_cfgelems[] = {
   { LEAF ("Enable"), 1, "default", ABSOFF (compat_tcp_enable), 0, uf_boolean_default, 0, pf_nop,
     BLURB("<p>This element enables the optional TCP transport - deprecated, use General/Transport instead.</p>") },
@@ -944,6 +968,8 @@ static const struct cfgelem domain_cfgelems[] = {
     BLURB("<p>The Tracing element controls the amount and type of information that is written into the tracing log by the DDSI service. This is useful to track the DDSI service during application development.</p>") },
   { GROUP("Internal|Unsupported", internal_cfgelems),
     BLURB("<p>The Internal elements deal with a variety of settings that evolving and that are not necessarily fully supported. For the vast majority of the Internal settings, the functionality per-se is supported, but the right to change the way the options control the functionality is reserved. This includes renaming or moving options.</p>") },
+  { GROUP("SharedMemory", shm_cfgelems),
+    BLURB("<p>The SharedMemory element allows specifying various parameters related to running DDSI over shared memory between processes on the same host.</p>") },
   { GROUP("TCP", tcp_cfgelems),
     BLURB("<p>The TCP element allows specifying various parameters related to running DDSI over TCP.</p>") },
   { GROUP("ThreadPool", tp_cfgelems),
@@ -1638,12 +1664,16 @@ static const char *en_retransmit_merging_vs[] = { "never", "adaptive", "always",
 static const enum retransmit_merging en_retransmit_merging_ms[] = { REXMIT_MERGE_NEVER, REXMIT_MERGE_ADAPTIVE, REXMIT_MERGE_ALWAYS, 0 };
 GENERIC_ENUM (retransmit_merging)
 
+static const char *en_timed_event_queue_vs[] = { "heap", "wheel", NULL };
+static const enum timed_event_queue en_timed_event_queue_ms[] = { TEVQ_FIBHEAP, TEVQ_TIMING_WHEEL, 0 };
+GENERIC_ENUM (timed_event_queue)
+
 static const char *en_sched_class_vs[] = { "realtime", "timeshare", "default", NULL };
 static const ddsrt_sched_t en_sched_class_ms[] = { DDSRT_SCHED_REALTIME, DDSRT_SCHED_TIMESHARE, DDSRT_SCHED_DEFAULT, 0 };
 GENERIC_ENUM_CTYPE (sched_class, ddsrt_sched_t)
 
-static const char *en_transport_selector_vs[] = { "default", "udp", "udp6", "tcp", "tcp6", "raweth", NULL };
-static const enum transport_selector en_transport_selector_ms[] = { TRANS_DEFAULT, TRANS_UDP, TRANS_UDP6, TRANS_TCP, TRANS_TCP6, TRANS_RAWETH, 0 };
+static const char *en_transport_selector_vs[] = { "default", "udp", "udp6", "tcp", "tcp6", "raweth", "shm", NULL };
+static const enum transport_selector en_transport_selector_ms[] = { TRANS_DEFAULT, TRANS_UDP, TRANS_UDP6, TRANS_TCP, TRANS_TCP6, TRANS_RAWETH, TRANS_SHM, 0 };
 GENERIC_ENUM (transport_selector)
 
 /* by putting the  "true" and "false" aliases at the end, they won't come out of the
@@ -2056,6 +2086,11 @@ static enum update_result uf_natint_255(struct cfgst *cfgst, void *parent, struc
   return uf_int_min_max(cfgst, parent, cfgelem, first, value, 0, 255);
 }
 
+static enum update_result uf_recv_batch_size(struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, int first, const char *value)
+{
+  return uf_int_min_max(cfgst, parent, cfgelem, first, value, 1, DDSI_MAX_RECV_BATCH);
+}
+
 static enum update_result uf_uint (struct cfgst *cfgst, void *parent, struct cfgelem const * const cfgelem, UNUSED_ARG (int first), const char *value)
 {
   uint32_t * const elem = cfg_address (cfgst, parent, cfgelem);
@@ -2971,6 +3006,7 @@ struct cfgst *config_init (const char *config, struct config *cfg, uint32_t domi
         ok1 = !(cfgst->cfg->compat_tcp_enable == BOOLDEF_TRUE || cfgst->cfg->compat_use_ipv6 == BOOLDEF_FALSE);
         break;
       case TRANS_RAWETH:
+      case TRANS_SHM:
         ok1 = !(cfgst->cfg->compat_tcp_enable == BOOLDEF_TRUE || cfgst->cfg->compat_use_ipv6 == BOOLDEF_TRUE);
         break;
     }
@@ -19,6 +19,7 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/md5.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/string.h"
@@ -929,7 +930,6 @@ static int sedp_write_endpoint
       ps.group_guid = epcommon->group_guid;
     }
 
-#ifdef DDSI_INCLUDE_SSM
     /* A bit of a hack -- the easy alternative would be to make it yet
      another parameter.  We only set "reader favours SSM" if we
      really do: no point in telling the world that everything is at
@@ -938,13 +938,22 @@ static int sedp_write_endpoint
     {
       const struct reader *rd = entidx_lookup_reader_guid (gv->entity_index, epguid);
       assert (rd);
+#ifdef DDSI_INCLUDE_SSM
       if (rd->favours_ssm)
       {
         ps.present |= PP_READER_FAVOURS_SSM;
         ps.reader_favours_ssm.state = 1u;
       }
-    }
 #endif
+      if (rd->field_filter.n > 0)
+      {
+        /* sequences of structs are always freed by ddsi_plist_fini, so make a copy */
+        ps.present |= PP_CYCLONE_FIELD_FILTER;
+        ps.field_filter.type_hash = rd->field_filter.type_hash;
+        ps.field_filter.n = rd->field_filter.n;
+        ps.field_filter.terms = ddsrt_memdup (rd->field_filter.terms, rd->field_filter.n * sizeof (*rd->field_filter.terms));
+      }
+    }
 
     qosdiff = ddsi_xqos_delta (xqos, defqos, ~(uint64_t)0);
     if (gv->config.explicitly_publish_qos_set_to_default)
@@ -1134,6 +1143,21 @@ static struct proxy_participant *implicitly_create_proxypp (struct ddsi_domaingv
   return entidx_lookup_proxy_participant_guid (gv->entity_index, ppguid);
 }
 
+#ifndef DDSI_INCLUDE_NETWORK_CHANNELS
+static struct nn_dqueue *user_dqueue_for_proxy_writer (const struct ddsi_domaingv *gv, const ddsi_guid_t *pwr_guid)
+{
+  /* All data of a writer must go through the same queue to be delivered in order,
+     any deterministic spreading of writers over the queues is fine */
+  if (gv->n_user_dqueues == 1)
+    return gv->user_dqueues[0];
+  else
+  {
+    const ddsi_guid_t g = nn_hton_guid (*pwr_guid);
+    return gv->user_dqueues[ddsrt_mh3 (&g, sizeof (g), 0) % gv->n_user_dqueues];
+  }
+}
+#endif
+
 static void handle_SEDP_alive (const struct receiver_state *rst, seqno_t seq, ddsi_plist_t *datap /* note: potentially modifies datap */, const ddsi_guid_prefix_t *src_guid_prefix, nn_vendorid_t vendorid, ddsrt_wctime_t timestamp)
 {
 #define E(msg, lbl) do { GVLOGDISC (msg); goto lbl; } while (0)
@@ -1304,7 +1328,7 @@ static void handle_SEDP_alive (const struct receiver_state *rst, seqno_t seq, dd
           new_proxy_writer (&ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : gv->xevents, timestamp);
         }
 #else
-        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, gv->user_dqueue, gv->xevents, timestamp, seq);
+        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, user_dqueue_for_proxy_writer (gv, &datap->endpoint_guid), gv->xevents, timestamp, seq);
 #endif
       }
     }
@@ -1312,7 +1336,7 @@ static void handle_SEDP_alive (const struct receiver_state *rst, seqno_t seq, dd
     {
       if (prd)
       {
-        update_proxy_reader (prd, seq, as, xqos, timestamp);
+        update_proxy_reader (prd, seq, as, xqos, (datap->present & PP_CYCLONE_FIELD_FILTER) ? &datap->field_filter : NULL, timestamp);
       }
       else
       {
@@ -299,6 +299,28 @@ static int print_proxy_participants (struct thread_state1 * const ts1, struct dd
   return x;
 }
 
+static int print_dqueue (ddsi_tran_conn_t conn, struct nn_dqueue *q)
+{
+  struct nn_dqueue_stats st;
+  nn_dqueue_get_stats (q, &st);
+  return cpf (conn, "dqueue %s depth %"PRIu32" max %"PRIu32" limit %"PRIu32" #full %"PRIu32" #throttle %"PRIu32"\n",
+              st.name, st.nof_samples, st.max_nof_samples, st.max_samples, st.nof_full, st.nof_throttled);
+}
+
+static int print_dqueues (struct ddsi_domaingv *gv, ddsi_tran_conn_t conn)
+{
+  int x = 0;
+  x += print_dqueue (conn, gv->builtins_dqueue);
+#ifdef DDSI_INCLUDE_NETWORK_CHANNELS
+  for (struct config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
+    x += print_dqueue (conn, chptr->dqueue);
+#else
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+    x += print_dqueue (conn, gv->user_dqueues[i]);
+#endif
+  return x;
+}
+
 static void debmon_handle_connection (struct debug_monitor *dm, ddsi_tran_conn_t conn)
 {
   struct thread_state1 * const ts1 = lookup_thread_state ();
@@ -307,6 +329,8 @@ static void debmon_handle_connection (struct debug_monitor *dm, ddsi_tran_conn_t
   r += print_participants (ts1, dm->gv, conn);
   if (r == 0)
     r += print_proxy_participants (ts1, dm->gv, conn);
+  if (r == 0)
+    r += print_dqueues (dm->gv, conn);
 
   /* Note: can only add plugins (at the tail) */
   ddsrt_mutex_lock (&dm->lock);
@@ -20,6 +20,7 @@
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/static_assert.h"
 
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_config.h"
@@ -40,6 +41,7 @@
 #include "dds/ddsi/q_protocol.h" /* NN_ENTITYID_... */
 #include "dds/ddsi/q_unused.h"
 #include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
 #include "dds/ddsi/ddsi_mcgroup.h"
 #include "dds/ddsi/q_receive.h"
 #include "dds/ddsi/ddsi_udp.h" /* nn_mc4gen_address_t */
@@ -102,7 +104,7 @@ static const unsigned builtin_writers_besmask =
 
 
 static dds_return_t new_writer_guid (struct writer **wr_out, const struct ddsi_guid *guid, const struct ddsi_guid *group_guid, struct participant *pp, const struct ddsi_sertopic *topic, const struct dds_qos *xqos, struct whc *whc, status_cb_t status_cb, void *status_cbarg);
-static dds_return_t new_reader_guid (struct reader **rd_out, const struct ddsi_guid *guid, const struct ddsi_guid *group_guid, struct participant *pp, const struct ddsi_sertopic *topic, const struct dds_qos *xqos, struct ddsi_rhc *rhc, status_cb_t status_cb, void *status_cbarg);
+static dds_return_t new_reader_guid (struct reader **rd_out, const struct ddsi_guid *guid, const struct ddsi_guid *group_guid, struct participant *pp, const struct ddsi_sertopic *topic, const struct dds_qos *xqos, const nn_field_filter_t *field_filter, struct ddsi_rhc *rhc, status_cb_t status_cb, void *status_cbarg);
 static struct participant *ref_participant (struct participant *pp, const struct ddsi_guid *guid_of_refing_entity);
 static void unref_participant (struct participant *pp, const struct ddsi_guid *guid_of_refing_entity);
 static struct entity_common *entity_common_from_proxy_endpoint_common (const struct proxy_endpoint_common *c);
@@ -602,11 +604,11 @@ static void add_security_builtin_endpoints(struct participant *pp, ddsi_guid_t *
   if (add_readers)
   {
     subguid->entityid = to_entityid (NN_ENTITYID_SEDP_BUILTIN_SUBSCRIPTIONS_SECURE_READER);
-    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_reader_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_reader_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
     pp->bes |= NN_BUILTIN_ENDPOINT_SUBSCRIPTION_MESSAGE_SECURE_DETECTOR;
 
     subguid->entityid = to_entityid (NN_ENTITYID_SEDP_BUILTIN_PUBLICATIONS_SECURE_READER);
-    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_writer_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_writer_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
     pp->bes |= NN_BUILTIN_ENDPOINT_PUBLICATION_MESSAGE_SECURE_DETECTOR;
   }
 
@@ -615,19 +617,19 @@ static void add_security_builtin_endpoints(struct participant *pp, ddsi_guid_t *
    * besmode flag setting, because all participant do require authentication.
    */
   subguid->entityid = to_entityid (NN_ENTITYID_SPDP_RELIABLE_BUILTIN_PARTICIPANT_SECURE_READER);
-  new_reader_guid (NULL, subguid, group_guid, pp, gv->spdp_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+  new_reader_guid (NULL, subguid, group_guid, pp, gv->spdp_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
   pp->bes |= NN_DISC_BUILTIN_ENDPOINT_PARTICIPANT_SECURE_DETECTOR;
 
   subguid->entityid = to_entityid (NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_VOLATILE_SECURE_READER);
-  new_reader_guid (NULL, subguid, group_guid, pp, gv->pgm_volatile_topic, &gv->builtin_volatile_xqos_rd, NULL, NULL, NULL);
+  new_reader_guid (NULL, subguid, group_guid, pp, gv->pgm_volatile_topic, &gv->builtin_volatile_xqos_rd, NULL, NULL, NULL, NULL);
   pp->bes |= NN_BUILTIN_ENDPOINT_PARTICIPANT_VOLATILE_SECURE_DETECTOR;
 
   subguid->entityid = to_entityid (NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_STATELESS_MESSAGE_READER);
-  new_reader_guid (NULL, subguid, group_guid, pp, gv->pgm_stateless_topic, &gv->builtin_stateless_xqos_rd, NULL, NULL, NULL);
+  new_reader_guid (NULL, subguid, group_guid, pp, gv->pgm_stateless_topic, &gv->builtin_stateless_xqos_rd, NULL, NULL, NULL, NULL);
   pp->bes |= NN_BUILTIN_ENDPOINT_PARTICIPANT_STATELESS_MESSAGE_DETECTOR;
 
   subguid->entityid = to_entityid (NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_MESSAGE_SECURE_READER);
-  new_reader_guid (NULL, subguid, group_guid, pp, gv->pmd_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+  new_reader_guid (NULL, subguid, group_guid, pp, gv->pmd_secure_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
   pp->bes |= NN_BUILTIN_ENDPOINT_PARTICIPANT_MESSAGE_SECURE_DETECTOR;
 }
 #endif
@@ -659,19 +661,19 @@ static void add_builtin_endpoints(struct participant *pp, ddsi_guid_t *subguid,
   if (add_readers)
   {
     subguid->entityid = to_entityid (NN_ENTITYID_SPDP_BUILTIN_PARTICIPANT_READER);
-    new_reader_guid (NULL, subguid, group_guid, pp, gv->spdp_topic, &gv->spdp_endpoint_xqos, NULL, NULL, NULL);
+    new_reader_guid (NULL, subguid, group_guid, pp, gv->spdp_topic, &gv->spdp_endpoint_xqos, NULL, NULL, NULL, NULL);
     pp->bes |= NN_DISC_BUILTIN_ENDPOINT_PARTICIPANT_DETECTOR;
 
     subguid->entityid = to_entityid (NN_ENTITYID_SEDP_BUILTIN_SUBSCRIPTIONS_READER);
-    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_reader_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_reader_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
     pp->bes |= NN_DISC_BUILTIN_ENDPOINT_SUBSCRIPTION_DETECTOR;
 
     subguid->entityid = to_entityid (NN_ENTITYID_SEDP_BUILTIN_PUBLICATIONS_READER);
-    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_writer_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+    new_reader_guid (NULL, subguid, group_guid, pp, gv->sedp_writer_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
     pp->bes |= NN_DISC_BUILTIN_ENDPOINT_PUBLICATION_DETECTOR;
 
     subguid->entityid = to_entityid (NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_MESSAGE_READER);
-    new_reader_guid (NULL, subguid, group_guid, pp, gv->pmd_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL);
+    new_reader_guid (NULL, subguid, group_guid, pp, gv->pmd_topic, &gv->builtin_endpoint_xqos_rd, NULL, NULL, NULL, NULL);
     pp->bes |= NN_BUILTIN_ENDPOINT_PARTICIPANT_MESSAGE_DATA_READER;
   }
 
@@ -1778,6 +1780,7 @@ static void free_wr_prd_match (const struct ddsi_domaingv *gv, const ddsi_guid_t
     (void) wr_guid;
 #endif
     nn_lat_estim_fini (&m->hb_to_ack_latency);
+    ddsrt_free (m->field_filter);
     ddsrt_free (m);
   }
 }
@@ -1875,6 +1878,7 @@ static void writer_drop_connection (const struct ddsi_guid *wr_guid, const struc
       remove_acked_messages (wr, &whcst, &deferred_free_list);
       wr->num_readers--;
       wr->num_reliable_readers -= m->is_reliable;
+      wr->num_filtered_readers -= (m->field_filter != NULL);
     }
 
     ddsrt_mutex_unlock (&wr->e.lock);
@@ -2172,11 +2176,96 @@ static void proxy_reader_drop_connection (const struct ddsi_guid *prd_guid, stru
   }
 }
 
+static void field_filter_copy (nn_field_filter_t *dst, const nn_field_filter_t *src)
+{
+  if (src && src->n > 0)
+  {
+    dst->type_hash = src->type_hash;
+    dst->n = src->n;
+    dst->terms = ddsrt_memdup (src->terms, src->n * sizeof (*src->terms));
+  }
+  else
+  {
+    dst->type_hash = 0;
+    dst->n = 0;
+    dst->terms = NULL;
+  }
+}
+
+static bool field_filter_eq (const nn_field_filter_t *a, const nn_field_filter_t *b)
+{
+  const uint32_t bn = b ? b->n : 0;
+  return a->n == bn && (bn == 0 || (a->type_hash == b->type_hash && memcmp (a->terms, b->terms, bn * sizeof (*a->terms)) == 0));
+}
+
+static struct dds_stream_field_term *compile_field_filter (const struct writer *wr, const ddsi_guid_t *prd_guid, const nn_field_filter_t *ff)
+{
+  /* The field filter is advertised as a list of ADR instructions in the
+     reader's type, which we can only interpret if the writer uses a type
+     with the same ops.  Anything we can't interpret simply means all
+     samples get sent, the reader filters them anyway. */
+  if (ff->n == 0 || wr->topic->ops != &ddsi_sertopic_ops_default)
+    return NULL;
+  const struct ddsi_sertopic_default *tp = (const struct ddsi_sertopic_default *) wr->topic;
+  if (ff->type_hash != dds_stream_fieldref_type_hash (&tp->type))
+  {
+    ELOGDISC (wr, "  writer "PGUIDFMT" ignoring field filter of prd "PGUIDFMT" for a different type\n", PGUID (wr->e.guid), PGUID (*prd_guid));
+    return NULL;
+  }
+  struct dds_stream_field_term *terms = ddsrt_malloc (ff->n * sizeof (*terms));
+  for (uint32_t i = 0; i < ff->n; i++)
+  {
+    const nn_field_filter_term_t *t = &ff->terms[i];
+    if (t->cmp > DDS_STREAM_FIELD_GE || !dds_stream_fieldref_init_index (&terms[i].ref, &tp->type, t->op_index))
+    {
+      ELOGDISC (wr, "  writer "PGUIDFMT" ignoring field filter of prd "PGUIDFMT"\n", PGUID (wr->e.guid), PGUID (*prd_guid));
+      ddsrt_free (terms);
+      return NULL;
+    }
+    terms[i].cmp = (enum dds_stream_field_cmp) t->cmp;
+    DDSRT_STATIC_ASSERT (sizeof (terms[i].value) == sizeof (t->value));
+    memcpy (&terms[i].value, &t->value, sizeof (terms[i].value));
+  }
+  return terms;
+}
+
+static void writer_set_field_filter_locked (struct writer *wr, struct wr_prd_match *m, const nn_field_filter_t *ff, uint32_t gen)
+{
+  /* generations make sure an older version of the proxy reader's filter never
+     replaces a newer one, whatever the order of the updates */
+  if ((int32_t) (gen - m->field_filter_gen) <= 0)
+    return;
+  wr->num_filtered_readers -= (m->field_filter != NULL);
+  ddsrt_free (m->field_filter);
+  m->field_filter_gen = gen;
+  m->field_filter_nterms = ff->n;
+  m->field_filter = compile_field_filter (wr, &m->prd_guid, ff);
+  wr->num_filtered_readers += (m->field_filter != NULL);
+}
+
+static void writer_update_field_filter (struct writer *wr, struct proxy_reader *prd)
+{
+  /* a copy of the filter, so the writer and proxy reader needn't both be locked */
+  struct wr_prd_match *m;
+  nn_field_filter_t ff;
+  uint32_t gen;
+  ddsrt_mutex_lock (&prd->e.lock);
+  field_filter_copy (&ff, &prd->field_filter);
+  gen = prd->field_filter_gen;
+  ddsrt_mutex_unlock (&prd->e.lock);
+  ddsrt_mutex_lock (&wr->e.lock);
+  if ((m = ddsrt_avl_lookup (&wr_readers_treedef, &wr->readers, &prd->e.guid)) != NULL)
+    writer_set_field_filter_locked (wr, m, &ff, gen);
+  ddsrt_mutex_unlock (&wr->e.lock);
+  ddsrt_free (ff.terms);
+}
+
 static void writer_add_connection (struct writer *wr, struct proxy_reader *prd, int64_t crypto_handle)
 {
   struct wr_prd_match *m = ddsrt_malloc (sizeof (*m));
   ddsrt_avl_ipath_t path;
   int pretend_everything_acked;
+  nn_field_filter_t ff;
   m->prd_guid = prd->e.guid;
   m->is_reliable = (prd->c.xqos->reliability.kind > DDS_RELIABILITY_BEST_EFFORT);
   m->assumed_in_sync = (wr->e.gv->config.retransmit_merging == REXMIT_MERGE_ALWAYS);
@@ -2191,6 +2280,8 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
 #endif
   /* m->demoted: see below */
   ddsrt_mutex_lock (&prd->e.lock);
+  field_filter_copy (&ff, &prd->field_filter);
+  m->field_filter_gen = prd->field_filter_gen;
   if (prd->deleting)
   {
     ELOGDISC (wr, "  writer_add_connection(wr "PGUIDFMT" prd "PGUIDFMT") - prd is being deleted\n",
@@ -2208,6 +2299,9 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
     pretend_everything_acked = 0;
   }
   ddsrt_mutex_unlock (&prd->e.lock);
+  m->field_filter_nterms = ff.n;
+  m->field_filter = compile_field_filter (wr, &prd->e.guid, &ff);
+  ddsrt_free (ff.terms);
   m->next_acknack = DDSI_COUNT_MIN;
   m->next_nackfrag = DDSI_COUNT_MIN;
   nn_lat_estim_init (&m->hb_to_ack_latency);
@@ -2226,6 +2320,7 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
               PGUID (wr->e.guid), PGUID (prd->e.guid));
     ddsrt_mutex_unlock (&wr->e.lock);
     nn_lat_estim_fini (&m->hb_to_ack_latency);
+    ddsrt_free (m->field_filter);
     ddsrt_free (m);
   }
   else
@@ -2236,8 +2331,18 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
     rebuild_writer_addrset (wr);
     wr->num_readers++;
     wr->num_reliable_readers += m->is_reliable;
+    wr->num_filtered_readers += (m->field_filter != NULL);
+    const uint32_t ff_gen = m->field_filter_gen;
     ddsrt_mutex_unlock (&wr->e.lock);
 
+    /* the proxy reader's field filter may have changed before the match was
+       added, in which case update_proxy_reader can't have updated it */
+    ddsrt_mutex_lock (&prd->e.lock);
+    const bool ff_changed = (prd->field_filter_gen != ff_gen);
+    ddsrt_mutex_unlock (&prd->e.lock);
+    if (ff_changed)
+      writer_update_field_filter (wr, prd);
+
     if (wr->status_cb)
     {
       status_cb_data_t data;
@@ -3588,6 +3693,7 @@ static void new_writer_guid_common_init (struct writer *wr, const struct ddsi_se
   wr->t_whc_high_upd.v = 0;
   wr->num_readers = 0;
   wr->num_reliable_readers = 0;
+  wr->num_filtered_readers = 0;
   wr->num_acks_received = 0;
   wr->num_nacks_received = 0;
   wr->throttle_count = 0;
@@ -4238,6 +4344,7 @@ static dds_return_t new_reader_guid
   struct participant *pp,
   const struct ddsi_sertopic *topic,
   const struct dds_qos *xqos,
+  const nn_field_filter_t *field_filter,
   struct ddsi_rhc *rhc,
   status_cb_t status_cb,
   void * status_entity
@@ -4286,6 +4393,7 @@ static dds_return_t new_reader_guid
   rd->handle_as_transient_local = (rd->xqos->durability.kind == DDS_DURABILITY_TRANSIENT_LOCAL) ||
                                   (rd->e.guid.entityid.u == NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_VOLATILE_SECURE_READER);
   rd->topic = ddsi_sertopic_ref (topic);
+  field_filter_copy (&rd->field_filter, field_filter);
   rd->ddsi2direct_cb = 0;
   rd->ddsi2direct_cbarg = 0;
   rd->init_acknack_count = 0;
@@ -4390,6 +4498,7 @@ dds_return_t new_reader
   struct participant *pp,
   const struct ddsi_sertopic *topic,
   const struct dds_qos *xqos,
+  const nn_field_filter_t *field_filter,
   struct ddsi_rhc * rhc,
   status_cb_t status_cb,
   void * status_cbarg
@@ -4402,7 +4511,7 @@ dds_return_t new_reader
   kind = topic->topickind_no_key ? NN_ENTITYID_KIND_READER_NO_KEY : NN_ENTITYID_KIND_READER_WITH_KEY;
   if ((rc = pp_allocate_entityid (&rdguid->entityid, kind, pp)) < 0)
     return rc;
-  return new_reader_guid (rd_out, rdguid, group_guid, pp, topic, xqos, rhc, status_cb, status_cbarg);
+  return new_reader_guid (rd_out, rdguid, group_guid, pp, topic, xqos, field_filter, rhc, status_cb, status_cbarg);
 }
 
 static void gc_delete_reader (struct gcreq *gcreq)
@@ -4450,6 +4559,7 @@ static void gc_delete_reader (struct gcreq *gcreq)
     (rd->status_cb) (rd->status_cb_entity, NULL);
   }
   ddsi_sertopic_unref ((struct ddsi_sertopic *) rd->topic);
+  ddsrt_free (rd->field_filter.terms);
 
   ddsi_xqos_fini (rd->xqos);
   ddsrt_free (rd->xqos);
@@ -4485,6 +4595,18 @@ void update_reader_qos (struct reader *rd, const dds_qos_t *xqos)
   ddsrt_mutex_unlock (&rd->e.lock);
 }
 
+void update_reader_field_filter (struct reader *rd, const nn_field_filter_t *field_filter)
+{
+  ddsrt_mutex_lock (&rd->e.lock);
+  if (!field_filter_eq (&rd->field_filter, field_filter))
+  {
+    ddsrt_free (rd->field_filter.terms);
+    field_filter_copy (&rd->field_filter, field_filter);
+    sedp_write_reader (rd);
+  }
+  ddsrt_mutex_unlock (&rd->e.lock);
+}
+
 /* PROXY-PARTICIPANT ------------------------------------------------ */
 static void proxy_participant_replace_minl (struct proxy_participant *proxypp, bool manbypp, struct lease *lnew)
 {
@@ -5567,10 +5689,29 @@ void update_proxy_writer (struct proxy_writer *pwr, seqno_t seq, struct addrset
   ddsrt_mutex_unlock (&pwr->e.lock);
 }
 
-void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp)
+static void proxy_reader_update_field_filters (struct proxy_reader *prd)
+{
+  struct prd_wr_match *m;
+  ddsi_guid_t wrguid;
+  memset (&wrguid, 0, sizeof (wrguid));
+  ddsrt_mutex_lock (&prd->e.lock);
+  while ((m = ddsrt_avl_lookup_succ (&prd_writers_treedef, &prd->writers, &wrguid)) != NULL)
+  {
+    struct writer *wr;
+    wrguid = m->wr_guid;
+    ddsrt_mutex_unlock (&prd->e.lock);
+    if ((wr = entidx_lookup_writer_guid (prd->e.gv->entity_index, &wrguid)) != NULL)
+      writer_update_field_filter (wr, prd);
+    ddsrt_mutex_lock (&prd->e.lock);
+  }
+  ddsrt_mutex_unlock (&prd->e.lock);
+}
+
+void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, const nn_field_filter_t *field_filter, ddsrt_wctime_t timestamp)
 {
   struct prd_wr_match * m;
   ddsi_guid_t wrguid;
+  bool field_filter_changed = false;
 
   memset (&wrguid, 0, sizeof (wrguid));
 
@@ -5620,9 +5761,20 @@ void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset
       }
     }
 
+    if (!field_filter_eq (&prd->field_filter, field_filter))
+    {
+      ddsrt_free (prd->field_filter.terms);
+      field_filter_copy (&prd->field_filter, field_filter);
+      prd->field_filter_gen++;
+      field_filter_changed = true;
+    }
+
     (void) update_qos_locked (&prd->e, prd->c.xqos, xqos, timestamp);
   }
   ddsrt_mutex_unlock (&prd->e.lock);
+
+  if (field_filter_changed)
+    proxy_reader_update_field_filters (prd);
 }
 
 static void gc_delete_proxy_writer (struct gcreq *gcreq)
@@ -5803,6 +5955,8 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
 #else
   prd->filter = NULL;
 #endif
+  field_filter_copy (&prd->field_filter, (plist->present & PP_CYCLONE_FIELD_FILTER) ? &plist->field_filter : NULL);
+  prd->field_filter_gen = 0;
 
   /* locking the entity prevents matching while the built-in topic hasn't been published yet */
   ddsrt_mutex_lock (&prd->e.lock);
@@ -5878,6 +6032,7 @@ static void gc_delete_proxy_reader (struct gcreq *gcreq)
 #ifdef DDSI_INCLUDE_SECURITY
   q_omg_security_deregister_remote_reader(prd);
 #endif
+  ddsrt_free (prd->field_filter.terms);
   proxy_endpoint_common_fini (&prd->e, &prd->c);
   ddsrt_free (prd);
 }
@@ -11,6 +11,7 @@
  */
 #include <ctype.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/md5.h"
@@ -56,6 +57,7 @@
 #include "dds/ddsi/ddsi_udp.h"
 #include "dds/ddsi/ddsi_tcp.h"
 #include "dds/ddsi/ddsi_raweth.h"
+#include "dds/ddsi/ddsi_shm.h"
 #include "dds/ddsi/ddsi_mcgroup.h"
 #include "dds/ddsi/ddsi_serdata_default.h"
 #include "dds/ddsi/ddsi_serdata_pserop.h"
@@ -63,11 +65,16 @@
 #include "dds/ddsi/ddsi_security_omg.h"
 
 #include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/ddsi_lwregs.h"
 #include "dds__whc.h"
 #include "dds/ddsi/ddsi_iid.h"
 
 #include "dds/ddsi/ddsi_security_omg.h"
 
+/* Upper bound for DeliveryQueueThreads: thread states are a fixed-size, process-wide
+   resource that also has to accommodate the other threads and application threads */
+#define MAX_USER_DQUEUES 16
+
 static void add_peer_addresses (const struct ddsi_domaingv *gv, struct addrset *as, const struct config_peer_listelem *list)
 {
   while (list)
@@ -415,6 +422,16 @@ static int check_thread_properties (const struct ddsi_domaingv *gv)
     for (i = 0; fixed[i]; i++)
       if (strcmp (fixed[i], e->name) == 0)
         break;
+#ifndef DDSI_INCLUDE_NETWORK_CHANNELS
+    if (fixed[i] == NULL && strncmp (e->name, "dq.user.", 8) == 0)
+    {
+      /* Additional user delivery queues are named dq.user.N, N = 1 .. DeliveryQueueThreads-1 */
+      char *endp;
+      unsigned long idx = strtoul (e->name + 8, &endp, 10);
+      if (*endp == 0 && idx >= 1 && idx < gv->config.delivery_queue_threads)
+        continue;
+    }
+#endif
     if (fixed[i] == NULL)
     {
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
@@ -560,6 +577,12 @@ int rtps_config_prep (struct ddsi_domaingv *gv, struct cfgst *cfgst)
 #endif /* DDSI_INCLUDE_BANDWIDTH_LIMITING */
   }
 
+  if (gv->config.delivery_queue_threads < 1 || gv->config.delivery_queue_threads > MAX_USER_DQUEUES)
+  {
+    DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "Invalid number of delivery queue threads: must be in [1,%d]\n", MAX_USER_DQUEUES);
+    goto err_config_late_error;
+  }
+
   /* Verify thread properties refer to defined threads */
   if (!check_thread_properties (gv))
   {
@@ -1087,6 +1110,19 @@ int rtps_init (struct ddsi_domaingv *gv)
         goto err_udp_tcp_init;
       gv->m_factory = ddsi_factory_find (gv, "raweth");
       break;
+    case TRANS_SHM:
+      gv->config.publish_uc_locators = 1;
+      gv->config.enable_uc_locators = 1;
+      /* There is no multicast, so discovery has to rely on the well-known
+         ports of this host, which requires participant indices */
+      gv->config.allowMulticast = AMC_FALSE;
+      if (gv->config.participantIndex == PARTICIPANT_INDEX_NONE)
+        gv->config.participantIndex = PARTICIPANT_INDEX_AUTO;
+      mc_available = false;
+      if (ddsi_shm_init (gv) < 0)
+        goto err_udp_tcp_init;
+      gv->m_factory = ddsi_factory_find (gv, "shm");
+      break;
   }
 
   if (!find_own_ip (gv, gv->config.networkAddressString))
@@ -1173,7 +1209,7 @@ int rtps_init (struct ddsi_domaingv *gv)
 #endif
 
   gv->xmsgpool = nn_xmsgpool_new ();
-  gv->serpool = ddsi_serdatapool_new ();
+  gv->serpool = ddsi_serdatapool_new (gv->config.serdata_pool_max_size);
 
   ddsi_plist_init_default_participant (&gv->default_plist_pp);
   ddsi_plist_init_default_participant (&gv->default_local_plist_pp);
@@ -1256,6 +1292,7 @@ int rtps_init (struct ddsi_domaingv *gv)
   gv->spdp_reorder = nn_reorder_new (&gv->logconfig, NN_REORDER_MODE_ALWAYS_DELIVER, gv->config.primary_reorder_maxsamples, false);
 
   gv->m_tkmap = ddsi_tkmap_new (gv);
+  gv->m_lwregs = ddsi_lwregs_new (gv);
 
   if (gv->m_factory->m_connless)
   {
@@ -1506,6 +1543,8 @@ int rtps_init (struct ddsi_domaingv *gv)
   gv->gcreq_queue = gcreq_queue_new (gv);
 
   ddsrt_atomic_st32 (&gv->rtps_keepgoing, 1);
+  ddsrt_atomic_st64 (&gv->recv_packets, 0);
+  ddsrt_atomic_st64 (&gv->recv_syscalls, 0);
 
   if (gv->config.xpack_send_async)
   {
@@ -1513,12 +1552,23 @@ int rtps_init (struct ddsi_domaingv *gv)
     nn_xpack_sendq_start (gv);
   }
 
-  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL);
+  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL, NULL);
 #ifdef DDSI_INCLUDE_NETWORK_CHANNELS
   for (struct config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
-    chptr->dqueue = nn_dqueue_new (chptr->name, &gv->config, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+    chptr->dqueue = nn_dqueue_new (chptr->name, &gv->config, gv->config.delivery_queue_maxsamples, user_dqueue_handler, user_dqueue_chain_handler, NULL);
 #else
-  gv->user_dqueue = nn_dqueue_new ("user", gv, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+  gv->n_user_dqueues = gv->config.delivery_queue_threads;
+  gv->user_dqueues = ddsrt_malloc (gv->n_user_dqueues * sizeof (*gv->user_dqueues));
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+  {
+    /* First one keeps the historical name so existing thread properties still apply */
+    char name[16];
+    if (i == 0)
+      (void) snprintf (name, sizeof (name), "user");
+    else
+      (void) snprintf (name, sizeof (name), "user.%"PRIu32, i);
+    gv->user_dqueues[i] = nn_dqueue_new (name, gv, gv->config.delivery_queue_maxsamples, user_dqueue_handler, user_dqueue_chain_handler, NULL);
+  }
 #endif
 
   if (reset_deaf_mute_time.v < DDS_NEVER)
@@ -1540,6 +1590,7 @@ err_mc_conn:
     ddsi_conn_free (gv->data_conn_uc);
   free_group_membership (gv->mship);
 err_unicast_sockets:
+  ddsi_lwregs_free (gv->m_lwregs);
   ddsi_tkmap_free (gv->m_tkmap);
   nn_reorder_free (gv->spdp_reorder);
   nn_defrag_free (gv->spdp_defrag);
@@ -1823,6 +1874,7 @@ void rtps_fini (struct ddsi_domaingv *gv)
 {
   /* Shut down the GC system -- no new requests will be added */
   gcreq_queue_free (gv->gcreq_queue);
+  gv->gcreq_queue = NULL;
 
   /* No new data gets added to any admin, all synchronous processing
      has ended, so now we can drain the delivery queues to end up with
@@ -1837,7 +1889,9 @@ void rtps_fini (struct ddsi_domaingv *gv)
     chptr = chptr->next;
   }
 #else
-  nn_dqueue_free (gv->user_dqueue);
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+    nn_dqueue_free (gv->user_dqueues[i]);
+  ddsrt_free (gv->user_dqueues);
 #endif
 
 #ifdef DDSI_INCLUDE_SECURITY
@@ -1908,6 +1962,7 @@ void rtps_fini (struct ddsi_domaingv *gv)
     nn_rbufpool_free (gv->recv_threads[i].arg.rbpool);
   }
 
+  ddsi_lwregs_free (gv->m_lwregs);
   ddsi_tkmap_free (gv->m_tkmap);
   entity_index_free (gv->entity_index);
   gv->entity_index = NULL;
@@ -419,6 +419,12 @@ struct nn_rbuf {
      approach.  Changes would be confined rmsg_new and rmsg_free. */
   unsigned char *freeptr;
 
+  /* End of the space reserved by nn_rmsg_new_batch, or NULL if no
+     batch is outstanding.  While set, new chunks are allocated beyond
+     it so they can't overlap messages in the batch that haven't been
+     processed yet. */
+  unsigned char *batch_end;
+
   /* to ensure reasonable alignment of raw[] */
   union {
     int64_t l;
@@ -446,6 +452,7 @@ static struct nn_rbuf *nn_rbuf_alloc_new (struct nn_rbufpool *rbp)
   rb->size = rbp->rbuf_size;
   rb->max_rmsg_size = rbp->max_rmsg_size;
   rb->freeptr = rb->raw;
+  rb->batch_end = NULL;
   rb->trace = rbp->trace;
   RBPTRACE ("rbuf_alloc_new(%p) = %p\n", (void *) rbp, (void *) rb);
   return rb;
@@ -494,11 +501,17 @@ static void nn_rbuf_release (struct nn_rbuf *rbuf)
 #define ASSERT_RMSG_UNCOMMITTED(rmsg) ((void) 0)
 #endif
 
+static unsigned char *nn_rbuf_allocptr (const struct nn_rbuf *rb)
+{
+  return (rb->batch_end && rb->batch_end > rb->freeptr) ? rb->batch_end : rb->freeptr;
+}
+
 static void *nn_rbuf_alloc (struct nn_rbufpool *rbp)
 {
   /* Note: only one thread calls nn_rmsg_new on a pool */
   uint32_t asize = max_rmsg_size_w_hdr (rbp->max_rmsg_size);
   struct nn_rbuf *rb;
+  unsigned char *ptr;
   RBPTRACE ("rmsg_rbuf_alloc(%p, %"PRIu32")\n", (void *) rbp, asize);
   ASSERT_RBUFPOOL_OWNER (rbp);
   rb = rbp->current;
@@ -506,7 +519,7 @@ static void *nn_rbuf_alloc (struct nn_rbufpool *rbp)
   assert (rb->freeptr >= rb->raw);
   assert (rb->freeptr <= rb->raw + rb->size);
 
-  if ((uint32_t) (rb->raw + rb->size - rb->freeptr) < asize)
+  if ((uint32_t) (rb->raw + rb->size - nn_rbuf_allocptr (rb)) < asize)
   {
     /* not enough space left for new rmsg */
     if ((rb = nn_rbuf_new (rbp)) == NULL)
@@ -516,11 +529,12 @@ static void *nn_rbuf_alloc (struct nn_rbufpool *rbp)
     assert ((uint32_t) (rb->raw + rb->size - rb->freeptr) >= asize);
   }
 
-  RBPTRACE ("rmsg_rbuf_alloc(%p, %"PRIu32") = %p\n", (void *) rbp, asize, (void *) rb->freeptr);
+  ptr = nn_rbuf_allocptr (rb);
+  RBPTRACE ("rmsg_rbuf_alloc(%p, %"PRIu32") = %p\n", (void *) rbp, asize, (void *) ptr);
 #if USE_VALGRIND
-  VALGRIND_MEMPOOL_ALLOC (rbp, rb->freeptr, asize);
+  VALGRIND_MEMPOOL_ALLOC (rbp, ptr, asize);
 #endif
-  return rb->freeptr;
+  return ptr;
 }
 
 static void init_rmsg_chunk (struct nn_rmsg_chunk *chunk, struct nn_rbuf *rbuf)
@@ -531,6 +545,16 @@ static void init_rmsg_chunk (struct nn_rmsg_chunk *chunk, struct nn_rbuf *rbuf)
   ddsrt_atomic_inc32 (&rbuf->n_live_rmsg_chunks);
 }
 
+static void init_rmsg (struct nn_rmsg *rmsg, struct nn_rbufpool *rbp)
+{
+  /* Reference to this rmsg, undone by rmsg_commit(). */
+  ddsrt_atomic_st32 (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS);
+  /* Initial chunk */
+  init_rmsg_chunk (&rmsg->chunk, rbp->current);
+  rmsg->trace = rbp->trace;
+  rmsg->lastchunk = &rmsg->chunk;
+}
+
 struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbp)
 {
   /* Note: only one thread calls nn_rmsg_new on a pool */
@@ -541,18 +565,79 @@ struct nn_rmsg *nn_rmsg_new (struct nn_rbufpool *rbp)
   if (rmsg == NULL)
     return NULL;
 
-  /* Reference to this rmsg, undone by rmsg_commit(). */
-  ddsrt_atomic_st32 (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS);
-  /* Initial chunk */
-  init_rmsg_chunk (&rmsg->chunk, rbp->current);
-  rmsg->trace = rbp->trace;
-  rmsg->lastchunk = &rmsg->chunk;
+  init_rmsg (rmsg, rbp);
   /* Incrementing freeptr happens in commit(), so that discarding the
      message is really simple. */
   RBPTRACE ("rmsg_new(%p) = %p\n", (void *) rbp, (void *) rmsg);
   return rmsg;
 }
 
+uint32_t nn_rmsg_new_batch (struct nn_rbufpool *rbp, uint32_t n, struct nn_rmsg **rmsgs)
+{
+  /* Allocates up to n messages at consecutive, worst-case sized slots in
+     the current rbuf, so that the kernel can fill all of them in one go.
+     Each message must then be set-size'd/processed/committed in order,
+     and nn_rbufpool_end_batch must be called once all have been
+     committed.  Processing a message may still require allocating
+     additional chunks, those go beyond the reserved space (or in a new
+     rbuf).  On return, the rbuf's freeptr has not been moved: it is
+     raised by committing the messages that are retained, which keeps
+     reclaiming the space of dropped messages as simple as in the
+     single-message case. */
+  const uint32_t stride = align_rmsg (max_rmsg_size_w_hdr (rbp->max_rmsg_size));
+  struct nn_rbuf *rb = rbp->current;
+  uint32_t avail;
+  RBPTRACE ("rmsg_new_batch(%p, %"PRIu32")\n", (void *) rbp, n);
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  assert (rb->batch_end == NULL);
+  assert (n > 0);
+
+  if (n > rb->size / stride)
+    n = rb->size / stride;
+  if (n == 0)
+  {
+    /* rbuf too small for an aligned slot: a single message reserving the
+       remainder of the rbuf is the best that can be done */
+    if ((rmsgs[0] = nn_rmsg_new (rbp)) == NULL)
+      return 0;
+    rbp->current->batch_end = rbp->current->raw + rbp->current->size;
+    return 1;
+  }
+
+  if ((avail = (uint32_t) (rb->raw + rb->size - rb->freeptr) / stride) == 0)
+  {
+    if ((rb = nn_rbuf_new (rbp)) == NULL)
+      return 0;
+    avail = (uint32_t) (rb->raw + rb->size - rb->freeptr) / stride;
+  }
+  if (n > avail)
+    n = avail;
+  assert (n > 0);
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    struct nn_rmsg *rmsg = (struct nn_rmsg *) (rb->freeptr + i * stride);
+#if USE_VALGRIND
+    VALGRIND_MEMPOOL_ALLOC (rbp, rmsg, stride);
+#endif
+    init_rmsg (rmsg, rbp);
+    rmsgs[i] = rmsg;
+  }
+  rb->batch_end = rb->freeptr + n * stride;
+  RBPTRACE ("rmsg_new_batch(%p) = %"PRIu32" @ %p\n", (void *) rbp, n, (void *) rmsgs[0]);
+  return n;
+}
+
+void nn_rbufpool_end_batch (struct nn_rbufpool *rbp)
+{
+  /* The batch may have caused a switch to a new rbuf, in which case the
+     new one never had a reservation and the old one may already have
+     been freed.  The old one is no longer used for allocating, so leaving
+     it as-is is fine. */
+  ASSERT_RBUFPOOL_OWNER (rbp);
+  rbp->current->batch_end = NULL;
+}
+
 void nn_rmsg_setsize (struct nn_rmsg *rmsg, uint32_t size)
 {
   uint32_t size8P = align_rmsg (size);
@@ -602,8 +687,11 @@ void nn_rmsg_free (struct nn_rmsg *rmsg)
 static void commit_rmsg_chunk (struct nn_rmsg_chunk *chunk)
 {
   struct nn_rbuf *rbuf = chunk->rbuf;
+  unsigned char * const endp1 = (unsigned char *) (chunk + 1) + chunk->u.size;
   RBUFTRACE ("commit_rmsg_chunk(%p)\n", (void *) chunk);
-  rbuf->freeptr = (unsigned char *) (chunk + 1) + chunk->u.size;
+  /* Messages in a batch needn't be committed in address order */
+  if (endp1 > rbuf->freeptr)
+    rbuf->freeptr = endp1;
 }
 
 void nn_rmsg_commit (struct nn_rmsg *rmsg)
@@ -626,7 +714,7 @@ void nn_rmsg_commit (struct nn_rmsg *rmsg)
   assert (ddsrt_atomic_ld32 (&rmsg->refcount) >= RMSG_REFCOUNT_UNCOMMITTED_BIAS);
   assert (ddsrt_atomic_ld32 (&rmsg->chunk.rbuf->n_live_rmsg_chunks) > 0);
   assert (ddsrt_atomic_ld32 (&chunk->rbuf->n_live_rmsg_chunks) > 0);
-  assert (chunk->rbuf->rbufpool->current == chunk->rbuf);
+  assert (chunk->rbuf->rbufpool->current == chunk->rbuf || chunk->rbuf->batch_end != NULL);
   if (ddsrt_atomic_sub32_nv (&rmsg->refcount, RMSG_REFCOUNT_UNCOMMITTED_BIAS) == 0)
     nn_rmsg_free (rmsg);
   else
@@ -667,7 +755,7 @@ static void nn_rmsg_rmbias_and_adjust (struct nn_rmsg *rmsg, int adjust)
     nn_rmsg_free (rmsg);
 }
 
-static void nn_rmsg_unref (struct nn_rmsg *rmsg)
+void nn_rmsg_unref (struct nn_rmsg *rmsg)
 {
   RMSGTRACE ("rmsg_unref(%p)\n", (void *) rmsg);
   assert (ddsrt_atomic_ld32 (&rmsg->refcount) > 0);
@@ -675,6 +763,17 @@ static void nn_rmsg_unref (struct nn_rmsg *rmsg)
     nn_rmsg_free (rmsg);
 }
 
+void nn_rmsg_ref (struct nn_rmsg *rmsg)
+{
+  /* Note: any thread may call this, but only while it holds a reference
+     to the rmsg (typically via an rdata in a sample being delivered).
+     The reference keeps alive all rbufs the rmsg has chunks in, so it
+     shouldn't be held beyond delivering the sample. */
+  RMSGTRACE ("rmsg_ref(%p)\n", (void *) rmsg);
+  assert (ddsrt_atomic_ld32 (&rmsg->refcount) > 0);
+  ddsrt_atomic_inc32 (&rmsg->refcount);
+}
+
 void *nn_rmsg_alloc (struct nn_rmsg *rmsg, uint32_t size)
 {
   struct nn_rmsg_chunk *chunk = rmsg->lastchunk;
@@ -2397,18 +2496,34 @@ void nn_reorder_set_next_seq (struct nn_reorder *reorder, seqno_t seq)
 
 /* DQUEUE -------------------------------------------------------------- */
 
+/* Producers (receive threads, but also threads enqueueing callbacks) push
+   sample chains onto a lock-free LIFO, the single consumer (the delivery
+   thread) takes everything in one go and reverses it.  For that to result
+   in FIFO order, each chain is reversed before pushing it.
+
+   The lock and condition variable are only used for waking up the
+   delivery thread when it is sleeping, and for threads waiting for the
+   queue to become empty. */
 struct nn_dqueue {
+  ddsrt_atomic_voidp_t pending;
+  ddsrt_atomic_uint32_t sleeping;
+  ddsrt_atomic_uint32_t nof_samples;
+  ddsrt_atomic_uint32_t nof_waiters_for_empty;
+
+  /* statistics, see nn_dqueue_get_stats */
+  ddsrt_atomic_uint32_t max_nof_samples;
+  ddsrt_atomic_uint32_t nof_full;
+  ddsrt_atomic_uint32_t nof_throttled;
+
   ddsrt_mutex_t lock;
   ddsrt_cond_t cond;
   nn_dqueue_handler_t handler;
+  nn_dqueue_chain_handler_t chain_handler;
   void *handler_arg;
 
-  struct nn_rsample_chain sc;
-
   struct thread_state1 *ts;
   char *name;
   uint32_t max_samples;
-  ddsrt_atomic_uint32_t nof_samples;
 };
 
 enum dqueue_elem_kind {
@@ -2452,6 +2567,57 @@ static enum dqueue_elem_kind dqueue_elem_kind (const struct nn_rsample_chain_ele
     return DQEK_BUBBLE;
 }
 
+static struct nn_rsample_chain_elem *dqueue_reverse (struct nn_rsample_chain_elem *e)
+{
+  struct nn_rsample_chain_elem *r = NULL;
+  while (e)
+  {
+    struct nn_rsample_chain_elem * const e1 = e->next;
+    e->next = r;
+    r = e;
+    e = e1;
+  }
+  return r;
+}
+
+static struct nn_rsample_chain_elem *dqueue_take_all (struct nn_dqueue *q)
+{
+  /* Only the delivery thread removes elements, so there is no ABA problem */
+  void *top;
+  do {
+    top = ddsrt_atomic_ldvoidp (&q->pending);
+  } while (top != NULL && !ddsrt_atomic_casvoidp (&q->pending, top, NULL));
+  return dqueue_reverse (top);
+}
+
+static void dqueue_sleep (struct nn_dqueue *q)
+{
+  /* Setting "sleeping" and then checking for pending elements pairs with
+     the producers pushing and then checking "sleeping", with full barriers
+     in between, so at least one of the two sides notices the other.  The
+     producer signals while holding the lock, so it can't slip in between
+     the check and the wait. */
+  ddsrt_mutex_lock (&q->lock);
+  ddsrt_atomic_st32 (&q->sleeping, 1);
+  ddsrt_atomic_fence ();
+  if (ddsrt_atomic_ldvoidp (&q->pending) == NULL)
+    ddsrt_cond_wait (&q->cond, &q->lock);
+  ddsrt_atomic_st32 (&q->sleeping, 0);
+  ddsrt_mutex_unlock (&q->lock);
+}
+
+static void dqueue_dec_nof_samples (struct nn_dqueue *q)
+{
+  /* Same pattern as for sleeping: waiters increment the count before
+     checking the number of samples */
+  if (ddsrt_atomic_dec32_ov (&q->nof_samples) == 1 && ddsrt_atomic_ld32 (&q->nof_waiters_for_empty) > 0)
+  {
+    ddsrt_mutex_lock (&q->lock);
+    ddsrt_cond_broadcast (&q->cond);
+    ddsrt_mutex_unlock (&q->lock);
+  }
+}
+
 static uint32_t dqueue_thread (struct nn_dqueue *q)
 {
   struct thread_state1 * const ts1 = lookup_thread_state ();
@@ -2461,32 +2627,45 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
   ddsi_guid_t rdguid, *prdguid = NULL;
   uint32_t rdguid_count = 0;
 
-  ddsrt_mutex_lock (&q->lock);
   while (keepgoing)
   {
-    struct nn_rsample_chain sc;
+    struct nn_rsample_chain_elem *first;
 
     LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
 
-    if (q->sc.first == NULL)
-      ddsrt_cond_wait (&q->cond, &q->lock);
-    sc = q->sc;
-    q->sc.first = q->sc.last = NULL;
-    ddsrt_mutex_unlock (&q->lock);
+    if ((first = dqueue_take_all (q)) == NULL)
+    {
+      dqueue_sleep (q);
+      if ((first = dqueue_take_all (q)) == NULL)
+        continue;
+    }
 
     thread_state_awake_fixed_domain (ts1);
-    while (sc.first)
+    while (first)
     {
-      struct nn_rsample_chain_elem *e = sc.first;
+      struct nn_rsample_chain_elem *e = first;
       int ret;
-      sc.first = e->next;
-      if (ddsrt_atomic_dec32_ov (&q->nof_samples) == 1) {
-        ddsrt_cond_broadcast (&q->cond);
-      }
+      first = e->next;
+      dqueue_dec_nof_samples (q);
       thread_state_awake_to_awake_no_nest (ts1);
       switch (dqueue_elem_kind (e))
       {
         case DQEK_DATA:
+          if (prdguid == NULL && q->chain_handler)
+          {
+            /* everything up to the next bubble goes to the chain handler in one
+               go, which allows it to deliver a burst of samples as a batch */
+            struct nn_rsample_chain sc = { e, e };
+            while (first && dqueue_elem_kind (first) != DQEK_BUBBLE)
+            {
+              dqueue_dec_nof_samples (q);
+              sc.last = first;
+              first = first->next;
+            }
+            sc.last->next = NULL;
+            q->chain_handler (&sc, q->handler_arg);
+            break;
+          }
           ret = q->handler (e->sampleinfo, e->fragchain, prdguid, q->handler_arg);
           (void) ret; /* eliminate set-but-not-used in NDEBUG case */
           assert (ret == 0); /* so every handler will return 0 */
@@ -2508,7 +2687,7 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
               /* Stuff enqueued behind the bubble will still be
                  processed, we do want to drain the queue.  Nothing
                  may be queued anymore once we queue the stop bubble,
-                 so q->sc.first should be empty.  If it isn't
+                 so q->pending should be empty.  If it isn't
                  ... dqueue_free fail an assertion.  STOP bubble
                  doesn't get malloced, and hence not freed. */
               keepgoing = 0;
@@ -2536,13 +2715,11 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
     }
 
     thread_state_asleep (ts1);
-    ddsrt_mutex_lock (&q->lock);
   }
-  ddsrt_mutex_unlock (&q->lock);
   return 0;
 }
 
-struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, void *arg)
+struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, nn_dqueue_chain_handler_t chain_handler, void *arg)
 {
   struct nn_dqueue *q;
   char *thrname;
@@ -2553,10 +2730,16 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
   if ((q->name = ddsrt_strdup (name)) == NULL)
     goto fail_name;
   q->max_samples = max_samples;
+  ddsrt_atomic_stvoidp (&q->pending, NULL);
+  ddsrt_atomic_st32 (&q->sleeping, 0);
   ddsrt_atomic_st32 (&q->nof_samples, 0);
+  ddsrt_atomic_st32 (&q->nof_waiters_for_empty, 0);
+  ddsrt_atomic_st32 (&q->max_nof_samples, 0);
+  ddsrt_atomic_st32 (&q->nof_full, 0);
+  ddsrt_atomic_st32 (&q->nof_throttled, 0);
   q->handler = handler;
+  q->chain_handler = chain_handler;
   q->handler_arg = arg;
-  q->sc.first = q->sc.last = NULL;
 
   ddsrt_mutex_init (&q->lock);
   ddsrt_cond_init (&q->cond);
@@ -2582,41 +2765,48 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
   return NULL;
 }
 
-static int nn_dqueue_enqueue_locked (struct nn_dqueue *q, struct nn_rsample_chain *sc)
+static void dqueue_add_nof_samples (struct nn_dqueue *q, uint32_t n)
 {
-  int must_signal;
-  if (q->sc.first == NULL)
-  {
-    must_signal = 1;
-    q->sc = *sc;
-  }
-  else
-  {
-    must_signal = 0;
-    q->sc.last->next = sc->first;
-    q->sc.last = sc->last;
-  }
-  return must_signal;
+  const uint32_t count = ddsrt_atomic_add32_nv (&q->nof_samples, n);
+  uint32_t max;
+  while (count > (max = ddsrt_atomic_ld32 (&q->max_nof_samples)) && !ddsrt_atomic_cas32 (&q->max_nof_samples, max, count))
+    ;
+}
+
+static bool nn_dqueue_push (struct nn_dqueue *q, struct nn_rsample_chain *sc)
+{
+  /* Returns true if the delivery thread must be woken up, which is only the
+     case if it is sleeping (it can't be if the queue wasn't empty) */
+  struct nn_rsample_chain_elem * const tail = sc->first;
+  struct nn_rsample_chain_elem * const head = dqueue_reverse (sc->first);
+  void *old;
+  assert (head == sc->last);
+  do {
+    old = ddsrt_atomic_ldvoidp (&q->pending);
+    tail->next = old;
+  } while (!ddsrt_atomic_casvoidp (&q->pending, old, head));
+  return old == NULL && ddsrt_atomic_ld32 (&q->sleeping);
+}
+
+static void nn_dqueue_signal (struct nn_dqueue *q)
+{
+  ddsrt_mutex_lock (&q->lock);
+  ddsrt_cond_broadcast (&q->cond);
+  ddsrt_mutex_unlock (&q->lock);
 }
 
 bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
 {
-  bool signal;
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
-  signal = nn_dqueue_enqueue_locked (q, sc);
-  ddsrt_mutex_unlock (&q->lock);
-  return signal;
+  dqueue_add_nof_samples (q, (uint32_t) rres);
+  return nn_dqueue_push (q, sc);
 }
 
 void dd_dqueue_enqueue_trigger (struct nn_dqueue *q)
 {
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_cond_broadcast (&q->cond);
-  ddsrt_mutex_unlock (&q->lock);
+  nn_dqueue_signal (q);
 }
 
 void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
@@ -2624,30 +2814,26 @@ void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reo
   assert (rres > 0);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
-  if (nn_dqueue_enqueue_locked (q, sc))
-    ddsrt_cond_broadcast (&q->cond);
-  ddsrt_mutex_unlock (&q->lock);
+  dqueue_add_nof_samples (q, (uint32_t) rres);
+  if (nn_dqueue_push (q, sc))
+    nn_dqueue_signal (q);
 }
 
-static int nn_dqueue_enqueue_bubble_locked (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
+static void nn_dqueue_init_bubble (struct nn_dqueue_bubble *b)
 {
-  struct nn_rsample_chain sc;
   b->sce.next = NULL;
   b->sce.fragchain = NULL;
   b->sce.sampleinfo = (struct nn_rsample_info *) b;
-  sc.first = sc.last = &b->sce;
-  return nn_dqueue_enqueue_locked (q, &sc);
 }
 
 static void nn_dqueue_enqueue_bubble (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
 {
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_inc32 (&q->nof_samples);
-  if (nn_dqueue_enqueue_bubble_locked (q, b))
-    ddsrt_cond_broadcast (&q->cond);
-  ddsrt_mutex_unlock (&q->lock);
+  struct nn_rsample_chain sc;
+  nn_dqueue_init_bubble (b);
+  sc.first = sc.last = &b->sce;
+  dqueue_add_nof_samples (q, 1);
+  if (nn_dqueue_push (q, &sc))
+    nn_dqueue_signal (q);
 }
 
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg)
@@ -2663,6 +2849,7 @@ void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, v
 void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct nn_rsample_chain *sc, nn_reorder_result_t rres)
 {
   struct nn_dqueue_bubble *b;
+  struct nn_rsample_chain sc1;
 
   b = ddsrt_malloc (sizeof (*b));
   b->kind = NN_DQBK_RDGUID;
@@ -2673,12 +2860,15 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
   assert (rdguid != NULL);
   assert (sc->first);
   assert (sc->last->next == NULL);
-  ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, 1 + (uint32_t) rres);
-  if (nn_dqueue_enqueue_bubble_locked (q, b))
-    ddsrt_cond_broadcast (&q->cond);
-  (void) nn_dqueue_enqueue_locked (q, sc);
-  ddsrt_mutex_unlock (&q->lock);
+
+  /* The bubble must immediately precede the samples, so push them together */
+  nn_dqueue_init_bubble (b);
+  b->sce.next = sc->first;
+  sc1.first = &b->sce;
+  sc1.last = sc->last;
+  dqueue_add_nof_samples (q, 1 + (uint32_t) rres);
+  if (nn_dqueue_push (q, &sc1))
+    nn_dqueue_signal (q);
 }
 
 int nn_dqueue_is_full (struct nn_dqueue *q)
@@ -2691,7 +2881,14 @@ int nn_dqueue_is_full (struct nn_dqueue *q)
      and survive the occasional decision to not queue when it
      could've been queued (we do), it should be ok. */
   const uint32_t count = ddsrt_atomic_ld32 (&q->nof_samples);
-  return (count >= q->max_samples);
+  if (count < q->max_samples)
+    return 0;
+  else
+  {
+    /* the caller will reject deliverable samples, relying on retransmits */
+    ddsrt_atomic_inc32 (&q->nof_full);
+    return 1;
+  }
 }
 
 void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q)
@@ -2699,15 +2896,28 @@ void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q)
   const uint32_t count = ddsrt_atomic_ld32 (&q->nof_samples);
   if (count >= q->max_samples)
   {
+    ddsrt_atomic_inc32 (&q->nof_throttled);
     ddsrt_mutex_lock (&q->lock);
+    ddsrt_atomic_inc32 (&q->nof_waiters_for_empty);
     /* In case the wakeups are were all deferred */
     ddsrt_cond_broadcast (&q->cond);
     while (ddsrt_atomic_ld32 (&q->nof_samples) > 0)
       ddsrt_cond_wait (&q->cond, &q->lock);
+    ddsrt_atomic_dec32 (&q->nof_waiters_for_empty);
     ddsrt_mutex_unlock (&q->lock);
   }
 }
 
+void nn_dqueue_get_stats (struct nn_dqueue *q, struct nn_dqueue_stats *st)
+{
+  st->name = q->name;
+  st->max_samples = q->max_samples;
+  st->nof_samples = ddsrt_atomic_ld32 (&q->nof_samples);
+  st->max_nof_samples = ddsrt_atomic_ld32 (&q->max_nof_samples);
+  st->nof_full = ddsrt_atomic_ld32 (&q->nof_full);
+  st->nof_throttled = ddsrt_atomic_ld32 (&q->nof_throttled);
+}
+
 void nn_dqueue_free (struct nn_dqueue *q)
 {
   /* There must not be any thread enqueueing things anymore at this
@@ -2720,7 +2930,7 @@ void nn_dqueue_free (struct nn_dqueue *q)
   nn_dqueue_enqueue_bubble (q, &b);
 
   join_thread (q->ts);
-  assert (q->sc.first == NULL);
+  assert (ddsrt_atomic_ldvoidp (&q->pending) == NULL);
   ddsrt_cond_destroy (&q->cond);
   ddsrt_mutex_destroy (&q->lock);
   ddsrt_free (q->name);
@@ -931,7 +931,7 @@ static int handle_AckNack (struct receiver_state *rst, ddsrt_etime_t tnow, const
         if (!wr->retransmitting && sample.unacked)
           writer_set_retransmitting (wr);
 
-        if (rst->gv->config.retransmit_merging != REXMIT_MERGE_NEVER && rn->assumed_in_sync && !prd->filter)
+        if (rst->gv->config.retransmit_merging != REXMIT_MERGE_NEVER && rn->assumed_in_sync && !prd->filter && !rn->field_filter)
         {
           /* send retransmit to all receivers, but skip if recently done */
           ddsrt_mtime_t tstamp = ddsrt_time_monotonic ();
@@ -957,6 +957,8 @@ static int handle_AckNack (struct receiver_state *rst, ddsrt_etime_t tnow, const
            * If so, call the filter to see if we should re-arrange the sequence gap when needed. */
           if (prd->filter && !prd->filter (wr, prd, sample.serdata))
             nn_gap_info_update (rst->gv, &gi, seqbase + i);
+          else if (!wr_prd_match_accepts_sample (wr, rn, sample.serdata))
+            nn_gap_info_update (rst->gv, &gi, seqbase + i);
           else
           {
             /* no merging, send directed retransmit */
@@ -2040,41 +2042,28 @@ static dds_return_t remote_on_delivery_failure_fastpath (struct entity_common *s
   return DDS_RETCODE_TRY_AGAIN;
 }
 
-static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, int pwr_locked)
-{
-  static const struct deliver_locally_ops deliver_locally_ops = {
-    .makesample = remote_make_sample,
-    .first_reader = proxy_writer_first_in_sync_reader,
-    .next_reader = proxy_writer_next_in_sync_reader,
-    .on_failure_fastpath = remote_on_delivery_failure_fastpath
-  };
-  struct receiver_state const * const rst = sampleinfo->rst;
-  struct ddsi_domaingv * const gv = rst->gv;
-  struct proxy_writer * const pwr = sampleinfo->pwr;
-  unsigned statusinfo;
-  Data_DataFrag_common_t *msg;
-  unsigned char data_smhdr_flags;
-  ddsi_plist_t qos;
-  int need_keyhash;
-
-  if (pwr->ddsi2direct_cb)
-  {
-    pwr->ddsi2direct_cb (sampleinfo, fragchain, pwr->ddsi2direct_cbarg);
-    return 0;
-  }
+static const struct deliver_locally_ops remote_deliver_locally_ops = {
+  .makesample = remote_make_sample,
+  .first_reader = proxy_writer_first_in_sync_reader,
+  .next_reader = proxy_writer_next_in_sync_reader,
+  .on_failure_fastpath = remote_on_delivery_failure_fastpath
+};
 
+static const Data_DataFrag_common_t *user_data_msg (const struct nn_rdata *fragchain)
+{
   /* FIXME: fragments are now handled by copying the message to
      freshly malloced memory (see defragment()) ... that'll have to
      change eventually */
   assert (fragchain->min == 0);
-  assert (!is_builtin_entityid (pwr->e.guid.entityid, pwr->c.vendor));
 
   /* Luckily, the Data header (up to inline QoS) is a prefix of the
      DataFrag header, so for the fixed-position things that we're
      interested in here, both can be treated as Data submessages. */
-  msg = (Data_DataFrag_common_t *) NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_SUBMSG_OFF (fragchain));
-  data_smhdr_flags = normalize_data_datafrag_flags (&msg->smhdr);
+  return (const Data_DataFrag_common_t *) NN_RMSG_PAYLOADOFF (fragchain->rmsg, NN_RDATA_SUBMSG_OFF (fragchain));
+}
 
+static bool user_data_needs_inline_qos (const struct nn_rsample_info *sampleinfo, unsigned char data_smhdr_flags)
+{
   /* Extract QoS's to the extent necessary.  The expected case has all
      we need predecoded into a few bits in the sample info.
 
@@ -2087,8 +2076,44 @@ static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const st
      Complex qos bit also gets set when statusinfo bits other than
      dispose/unregister are set.  They are not currently defined, but
      this may save us if they do get defined one day.  */
-  need_keyhash = (sampleinfo->size == 0 || (data_smhdr_flags & (DATA_FLAG_KEYFLAG | DATA_FLAG_DATAFLAG)) == 0);
-  if (!(sampleinfo->complex_qos || need_keyhash) || !(data_smhdr_flags & DATA_FLAG_INLINE_QOS))
+  const bool need_keyhash = (sampleinfo->size == 0 || (data_smhdr_flags & (DATA_FLAG_KEYFLAG | DATA_FLAG_DATAFLAG)) == 0);
+  return (sampleinfo->complex_qos || need_keyhash) && (data_smhdr_flags & DATA_FLAG_INLINE_QOS);
+}
+
+static void make_remote_sourceinfo (struct remote_sourceinfo *sourceinfo, const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, unsigned char data_smhdr_flags, const ddsi_plist_t *qos, unsigned statusinfo)
+{
+  /* FIXME: should it be 0, local wall clock time or INVALID? */
+  const ddsrt_wctime_t tstamp = (sampleinfo->timestamp.v != DDSRT_WCTIME_INVALID.v) ? sampleinfo->timestamp : ((ddsrt_wctime_t) {0});
+  *sourceinfo = (struct remote_sourceinfo) {
+    .sampleinfo = sampleinfo,
+    .data_smhdr_flags = data_smhdr_flags,
+    .qos = qos,
+    .fragchain = fragchain,
+    .statusinfo = statusinfo,
+    .tstamp = tstamp
+  };
+}
+
+static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, int pwr_locked)
+{
+  struct receiver_state const * const rst = sampleinfo->rst;
+  struct ddsi_domaingv * const gv = rst->gv;
+  struct proxy_writer * const pwr = sampleinfo->pwr;
+  unsigned statusinfo;
+  const Data_DataFrag_common_t *msg;
+  unsigned char data_smhdr_flags;
+  ddsi_plist_t qos;
+
+  if (pwr->ddsi2direct_cb)
+  {
+    pwr->ddsi2direct_cb (sampleinfo, fragchain, pwr->ddsi2direct_cbarg);
+    return 0;
+  }
+
+  assert (!is_builtin_entityid (pwr->e.guid.entityid, pwr->c.vendor));
+  msg = user_data_msg (fragchain);
+  data_smhdr_flags = normalize_data_datafrag_flags (&msg->smhdr);
+  if (!user_data_needs_inline_qos (sampleinfo, data_smhdr_flags))
   {
     ddsi_plist_init_empty (&qos);
     statusinfo = sampleinfo->statusinfo;
@@ -2116,24 +2141,16 @@ static int deliver_user_data (const struct nn_rsample_info *sampleinfo, const st
     statusinfo = (qos.present & PP_STATUSINFO) ? qos.statusinfo : 0;
   }
 
-  /* FIXME: should it be 0, local wall clock time or INVALID? */
-  const ddsrt_wctime_t tstamp = (sampleinfo->timestamp.v != DDSRT_WCTIME_INVALID.v) ? sampleinfo->timestamp : ((ddsrt_wctime_t) {0});
   struct ddsi_writer_info wrinfo;
   ddsi_make_writer_info (&wrinfo, &pwr->e, pwr->c.xqos, statusinfo);
 
-  struct remote_sourceinfo sourceinfo = {
-    .sampleinfo = sampleinfo,
-    .data_smhdr_flags = data_smhdr_flags,
-    .qos = &qos,
-    .fragchain = fragchain,
-    .statusinfo = statusinfo,
-    .tstamp = tstamp
-  };
+  struct remote_sourceinfo sourceinfo;
+  make_remote_sourceinfo (&sourceinfo, sampleinfo, fragchain, data_smhdr_flags, &qos, statusinfo);
   if (rdguid)
-    (void) deliver_locally_one (gv, &pwr->e, pwr_locked != 0, rdguid, &wrinfo, &deliver_locally_ops, &sourceinfo);
+    (void) deliver_locally_one (gv, &pwr->e, pwr_locked != 0, rdguid, &wrinfo, &remote_deliver_locally_ops, &sourceinfo);
   else
   {
-    (void) deliver_locally_allinsync (gv, &pwr->e, pwr_locked != 0, &pwr->rdary, &wrinfo, &deliver_locally_ops, &sourceinfo);
+    (void) deliver_locally_allinsync (gv, &pwr->e, pwr_locked != 0, &pwr->rdary, &wrinfo, &remote_deliver_locally_ops, &sourceinfo);
     ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (sampleinfo->seq + 1));
   }
 
@@ -2148,11 +2165,76 @@ int user_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct
   return res;
 }
 
-static void deliver_user_data_synchronously (struct nn_rsample_chain *sc, const ddsi_guid_t *rdguid)
+static bool can_deliver_user_data_batched (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const struct proxy_writer *pwr)
+{
+  if (sampleinfo->pwr != pwr || pwr->ddsi2direct_cb)
+    return false;
+  const Data_DataFrag_common_t *msg = user_data_msg (fragchain);
+  return !user_data_needs_inline_qos (sampleinfo, normalize_data_datafrag_flags (&msg->smhdr));
+}
+
+static void deliver_user_data_batch (struct nn_rsample_chain *sc, int pwr_locked)
+{
+  /* Delivers the leading samples in the chain from the same proxy writer that don't
+     require interpreting the inline QoS (which is the common case) as a single batch,
+     so that each reader's history cache is locked and its listeners/conditions
+     triggered only once.  Consumes at least the first element of the chain. */
+  struct proxy_writer * const pwr = sc->first->sampleinfo->pwr;
+  struct ddsi_domaingv * const gv = pwr->e.gv;
+  struct ddsi_writer_info wrinfo[DELIVER_LOCALLY_MAX_BATCH];
+  struct remote_sourceinfo sourceinfo[DELIVER_LOCALLY_MAX_BATCH];
+  void *vsourceinfo[DELIVER_LOCALLY_MAX_BATCH];
+  struct nn_rdata *fragchains[DELIVER_LOCALLY_MAX_BATCH];
+  seqno_t lastseq = 0;
+  ddsi_plist_t qos;
+  uint32_t n = 0;
+
+  assert (!is_builtin_entityid (pwr->e.guid.entityid, pwr->c.vendor));
+  ddsi_plist_init_empty (&qos);
+  while (n < DELIVER_LOCALLY_MAX_BATCH && sc->first)
+  {
+    struct nn_rsample_chain_elem *e = sc->first;
+    if (e->sampleinfo == NULL)
+    {
+      /* gap: nothing to deliver */
+      sc->first = e->next;
+      nn_fragchain_unref (e->fragchain);
+    }
+    else if (n > 0 && !can_deliver_user_data_batched (e->sampleinfo, e->fragchain, pwr))
+    {
+      break;
+    }
+    else
+    {
+      const Data_DataFrag_common_t *msg = user_data_msg (e->fragchain);
+      sc->first = e->next;
+      ddsi_make_writer_info (&wrinfo[n], &pwr->e, pwr->c.xqos, e->sampleinfo->statusinfo);
+      make_remote_sourceinfo (&sourceinfo[n], e->sampleinfo, e->fragchain, normalize_data_datafrag_flags (&msg->smhdr), &qos, e->sampleinfo->statusinfo);
+      vsourceinfo[n] = &sourceinfo[n];
+      fragchains[n] = e->fragchain;
+      lastseq = e->sampleinfo->seq;
+      n++;
+    }
+  }
+  if (n > 0)
+  {
+    (void) deliver_locally_allinsync_batch (gv, &pwr->e, pwr_locked != 0, &pwr->rdary, n, wrinfo, &remote_deliver_locally_ops, vsourceinfo);
+    ddsrt_atomic_st32 (&pwr->next_deliv_seq_lowword, (uint32_t) (lastseq + 1));
+    for (uint32_t i = 0; i < n; i++)
+      nn_fragchain_unref (fragchains[i]);
+  }
+}
+
+static void deliver_user_data_chain (struct nn_rsample_chain *sc, const ddsi_guid_t *rdguid, int pwr_locked)
 {
   while (sc->first)
   {
     struct nn_rsample_chain_elem *e = sc->first;
+    if (rdguid == NULL && e->sampleinfo != NULL && can_deliver_user_data_batched (e->sampleinfo, e->fragchain, e->sampleinfo->pwr))
+    {
+      deliver_user_data_batch (sc, pwr_locked);
+      continue;
+    }
     sc->first = e->next;
     if (e->sampleinfo != NULL)
     {
@@ -2160,12 +2242,22 @@ static void deliver_user_data_synchronously (struct nn_rsample_chain *sc, const
          sample_lost events. Also note that the synchronous path is
          _never_ used for historical data, and therefore never has the
          GUID of a reader to deliver to */
-      deliver_user_data (e->sampleinfo, e->fragchain, rdguid, 1);
+      deliver_user_data (e->sampleinfo, e->fragchain, rdguid, pwr_locked);
     }
     nn_fragchain_unref (e->fragchain);
   }
 }
 
+void user_dqueue_chain_handler (struct nn_rsample_chain *sc, UNUSED_ARG (void *qarg))
+{
+  deliver_user_data_chain (sc, NULL, 0);
+}
+
+static void deliver_user_data_synchronously (struct nn_rsample_chain *sc, const ddsi_guid_t *rdguid)
+{
+  deliver_user_data_chain (sc, rdguid, 1);
+}
+
 static void clean_defrag (struct proxy_writer *pwr)
 {
   seqno_t seq = nn_reorder_next_seq (pwr->reorder);
@@ -3107,6 +3199,55 @@ malformed_asleep:
   return -1;
 }
 
+static ssize_t process_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct nn_rmsg *rmsg, ssize_t sz, const nn_locator_t *srcloc)
+{
+  unsigned char * buff = (unsigned char *) NN_RMSG_PAYLOAD (rmsg);
+  Header_t * hdr = (Header_t*) buff;
+
+  if (sz > 0 && !gv->deaf)
+  {
+    nn_rmsg_setsize (rmsg, (uint32_t) sz);
+    assert (thread_is_asleep ());
+
+    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
+    {
+      /* discard packets that are really too small or don't have magic cookie */
+    }
+    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+    {
+      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
+                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
+      if (NN_PEDANTIC_P (gv->config))
+        malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
+    }
+    else
+    {
+      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+
+      if (gv->logconfig.c.mask & DDS_LC_TRACE)
+      {
+        char addrstr[DDSI_LOCSTRLEN];
+        ddsi_locator_to_string(addrstr, sizeof(addrstr), srcloc);
+        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
+                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
+      }
+      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
+      if (res != NN_RTPS_MSG_STATE_ERROR)
+      {
+        handle_submsg_sequence (ts1, gv, conn, srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
+      }
+      else
+      {
+        /* drop message */
+        sz = 1;
+      }
+    }
+  }
+  nn_rmsg_commit (rmsg);
+  return sz;
+}
+
 static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool)
 {
   /* UDP max packet size is 64kB */
@@ -3190,48 +3331,101 @@ static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *g
     sz = ddsi_conn_read (conn, buff, buff_len, true, &srcloc);
   }
 
-  if (sz > 0 && !gv->deaf)
+  ddsrt_atomic_inc64 (&gv->recv_syscalls);
+  if (sz > 0)
+    ddsrt_atomic_inc64 (&gv->recv_packets);
+  sz = process_packet (ts1, gv, conn, guidprefix, rbpool, rmsg, sz, &srcloc);
+  return (sz > 0);
+}
+
+static uint32_t process_coalesced_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, const unsigned char *buf, size_t sz, size_t segsize, const nn_locator_t *srcloc)
+{
+  /* Datagrams coalesced by the kernel (GRO) get split into separate rmsgs
+     again, as each is a separate RTPS message.  The new rmsgs are allocated
+     beyond the batch reservation, so buf remains intact while doing so. */
+  uint32_t npackets = 0;
+  for (size_t off = 0; off < sz; off += segsize)
   {
-    nn_rmsg_setsize (rmsg, (uint32_t) sz);
-    assert (thread_is_asleep ());
+    const size_t len = (sz - off < segsize) ? sz - off : segsize;
+    struct nn_rmsg *rmsg;
+    if ((rmsg = nn_rmsg_new (rbpool)) == NULL)
+      break;
+    memcpy (NN_RMSG_PAYLOAD (rmsg), buf + off, len);
+    npackets++;
+    (void) process_packet (ts1, gv, conn, guidprefix, rbpool, rmsg, (ssize_t) len, srcloc);
+  }
+  return npackets;
+}
 
-    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
+static bool do_packet_batch (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool)
+{
+  /* Batched equivalent of do_packet for datagram transports: the packets
+     are received in consecutive rmsgs in one go, and then processed one
+     by one exactly as do_packet does. */
+  const size_t maxsz = gv->config.rmsg_chunk_size < 65536 ? gv->config.rmsg_chunk_size : 65536;
+  struct nn_rmsg *rmsgs[DDSI_MAX_RECV_BATCH];
+  unsigned char *bufs[DDSI_MAX_RECV_BATCH];
+  size_t sizes[DDSI_MAX_RECV_BATCH];
+  uint32_t segsizes[DDSI_MAX_RECV_BATCH];
+  nn_locator_t srclocs[DDSI_MAX_RECV_BATCH];
+  uint32_t n, npackets = 0;
+  int nrcvd;
+  bool ok;
+
+  assert (!conn->m_stream);
+  if ((n = nn_rmsg_new_batch (rbpool, (uint32_t) gv->config.recv_batch_size, rmsgs)) == 0)
+    return false;
+  for (uint32_t i = 0; i < n; i++)
+    bufs[i] = (unsigned char *) NN_RMSG_PAYLOAD (rmsgs[i]);
+
+  nrcvd = ddsi_conn_read_batch (conn, n, bufs, maxsz, sizes, segsizes, srclocs);
+  ddsrt_atomic_inc64 (&gv->recv_syscalls);
+  ok = (nrcvd >= 0);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    if ((int) i < nrcvd && sizes[i] > 0 && segsizes[i] > 0 && !gv->deaf)
     {
-      /* discard packets that are really too small or don't have magic cookie */
+      npackets += process_coalesced_packet (ts1, gv, conn, guidprefix, rbpool, bufs[i], sizes[i], segsizes[i], &srclocs[i]);
+      nn_rmsg_commit (rmsgs[i]);
     }
-    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+    else if ((int) i < nrcvd && sizes[i] > 0)
     {
-      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
-      if (NN_PEDANTIC_P (gv->config))
-        malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
+      npackets++;
+      (void) process_packet (ts1, gv, conn, guidprefix, rbpool, rmsgs[i], (ssize_t) sizes[i], &srclocs[i]);
     }
     else
     {
-      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+      nn_rmsg_commit (rmsgs[i]);
+    }
+  }
+  nn_rbufpool_end_batch (rbpool);
+  ddsrt_atomic_add64 (&gv->recv_packets, npackets);
+  return ok;
+}
 
-      if (gv->logconfig.c.mask & DDS_LC_TRACE)
-      {
-        char addrstr[DDSI_LOCSTRLEN];
-        ddsi_locator_to_string(addrstr, sizeof(addrstr), &srcloc);
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
-      }
-      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
-      if (res != NN_RTPS_MSG_STATE_ERROR)
-      {
-        handle_submsg_sequence (ts1, gv, conn, &srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
-      }
-      else
-      {
-        /* drop message */
-        sz = 1;
-      }
+static bool do_packets (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool)
+{
+  if ((gv->config.recv_batch_size > 1 || conn->m_gro) && conn->m_read_batch_fn != 0 && !conn->m_stream)
+    return do_packet_batch (ts1, gv, conn, guidprefix, rbpool);
+  else
+    return do_packet (ts1, gv, conn, guidprefix, rbpool);
+}
+
+static void log_recv_stats (struct ddsi_domaingv *gv, ddsrt_mtime_t *next_log)
+{
+  if (gv->logconfig.c.mask & DDS_LC_TIMING)
+  {
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    if (tnow.v >= next_log->v)
+    {
+      GVLOG (DDS_LC_TIMING, "recv_stats packets %"PRIu64" syscalls %"PRIu64" serdata zerocopy %"PRIu32" (stored %"PRIu32") copied %"PRIu32" pool hits %"PRIu32" misses %"PRIu32"\n",
+             ddsrt_atomic_ld64 (&gv->recv_packets), ddsrt_atomic_ld64 (&gv->recv_syscalls),
+             ddsrt_atomic_ld32 (&gv->serpool->from_ser_zerocopy), ddsrt_atomic_ld32 (&gv->serpool->from_ser_detached),
+             ddsrt_atomic_ld32 (&gv->serpool->from_ser_copy),
+             ddsrt_atomic_ld32 (&gv->serpool->hits), ddsrt_atomic_ld32 (&gv->serpool->misses));
+      next_log->v = tnow.v + DDS_NSECS_IN_SEC;
     }
   }
-  nn_rmsg_commit (rmsg);
-  return (sz > 0);
 }
 
 struct local_participant_desc
@@ -3427,6 +3621,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
   struct nn_rbufpool *rbpool = recv_thread_arg->rbpool;
   os_sockWaitset waitset = recv_thread_arg->mode == RTM_MANY ? recv_thread_arg->u.many.ws : NULL;
   ddsrt_mtime_t next_thread_cputime = { 0 };
+  ddsrt_mtime_t next_recv_stats = { 0 };
 
   nn_rbufpool_setowner (rbpool, ddsrt_thread_self ());
   if (waitset == NULL)
@@ -3435,7 +3630,8 @@ uint32_t recv_thread (void *vrecv_thread_arg)
     while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing))
     {
       LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
-      (void) do_packet (ts1, gv, conn, NULL, rbpool);
+      log_recv_stats (gv, &next_recv_stats);
+      (void) do_packets (ts1, gv, conn, NULL, rbpool);
     }
   }
   else
@@ -3466,6 +3662,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
     {
       int rebuildws = 0;
       LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
+      log_recv_stats (gv, &next_recv_stats);
       if (gv->config.many_sockets_mode != MSM_MANY_UNICAST)
       {
         /* no other sockets to check */
@@ -3500,7 +3697,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
           else
             guid_prefix = &lps.ps[(unsigned)idx - num_fixed].guid_prefix;
           /* Process message and clean out connection if failed or closed */
-          if (!do_packet (ts1, gv, conn, guid_prefix, rbpool) && !conn->m_connless)
+          if (!do_packets (ts1, gv, conn, guid_prefix, rbpool) && !conn->m_connless)
             ddsi_conn_free (conn);
         }
       }
@@ -27,9 +27,12 @@
 #define MODE_KQUEUE 1
 #define MODE_SELECT 2
 #define MODE_WFMEVS 3
+#define MODE_EPOLL 4
 
 #if defined __APPLE__
 #define MODE_SEL MODE_KQUEUE
+#elif defined __linux && !LWIP_SOCKET
+#define MODE_SEL MODE_EPOLL
 #elif defined WINCE
 #define MODE_SEL MODE_WFMEVS
 #else
@@ -281,6 +284,251 @@ int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
   return -1;
 }
 
+#elif MODE_SEL == MODE_EPOLL
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* Entries are kept in a dense array in the order in which they were added,
+   with the eventfd used for triggering in position 0, so the indices returned
+   by os_sockWaitsetNextEvent are the same as in the select-based version.
+   The epoll data of a descriptor holds its position and the descriptor
+   itself, so that events for entries that were removed or moved after
+   epoll_wait returned can be recognized and ignored.  Because epoll is
+   level-triggered, any data on a moved entry will be reported again on the
+   next call to os_sockWaitsetWait. */
+
+struct entry {
+  ddsi_tran_conn_t conn;
+  int fd;
+};
+
+struct os_sockWaitsetCtx
+{
+  struct os_sockWaitset *ws;
+  struct epoll_event *evs;
+  uint32_t nevs;
+  uint32_t evs_sz;
+  uint32_t index; /* cursor for enumerating */
+};
+
+struct os_sockWaitset
+{
+  int epfd;
+  int evfd; /* eventfd used for triggering */
+  uint32_t n; /* number of entries, including trigger */
+  uint32_t sz;
+  struct entry *entries;
+  struct os_sockWaitsetCtx ctx; /* set of descriptors being handled */
+  ddsrt_mutex_t lock; /* for add/delete */
+};
+
+static int epoll_ctl_entry (os_sockWaitset ws, int op, uint32_t idx)
+{
+  struct epoll_event ev;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = ((uint64_t) (uint32_t) ws->entries[idx].fd << 32) | idx;
+  return epoll_ctl (ws->epfd, op, ws->entries[idx].fd, &ev);
+}
+
+static int add_entry_locked (os_sockWaitset ws, ddsi_tran_conn_t conn, int fd)
+{
+  uint32_t idx;
+  assert (fd >= 0);
+  for (idx = 1; idx < ws->n; idx++)
+    if (ws->entries[idx].conn == conn)
+      return 0;
+  if (ws->n == ws->sz)
+  {
+    ws->sz += WAITSET_DELTA;
+    ws->entries = ddsrt_realloc (ws->entries, ws->sz * sizeof (*ws->entries));
+  }
+  ws->entries[ws->n].conn = conn;
+  ws->entries[ws->n].fd = fd;
+  if (epoll_ctl_entry (ws, EPOLL_CTL_ADD, ws->n) == -1)
+    return -1;
+  ws->n++;
+  return 1;
+}
+
+static void remove_entry_locked (os_sockWaitset ws, uint32_t idx)
+{
+  /* Descriptors that have been closed in the meantime are no longer in the
+     epoll set, failure to delete them is therefore expected */
+  assert (idx > 0 && idx < ws->n);
+  (void) epoll_ctl_entry (ws, EPOLL_CTL_DEL, idx);
+  ws->entries[idx].conn = NULL;
+  ws->entries[idx].fd = -1;
+}
+
+os_sockWaitset os_sockWaitsetNew (void)
+{
+  const uint32_t sz = WAITSET_DELTA;
+  os_sockWaitset ws;
+  if ((ws = ddsrt_malloc (sizeof (*ws))) == NULL)
+    goto fail_waitset;
+  ws->n = 0;
+  ws->sz = sz;
+  if ((ws->entries = ddsrt_malloc (sz * sizeof (*ws->entries))) == NULL)
+    goto fail_entries;
+  ws->ctx.ws = ws;
+  ws->ctx.nevs = 0;
+  ws->ctx.index = 0;
+  ws->ctx.evs_sz = sz;
+  if ((ws->ctx.evs = ddsrt_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.evs))) == NULL)
+    goto fail_ctx_evs;
+  if ((ws->epfd = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+    goto fail_epoll;
+  if ((ws->evfd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+    goto fail_eventfd;
+  ws->entries[0].conn = NULL;
+  ws->entries[0].fd = ws->evfd;
+  if (epoll_ctl_entry (ws, EPOLL_CTL_ADD, 0) == -1)
+    goto fail_add_trigger;
+  ws->n = 1;
+  ddsrt_mutex_init (&ws->lock);
+  return ws;
+
+fail_add_trigger:
+  close (ws->evfd);
+fail_eventfd:
+  close (ws->epfd);
+fail_epoll:
+  ddsrt_free (ws->ctx.evs);
+fail_ctx_evs:
+  ddsrt_free (ws->entries);
+fail_entries:
+  ddsrt_free (ws);
+fail_waitset:
+  return NULL;
+}
+
+void os_sockWaitsetFree (os_sockWaitset ws)
+{
+  ddsrt_mutex_destroy (&ws->lock);
+  close (ws->evfd);
+  close (ws->epfd);
+  ddsrt_free (ws->entries);
+  ddsrt_free (ws->ctx.evs);
+  ddsrt_free (ws);
+}
+
+void os_sockWaitsetTrigger (os_sockWaitset ws)
+{
+  /* EAGAIN means the counter is saturated, which is as triggered as it gets */
+  const uint64_t one = 1;
+  if (write (ws->evfd, &one, sizeof (one)) != (ssize_t) sizeof (one) && errno != EAGAIN)
+  {
+    DDS_WARNING("os_sockWaitsetTrigger: write failed on trigger eventfd, errno = %d\n", errno);
+  }
+}
+
+int os_sockWaitsetAdd (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  int ret;
+  ddsrt_mutex_lock (&ws->lock);
+  ret = add_entry_locked (ws, conn, ddsi_conn_handle (conn));
+  ddsrt_mutex_unlock (&ws->lock);
+  return ret;
+}
+
+void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index)
+{
+  uint32_t i;
+  ddsrt_mutex_lock (&ws->lock);
+  for (i = index + 1; i < ws->n; i++)
+    remove_entry_locked (ws, i);
+  if (index + 1 < ws->n)
+    ws->n = index + 1;
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  uint32_t i;
+  ddsrt_mutex_lock (&ws->lock);
+  for (i = 1; i < ws->n; i++)
+    if (ws->entries[i].conn == conn)
+      break;
+  if (i < ws->n)
+  {
+    remove_entry_locked (ws, i);
+    if (i != --ws->n)
+    {
+      /* move the last one into the hole, same as the select-based version */
+      ws->entries[i] = ws->entries[ws->n];
+      if (epoll_ctl_entry (ws, EPOLL_CTL_MOD, i) == -1)
+        DDS_WARNING("os_sockWaitsetRemove: epoll_ctl failed, errno = %d\n", errno);
+    }
+  }
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+{
+  /* if the array of events is smaller than the number of descriptors in the
+     epoll set, the kernel will just return what can be stored, and the array
+     will be grown on the next call */
+  uint32_t n;
+  int nevs;
+  ddsrt_mutex_lock (&ws->lock);
+  n = ws->n;
+  ddsrt_mutex_unlock (&ws->lock);
+  if (ws->ctx.evs_sz < n)
+  {
+    ws->ctx.evs_sz = n;
+    ws->ctx.evs = ddsrt_realloc (ws->ctx.evs, n * sizeof (*ws->ctx.evs));
+  }
+  nevs = epoll_wait (ws->epfd, ws->ctx.evs, (int) ws->ctx.evs_sz, -1);
+  if (nevs < 0)
+  {
+    if (errno == EINTR)
+      nevs = 0;
+    else
+    {
+      DDS_WARNING("os_sockWaitsetWait: epoll_wait failed, errno = %d\n", errno);
+      return NULL;
+    }
+  }
+  ws->ctx.nevs = (uint32_t) nevs;
+  ws->ctx.index = 0;
+  return &ws->ctx;
+}
+
+int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
+{
+  os_sockWaitset const ws = ctx->ws;
+  while (ctx->index < ctx->nevs)
+  {
+    const uint64_t data = ctx->evs[ctx->index++].data.u64;
+    const uint32_t idx = (uint32_t) data;
+    const int fd = (int) (data >> 32);
+    if (idx == 0)
+    {
+      /* trigger eventfd, reading it resets it */
+      uint64_t dummy;
+      (void) read (fd, &dummy, sizeof (dummy));
+    }
+    else
+    {
+      ddsi_tran_conn_t c = NULL;
+      ddsrt_mutex_lock (&ws->lock);
+      if (idx < ws->n && ws->entries[idx].fd == fd)
+        c = ws->entries[idx].conn;
+      ddsrt_mutex_unlock (&ws->lock);
+      if (c != NULL)
+      {
+        *conn = c;
+        return (int) (idx - 1);
+      }
+    }
+  }
+  return -1;
+}
+
 #elif MODE_SEL == MODE_WFMEVS
 
 struct os_sockWaitsetCtx
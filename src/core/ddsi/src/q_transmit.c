@@ -37,6 +37,8 @@
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds/ddsi/ddsi_sertopic.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
 #include "dds/ddsi/ddsi_security_omg.h"
 
 #include "dds/ddsi/sysdeps.h"
@@ -954,6 +956,52 @@ int enqueue_sample_wrlock_held (struct writer *wr, seqno_t seq, const struct dds
   return enqueued ? 0 : -1;
 }
 
+int wr_prd_match_accepts_sample (const struct writer *wr, const struct wr_prd_match *m, const struct ddsi_serdata *serdata)
+{
+  /* field filters are only compiled for writers using the default sertopic,
+     and only ever reject valid data, never disposes and unregisters */
+  if (m->field_filter == NULL || serdata->kind != SDK_DATA || serdata->statusinfo != 0)
+    return 1;
+  const struct ddsi_sertopic_default *tp = (const struct ddsi_sertopic_default *) wr->topic;
+  return dds_stream_field_terms_hold ((const struct ddsi_serdata_default *) serdata, &tp->type, m->field_filter_nterms, m->field_filter);
+}
+
+static void enqueue_sample_filtered_wrlock_held (struct writer *wr, seqno_t seq, const struct ddsi_plist *plist, struct ddsi_serdata *serdata)
+{
+  /* Only used when all readers are addressed by unicast: then sending the
+     sample to each reader that accepts it costs no more than sending it to
+     all of them, and a reliable reader that rejects it gets a GAP instead */
+  struct ddsi_domaingv * const gv = wr->e.gv;
+  struct wr_prd_match *m;
+  ddsrt_avl_iter_t it;
+  int sent = 0;
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  for (m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    struct proxy_reader *prd;
+    if ((prd = entidx_lookup_proxy_reader_guid (gv->entity_index, &m->prd_guid)) == NULL)
+      continue;
+    if (wr_prd_match_accepts_sample (wr, m, serdata))
+    {
+      if (enqueue_sample_wrlock_held (wr, seq, plist, serdata, prd, 1) == 0)
+        sent = 1;
+    }
+    else if (m->is_reliable)
+    {
+      struct nn_gap_info gi;
+      struct nn_xmsg *gap;
+      ETRACE (wr, "filtered "PGUIDFMT" seq %"PRId64" for prd "PGUIDFMT"\n", PGUID (wr->e.guid), seq, PGUID (m->prd_guid));
+      nn_gap_info_init (&gi);
+      nn_gap_info_update (gv, &gi, seq);
+      if ((gap = nn_gap_info_create_gap (wr, prd, &gi)) != NULL)
+        qxev_msg (wr->evq, gap);
+    }
+  }
+  /* no data message means nothing updates seq_xmit on transmission */
+  if (!sent)
+    writer_update_seq_xmit (wr, seq);
+}
+
 static int insert_sample_in_whc (struct writer *wr, seqno_t seq, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk)
 {
   /* returns: < 0 on error, 0 if no need to insert in whc, > 0 if inserted */
@@ -1344,7 +1392,15 @@ static int write_sample_eot (struct thread_state1 * const ts1, struct nn_xpack *
     /* Note the subtlety of enqueueing with the lock held but
        transmitting without holding the lock. Still working on
        cleaning that up. */
-    if (xp)
+    if (wr->num_filtered_readers > 0 && serdata->kind == SDK_DATA && serdata->statusinfo == 0 &&
+        addrset_empty_mc (wr->as) && (wr->as_group == NULL || addrset_empty (wr->as_group)))
+    {
+      if (wr->heartbeat_xevent)
+        writer_hbcontrol_note_asyncwrite (wr, tnow);
+      enqueue_sample_filtered_wrlock_held (wr, seq, plist, serdata);
+      ddsrt_mutex_unlock (&wr->e.lock);
+    }
+    else if (xp)
     {
       /* If all reliable readers disappear between unlocking the writer and
        * creating the message, the WHC will free the plist (if any). Currently,
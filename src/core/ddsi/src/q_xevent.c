@@ -18,6 +18,7 @@
 
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/twheel.h"
 
 #include "dds/ddsi/q_log.h"
 #include "dds/ddsi/q_addrset.h"
@@ -64,7 +65,10 @@ enum xeventkind
 
 struct xevent
 {
-  ddsrt_fibheap_node_t heapnode;
+  union {
+    ddsrt_fibheap_node_t heap;
+    ddsrt_twheel_node_t wheel;
+  } qnode; /* depending on evq->impl */
   struct xeventq *evq;
   ddsrt_mtime_t tsched;
   enum xeventkind kind;
@@ -140,7 +144,9 @@ struct xevent_nt
 };
 
 struct xeventq {
-  ddsrt_fibheap_t xevents;
+  enum timed_event_queue impl;
+  ddsrt_fibheap_t xevents; /* iff impl = TEVQ_FIBHEAP */
+  ddsrt_twheel_t *xevents_wheel; /* iff impl = TEVQ_TIMING_WHEEL */
   ddsrt_avl_tree_t msg_xevents;
   struct xevent_nt *non_timed_xmit_list_oldest;
   struct xevent_nt *non_timed_xmit_list_newest; /* undefined if ..._oldest == NULL */
@@ -165,7 +171,12 @@ static void handle_nontimed_xevent (struct xevent_nt *xev, struct nn_xpack *xp);
 
 static const ddsrt_avl_treedef_t msg_xevents_treedef = DDSRT_AVL_TREEDEF_INITIALIZER_INDKEY (offsetof (struct xevent_nt, u.msg_rexmit.msg_avlnode), offsetof (struct xevent_nt, u.msg_rexmit.msg), msg_xevents_cmp, 0);
 
-static const ddsrt_fibheap_def_t evq_xevents_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, heapnode), compare_xevent_tsched);
+static const ddsrt_fibheap_def_t evq_xevents_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, qnode.heap), compare_xevent_tsched);
+
+/* 2^16ns ~ 65us ticks: events within a tick are not ordered, but never fire
+   early; smaller ticks mean fewer events to look at when handling the current
+   tick, larger ones fewer steps in moving events to lower levels */
+static const ddsrt_twheel_def_t evq_xevents_twdef = DDSRT_TWHEELDEF_INITIALIZER(offsetof (struct xevent, qnode.wheel), offsetof (struct xevent, tsched.v), 16);
 
 static int compare_xevent_tsched (const void *va, const void *vb)
 {
@@ -311,6 +322,45 @@ static int nontimed_xevent_in_queue (struct xeventq *evq, struct xevent_nt *ev)
 }
 #endif
 
+static void xevq_insert (struct xeventq *evq, struct xevent *ev)
+{
+  if (evq->impl == TEVQ_FIBHEAP)
+    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+  else
+    ddsrt_twheel_insert (&evq_xevents_twdef, evq->xevents_wheel, ev);
+}
+
+static void xevq_decrease_key (struct xeventq *evq, struct xevent *ev)
+{
+  if (evq->impl == TEVQ_FIBHEAP)
+    ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+  else
+    ddsrt_twheel_decrease_key (&evq_xevents_twdef, evq->xevents_wheel, ev);
+}
+
+static void xevq_delete (struct xeventq *evq, struct xevent *ev)
+{
+  if (evq->impl == TEVQ_FIBHEAP)
+    ddsrt_fibheap_delete (&evq_xevents_fhdef, &evq->xevents, ev);
+  else
+    ddsrt_twheel_delete (&evq_xevents_twdef, evq->xevents_wheel, ev);
+}
+
+static struct xevent *xevq_extract_due (struct xeventq *evq, ddsrt_mtime_t tnow)
+{
+  /* returns an event scheduled at or before tnow, the earliest one if the
+     queue is a heap */
+  if (evq->impl == TEVQ_FIBHEAP)
+  {
+    struct xevent *min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents);
+    return (min != NULL && min->tsched.v <= tnow.v) ? ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents) : NULL;
+  }
+  else
+  {
+    return ddsrt_twheel_extract_due (&evq_xevents_twdef, evq->xevents_wheel, tnow.v);
+  }
+}
+
 static void free_xevent (struct xeventq *evq, struct xevent *ev)
 {
   (void) evq;
@@ -341,12 +391,12 @@ void delete_xevent (struct xevent *ev)
   if (ev->tsched.v != DDS_NEVER)
   {
     ev->tsched.v = TSCHED_DELETE;
-    ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+    xevq_decrease_key (evq, ev);
   }
   else
   {
     ev->tsched.v = TSCHED_DELETE;
-    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+    xevq_insert (evq, ev);
   }
   /* TSCHED_DELETE is absolute minimum time, so chances are we need to
      wake up the thread.  The superfluous signal is harmless. */
@@ -365,7 +415,7 @@ void delete_xevent_callback (struct xevent *ev)
     if (ev->tsched.v != DDS_NEVER)
     {
       assert (ev->tsched.v != TSCHED_DELETE);
-      ddsrt_fibheap_delete (&evq_xevents_fhdef, &evq->xevents, ev);
+      xevq_delete (evq, ev);
       ev->tsched.v = DDS_NEVER;
     }
     if (ev->u.callback.executing)
@@ -397,12 +447,12 @@ int resched_xevent_if_earlier (struct xevent *ev, ddsrt_mtime_t tsched)
     if (ev->tsched.v != DDS_NEVER)
     {
       ev->tsched = tsched;
-      ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+      xevq_decrease_key (evq, ev);
     }
     else
     {
       ev->tsched = tsched;
-      ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+      xevq_insert (evq, ev);
     }
     is_resched = 1;
     if (tsched.v < tbefore.v)
@@ -464,9 +514,20 @@ static struct xevent_nt *qxev_common_nt (struct xeventq *evq, enum xeventkind_nt
 
 static ddsrt_mtime_t earliest_in_xeventq (struct xeventq *evq)
 {
-  struct xevent *min;
+  /* Exact for the heap, a lower bound for the timing wheel.  That suffices
+     for deciding whether to wake up the thread and how long it may sleep, at
+     worst the thread wakes up early and goes back to sleep. */
   ASSERT_MUTEX_HELD (&evq->lock);
-  return ((min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents)) != NULL) ? min->tsched : DDSRT_MTIME_NEVER;
+  if (evq->impl == TEVQ_FIBHEAP)
+  {
+    struct xevent *min;
+    return ((min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents)) != NULL) ? min->tsched : DDSRT_MTIME_NEVER;
+  }
+  else
+  {
+    const int64_t next = ddsrt_twheel_next (&evq_xevents_twdef, evq->xevents_wheel);
+    return (ddsrt_mtime_t) { (next == INT64_MAX) ? DDS_NEVER : next };
+  }
 }
 
 static void qxev_insert (struct xevent *ev)
@@ -478,7 +539,7 @@ static void qxev_insert (struct xevent *ev)
   if (ev->tsched.v != DDS_NEVER)
   {
     ddsrt_mtime_t tbefore = earliest_in_xeventq (evq);
-    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+    xevq_insert (evq, ev);
     if (ev->tsched.v < tbefore.v)
       ddsrt_cond_broadcast (&evq->cond);
   }
@@ -510,7 +571,17 @@ struct xeventq * xeventq_new
   /* limit to 2GB to prevent overflow (4GB - 64kB should be ok, too) */
   if (max_queued_rexmit_bytes > 2147483648u)
     max_queued_rexmit_bytes = 2147483648u;
-  ddsrt_fibheap_init (&evq_xevents_fhdef, &evq->xevents);
+  evq->impl = conn->m_base.gv->config.timed_event_queue;
+  if (evq->impl == TEVQ_FIBHEAP)
+  {
+    ddsrt_fibheap_init (&evq_xevents_fhdef, &evq->xevents);
+    evq->xevents_wheel = NULL;
+  }
+  else
+  {
+    evq->xevents_wheel = ddsrt_malloc (sizeof (*evq->xevents_wheel));
+    ddsrt_twheel_init (&evq_xevents_twdef, evq->xevents_wheel, ddsrt_time_monotonic ().v);
+  }
   ddsrt_avl_init (&msg_xevents_treedef, &evq->msg_xevents);
   evq->non_timed_xmit_list_oldest = NULL;
   evq->non_timed_xmit_list_newest = NULL;
@@ -566,8 +637,9 @@ void xeventq_free (struct xeventq *evq)
 {
   struct xevent *ev;
   assert (evq->ts == NULL);
-  while ((ev = ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents)) != NULL)
+  while ((ev = xevq_extract_due (evq, (ddsrt_mtime_t) { INT64_MAX })) != NULL)
     free_xevent (evq, ev);
+  ddsrt_free (evq->xevents_wheel);
 
   {
     struct nn_xpack *xp = nn_xpack_new (evq->tev_conn, evq->auxiliary_bandwidth_limit, false);
@@ -1402,9 +1474,9 @@ static void handle_xevents (struct thread_state1 * const ts1, struct xeventq *xe
 
   while (xeventsToProcess)
   {
-    while (earliest_in_xeventq(xevq).v <= tnow.v)
+    struct xevent *xev;
+    while ((xev = xevq_extract_due (xevq, tnow)) != NULL)
     {
-      struct xevent *xev = ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &xevq->xevents);
       if (xev->tsched.v == TSCHED_DELETE)
       {
         free_xevent (xevq, xev);
@@ -222,6 +222,17 @@ struct nn_xpack
 
   struct nn_xmsg_chain included_msgs;
 
+  /* With segmentation offload, the packet can be a sequence of RTPS
+     messages that the kernel sends as separate datagrams.  All but the
+     last one must be exactly segsize bytes, which is achieved by adding
+     PAD submessages. */
+  struct {
+    uint32_t nsegs;    /* number of RTPS messages in the packet */
+    uint32_t segsize;  /* size of all but the last, 0 if nsegs = 1 */
+    uint32_t segstart; /* offset of the last one in the packet */
+    SubmessageHeader_t pad[DDSI_MAX_GSO_SEGMENTS];
+  } gso;
+
 #ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
   struct nn_bw_limiter limiter;
 #endif
@@ -1147,6 +1158,9 @@ static void nn_xpack_reinit (struct nn_xpack *xp)
   xp->msg_len.length = 0;
   xp->included_msgs.latest = NULL;
   xp->maxdelay = DDS_INFINITY;
+  xp->gso.nsegs = 1;
+  xp->gso.segsize = 0;
+  xp->gso.segstart = 0;
 #ifdef DDSI_INCLUDE_SECURITY
   xp->sec_info.use_rtps_encoding = 0;
 #endif
@@ -1213,6 +1227,14 @@ static ssize_t nn_xpack_send_rtps(struct nn_xpack * xp, const nn_locator_t *loc)
 {
   ssize_t ret = -1;
 
+  if (xp->gso.nsegs > 1)
+  {
+    /* never encoded, see nn_xpack_maynewsegment */
+    if (ddsi_conn_write_multi (xp->conn, 1, loc, xp->niov, xp->iov, xp->gso.segsize, xp->call_flags) > 0)
+      ret = (ssize_t) xp->msg_len.length;
+    return ret;
+  }
+
 #ifdef DDSI_INCLUDE_SECURITY
   /* Only encode when needed. */
   if (xp->sec_info.use_rtps_encoding)
@@ -1328,6 +1350,73 @@ static void nn_xpack_send1_threaded (const nn_locator_t *loc, void * varg)
   ddsrt_thread_pool_submit (arg->xp->gv->thread_pool, nn_xpack_send1_thread, arg);
 }
 
+/* Sending the same packet to many unicast destinations: collect the
+   destinations and hand them to the transport in batches, so it can do it
+   with a single system call (sendmmsg) rather than one per destination */
+
+struct nn_xpack_send_multi_arg {
+  struct nn_xpack *xp;
+  uint32_t n;
+  nn_locator_t dsts[DDSI_MAX_WRITE_MULTI];
+};
+
+static bool nn_xpack_use_send_multi (const struct nn_xpack *xp)
+{
+  /* Lossiness and muting are per destination, encoding may be too */
+  struct ddsi_domaingv const * const gv = xp->gv;
+  if (xp->conn->m_write_multi_fn == 0 || gv->config.xmit_lossiness > 0 || gv->mute)
+    return false;
+#ifdef DDSI_INCLUDE_SECURITY
+  if (xp->sec_info.use_rtps_encoding)
+    return false;
+#endif
+  return true;
+}
+
+static void nn_xpack_send_multi_flush (struct nn_xpack_send_multi_arg *arg)
+{
+  struct nn_xpack *xp = arg->xp;
+  struct ddsi_domaingv const * const gv = xp->gv;
+  int nsent;
+  if (arg->n == 0)
+    return;
+  nsent = ddsi_conn_write_multi (xp->conn, arg->n, arg->dsts, xp->niov, xp->iov, xp->gso.segsize, xp->call_flags);
+  GVTRACE (" (batch %"PRIu32" sent %d)", arg->n, nsent);
+  arg->n = 0;
+#ifdef DDSI_INCLUDE_BANDWIDTH_LIMITING
+  if (nsent > 0)
+  {
+    nn_bw_limit_sleep_if_needed (gv, &xp->limiter, (ssize_t) nsent * (ssize_t) xp->msg_len.length);
+  }
+#endif
+}
+
+static void nn_xpack_send_multi_add (const nn_locator_t *loc, void *varg)
+{
+  struct nn_xpack_send_multi_arg *arg = varg;
+  struct ddsi_domaingv const * const gv = arg->xp->gv;
+  if (gv->logconfig.c.mask & DDS_LC_TRACE)
+  {
+    char buf[DDSI_LOCSTRLEN];
+    GVTRACE (" %s", ddsi_locator_to_string (buf, sizeof(buf), loc));
+  }
+  arg->dsts[arg->n++] = *loc;
+  if (arg->n == DDSI_MAX_WRITE_MULTI)
+    nn_xpack_send_multi_flush (arg);
+}
+
+static size_t nn_xpack_send_multi (struct nn_xpack *xp, struct addrset *as)
+{
+  struct nn_xpack_send_multi_arg arg;
+  size_t calls;
+  arg.xp = xp;
+  arg.n = 0;
+  calls = addrset_forall_count (as, nn_xpack_send_multi_add, &arg);
+  nn_xpack_send_multi_flush (&arg);
+  xp->call_flags = 0;
+  return calls;
+}
+
 static void nn_xpack_send_real (struct nn_xpack *xp)
 {
   struct ddsi_domaingv const * const gv = xp->gv;
@@ -1346,6 +1435,8 @@ static void nn_xpack_send_real (struct nn_xpack *xp)
   {
     int i;
     GVTRACE ("nn_xpack_send %"PRIu32":", xp->msg_len.length);
+    if (xp->gso.nsegs > 1)
+      GVTRACE (" (%"PRIu32" segments of %"PRIu32")", xp->gso.nsegs, xp->gso.segsize);
     for (i = 0; i < (int) xp->niov; i++)
     {
       GVTRACE (" %p:%lu", (void *) xp->iov[i].iov_base, (unsigned long) xp->iov[i].iov_len);
@@ -1366,7 +1457,11 @@ static void nn_xpack_send_real (struct nn_xpack *xp)
     calls = 0;
     if (xp->dstaddr.all.as)
     {
-      if (xp->gv->thread_pool == NULL)
+      if (xp->gv->thread_pool == NULL && nn_xpack_use_send_multi (xp))
+      {
+        calls = nn_xpack_send_multi (xp, xp->dstaddr.all.as);
+      }
+      else if (xp->gv->thread_pool == NULL)
       {
         calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
       }
@@ -1535,6 +1630,30 @@ static int addressing_info_eq_onesidederr (const struct nn_xpack *xp, const stru
   return 0;
 }
 
+static int nn_xpack_compatible (const struct nn_xpack *xp, const struct nn_xmsg *m, const uint32_t flags)
+{
+  /* Check if different call semantics */
+
+  if (xp->call_flags != flags)
+  {
+    return 0;
+  }
+
+#ifdef DDSI_INCLUDE_NETWORK_PARTITIONS
+  /* Don't mix up xmsg for different encoders */
+  if (xp->encoderId != m->encoderid)
+    return 0;
+#endif
+
+#ifdef DDSI_INCLUDE_SECURITY
+  /* Don't mix up encoded and plain rtps messages */
+  if (xp->sec_info.use_rtps_encoding != m->sec_info.use_rtps_encoding)
+    return 0;
+#endif
+
+  return addressing_info_eq_onesidederr (xp, m);
+}
+
 static int nn_xpack_mayaddmsg (const struct nn_xpack *xp, const struct nn_xmsg *m, const uint32_t flags)
 {
   unsigned max_msg_size = xp->gv->config.max_msg_size;
@@ -1548,33 +1667,93 @@ static int nn_xpack_mayaddmsg (const struct nn_xpack *xp, const struct nn_xmsg *
 
   payload_size = m->refd_payload ? (unsigned) m->refd_payload_iov.iov_len : 0;
 
-  /* Check if max message size exceeded */
+  /* Check if max message size exceeded; once segmented, the last
+     segment may not exceed the size of the preceding ones */
 
-  if (xp->msg_len.length + m->sz + payload_size > max_msg_size)
+  if (xp->gso.nsegs > 1)
   {
-    return 0;
+    max_msg_size = xp->gso.segsize;
+    if (xp->msg_len.length + m->sz + payload_size > DDSI_MAX_GSO_SIZE)
+      return 0;
   }
-
-  /* Check if different call semantics */
-
-  if (xp->call_flags != flags)
+  if (xp->msg_len.length - xp->gso.segstart + m->sz + payload_size > max_msg_size)
   {
     return 0;
   }
 
-#ifdef DDSI_INCLUDE_NETWORK_PARTITIONS
-  /* Don't mix up xmsg for different encoders */
-  if (xp->encoderId != m->encoderid)
-    return 0;
-#endif
+  return nn_xpack_compatible (xp, m, flags);
+}
 
-#ifdef DDSI_INCLUDE_SECURITY
-  /* Don't mix up encoded and plain rtps messages */
-  if (xp->sec_info.use_rtps_encoding != m->sec_info.use_rtps_encoding)
+#define NN_XPACK_MAX_PAD 512
+
+static int nn_xpack_maynewsegment (const struct nn_xpack *xp, const struct nn_xmsg *m, const uint32_t flags)
+{
+  /* Whether m can be added by closing the current RTPS message and starting
+     a new one in the same packet, to be split into separate datagrams by
+     the kernel (UDP segmentation offload) */
+  const uint32_t cursz = xp->msg_len.length - xp->gso.segstart;
+  const uint32_t segsize = (xp->gso.nsegs > 1) ? xp->gso.segsize : cursz;
+  const unsigned payload_size = m->refd_payload ? (unsigned) m->refd_payload_iov.iov_len : 0;
+
+  assert (xp->niov > 0);
+  if (!xp->gv->config.xmit_gso || !xp->conn->m_gso || !nn_xpack_use_send_multi (xp))
     return 0;
-#endif
+  if (xp->gso.nsegs == DDSI_MAX_GSO_SEGMENTS || cursz <= RTPS_MESSAGE_HEADER_SIZE)
+    return 0;
+  /* PAD submessage, its contents and the new RTPS header */
+  if (xp->niov + 3 + NN_XMSG_MAX_SUBMESSAGE_IOVECS > NN_XMSG_MAX_MESSAGE_IOVECS)
+    return 0;
+  if (segsize - cursz > NN_XPACK_MAX_PAD)
+    return 0;
+  if (RTPS_MESSAGE_HEADER_SIZE + m->sz + payload_size > segsize)
+    return 0;
+  if (xp->msg_len.length + (segsize - cursz) + RTPS_MESSAGE_HEADER_SIZE + m->sz + payload_size > DDSI_MAX_GSO_SIZE)
+    return 0;
+  return nn_xpack_compatible (xp, m, flags);
+}
 
-  return addressing_info_eq_onesidederr (xp, m);
+static void nn_xpack_newsegment (struct nn_xpack *xp)
+{
+  static const unsigned char zeros[NN_XPACK_MAX_PAD] = { 0 };
+  struct ddsi_domaingv const * const gv = xp->gv;
+  const uint32_t cursz = xp->msg_len.length - xp->gso.segstart;
+  uint32_t pad;
+
+  if (xp->gso.nsegs == 1)
+    xp->gso.segsize = cursz;
+  assert (cursz <= xp->gso.segsize);
+  assert (xp->gso.segsize - cursz <= NN_XPACK_MAX_PAD);
+  pad = xp->gso.segsize - cursz;
+  GVTRACE ("xpack_newsegment %p %"PRIu32" pad %"PRIu32"\n", (void *) xp, xp->gso.nsegs, pad);
+
+  /* Both sizes are multiples of 4, so a PAD submessage always fits */
+  assert ((pad % 4) == 0);
+  if (pad > 0)
+  {
+    SubmessageHeader_t *padhdr = &xp->gso.pad[xp->gso.nsegs - 1];
+    padhdr->submessageId = SMID_PAD;
+    padhdr->flags = (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN ? SMFLAG_ENDIANNESS : 0);
+    padhdr->octetsToNextHeader = (uint16_t) (pad - RTPS_SUBMESSAGE_HEADER_SIZE);
+    xp->iov[xp->niov].iov_base = (void *) padhdr;
+    xp->iov[xp->niov].iov_len = RTPS_SUBMESSAGE_HEADER_SIZE;
+    xp->niov++;
+    if (pad > RTPS_SUBMESSAGE_HEADER_SIZE)
+    {
+      xp->iov[xp->niov].iov_base = (void *) zeros;
+      xp->iov[xp->niov].iov_len = (ddsrt_iov_len_t) (pad - RTPS_SUBMESSAGE_HEADER_SIZE);
+      xp->niov++;
+    }
+  }
+
+  /* The new RTPS message has the same header as the first one */
+  xp->iov[xp->niov].iov_base = (void *) &xp->hdr;
+  xp->iov[xp->niov].iov_len = sizeof (xp->hdr);
+  xp->niov++;
+  xp->gso.segstart = xp->msg_len.length + pad;
+  xp->msg_len.length = xp->gso.segstart + (uint32_t) sizeof (xp->hdr);
+  xp->gso.nsegs++;
+  xp->last_src = &xp->hdr.guid_prefix;
+  xp->last_dst = NULL;
 }
 
 int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flags)
@@ -1610,9 +1789,14 @@ int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flag
   if (!nn_xpack_mayaddmsg (xp, m, flags))
   {
     assert (xp->niov > 0);
-    nn_xpack_send (xp, false);
+    if (nn_xpack_maynewsegment (xp, m, flags))
+      nn_xpack_newsegment (xp);
+    else
+    {
+      nn_xpack_send (xp, false);
+      result = 1;
+    }
     assert (nn_xpack_mayaddmsg (xp, m, flags));
-    result = 1;
   }
 
   niov = xp->niov;
@@ -1758,14 +1942,22 @@ int nn_xpack_addmsg (struct nn_xpack *xp, struct nn_xmsg *m, const uint32_t flag
   xp->msg_len.length = (uint32_t) sz;
   xp->niov = niov;
 
-  if (xpo_niov > 0 && sz > xp->gv->config.max_msg_size)
+  if (xpo_niov > 0 && sz - xp->gso.segstart > (xp->gso.nsegs > 1 ? xp->gso.segsize : xp->gv->config.max_msg_size))
   {
     GVTRACE (" => now niov %d sz %"PRIuSIZE" > max_msg_size %"PRIu32", nn_xpack_send niov %d sz %"PRIu32" now\n",
              (int) niov, sz, gv->config.max_msg_size, (int) xpo_niov, xpo_sz);
     xp->msg_len.length = xpo_sz;
     xp->niov = xpo_niov;
-    nn_xpack_send (xp, false);
-    result = nn_xpack_addmsg (xp, m, flags); /* Retry on emptied xp */
+    if (nn_xpack_maynewsegment (xp, m, flags))
+    {
+      nn_xpack_newsegment (xp);
+      (void) nn_xpack_addmsg (xp, m, flags); /* Retry in new segment */
+    }
+    else
+    {
+      nn_xpack_send (xp, false);
+      result = nn_xpack_addmsg (xp, m, flags); /* Retry on emptied xp */
+    }
   }
   else
   {
@@ -0,0 +1,719 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsrt/md5.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
+
+/* A telemetry-like type with 200 primitive fields in addition to a string,
+   a nested struct, an array and a sequence:
+
+     struct Pos { double x, y, z; };
+     struct Telemetry {
+       string source;
+       Pos pos;
+       long id;
+       long l0; double d0; short s0; octet o0; float f0;
+       ...
+       long l39; double d39; short s39; octet o39; float f39;
+       float cov[9];
+       sequence<long> samples;
+     };
+     #pragma keylist Telemetry id
+
+   The descriptor and (de)serializers below are what "idlc -genmarshal"
+   generates for it, but for the repetitive fields being written using
+   macros. */
+#define TELEMETRY_GROUPS(G) \
+  G(0)  G(1)  G(2)  G(3)  G(4)  G(5)  G(6)  G(7)  G(8)  G(9)  \
+  G(10) G(11) G(12) G(13) G(14) G(15) G(16) G(17) G(18) G(19) \
+  G(20) G(21) G(22) G(23) G(24) G(25) G(26) G(27) G(28) G(29) \
+  G(30) G(31) G(32) G(33) G(34) G(35) G(36) G(37) G(38) G(39)
+
+typedef struct Pos
+{
+  double x;
+  double y;
+  double z;
+} Pos;
+
+#define TELEMETRY_FIELDS(n) int32_t l##n; double d##n; int16_t s##n; uint8_t o##n; float f##n;
+typedef struct Telemetry
+{
+  char * source;
+  Pos pos;
+  int32_t id;
+  TELEMETRY_GROUPS (TELEMETRY_FIELDS)
+  float cov[9];
+  dds_sequence_t samples;
+} Telemetry;
+#undef TELEMETRY_FIELDS
+
+#define TELEMETRY_OPS(n) \
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_SGN, offsetof (Telemetry, l##n), \
+  DDS_OP_ADR | DDS_OP_TYPE_8BY | DDS_OP_FLAG_FP, offsetof (Telemetry, d##n), \
+  DDS_OP_ADR | DDS_OP_TYPE_2BY | DDS_OP_FLAG_SGN, offsetof (Telemetry, s##n), \
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (Telemetry, o##n), \
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_FP, offsetof (Telemetry, f##n),
+static const uint32_t Telemetry_ops [] =
+{
+  DDS_OP_ADR | DDS_OP_TYPE_STR, offsetof (Telemetry, source),
+  DDS_OP_ADR | DDS_OP_TYPE_8BY | DDS_OP_FLAG_FP, offsetof (Telemetry, pos.x),
+  DDS_OP_ADR | DDS_OP_TYPE_8BY | DDS_OP_FLAG_FP, offsetof (Telemetry, pos.y),
+  DDS_OP_ADR | DDS_OP_TYPE_8BY | DDS_OP_FLAG_FP, offsetof (Telemetry, pos.z),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_SGN | DDS_OP_FLAG_KEY, offsetof (Telemetry, id),
+  TELEMETRY_GROUPS (TELEMETRY_OPS)
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_4BY | DDS_OP_FLAG_FP, offsetof (Telemetry, cov), 9,
+  DDS_OP_ADR | DDS_OP_TYPE_SEQ | DDS_OP_SUBTYPE_4BY | DDS_OP_FLAG_SGN, offsetof (Telemetry, samples),
+  DDS_OP_RTS
+};
+#undef TELEMETRY_OPS
+
+static void Telemetry_marshal_write (dds_ostream_t * __restrict os, const void * __restrict vsample)
+{
+  const Telemetry *sample = vsample;
+  dds_stream_write_string (os, sample->source);
+  dds_os_put_bytes_aligned (os, &sample->pos.x, 1u, 8u);
+  dds_os_put_bytes_aligned (os, &sample->pos.y, 1u, 8u);
+  dds_os_put_bytes_aligned (os, &sample->pos.z, 1u, 8u);
+  dds_os_put4 (os, (uint32_t) sample->id);
+#define TELEMETRY_WRITE(n) \
+  dds_os_put4 (os, (uint32_t) sample->l##n); \
+  dds_os_put_bytes_aligned (os, &sample->d##n, 1u, 8u); \
+  dds_os_put2 (os, (uint16_t) sample->s##n); \
+  dds_os_put1 (os, (uint8_t) sample->o##n); \
+  dds_os_put_bytes_aligned (os, &sample->f##n, 1u, 4u);
+  TELEMETRY_GROUPS (TELEMETRY_WRITE)
+#undef TELEMETRY_WRITE
+  dds_os_put_bytes_aligned (os, sample->cov, 9u, 4u);
+  dds_stream_write_primseq (os, (const dds_sequence_t *) &sample->samples, 4u);
+}
+
+static void Telemetry_marshal_read (dds_istream_t * __restrict is, void * __restrict vsample)
+{
+  Telemetry *sample = vsample;
+  sample->source = dds_stream_reuse_string (is, sample->source);
+  dds_is_get_bytes (is, &sample->pos.x, 1u, 8u);
+  dds_is_get_bytes (is, &sample->pos.y, 1u, 8u);
+  dds_is_get_bytes (is, &sample->pos.z, 1u, 8u);
+  sample->id = (int32_t) dds_is_get4 (is);
+#define TELEMETRY_READ(n) \
+  sample->l##n = (int32_t) dds_is_get4 (is); \
+  dds_is_get_bytes (is, &sample->d##n, 1u, 8u); \
+  sample->s##n = (int16_t) dds_is_get2 (is); \
+  sample->o##n = (uint8_t) dds_is_get1 (is); \
+  dds_is_get_bytes (is, &sample->f##n, 1u, 4u);
+  TELEMETRY_GROUPS (TELEMETRY_READ)
+#undef TELEMETRY_READ
+  dds_is_get_bytes (is, sample->cov, 9u, 4u);
+  dds_stream_read_primseq (is, (dds_sequence_t *) &sample->samples, 4u);
+}
+
+static void Telemetry_marshal_write_key (dds_ostream_t * __restrict os, const void * __restrict vsample)
+{
+  const Telemetry *sample = vsample;
+  dds_os_put4 (os, (uint32_t) sample->id);
+}
+
+static void Telemetry_marshal_extract_key (dds_istream_t * __restrict is, dds_ostream_t * __restrict os)
+{
+  dds_stream_skip_string (is);
+  (void) dds_is_get8 (is);
+  (void) dds_is_get8 (is);
+  (void) dds_is_get8 (is);
+  dds_os_put4 (os, dds_is_get4 (is));
+}
+
+static bool Telemetry_marshal_normalize (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap)
+{
+  if (!dds_stream_normalize_string (data, off, size, bswap, SIZE_MAX)) return false;
+  if (!dds_stream_normalize_uint64 (data, off, size, bswap)) return false;
+  if (!dds_stream_normalize_uint64 (data, off, size, bswap)) return false;
+  if (!dds_stream_normalize_uint64 (data, off, size, bswap)) return false;
+  if (!dds_stream_normalize_uint32 (data, off, size, bswap)) return false;
+#define TELEMETRY_NORMALIZE(n) \
+  if (!dds_stream_normalize_uint32 (data, off, size, bswap)) return false; \
+  if (!dds_stream_normalize_uint64 (data, off, size, bswap)) return false; \
+  if (!dds_stream_normalize_uint16 (data, off, size, bswap)) return false; \
+  if (!dds_stream_normalize_uint8 (data, off, size, bswap)) return false; \
+  if (!dds_stream_normalize_uint32 (data, off, size, bswap)) return false;
+  TELEMETRY_GROUPS (TELEMETRY_NORMALIZE)
+#undef TELEMETRY_NORMALIZE
+  if (!dds_stream_normalize_primarray (data, off, size, bswap, 9u, DDS_OP_VAL_4BY)) return false;
+  if (!dds_stream_normalize_primseq (data, off, size, bswap, DDS_OP_VAL_4BY)) return false;
+  return true;
+}
+
+static const dds_topic_marshal_ops_t Telemetry_marshal =
+{
+  Telemetry_marshal_write,
+  Telemetry_marshal_read,
+  Telemetry_marshal_write_key,
+  Telemetry_marshal_extract_key,
+  Telemetry_marshal_normalize
+};
+
+/* index of "id" in Telemetry_ops */
+static uint32_t Telemetry_keys[] = { 8 };
+
+static void init_topic (struct ddsi_sertopic_default *tp, bool generated)
+{
+  memset (tp, 0, sizeof (*tp));
+  tp->type.m_size = (uint32_t) sizeof (Telemetry);
+  tp->type.m_align = (uint32_t) sizeof (char *);
+  tp->type.m_flagset = DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_FIXED_KEY | (generated ? DDS_TOPIC_GENERATED_OPS : 0);
+  tp->type.m_nkeys = 1;
+  tp->type.m_keys = Telemetry_keys;
+  tp->type.m_ops = (uint32_t *) Telemetry_ops;
+  tp->type.m_nops = dds_stream_countops (tp->type.m_ops);
+  tp->type.m_marshal = generated ? &Telemetry_marshal : NULL;
+  tp->opt_size = 0;
+}
+
+static void init_sample (Telemetry *s, ddsrt_prng_t *prng)
+{
+  char buf[32];
+  memset (s, 0, sizeof (*s));
+  (void) snprintf (buf, sizeof (buf), "sensor-%"PRIu32, ddsrt_prng_random (prng) % 1000);
+  s->source = ddsrt_strdup (buf);
+  s->pos.x = 1.0; s->pos.y = 2.0; s->pos.z = 3.0;
+  s->id = (int32_t) ddsrt_prng_random (prng);
+#define TELEMETRY_INIT(n) \
+  s->l##n = (int32_t) ddsrt_prng_random (prng); \
+  s->d##n = (double) ddsrt_prng_random (prng) / 7.0; \
+  s->s##n = (int16_t) ddsrt_prng_random (prng); \
+  s->o##n = (uint8_t) ddsrt_prng_random (prng); \
+  s->f##n = (float) ddsrt_prng_random (prng) / 3.0f;
+  TELEMETRY_GROUPS (TELEMETRY_INIT)
+#undef TELEMETRY_INIT
+  for (uint32_t i = 0; i < 9; i++)
+    s->cov[i] = (float) i;
+  s->samples._length = s->samples._maximum = ddsrt_prng_random (prng) % 8;
+  s->samples._buffer = ddsrt_malloc (s->samples._length * sizeof (int32_t) + 1);
+  s->samples._release = true;
+  for (uint32_t i = 0; i < s->samples._length; i++)
+    ((int32_t *) s->samples._buffer)[i] = (int32_t) ddsrt_prng_random (prng);
+}
+
+static void fini_sample (Telemetry *s)
+{
+  ddsrt_free (s->source);
+  ddsrt_free (s->samples._buffer);
+}
+
+static bool sample_equal (const Telemetry *a, const Telemetry *b)
+{
+  /* all fields are initialized, but there is padding, so compare field-by-field
+     where it matters and the fixed part using the serialized form */
+  if (strcmp (a->source, b->source) != 0 || a->id != b->id)
+    return false;
+  if (a->samples._length != b->samples._length)
+    return false;
+  if (a->samples._length > 0 && memcmp (a->samples._buffer, b->samples._buffer, a->samples._length * sizeof (int32_t)) != 0)
+    return false;
+  if (memcmp (&a->pos, &b->pos, sizeof (a->pos)) != 0 || memcmp (a->cov, b->cov, sizeof (a->cov)) != 0)
+    return false;
+#define TELEMETRY_CMP(n) \
+  if (a->l##n != b->l##n || a->d##n != b->d##n || a->s##n != b->s##n || a->o##n != b->o##n || a->f##n != b->f##n) \
+    return false;
+  TELEMETRY_GROUPS (TELEMETRY_CMP)
+#undef TELEMETRY_CMP
+  return true;
+}
+
+CU_Test(ddsi_cdrstream, generated_equivalence)
+{
+  struct ddsi_sertopic_default tpi, tpg;
+  ddsrt_prng_t prng;
+  init_topic (&tpi, false);
+  init_topic (&tpg, true);
+  ddsrt_prng_init_simple (&prng, ddsrt_random ());
+  for (int iter = 0; iter < 100; iter++)
+  {
+    Telemetry s, ri, rg;
+    dds_ostream_t osi, osg, oki, okg;
+    dds_istream_t is;
+    init_sample (&s, &prng);
+
+    /* identical serialized form */
+    dds_ostream_init (&osi, 0);
+    dds_ostream_init (&osg, 0);
+    dds_stream_write_sample (&osi, &s, &tpi);
+    dds_stream_write_sample (&osg, &s, &tpg);
+    CU_ASSERT_FATAL (osi.m_index == osg.m_index);
+    CU_ASSERT_FATAL (memcmp (osi.m_buffer, osg.m_buffer, osi.m_index) == 0);
+    CU_ASSERT_FATAL (dds_stream_getsize_sample (&s, &tpi) == osi.m_index);
+
+    /* identical key, both from the sample and from the serialized form */
+    dds_ostream_init (&oki, 0);
+    dds_ostream_init (&okg, 0);
+    dds_stream_write_key (&oki, (const char *) &s, &tpi);
+    dds_stream_write_key (&okg, (const char *) &s, &tpg);
+    CU_ASSERT_FATAL (oki.m_index == okg.m_index && memcmp (oki.m_buffer, okg.m_buffer, oki.m_index) == 0);
+    CU_ASSERT_FATAL (dds_stream_getsize_key ((const char *) &s, &tpi) == oki.m_index);
+    okg.m_index = 0;
+    is.m_buffer = osg.m_buffer; is.m_size = osg.m_index; is.m_index = 0;
+    dds_stream_extract_key_from_data (&is, &okg, &tpg);
+    CU_ASSERT_FATAL (oki.m_index == okg.m_index && memcmp (oki.m_buffer, okg.m_buffer, oki.m_index) == 0);
+    dds_ostream_fini (&oki);
+    dds_ostream_fini (&okg);
+
+    /* validation: accept the complete data, reject any truncation of it, and
+       do the same thing to the data when byte-swapping */
+    CU_ASSERT_FATAL (dds_stream_normalize (osi.m_buffer, osi.m_index, false, &tpi, false));
+    CU_ASSERT_FATAL (dds_stream_normalize (osg.m_buffer, osg.m_index, false, &tpg, false));
+    for (uint32_t size = 0; size < osi.m_index; size++)
+    {
+      CU_ASSERT_FATAL (!dds_stream_normalize (osi.m_buffer, size, false, &tpi, false));
+      CU_ASSERT_FATAL (!dds_stream_normalize (osg.m_buffer, size, false, &tpg, false));
+    }
+    {
+      char *bi = ddsrt_memdup (osi.m_buffer, osi.m_index);
+      char *bg = ddsrt_memdup (osg.m_buffer, osg.m_index);
+      const bool oki_swap = dds_stream_normalize (bi, osi.m_index, true, &tpi, false);
+      const bool okg_swap = dds_stream_normalize (bg, osg.m_index, true, &tpg, false);
+      CU_ASSERT_FATAL (oki_swap == okg_swap);
+      CU_ASSERT_FATAL (memcmp (bi, bg, osi.m_index) == 0);
+      ddsrt_free (bi);
+      ddsrt_free (bg);
+    }
+
+    /* reading gives back the original, also when reusing a sample */
+    memset (&ri, 0, sizeof (ri));
+    memset (&rg, 0, sizeof (rg));
+    for (int k = 0; k < 2; k++)
+    {
+      is.m_buffer = osi.m_buffer; is.m_size = osi.m_index; is.m_index = 0;
+      dds_stream_read_sample (&is, &ri, &tpi);
+      CU_ASSERT_FATAL (is.m_index == osi.m_index);
+      is.m_buffer = osg.m_buffer; is.m_size = osg.m_index; is.m_index = 0;
+      dds_stream_read_sample (&is, &rg, &tpg);
+      CU_ASSERT_FATAL (is.m_index == osg.m_index);
+      CU_ASSERT_FATAL (sample_equal (&s, &ri));
+      CU_ASSERT_FATAL (sample_equal (&s, &rg));
+    }
+    fini_sample (&ri);
+    fini_sample (&rg);
+    fini_sample (&s);
+    dds_ostream_fini (&osi);
+    dds_ostream_fini (&osg);
+  }
+}
+
+CU_Test(ddsi_cdrstream, getsize)
+{
+  /* Writing into a buffer of the initial size serdata_default_new used to
+     allocate (128 bytes) requires growing the buffer for larger samples,
+     which reallocates (and copies) it; sizing it with getsize never does */
+  struct ddsi_sertopic_default tp;
+  ddsrt_prng_t prng;
+  const uint32_t n = 1000;
+  uint32_t grown_default = 0, grown_exact = 0;
+  init_topic (&tp, false);
+  ddsrt_prng_init_simple (&prng, ddsrt_random ());
+  for (uint32_t iter = 0; iter < n; iter++)
+  {
+    Telemetry s;
+    dds_ostream_t os;
+    init_sample (&s, &prng);
+    /* make the string vary from empty to much longer than the rest */
+    const size_t len = (iter % 4 == 0) ? 0 : ddsrt_prng_random (&prng) % 10000;
+    ddsrt_free (s.source);
+    s.source = ddsrt_malloc (len + 1);
+    memset (s.source, 'x', len);
+    s.source[len] = 0;
+
+    const uint32_t size = dds_stream_getsize_sample (&s, &tp);
+    /* a stream allocated in 4kB steps, unlike a serdata, so set the size
+       directly */
+    os.m_buffer = ddsrt_malloc (128); os.m_size = 128; os.m_index = 0;
+    dds_stream_write_sample (&os, &s, &tp);
+    CU_ASSERT_FATAL (os.m_index == size);
+    if (os.m_size != 128)
+      grown_default++;
+    dds_ostream_fini (&os);
+
+    os.m_buffer = ddsrt_malloc (size); os.m_size = size; os.m_index = 0;
+    dds_stream_write_sample (&os, &s, &tp);
+    CU_ASSERT_FATAL (os.m_index == size);
+    if (os.m_size != size)
+      grown_exact++;
+    dds_ostream_fini (&os);
+    fini_sample (&s);
+  }
+  printf ("getsize: %"PRIu32" writes, of which reallocating: initial size 128 %"PRIu32", computed size %"PRIu32"\n", n, grown_default, grown_exact);
+  CU_ASSERT_FATAL (grown_exact == 0);
+}
+
+static void bench (const char *what, const struct ddsi_sertopic_default *tp, const Telemetry *s, uint32_t n)
+{
+  dds_ostream_t os;
+  dds_istream_t is;
+  Telemetry r;
+  dds_time_t t0, t1, t2, t3;
+  memset (&r, 0, sizeof (r));
+  dds_ostream_init (&os, 0);
+
+  t0 = dds_time ();
+  for (uint32_t i = 0; i < n; i++)
+  {
+    os.m_index = 0;
+    dds_stream_write_sample (&os, s, tp);
+  }
+  t1 = dds_time ();
+  for (uint32_t i = 0; i < n; i++)
+  {
+    CU_ASSERT_FATAL (dds_stream_normalize (os.m_buffer, os.m_index, false, tp, false));
+  }
+  t2 = dds_time ();
+  for (uint32_t i = 0; i < n; i++)
+  {
+    is.m_buffer = os.m_buffer; is.m_size = os.m_index; is.m_index = 0;
+    dds_stream_read_sample (&is, &r, tp);
+  }
+  t3 = dds_time ();
+
+  printf ("cdrstream %s: %"PRIu32" bytes write %.1f ns normalize %.1f ns read %.1f ns\n", what, os.m_index,
+          (double) (t1 - t0) / n, (double) (t2 - t1) / n, (double) (t3 - t2) / n);
+  fini_sample (&r);
+  dds_ostream_fini (&os);
+}
+
+CU_Test(ddsi_cdrstream, bench, .timeout = 60)
+{
+  struct ddsi_sertopic_default tpi, tpg;
+  ddsrt_prng_t prng;
+  Telemetry s;
+  init_topic (&tpi, false);
+  init_topic (&tpg, true);
+  ddsrt_prng_init_simple (&prng, 1);
+  init_sample (&s, &prng);
+  bench ("interpreted", &tpi, &s, 200000);
+  bench ("generated", &tpg, &s, 200000);
+  fini_sample (&s);
+}
+
+/* Types for checking the memcpy fast path, the ops are flattened the way
+   idlc generates them, i.e., with nested structs inlined */
+struct flat { uint32_t seq; uint32_t keyval; uint8_t baggage[24]; };
+struct padmid { uint8_t a; uint32_t b; };
+struct padend { uint32_t a; uint8_t b; };
+struct inner1 { uint8_t b; uint32_t c; };
+struct nested1 { uint8_t a; struct inner1 in; };
+struct inner2 { uint32_t b; uint8_t c; };
+struct nested2 { uint32_t a; struct inner2 in; uint8_t d; };
+struct nested3 { uint32_t a; struct padmid in; uint16_t d[3]; };
+struct elem1 { uint32_t x; uint16_t y; };
+struct arrstu1 { uint32_t a; struct elem1 e[3]; };
+struct elem2 { uint32_t x; uint32_t y; };
+struct arrstu2 { uint8_t a; struct elem2 e[3]; uint8_t z; };
+struct dbl { uint8_t a; double d; };
+
+static const uint32_t flat_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct flat, seq),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_KEY, offsetof (struct flat, keyval),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_1BY, offsetof (struct flat, baggage), 24,
+  DDS_OP_RTS
+};
+static const uint32_t padmid_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct padmid, a),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct padmid, b),
+  DDS_OP_RTS
+};
+static const uint32_t padend_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct padend, a),
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct padend, b),
+  DDS_OP_RTS
+};
+static const uint32_t nested1_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct nested1, a),
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct nested1, in.b),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct nested1, in.c),
+  DDS_OP_RTS
+};
+static const uint32_t nested2_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct nested2, a),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct nested2, in.b),
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct nested2, in.c),
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct nested2, d),
+  DDS_OP_RTS
+};
+static const uint32_t nested3_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct nested3, a),
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct nested3, in.a),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct nested3, in.b),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_2BY, offsetof (struct nested3, d), 3,
+  DDS_OP_RTS
+};
+static const uint32_t arrstu1_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct arrstu1, a),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_STU, offsetof (struct arrstu1, e), 3, (10u << 16) + 5u, sizeof (struct elem1),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct elem1, x),
+  DDS_OP_ADR | DDS_OP_TYPE_2BY, offsetof (struct elem1, y),
+  DDS_OP_RTS,
+  DDS_OP_RTS
+};
+static const uint32_t arrstu2_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct arrstu2, a),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_STU, offsetof (struct arrstu2, e), 3, (10u << 16) + 5u, sizeof (struct elem2),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct elem2, x),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct elem2, y),
+  DDS_OP_RTS,
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct arrstu2, z),
+  DDS_OP_RTS
+};
+static const uint32_t dbl_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (struct dbl, a),
+  DDS_OP_ADR | DDS_OP_TYPE_8BY | DDS_OP_FLAG_FP, offsetof (struct dbl, d),
+  DDS_OP_RTS
+};
+
+static void init_pod_topic (struct ddsi_sertopic_default *tp, const uint32_t *ops, uint32_t size, uint32_t align)
+{
+  memset (tp, 0, sizeof (*tp));
+  tp->type.m_size = size;
+  tp->type.m_align = align;
+  tp->type.m_flagset = DDS_TOPIC_NO_OPTIMIZE;
+  tp->type.m_ops = (uint32_t *) ops;
+  tp->type.m_nops = dds_stream_countops (ops);
+  tp->opt_size = dds_stream_check_optimize (&tp->type);
+}
+
+/* C99 has no _Alignof, but this gives the same */
+#define POD_ALIGNOF(t) offsetof (struct { char c; struct t x; }, x)
+#define POD_TOPIC(tp, t) init_pod_topic ((tp), t##_ops, (uint32_t) sizeof (struct t), (uint32_t) POD_ALIGNOF (t))
+
+static void check_pod (const char *name, const struct ddsi_sertopic_default *tp, size_t expected)
+{
+  struct ddsi_sertopic_default tpi = *tp;
+  const uint32_t size = tp->type.m_size;
+  unsigned char *sample = ddsrt_malloc (size), *ri = ddsrt_malloc (size), *ro = ddsrt_malloc (size);
+  dds_ostream_t osi, oso;
+  dds_istream_t is;
+  printf ("%s: size %"PRIu32" opt_size %"PRIuSIZE" expected %"PRIuSIZE"\n", name, size, tp->opt_size, expected);
+  CU_ASSERT_FATAL (tp->opt_size == expected);
+
+  /* the interpreter defines the correct result, the memcpy path must give the
+     same representation and validate the same way; padding in memory ends up
+     in the CDR with the memcpy path, so start from a sample with zero padding
+     obtained by reading it with the interpreter */
+  tpi.opt_size = 0;
+  for (uint32_t i = 0; i < size; i++)
+    sample[i] = (unsigned char) (i + 1);
+  dds_ostream_init (&osi, 0);
+  dds_ostream_init (&oso, 0);
+  dds_stream_write_sample (&osi, sample, &tpi);
+  memset (ri, 0, size);
+  is.m_buffer = osi.m_buffer; is.m_size = osi.m_index; is.m_index = 0;
+  dds_stream_read_sample (&is, ri, &tpi);
+  CU_ASSERT_FATAL (is.m_index == osi.m_index);
+  dds_stream_write_sample (&oso, ri, tp);
+  CU_ASSERT_FATAL (oso.m_index == osi.m_index);
+  CU_ASSERT_FATAL (memcmp (osi.m_buffer, oso.m_buffer, osi.m_index) == 0);
+  for (uint32_t sz = 0; sz <= osi.m_index; sz++)
+    CU_ASSERT_FATAL (dds_stream_normalize (osi.m_buffer, sz, false, &tpi, false) == dds_stream_normalize (osi.m_buffer, sz, false, tp, false));
+
+  CU_ASSERT_FATAL (dds_stream_getsize_sample (ri, &tpi) == osi.m_index);
+  CU_ASSERT_FATAL (dds_stream_getsize_sample (ri, tp) == osi.m_index);
+
+  memset (ro, 0, size);
+  is.m_buffer = osi.m_buffer; is.m_size = osi.m_index; is.m_index = 0;
+  dds_stream_read_sample (&is, ro, tp);
+  CU_ASSERT_FATAL (is.m_index == osi.m_index);
+  CU_ASSERT_FATAL (memcmp (ri, ro, size) == 0);
+
+  dds_ostream_fini (&osi);
+  dds_ostream_fini (&oso);
+  ddsrt_free (sample);
+  ddsrt_free (ri);
+  ddsrt_free (ro);
+}
+
+CU_Test(ddsi_cdrstream, optimize_layout)
+{
+  struct ddsi_sertopic_default tp;
+  POD_TOPIC (&tp, flat);    check_pod ("flat", &tp, 32);
+  POD_TOPIC (&tp, padmid);  check_pod ("padmid", &tp, 8);
+  POD_TOPIC (&tp, padend);  check_pod ("padend", &tp, 5);
+  /* nested struct aligned more strictly than its first member: padding in
+     memory that CDR doesn't have */
+  POD_TOPIC (&tp, nested1); check_pod ("nested1", &tp, 0);
+  /* trailing padding of a nested struct is not trailing padding of the whole */
+  POD_TOPIC (&tp, nested2); check_pod ("nested2", &tp, 0);
+  POD_TOPIC (&tp, nested3); check_pod ("nested3", &tp, 18);
+  /* elements of arrays of structs may not have trailing padding */
+  POD_TOPIC (&tp, arrstu1); check_pod ("arrstu1", &tp, 0);
+  POD_TOPIC (&tp, arrstu2); check_pod ("arrstu2", &tp, 29);
+  /* CDR aligns doubles to 8, not all ABIs do that in structs */
+  POD_TOPIC (&tp, dbl);     check_pod ("dbl", &tp, (offsetof (struct dbl, d) == 8) ? 16 : 0);
+}
+
+/* The ddsperf types, unlike idlc, the test doesn't know about the exact
+   size of the baggage, so define them with the fixed sizes */
+struct Keyed32 { uint32_t seq; uint32_t keyval; uint8_t baggage[24]; };
+struct Keyed256 { uint32_t seq; uint32_t keyval; uint8_t baggage[248]; };
+struct Unkeyed1024 { uint32_t seq; uint8_t baggage[1020]; };
+static const uint32_t Keyed32_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct Keyed32, seq),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_KEY, offsetof (struct Keyed32, keyval),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_1BY, offsetof (struct Keyed32, baggage), 24,
+  DDS_OP_RTS
+};
+static const uint32_t Keyed256_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct Keyed256, seq),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_KEY, offsetof (struct Keyed256, keyval),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_1BY, offsetof (struct Keyed256, baggage), 248,
+  DDS_OP_RTS
+};
+static const uint32_t Unkeyed1024_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY, offsetof (struct Unkeyed1024, seq),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_1BY, offsetof (struct Unkeyed1024, baggage), 1020,
+  DDS_OP_RTS
+};
+
+static void bench_pod (const char *name, const struct ddsi_sertopic_default *tp, uint32_t n)
+{
+  struct ddsi_sertopic_default tpi = *tp;
+  const uint32_t size = tp->type.m_size;
+  void *sample = ddsrt_calloc (1, size);
+  dds_ostream_t os;
+  dds_istream_t is;
+  dds_time_t t[2][4];
+  CU_ASSERT_FATAL (tp->opt_size == size);
+  tpi.opt_size = 0;
+  dds_ostream_init (&os, 0);
+  for (int k = 0; k < 2; k++)
+  {
+    const struct ddsi_sertopic_default *x = k ? tp : &tpi;
+    t[k][0] = dds_time ();
+    for (uint32_t i = 0; i < n; i++)
+    {
+      os.m_index = 0;
+      dds_stream_write_sample (&os, sample, x);
+    }
+    t[k][1] = dds_time ();
+    for (uint32_t i = 0; i < n; i++)
+      CU_ASSERT_FATAL (dds_stream_normalize (os.m_buffer, os.m_index, false, x, false));
+    t[k][2] = dds_time ();
+    for (uint32_t i = 0; i < n; i++)
+    {
+      is.m_buffer = os.m_buffer; is.m_size = os.m_index; is.m_index = 0;
+      dds_stream_read_sample (&is, sample, x);
+    }
+    t[k][3] = dds_time ();
+  }
+  printf ("%s (ns, interpreted/memcpy): write %.1f/%.1f normalize %.1f/%.1f read %.1f/%.1f\n", name,
+          (double) (t[0][1] - t[0][0]) / n, (double) (t[1][1] - t[1][0]) / n,
+          (double) (t[0][2] - t[0][1]) / n, (double) (t[1][2] - t[1][1]) / n,
+          (double) (t[0][3] - t[0][2]) / n, (double) (t[1][3] - t[1][2]) / n);
+  dds_ostream_fini (&os);
+  ddsrt_free (sample);
+}
+
+CU_Test(ddsi_cdrstream, bench_optimize, .timeout = 60)
+{
+  struct ddsi_sertopic_default tp;
+  POD_TOPIC (&tp, Keyed32);     bench_pod ("Keyed32", &tp, 1000000);
+  POD_TOPIC (&tp, Keyed256);    bench_pod ("Keyed256", &tp, 1000000);
+  POD_TOPIC (&tp, Unkeyed1024); bench_pod ("Unkeyed1024", &tp, 1000000);
+}
+
+/* struct StrKey { string k; long v; }; #pragma keylist StrKey k */
+struct StrKey { char *k; int32_t v; };
+static const uint32_t StrKey_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_STR | DDS_OP_FLAG_KEY, offsetof (struct StrKey, k),
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_SGN, offsetof (struct StrKey, v),
+  DDS_OP_RTS
+};
+static uint32_t StrKey_keys[] = { 0 };
+
+static void md5_of_string_key (const char *k, unsigned char *md5)
+{
+  /* big-endian CDR of the key: length including terminator, then the string */
+  const uint32_t n = (uint32_t) strlen (k) + 1;
+  unsigned char buf[64];
+  ddsrt_md5_state_t st;
+  assert (n + 4 <= sizeof (buf));
+  buf[0] = (unsigned char) (n >> 24); buf[1] = (unsigned char) (n >> 16);
+  buf[2] = (unsigned char) (n >> 8); buf[3] = (unsigned char) n;
+  memcpy (buf + 4, k, n);
+  ddsrt_md5_init (&st);
+  ddsrt_md5_append (&st, buf, 4 + n);
+  ddsrt_md5_finish (&st, md5);
+}
+
+CU_Test(ddsi_cdrstream, keyhash)
+{
+  /* a key that does not fit in 16 bytes, so the keyhash is the MD5 of the
+     key, whether the serdata is constructed from a sample, a key or data */
+  static const char *keys[] = { "instance-1-with-a-long-name", "instance-2-with-a-long-name" };
+  struct serdatapool *pool = ddsi_serdatapool_new (8192);
+  struct ddsi_sertopic_default tp;
+  struct ddsi_serdata *d[2], *dk[2], *dr[2];
+  memset (&tp, 0, sizeof (tp));
+  tp.c.serdata_ops = &ddsi_serdata_ops_cdr;
+  tp.native_encoding_identifier = DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN ? CDR_LE : CDR_BE;
+  tp.serpool = pool;
+  tp.type.m_size = (uint32_t) sizeof (struct StrKey);
+  tp.type.m_align = (uint32_t) sizeof (char *);
+  tp.type.m_flagset = DDS_TOPIC_NO_OPTIMIZE;
+  tp.type.m_nkeys = 1;
+  tp.type.m_keys = StrKey_keys;
+  tp.type.m_ops = (uint32_t *) StrKey_ops;
+  tp.type.m_nops = dds_stream_countops (tp.type.m_ops);
+  for (int i = 0; i < 2; i++)
+  {
+    struct StrKey s = { .k = (char *) keys[i], .v = i };
+    unsigned char ser[128];
+    d[i] = ddsi_serdata_from_sample (&tp.c, SDK_DATA, &s);
+    dk[i] = ddsi_serdata_from_sample (&tp.c, SDK_KEY, &s);
+    const uint32_t sz = ddsi_serdata_size (d[i]);
+    CU_ASSERT_FATAL (sz <= sizeof (ser));
+    ddsi_serdata_to_ser (d[i], 0, sz, ser);
+    ddsrt_iovec_t iov = { .iov_base = ser, .iov_len = sz };
+    dr[i] = ddsi_serdata_from_ser_iov (&tp.c, SDK_DATA, 1, &iov, sz);
+    CU_ASSERT_FATAL (d[i] != NULL && dk[i] != NULL && dr[i] != NULL);
+  }
+  for (int i = 0; i < 2; i++)
+  {
+    unsigned char md5[16];
+    struct ddsi_keyhash kh;
+    md5_of_string_key (keys[i], md5);
+    struct ddsi_serdata * const xs[] = { d[i], dk[i], dr[i] };
+    for (int j = 0; j < 3; j++)
+    {
+      CU_ASSERT (xs[j]->hash == d[i]->hash);
+      CU_ASSERT (ddsi_serdata_eqkey (xs[j], d[i]));
+      CU_ASSERT (!ddsi_serdata_eqkey (xs[j], d[1 - i]));
+      ddsi_serdata_get_keyhash (xs[j], &kh, false);
+      CU_ASSERT (memcmp (kh.value, md5, 16) == 0);
+      ddsi_serdata_get_keyhash (xs[j], &kh, true);
+      CU_ASSERT (memcmp (kh.value, md5, 16) == 0);
+    }
+  }
+  for (int i = 0; i < 2; i++)
+  {
+    ddsi_serdata_unref (d[i]);
+    ddsi_serdata_unref (dk[i]);
+    ddsi_serdata_unref (dr[i]);
+  }
+  ddsi_serdatapool_free (pool);
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsi/q_radmin.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+
+#define MAX_PRODUCERS 4
+
+/* The delivery thread only needs a domain for its thread state and the
+   (disabled) logging, so a zero-initialized one suffices */
+static struct ddsi_domaingv gv;
+
+struct delivery_state {
+  uint32_t count;
+  uint32_t out_of_order;
+  int64_t latency_sum;
+  int64_t latency_max;
+  seqno_t last_seq[MAX_PRODUCERS];
+  ddsrt_atomic_uint32_t delivered;
+};
+
+struct producer_arg {
+  struct nn_dqueue *q;
+  uint32_t id;
+  uint32_t n;
+  ddsrt_atomic_uint32_t *delivered; /* non-NULL: wait for delivery of each sample */
+  struct nn_rbufpool *rbp;
+};
+
+static int deliver (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, void *qarg)
+{
+  struct delivery_state *st = qarg;
+  const int64_t latency = ddsrt_time_monotonic ().v - sampleinfo->timestamp.v;
+  const uint32_t id = (uint32_t) (sampleinfo->seq >> 32);
+  (void) fragchain; (void) rdguid;
+  assert (id < MAX_PRODUCERS);
+  if (sampleinfo->seq != st->last_seq[id] + 1)
+    st->out_of_order++;
+  st->last_seq[id] = sampleinfo->seq;
+  st->latency_sum += latency;
+  if (latency > st->latency_max)
+    st->latency_max = latency;
+  st->count++;
+  ddsrt_atomic_inc32 (&st->delivered);
+  return 0;
+}
+
+static void enqueue_sample (struct nn_dqueue *q, struct nn_rbufpool *rbp, seqno_t seq)
+{
+  /* A gap-like rdata is enough for the queue, the sampleinfo makes it a data sample */
+  struct nn_rmsg *rmsg = nn_rmsg_new (rbp);
+  CU_ASSERT_FATAL (rmsg != NULL);
+  nn_rmsg_setsize (rmsg, 0);
+  struct nn_rdata *rdata = nn_rdata_newgap (rmsg);
+  struct nn_rsample_info *si = nn_rmsg_alloc (rmsg, sizeof (*si));
+  struct nn_rsample_chain_elem *sce = nn_rmsg_alloc (rmsg, sizeof (*sce));
+  memset (si, 0, sizeof (*si));
+  si->seq = seq;
+  sce->fragchain = rdata;
+  sce->next = NULL;
+  sce->sampleinfo = si;
+  nn_fragchain_adjust_refcount (rdata, 1);
+  struct nn_rsample_chain sc = { sce, sce };
+  si->timestamp.v = ddsrt_time_monotonic ().v;
+  nn_dqueue_enqueue (q, &sc, 1);
+  nn_rmsg_commit (rmsg);
+}
+
+static uint32_t producer (void *varg)
+{
+  struct producer_arg * const arg = varg;
+  struct nn_rbufpool *rbp = arg->rbp;
+  nn_rbufpool_setowner (rbp, ddsrt_thread_self ());
+  for (uint32_t i = 1; i <= arg->n; i++)
+  {
+    enqueue_sample (arg->q, rbp, ((seqno_t) arg->id << 32) + i);
+    if (arg->delivered)
+    {
+      while (ddsrt_atomic_ld32 (arg->delivered) < i)
+        ;
+    }
+  }
+  return 0;
+}
+
+static void set_flag (void *varg)
+{
+  ddsrt_atomic_st32 (varg, 1);
+}
+
+static void wait_for_flag (void *varg)
+{
+  while (!ddsrt_atomic_ld32 (varg))
+    dds_sleepfor (DDS_MSECS (1));
+}
+
+struct chain_state {
+  uint32_t calls;
+  uint32_t count;
+  uint32_t out_of_order;
+  seqno_t last_seq;
+};
+
+static int deliver_not_expected (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, void *qarg)
+{
+  (void) sampleinfo; (void) fragchain; (void) rdguid; (void) qarg;
+  CU_FAIL ("sample delivered individually");
+  return 0;
+}
+
+static void deliver_chain (struct nn_rsample_chain *sc, void *qarg)
+{
+  struct chain_state *st = qarg;
+  st->calls++;
+  while (sc->first)
+  {
+    struct nn_rsample_chain_elem *e = sc->first;
+    sc->first = e->next;
+    if (e->sampleinfo->seq != st->last_seq + 1)
+      st->out_of_order++;
+    st->last_seq = e->sampleinfo->seq;
+    st->count++;
+    nn_fragchain_unref (e->fragchain);
+  }
+}
+
+static void run (const char *what, uint32_t nproducers, uint32_t n, bool wait_for_delivery)
+{
+  struct delivery_state st;
+  struct producer_arg args[MAX_PRODUCERS];
+  ddsrt_thread_t tids[MAX_PRODUCERS];
+  ddsrt_threadattr_t tattr;
+  ddsrt_atomic_uint32_t done = DDSRT_ATOMIC_UINT32_INIT (0);
+  ddsrt_mtime_t t0, t1;
+  memset (&st, 0, sizeof (st));
+  for (uint32_t i = 0; i < MAX_PRODUCERS; i++)
+    st.last_seq[i] = (seqno_t) i << 32;
+  struct nn_dqueue *q = nn_dqueue_new ("bench", &gv, UINT32_MAX, deliver, NULL, &st);
+  CU_ASSERT_FATAL (q != NULL);
+  ddsrt_threadattr_init (&tattr);
+  t0 = ddsrt_time_monotonic ();
+  for (uint32_t i = 0; i < nproducers; i++)
+  {
+    args[i].q = q;
+    args[i].id = i;
+    args[i].n = n;
+    args[i].delivered = wait_for_delivery ? &st.delivered : NULL;
+    args[i].rbp = nn_rbufpool_new (&gv.logconfig, 1048576, 65536);
+    CU_ASSERT_FATAL (ddsrt_thread_create (&tids[i], "prod", &tattr, producer, &args[i]) == DDS_RETCODE_OK);
+  }
+  for (uint32_t i = 0; i < nproducers; i++)
+    (void) ddsrt_thread_join (tids[i], NULL);
+  /* the queue is FIFO, so everything has been delivered when the callback gets invoked */
+  nn_dqueue_enqueue_callback (q, set_flag, &done);
+  while (!ddsrt_atomic_ld32 (&done))
+    dds_sleepfor (DDS_MSECS (1));
+  t1 = ddsrt_time_monotonic ();
+  nn_dqueue_free (q);
+  /* rbufs are freed once all samples in them have been delivered, but the
+     pools must outlive them */
+  for (uint32_t i = 0; i < nproducers; i++)
+    nn_rbufpool_free (args[i].rbp);
+
+  CU_ASSERT (st.count == nproducers * n);
+  CU_ASSERT (st.out_of_order == 0);
+  printf ("dqueue %s %u producers: %.2f Msamples/s latency avg %.2f us max %.1f us\n",
+          what, nproducers, (double) st.count / (double) (t1.v - t0.v) * 1e3,
+          (double) st.latency_sum / st.count / 1e3, (double) st.latency_max / 1e3);
+}
+
+CU_Init(ddsi_dqueue)
+{
+  ddsrt_init ();
+  thread_states_init (16);
+  memset (&gv, 0, sizeof (gv));
+  return 0;
+}
+
+CU_Clean(ddsi_dqueue)
+{
+  thread_states_fini ();
+  ddsrt_fini ();
+  return 0;
+}
+
+CU_Test(ddsi_dqueue, bench_throughput, .timeout = 60)
+{
+  static const uint32_t nproducers[] = { 1, 2, 4 };
+  for (size_t k = 0; k < sizeof (nproducers) / sizeof (nproducers[0]); k++)
+    run ("flood", nproducers[k], 500000, false);
+}
+
+CU_Test(ddsi_dqueue, bench_latency, .timeout = 60)
+{
+  /* one sample at a time, so that the delivery thread goes to sleep in between */
+  run ("ping-pong", 1, 20000, true);
+}
+
+CU_Test(ddsi_dqueue, chain)
+{
+  /* a burst of samples that accumulates while the delivery thread is busy gets
+     handed to the chain handler in one go */
+  struct chain_state st;
+  ddsrt_atomic_uint32_t go = DDSRT_ATOMIC_UINT32_INIT (0);
+  ddsrt_atomic_uint32_t done = DDSRT_ATOMIC_UINT32_INIT (0);
+  memset (&st, 0, sizeof (st));
+  struct nn_dqueue *q = nn_dqueue_new ("chain", &gv, UINT32_MAX, deliver_not_expected, deliver_chain, &st);
+  CU_ASSERT_FATAL (q != NULL);
+  struct nn_rbufpool *rbp = nn_rbufpool_new (&gv.logconfig, 1048576, 65536);
+  nn_rbufpool_setowner (rbp, ddsrt_thread_self ());
+  nn_dqueue_enqueue_callback (q, wait_for_flag, &go);
+  for (seqno_t i = 1; i <= 100; i++)
+    enqueue_sample (q, rbp, i);
+  ddsrt_atomic_st32 (&go, 1);
+  nn_dqueue_enqueue_callback (q, set_flag, &done);
+  while (!ddsrt_atomic_ld32 (&done))
+    dds_sleepfor (DDS_MSECS (1));
+  nn_dqueue_free (q);
+  nn_rbufpool_free (rbp);
+
+  CU_ASSERT (st.calls == 1);
+  CU_ASSERT (st.count == 100);
+  CU_ASSERT (st.out_of_order == 0);
+}
+
+static uint32_t set_flag_later (void *varg)
+{
+  dds_sleepfor (DDS_MSECS (100));
+  set_flag (varg);
+  return 0;
+}
+
+CU_Test(ddsi_dqueue, stats)
+{
+  struct delivery_state st;
+  struct nn_dqueue_stats qst;
+  ddsrt_atomic_uint32_t go = DDSRT_ATOMIC_UINT32_INIT (0);
+  ddsrt_thread_t tid;
+  ddsrt_threadattr_t tattr;
+  memset (&st, 0, sizeof (st));
+  struct nn_dqueue *q = nn_dqueue_new ("stats", &gv, 4, deliver, NULL, &st);
+  CU_ASSERT_FATAL (q != NULL);
+  struct nn_rbufpool *rbp = nn_rbufpool_new (&gv.logconfig, 1048576, 65536);
+  nn_rbufpool_setowner (rbp, ddsrt_thread_self ());
+
+  nn_dqueue_get_stats (q, &qst);
+  CU_ASSERT (strcmp (qst.name, "stats") == 0);
+  CU_ASSERT (qst.max_samples == 4);
+  CU_ASSERT (qst.nof_samples == 0 && qst.max_nof_samples == 0);
+  CU_ASSERT (qst.nof_full == 0 && qst.nof_throttled == 0);
+
+  /* with the delivery thread blocked, the samples pile up in the queue */
+  nn_dqueue_enqueue_callback (q, wait_for_flag, &go);
+  CU_ASSERT (!nn_dqueue_is_full (q));
+  for (seqno_t i = 1; i <= 5; i++)
+    enqueue_sample (q, rbp, i);
+  CU_ASSERT (nn_dqueue_is_full (q));
+  nn_dqueue_get_stats (q, &qst);
+  CU_ASSERT (qst.nof_samples >= 5);
+  CU_ASSERT (qst.max_nof_samples >= qst.nof_samples);
+  CU_ASSERT (qst.nof_full == 1 && qst.nof_throttled == 0);
+
+  /* a full queue throttles the receive thread until it has drained */
+  ddsrt_threadattr_init (&tattr);
+  CU_ASSERT_FATAL (ddsrt_thread_create (&tid, "go", &tattr, set_flag_later, &go) == DDS_RETCODE_OK);
+  nn_dqueue_wait_until_empty_if_full (q);
+  (void) ddsrt_thread_join (tid, NULL);
+  CU_ASSERT (st.count == 5);
+  nn_dqueue_get_stats (q, &qst);
+  CU_ASSERT (qst.nof_samples == 0);
+  CU_ASSERT (qst.max_nof_samples >= 5);
+  CU_ASSERT (qst.nof_full == 1 && qst.nof_throttled == 1);
+
+  /* once empty, it no longer does */
+  nn_dqueue_wait_until_empty_if_full (q);
+  CU_ASSERT (!nn_dqueue_is_full (q));
+  nn_dqueue_get_stats (q, &qst);
+  CU_ASSERT (qst.nof_full == 1 && qst.nof_throttled == 1);
+
+  nn_dqueue_free (q);
+  nn_rbufpool_free (rbp);
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_gc.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_lwregs.h"
+
+/* The table only needs a domain for the garbage collector, so a zero-initialized
+   one suffices */
+static struct ddsi_domaingv gv;
+static struct ddsi_lwregs *regs;
+
+CU_Init(ddsi_lwregs)
+{
+  ddsrt_init ();
+  thread_states_init (16);
+  memset (&gv, 0, sizeof (gv));
+  gv.gcreq_queue = gcreq_queue_new (&gv);
+  regs = ddsi_lwregs_new (&gv);
+  thread_state_awake (lookup_thread_state (), &gv);
+  return 0;
+}
+
+CU_Clean(ddsi_lwregs)
+{
+  thread_state_asleep (lookup_thread_state ());
+  gcreq_queue_free (gv.gcreq_queue);
+  ddsi_lwregs_free (regs);
+  thread_states_fini ();
+  ddsrt_fini ();
+  return 0;
+}
+
+CU_Test(ddsi_lwregs, add_delete)
+{
+  /* enough slots to need more than one entry per <instance,writer> */
+  uint32_t slots[40];
+  for (uint32_t i = 0; i < 40; i++)
+  {
+    slots[i] = ddsi_lwregs_alloc_slot (regs);
+    CU_ASSERT_FATAL (slots[i] == i);
+  }
+
+  for (uint32_t i = 0; i < 40; i += 3)
+  {
+    CU_ASSERT (ddsi_lwregs_add (regs, slots[i], 1, 2) == 1);
+    CU_ASSERT (ddsi_lwregs_add (regs, slots[i], 1, 2) == 0);
+  }
+  for (uint32_t i = 0; i < 40; i++)
+  {
+    CU_ASSERT (ddsi_lwregs_contains (regs, slots[i], 1, 2) == (i % 3 == 0));
+    CU_ASSERT (!ddsi_lwregs_contains (regs, slots[i], 2, 1));
+  }
+  for (uint32_t i = 0; i < 40; i++)
+  {
+    CU_ASSERT (ddsi_lwregs_delete (regs, slots[i], 1, 2) == (i % 3 == 0));
+    CU_ASSERT (!ddsi_lwregs_contains (regs, slots[i], 1, 2));
+  }
+
+  /* once all registrations are gone, the entry is gone, and adding must create a new one */
+  CU_ASSERT (ddsi_lwregs_add (regs, slots[5], 1, 2) == 1);
+  CU_ASSERT (ddsi_lwregs_contains (regs, slots[5], 1, 2));
+  CU_ASSERT (!ddsi_lwregs_contains (regs, slots[4], 1, 2));
+  CU_ASSERT (ddsi_lwregs_delete (regs, slots[5], 1, 2) == 1);
+
+  for (uint32_t i = 0; i < 40; i++)
+    ddsi_lwregs_free_slot (regs, slots[i], 0);
+}
+
+CU_Test(ddsi_lwregs, free_slot)
+{
+  const uint32_t a = ddsi_lwregs_alloc_slot (regs);
+  const uint32_t b = ddsi_lwregs_alloc_slot (regs);
+  for (uint64_t iid = 1; iid <= 100; iid++)
+  {
+    CU_ASSERT (ddsi_lwregs_add (regs, a, iid, 1000) == 1);
+    if (iid % 2)
+      CU_ASSERT (ddsi_lwregs_add (regs, b, iid, 1000) == 1);
+  }
+
+  /* freeing a slot drops its registrations without affecting the others, and a
+     reused slot starts out without any registrations */
+  ddsi_lwregs_free_slot (regs, a, 100);
+  const uint32_t c = ddsi_lwregs_alloc_slot (regs);
+  CU_ASSERT_FATAL (c == a);
+  for (uint64_t iid = 1; iid <= 100; iid++)
+  {
+    CU_ASSERT (!ddsi_lwregs_contains (regs, c, iid, 1000));
+    CU_ASSERT (ddsi_lwregs_contains (regs, b, iid, 1000) == (iid % 2));
+  }
+  ddsi_lwregs_free_slot (regs, b, 50);
+  ddsi_lwregs_free_slot (regs, c, 0);
+}
+
+/* Registrations of 100 writers for 1000 instances in 50 readers, both in the shared
+   table and in a private table per reader like the RHC used to have.  A sample gets
+   delivered to all readers in turn, hence the readers in the inner loop. */
+#define BENCH_NWRITERS 100
+#define BENCH_NREADERS 50
+#define BENCH_NINSTANCES 1000
+
+struct lwreg { uint64_t iid, wr_iid; };
+
+static uint32_t lwreg_hash (const void *vl)
+{
+  const struct lwreg *l = vl;
+  return (uint32_t) (l->iid ^ l->wr_iid);
+}
+
+static int lwreg_equals (const void *va, const void *vb)
+{
+  const struct lwreg *a = va, *b = vb;
+  return a->iid == b->iid && a->wr_iid == b->wr_iid;
+}
+
+static uint64_t bench_iid (uint32_t i) { return (i + 1) * UINT64_C (0x9e3779b97f4a7c15); }
+static uint64_t bench_wr_iid (uint32_t i) { return (i + 1) * UINT64_C (0xc2b2ae3d27d4eb4f); }
+
+CU_Test(ddsi_lwregs, bench, .timeout = 300)
+{
+  uint32_t slots[BENCH_NREADERS];
+  struct ddsrt_ehh *ehh[BENCH_NREADERS];
+  for (uint32_t r = 0; r < BENCH_NREADERS; r++)
+  {
+    slots[r] = ddsi_lwregs_alloc_slot (regs);
+    ehh[r] = ddsrt_ehh_new (sizeof (struct lwreg), 1, lwreg_hash, lwreg_equals);
+  }
+
+  for (int shared = 1; shared >= 0; shared--)
+  {
+    uint32_t n = 0;
+    dds_time_t t0 = dds_time ();
+    for (uint32_t i = 0; i < BENCH_NINSTANCES; i++)
+      for (uint32_t w = 0; w < BENCH_NWRITERS; w++)
+        for (uint32_t r = 0; r < BENCH_NREADERS; r++)
+        {
+          struct lwreg l = { bench_iid (i), bench_wr_iid (w) };
+          n += (uint32_t) (shared ? ddsi_lwregs_add (regs, slots[r], l.iid, l.wr_iid) : ddsrt_ehh_add (ehh[r], &l));
+        }
+    dds_time_t t1 = dds_time ();
+    CU_ASSERT (n == BENCH_NREADERS * BENCH_NINSTANCES * BENCH_NWRITERS);
+    for (uint32_t i = 0; i < BENCH_NINSTANCES; i++)
+      for (uint32_t w = 0; w < BENCH_NWRITERS; w++)
+        for (uint32_t r = 0; r < BENCH_NREADERS; r++)
+        {
+          struct lwreg l = { bench_iid (i), bench_wr_iid (w) };
+          n -= (uint32_t) (shared ? ddsi_lwregs_contains (regs, slots[r], l.iid, l.wr_iid) : (ddsrt_ehh_lookup (ehh[r], &l) != NULL));
+        }
+    dds_time_t t2 = dds_time ();
+    CU_ASSERT (n == 0);
+    for (uint32_t i = 0; i < BENCH_NINSTANCES; i++)
+      for (uint32_t w = 0; w < BENCH_NWRITERS; w++)
+        for (uint32_t r = 0; r < BENCH_NREADERS; r++)
+        {
+          struct lwreg l = { bench_iid (i), bench_wr_iid (w) };
+          n += (uint32_t) (shared ? ddsi_lwregs_delete (regs, slots[r], l.iid, l.wr_iid) : ddsrt_ehh_remove (ehh[r], &l));
+        }
+    dds_time_t t3 = dds_time ();
+    CU_ASSERT (n == BENCH_NREADERS * BENCH_NINSTANCES * BENCH_NWRITERS);
+    printf ("%s: add %.1f ns contains %.1f ns delete %.1f ns\n", shared ? "shared" : "per-reader",
+            (double) (t1 - t0) / n, (double) (t2 - t1) / n, (double) (t3 - t2) / n);
+  }
+
+  for (uint32_t r = 0; r < BENCH_NREADERS; r++)
+  {
+    ddsi_lwregs_free_slot (regs, slots[r], 0);
+    ddsrt_ehh_free (ehh[r]);
+  }
+}
@@ -10,12 +10,16 @@
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
 
+#include <string.h>
+
 #include "CUnit/Theory.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/endian.h"
 #include "dds/ddsi/ddsi_xqos.h"
 #include "dds/ddsi/ddsi_plist.h"
+#include "dds/ddsi/ddsi_vendor.h"
+#include "dds/ddsi/q_protocol.h"
 
 CU_Test (ddsi_plist, unalias_copy_merge)
 {
@@ -270,3 +274,58 @@ CU_Test (ddsi_plist, unalias_copy_merge)
   ddsi_plist_fini (&p3);
   ddsi_plist_fini (&p4);
 }
+
+CU_Test (ddsi_plist, field_filter)
+{
+  /* { op_index, cmp, value } terms, then the type hash; the first term is a double, 0.5 */
+  static const unsigned char buf[] = {
+    0x19, 0x80, 44, 0, /* PID_CYCLONE_FIELD_FILTER */
+    2, 0, 0, 0,
+    4, 0, 0, 0,  2, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0,  0, 0, 0xe0, 0x3f,
+    8, 0, 0, 0,  5, 0, 0, 0,  0xfe, 0xff, 0xff, 0xff,  0xff, 0xff, 0xff, 0xff,
+    0x78, 0x56, 0x34, 0x12,
+    1, 0, 0, 0 /* PID_SENTINEL */
+  };
+  struct ddsrt_log_cfg logcfg;
+  dds_log_cfg_init (&logcfg, 0, 0, NULL, NULL);
+  ddsi_plist_src_t src = {
+    .protocol_version = { 2, 1 },
+    .vendorid = NN_VENDORID_ECLIPSE,
+    .encoding = PL_CDR_LE,
+    .buf = buf,
+    .bufsz = sizeof (buf),
+    .strict = true,
+    .factory = NULL,
+    .logconfig = &logcfg
+  };
+  ddsi_plist_t p, q;
+  dds_return_t rc;
+  double d;
+
+  rc = ddsi_plist_init_frommsg (&p, NULL, ~(uint64_t)0, ~(uint64_t)0, &src);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (p.present & PP_CYCLONE_FIELD_FILTER);
+  CU_ASSERT (p.field_filter.type_hash == 0x12345678);
+  CU_ASSERT_FATAL (p.field_filter.n == 2);
+  CU_ASSERT (p.field_filter.terms[0].op_index == 4 && p.field_filter.terms[0].cmp == 2);
+  memcpy (&d, &p.field_filter.terms[0].value, sizeof (d));
+  CU_ASSERT (d == 0.5);
+  CU_ASSERT (p.field_filter.terms[1].op_index == 8 && p.field_filter.terms[1].cmp == 5);
+  CU_ASSERT (p.field_filter.terms[1].value == -2);
+
+  /* copy must be deep, because the original aliases the message */
+  ddsi_plist_init_empty (&q);
+  ddsi_plist_copy (&q, &p);
+  ddsi_plist_fini (&p);
+  CU_ASSERT (q.field_filter.type_hash == 0x12345678);
+  CU_ASSERT_FATAL (q.field_filter.n == 2);
+  CU_ASSERT (q.field_filter.terms[1].value == -2);
+  ddsi_plist_fini (&q);
+
+  /* other vendors' parameters with this id are ignored */
+  src.vendorid = NN_VENDORID (OCI);
+  rc = ddsi_plist_init_frommsg (&p, NULL, ~(uint64_t)0, ~(uint64_t)0, &src);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  CU_ASSERT (!(p.present & PP_CYCLONE_FIELD_FILTER));
+  ddsi_plist_fini (&p);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/log.h"
+#include "dds/ddsrt/threads.h"
+#include "dds/ddsi/q_radmin.h"
+
+#define MAX_RMSG_SIZE 1024u
+#define RBUF_SIZE 16384u
+
+/* tracing disabled */
+static struct ddsrt_log_cfg logcfg;
+
+static struct nn_rbufpool *new_pool (uint32_t rbuf_size, uint32_t max_rmsg_size)
+{
+  struct nn_rbufpool *rbp = nn_rbufpool_new (&logcfg, rbuf_size, max_rmsg_size);
+  CU_ASSERT_FATAL (rbp != NULL);
+  nn_rbufpool_setowner (rbp, ddsrt_thread_self ());
+  return rbp;
+}
+
+/* Mimics receiving a packet of size bytes into rmsg */
+static void fill (struct nn_rmsg *rmsg, uint32_t size, unsigned char v)
+{
+  memset (NN_RMSG_PAYLOAD (rmsg), v, size);
+  nn_rmsg_setsize (rmsg, size);
+}
+
+static bool check (const struct nn_rmsg *rmsg, uint32_t size, unsigned char v)
+{
+  const unsigned char *p = NN_RMSG_PAYLOAD (rmsg);
+  for (uint32_t i = 0; i < size; i++)
+    if (p[i] != v)
+      return false;
+  return true;
+}
+
+CU_Init(ddsi_radmin)
+{
+  ddsrt_init ();
+  memset (&logcfg, 0, sizeof (logcfg));
+  return 0;
+}
+
+CU_Clean(ddsi_radmin)
+{
+  ddsrt_fini ();
+  return 0;
+}
+
+CU_Test(ddsi_radmin, batch_consecutive)
+{
+  /* all slots of a batch are in the same rbuf, at a fixed stride large
+     enough for a maximum-sized message */
+  struct nn_rbufpool *rbp = new_pool (RBUF_SIZE, MAX_RMSG_SIZE);
+  struct nn_rmsg *rmsgs[8];
+  const uint32_t n = nn_rmsg_new_batch (rbp, 8, rmsgs);
+  CU_ASSERT_FATAL (n == 8);
+  const ptrdiff_t stride = (unsigned char *) rmsgs[1] - (unsigned char *) rmsgs[0];
+  CU_ASSERT (stride >= (ptrdiff_t) (sizeof (struct nn_rmsg) + MAX_RMSG_SIZE));
+  for (uint32_t i = 1; i < n; i++)
+    CU_ASSERT ((unsigned char *) rmsgs[i] - (unsigned char *) rmsgs[i-1] == stride);
+  for (uint32_t i = 0; i < n; i++)
+    fill (rmsgs[i], MAX_RMSG_SIZE, (unsigned char) (i + 1));
+  for (uint32_t i = 0; i < n; i++)
+    nn_rmsg_commit (rmsgs[i]);
+  nn_rbufpool_end_batch (rbp);
+  nn_rbufpool_free (rbp);
+}
+
+CU_Test(ddsi_radmin, batch_alloc_beyond_reservation)
+{
+  /* processing the first message of a batch may allocate new messages and
+     additional chunks, neither may overwrite the messages not yet processed */
+  struct nn_rbufpool *rbp = new_pool (RBUF_SIZE, MAX_RMSG_SIZE);
+  struct nn_rmsg *rmsgs[4];
+  const uint32_t n = nn_rmsg_new_batch (rbp, 4, rmsgs);
+  CU_ASSERT_FATAL (n == 4);
+  for (uint32_t i = 0; i < n; i++)
+    fill (rmsgs[i], MAX_RMSG_SIZE, (unsigned char) (i + 1));
+
+  /* a coalesced datagram gets split into new messages */
+  struct nn_rmsg *split = nn_rmsg_new (rbp);
+  CU_ASSERT_FATAL (split != NULL);
+  CU_ASSERT ((unsigned char *) split >= (unsigned char *) rmsgs[n-1] + sizeof (struct nn_rmsg) + MAX_RMSG_SIZE);
+  fill (split, MAX_RMSG_SIZE, 0xff);
+  nn_rmsg_commit (split);
+
+  /* a full message needs a new chunk for its rdatas */
+  nn_rmsg_ref (rmsgs[0]);
+  void *extra = nn_rmsg_alloc (rmsgs[0], 64);
+  CU_ASSERT_FATAL (extra != NULL);
+  memset (extra, 0xee, 64);
+  CU_ASSERT ((unsigned char *) extra < (unsigned char *) rmsgs[0] || (unsigned char *) extra >= (unsigned char *) rmsgs[n-1] + sizeof (struct nn_rmsg) + MAX_RMSG_SIZE);
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    CU_ASSERT (check (rmsgs[i], MAX_RMSG_SIZE, (unsigned char) (i + 1)));
+    nn_rmsg_commit (rmsgs[i]);
+  }
+  nn_rbufpool_end_batch (rbp);
+  nn_rmsg_unref (rmsgs[0]);
+  nn_rbufpool_free (rbp);
+}
+
+CU_Test(ddsi_radmin, batch_reclaim)
+{
+  struct nn_rbufpool *rbp = new_pool (RBUF_SIZE, MAX_RMSG_SIZE);
+  struct nn_rmsg *rmsgs[4], *rmsg;
+  uint32_t n;
+
+  /* space of messages that are dropped is reused */
+  n = nn_rmsg_new_batch (rbp, 4, rmsgs);
+  CU_ASSERT_FATAL (n == 4);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    fill (rmsgs[i], 100, (unsigned char) (i + 1));
+    nn_rmsg_commit (rmsgs[i]);
+  }
+  nn_rbufpool_end_batch (rbp);
+  rmsg = nn_rmsg_new (rbp);
+  CU_ASSERT (rmsg == rmsgs[0]);
+  nn_rmsg_setsize (rmsg, 100);
+  nn_rmsg_commit (rmsg);
+
+  /* messages that are retained are kept, even if committed out of order,
+     and the space following the last retained one is reused */
+  n = nn_rmsg_new_batch (rbp, 4, rmsgs);
+  CU_ASSERT_FATAL (n == 4);
+  for (uint32_t i = 0; i < n; i++)
+    fill (rmsgs[i], 100, (unsigned char) (i + 1));
+  nn_rmsg_ref (rmsgs[0]);
+  nn_rmsg_ref (rmsgs[2]);
+  for (uint32_t i = n; i > 0; i--)
+    nn_rmsg_commit (rmsgs[i-1]);
+  nn_rbufpool_end_batch (rbp);
+  rmsg = nn_rmsg_new (rbp);
+  CU_ASSERT_FATAL (rmsg != NULL);
+  CU_ASSERT ((unsigned char *) rmsg >= NN_RMSG_PAYLOAD (rmsgs[2]) + 100);
+  CU_ASSERT ((unsigned char *) rmsg <= (unsigned char *) rmsgs[3]);
+  fill (rmsg, MAX_RMSG_SIZE, 0xff);
+  nn_rmsg_commit (rmsg);
+  CU_ASSERT (check (rmsgs[0], 100, 1));
+  CU_ASSERT (check (rmsgs[2], 100, 3));
+  nn_rmsg_unref (rmsgs[0]);
+  nn_rmsg_unref (rmsgs[2]);
+  nn_rbufpool_free (rbp);
+}
+
+CU_Test(ddsi_radmin, batch_new_rbuf)
+{
+  /* retaining everything forces batches to shrink to what is left in the
+     rbuf and then to move on to a new rbuf, while the old one must remain
+     valid until the last message in it is released */
+  struct nn_rbufpool *rbp = new_pool (RBUF_SIZE, MAX_RMSG_SIZE);
+  struct nn_rmsg *kept[64];
+  uint32_t nkept = 0;
+  bool shrunk = false;
+  while (nkept + 8 <= 64)
+  {
+    struct nn_rmsg *rmsgs[8];
+    const uint32_t n = nn_rmsg_new_batch (rbp, 8, rmsgs);
+    CU_ASSERT_FATAL (n > 0 && n <= 8);
+    if (n < 8)
+      shrunk = true;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      fill (rmsgs[i], MAX_RMSG_SIZE, (unsigned char) (nkept + 1));
+      nn_rmsg_ref (rmsgs[i]);
+      nn_rmsg_commit (rmsgs[i]);
+      kept[nkept++] = rmsgs[i];
+    }
+    nn_rbufpool_end_batch (rbp);
+  }
+  CU_ASSERT (shrunk);
+  for (uint32_t i = 0; i < nkept; i++)
+    CU_ASSERT (check (kept[i], MAX_RMSG_SIZE, (unsigned char) (i + 1)));
+  for (uint32_t i = 0; i < nkept; i++)
+    nn_rmsg_unref (kept[i]);
+  nn_rbufpool_free (rbp);
+}
+
+CU_Test(ddsi_radmin, batch_small_rbuf)
+{
+  /* an rbuf that can't hold an aligned slot yields batches of one message
+     that may use all of the rbuf */
+  struct nn_rbufpool *rbp = new_pool (0, MAX_RMSG_SIZE - 1);
+  for (int k = 0; k < 3; k++)
+  {
+    struct nn_rmsg *rmsgs[4];
+    const uint32_t n = nn_rmsg_new_batch (rbp, 4, rmsgs);
+    CU_ASSERT_FATAL (n == 1);
+    fill (rmsgs[0], 1000, (unsigned char) (k + 1));
+    nn_rmsg_ref (rmsgs[0]);
+    nn_rmsg_commit (rmsgs[0]);
+    nn_rbufpool_end_batch (rbp);
+    CU_ASSERT (check (rmsgs[0], 1000, (unsigned char) (k + 1)));
+    nn_rmsg_unref (rmsgs[0]);
+  }
+  nn_rbufpool_free (rbp);
+}
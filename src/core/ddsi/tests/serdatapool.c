@@ -0,0 +1,135 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
+
+/* struct Blob { sequence<octet> data; }; */
+static const uint32_t Blob_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_SEQ | DDS_OP_SUBTYPE_1BY, 0u,
+  DDS_OP_RTS
+};
+
+static void init_topic (struct ddsi_sertopic_default *tp, struct serdatapool *pool)
+{
+  memset (tp, 0, sizeof (*tp));
+  tp->c.serdata_ops = &ddsi_serdata_ops_cdr_nokey;
+  tp->native_encoding_identifier = DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN ? CDR_LE : CDR_BE;
+  tp->serpool = pool;
+  tp->type.m_size = (uint32_t) sizeof (dds_sequence_t);
+  tp->type.m_align = (uint32_t) sizeof (void *);
+  tp->type.m_flagset = DDS_TOPIC_NO_OPTIMIZE;
+  tp->type.m_ops = (uint32_t *) Blob_ops;
+  tp->type.m_nops = dds_stream_countops (tp->type.m_ops);
+}
+
+static struct ddsi_serdata *make (const struct ddsi_sertopic_default *tp, uint32_t size)
+{
+  static unsigned char buf[65536];
+  dds_sequence_t s = { ._maximum = size, ._length = size, ._buffer = buf, ._release = false };
+  return ddsi_serdata_from_sample (&tp->c, SDK_DATA, &s);
+}
+
+CU_Test(ddsi_serdatapool, size_classes)
+{
+  /* 1000 is rounded down to 512, so the classes are 128, 256 and 512 */
+  struct serdatapool *pool = ddsi_serdatapool_new (1000);
+  struct ddsi_sertopic_default tp;
+  struct ddsi_serdata *d[3];
+  init_topic (&tp, pool);
+  CU_ASSERT_FATAL (pool->nclasses == 3);
+  CU_ASSERT_FATAL (pool->max_pooled_size == 512);
+
+  /* everything misses on an empty pool, allocating full-sized classes */
+  d[0] = make (&tp, 10);
+  d[1] = make (&tp, 200);
+  d[2] = make (&tp, 400);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->hits) == 0);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->misses) == 3);
+  CU_ASSERT (((struct ddsi_serdata_default *) d[0])->size == 128);
+  CU_ASSERT (((struct ddsi_serdata_default *) d[1])->size == 256);
+  CU_ASSERT (((struct ddsi_serdata_default *) d[2])->size == 512);
+  for (int i = 0; i < 3; i++)
+    ddsi_serdata_unref (d[i]);
+
+  /* same sizes again: all hits, and each one from its own class */
+  d[0] = make (&tp, 100);
+  d[1] = make (&tp, 129);
+  d[2] = make (&tp, 300);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->hits) == 3);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->misses) == 3);
+  CU_ASSERT (((struct ddsi_serdata_default *) d[0])->size == 128);
+  CU_ASSERT (((struct ddsi_serdata_default *) d[1])->size == 256);
+  CU_ASSERT (((struct ddsi_serdata_default *) d[2])->size == 512);
+
+  /* the 256 and 512 byte classes are now empty */
+  struct ddsi_serdata *x = make (&tp, 250);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->misses) == 4);
+  ddsi_serdata_unref (x);
+
+  /* larger than the largest class: not pooled */
+  x = make (&tp, 4000);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->misses) == 4);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->hits) == 3);
+  ddsi_serdata_unref (x);
+
+  for (int i = 0; i < 3; i++)
+    ddsi_serdata_unref (d[i]);
+  ddsi_serdatapool_free (pool);
+}
+
+CU_Test(ddsi_serdatapool, steady_state)
+{
+  struct serdatapool *pool = ddsi_serdatapool_new (8192);
+  struct ddsi_sertopic_default tp;
+  struct ddsi_serdata *d[64];
+  init_topic (&tp, pool);
+  CU_ASSERT_FATAL (pool->nclasses == 7);
+  /* once warmed up, a mix of sizes never needs to allocate */
+  for (int iter = 0; iter < 10; iter++)
+  {
+    for (uint32_t i = 0; i < 64; i++)
+      d[i] = make (&tp, (i * 131) % 8000);
+    for (uint32_t i = 0; i < 64; i++)
+      ddsi_serdata_unref (d[i]);
+    if (iter == 0)
+      CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->hits) + ddsrt_atomic_ld32 (&pool->misses) == 64);
+  }
+  const uint32_t misses = ddsrt_atomic_ld32 (&pool->misses);
+  CU_ASSERT_FATAL (misses <= 64);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->hits) == 640 - misses);
+  for (uint32_t i = 0; i < 64; i++)
+    d[i] = make (&tp, (i * 131) % 8000);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->misses) == misses);
+  for (uint32_t i = 0; i < 64; i++)
+    ddsi_serdata_unref (d[i]);
+  ddsi_serdatapool_free (pool);
+}
+
+CU_Test(ddsi_serdatapool, disabled)
+{
+  struct serdatapool *pool = ddsi_serdatapool_new (0);
+  struct ddsi_sertopic_default tp;
+  init_topic (&tp, pool);
+  CU_ASSERT_FATAL (pool->nclasses == 0);
+  for (int i = 0; i < 10; i++)
+    ddsi_serdata_unref (make (&tp, 10));
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->hits) == 0);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&pool->misses) == 0);
+  ddsi_serdatapool_free (pool);
+}
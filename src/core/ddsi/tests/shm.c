@@ -0,0 +1,397 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "CUnit/Test.h"
+
+#include "dds/dds.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_gc.h"
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_shm.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+
+/* The transport only needs a domain for its configuration, the (disabled)
+   logging and the garbage collector, so a zero-initialized one suffices */
+static struct ddsi_domaingv gv;
+static ddsi_tran_factory_t fact;
+
+CU_Init(ddsi_shm)
+{
+  ddsrt_init ();
+  thread_states_init (16);
+  memset (&gv, 0, sizeof (gv));
+  gv.gcreq_queue = gcreq_queue_new (&gv);
+  if (gv.gcreq_queue == NULL || ddsi_shm_init (&gv) < 0)
+    return -1;
+  fact = ddsi_factory_find (&gv, "shm");
+  return 0;
+}
+
+CU_Clean(ddsi_shm)
+{
+  gcreq_queue_free (gv.gcreq_queue);
+  gv.gcreq_queue = NULL;
+  ddsi_tran_factories_fini (&gv);
+  thread_states_fini ();
+  ddsrt_fini ();
+  return 0;
+}
+
+static ddsi_tran_conn_t create_conn (enum ddsi_tran_qos_purpose purpose, uint32_t port)
+{
+  const struct ddsi_tran_qos qos = { .m_purpose = purpose, .m_diffserv = 0 };
+  ddsi_tran_conn_t conn;
+  dds_return_t rc = ddsi_factory_create_conn (&conn, fact, port, &qos);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK && conn != NULL);
+  return conn;
+}
+
+static void send_msg (ddsi_tran_conn_t tx, ddsi_tran_conn_t rx, uint32_t seq, size_t len)
+{
+  unsigned char buf[4096];
+  nn_locator_t loc;
+  ddsrt_iovec_t iov[2];
+  assert (len >= sizeof (seq) && len <= sizeof (buf));
+  memcpy (buf, &seq, sizeof (seq));
+  for (size_t i = sizeof (seq); i < len; i++)
+    buf[i] = (unsigned char) (seq + i);
+  /* split over two iovecs like a header and a payload */
+  iov[0].iov_base = buf;
+  iov[0].iov_len = (ddsrt_iov_len_t) sizeof (seq);
+  iov[1].iov_base = buf + sizeof (seq);
+  iov[1].iov_len = (ddsrt_iov_len_t) (len - sizeof (seq));
+  ddsi_conn_locator (rx, &loc);
+  CU_ASSERT (ddsi_conn_write (tx, &loc, 2, iov, 0) == (ssize_t) len);
+}
+
+/* Returns the sequence number in the message, or UINT32_MAX if there is none */
+static uint32_t recv_msg (ddsi_tran_conn_t rx, ddsi_tran_conn_t tx, size_t *len)
+{
+  unsigned char buf[4096];
+  nn_locator_t src;
+  uint32_t seq;
+  ssize_t n = ddsi_conn_read (rx, buf, sizeof (buf), true, &src);
+  CU_ASSERT_FATAL (n >= 0);
+  if (n == 0)
+    return UINT32_MAX;
+  CU_ASSERT_FATAL ((size_t) n >= sizeof (seq));
+  CU_ASSERT (src.kind == NN_LOCATOR_KIND_SHM && src.port == ddsi_conn_port (tx));
+  memcpy (&seq, buf, sizeof (seq));
+  for (size_t i = sizeof (seq); i < (size_t) n; i++)
+    CU_ASSERT_FATAL (buf[i] == (unsigned char) (seq + i));
+  *len = (size_t) n;
+  return seq;
+}
+
+static bool doorbell_rung (ddsi_tran_conn_t rx)
+{
+  struct pollfd pfd = { .fd = ddsi_conn_handle (rx), .events = POLLIN };
+  return poll (&pfd, 1, 0) == 1;
+}
+
+CU_Test(ddsi_shm, put_get_wrap)
+{
+  /* several times round the (128kB) ring with messages of varying sizes, so
+     that the end of the ring is hit at many different offsets */
+  ddsi_tran_conn_t rx = create_conn (DDSI_TRAN_QOS_RECV_UC, 0);
+  ddsi_tran_conn_t tx = create_conn (DDSI_TRAN_QOS_XMIT, 0);
+  uint32_t seq_out = 0, seq_in = 0;
+  size_t len;
+  for (int k = 0; k < 1000; k++)
+  {
+    for (int i = 0; i < 1 + k % 7; i++, seq_out++)
+      send_msg (tx, rx, seq_out, 4 + (seq_out * 37) % 3000);
+    while (seq_in < seq_out)
+    {
+      const uint32_t seq = recv_msg (rx, tx, &len);
+      CU_ASSERT_FATAL (seq == seq_in);
+      CU_ASSERT (len == 4 + (seq * 37) % 3000);
+      seq_in++;
+    }
+    CU_ASSERT (recv_msg (rx, tx, &len) == UINT32_MAX);
+  }
+  ddsi_conn_free (tx);
+  ddsi_conn_free (rx);
+}
+
+CU_Test(ddsi_shm, full)
+{
+  /* messages that don't fit are dropped, the ones that do fit arrive intact
+     and in order */
+  ddsi_tran_conn_t rx = create_conn (DDSI_TRAN_QOS_RECV_UC, 0);
+  ddsi_tran_conn_t tx = create_conn (DDSI_TRAN_QOS_XMIT, 0);
+  uint32_t seq_in = 0, seq;
+  size_t len;
+  for (uint32_t i = 0; i < 100; i++)
+    send_msg (tx, rx, i, 4000);
+  while ((seq = recv_msg (rx, tx, &len)) != UINT32_MAX)
+  {
+    CU_ASSERT_FATAL (seq == seq_in);
+    seq_in++;
+  }
+  CU_ASSERT (seq_in > 0 && seq_in < 100);
+  /* there's room again */
+  send_msg (tx, rx, 100, 4000);
+  CU_ASSERT (recv_msg (rx, tx, &len) == 100);
+  ddsi_conn_free (tx);
+  ddsi_conn_free (rx);
+}
+
+CU_Test(ddsi_shm, doorbell)
+{
+  /* the doorbell only rings if the receiver has found the ring empty, and
+     it stays quiet until the receiver finds it empty again */
+  ddsi_tran_conn_t rx = create_conn (DDSI_TRAN_QOS_RECV_UC, 0);
+  ddsi_tran_conn_t tx = create_conn (DDSI_TRAN_QOS_XMIT, 0);
+  size_t len;
+  CU_ASSERT (!doorbell_rung (rx));
+  send_msg (tx, rx, 1, 100);
+  CU_ASSERT (doorbell_rung (rx));
+  send_msg (tx, rx, 2, 100);
+  CU_ASSERT (recv_msg (rx, tx, &len) == 1);
+  CU_ASSERT (doorbell_rung (rx));
+  CU_ASSERT (recv_msg (rx, tx, &len) == 2);
+  CU_ASSERT (!doorbell_rung (rx));
+  CU_ASSERT (recv_msg (rx, tx, &len) == UINT32_MAX);
+  CU_ASSERT (!doorbell_rung (rx));
+  send_msg (tx, rx, 3, 100);
+  CU_ASSERT (doorbell_rung (rx));
+  CU_ASSERT (recv_msg (rx, tx, &len) == 3);
+  CU_ASSERT (!doorbell_rung (rx));
+  ddsi_conn_free (tx);
+  ddsi_conn_free (rx);
+}
+
+struct blocking_reader_arg {
+  ddsi_tran_conn_t rx, tx;
+  uint32_t n;
+  ddsrt_atomic_uint32_t received;
+};
+
+static uint32_t blocking_reader (void *varg)
+{
+  struct blocking_reader_arg *arg = varg;
+  size_t len;
+  for (uint32_t i = 0; i < arg->n; i++)
+  {
+    /* blocking read: never returns without a message */
+    const uint32_t seq = recv_msg (arg->rx, arg->tx, &len);
+    CU_ASSERT (seq == i);
+    ddsrt_atomic_inc32 (&arg->received);
+  }
+  return 0;
+}
+
+CU_Test(ddsi_shm, sleep_wakeup, .timeout = 30)
+{
+  /* a receive thread that went to sleep on an empty ring gets woken up by
+     each message, whether sent right away or after a while */
+  struct blocking_reader_arg arg;
+  ddsrt_threadattr_t tattr;
+  ddsrt_thread_t tid;
+  arg.rx = create_conn (DDSI_TRAN_QOS_RECV_UC, 0);
+  arg.tx = create_conn (DDSI_TRAN_QOS_XMIT, 0);
+  arg.n = 2000;
+  ddsrt_atomic_st32 (&arg.received, 0);
+  ddsi_conn_disable_multiplexing (arg.rx);
+  ddsrt_threadattr_init (&tattr);
+  CU_ASSERT_FATAL (ddsrt_thread_create (&tid, "shm_rx", &tattr, blocking_reader, &arg) == DDS_RETCODE_OK);
+  for (uint32_t i = 0; i < arg.n; i++)
+  {
+    send_msg (arg.tx, arg.rx, i, 64);
+    if (i % 100 == 0)
+    {
+      /* give it time to go to sleep */
+      const dds_time_t tend = dds_time () + DDS_SECS (5);
+      while (ddsrt_atomic_ld32 (&arg.received) <= i && dds_time () < tend)
+        dds_sleepfor (DDS_MSECS (1));
+      dds_sleepfor (DDS_MSECS (10));
+      CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&arg.received) == i + 1);
+    }
+  }
+  CU_ASSERT_FATAL (ddsrt_thread_join (tid, NULL) == DDS_RETCODE_OK);
+  CU_ASSERT (ddsrt_atomic_ld32 (&arg.received) == arg.n);
+  ddsi_conn_free (arg.tx);
+  ddsi_conn_free (arg.rx);
+}
+
+CU_Test(ddsi_shm, peer_gone)
+{
+  /* a receiver that went away is noticed and a new one on the same port gets
+     the messages */
+  ddsi_tran_conn_t rx = create_conn (DDSI_TRAN_QOS_RECV_UC, 0);
+  ddsi_tran_conn_t tx = create_conn (DDSI_TRAN_QOS_XMIT, 0);
+  const uint32_t port = ddsi_conn_port (rx);
+  nn_locator_t loc;
+  size_t len;
+  send_msg (tx, rx, 1, 100);
+  CU_ASSERT (recv_msg (rx, tx, &len) == 1);
+  ddsi_conn_locator (rx, &loc);
+  ddsi_conn_free (rx);
+
+  /* sending to nobody: silently dropped */
+  ddsrt_iovec_t iov = { .iov_base = &len, .iov_len = sizeof (len) };
+  CU_ASSERT (ddsi_conn_write (tx, &loc, 1, &iov, 0) == (ssize_t) sizeof (len));
+
+  rx = create_conn (DDSI_TRAN_QOS_RECV_UC, port);
+  send_msg (tx, rx, 2, 100);
+  CU_ASSERT (recv_msg (rx, tx, &len) == 2);
+  ddsi_conn_free (tx);
+  ddsi_conn_free (rx);
+}
+
+CU_Test(ddsi_shm, peer_revalidated, .timeout = 10)
+{
+  /* a receiver that crashed doesn't get to mark its ring as closed, then a
+     new one may have taken over the port, and the sender has to find out by
+     checking whether the ring it has mapped is still the one with that name */
+  ddsi_tran_conn_t rx = create_conn (DDSI_TRAN_QOS_RECV_UC, 0);
+  ddsi_tran_conn_t tx = create_conn (DDSI_TRAN_QOS_XMIT, 0);
+  const uint32_t port = ddsi_conn_port (rx);
+  char name[64];
+  size_t len;
+  send_msg (tx, rx, 1, 100);
+  CU_ASSERT (recv_msg (rx, tx, &len) == 1);
+
+  /* what a new receiver does when it finds a stale ring */
+  (void) snprintf (name, sizeof (name), "/cyclonedds.%u.%"PRIu32, (unsigned) getuid (), port);
+  CU_ASSERT_FATAL (shm_unlink (name) == 0);
+  ddsi_tran_conn_t rx2 = create_conn (DDSI_TRAN_QOS_RECV_UC, port);
+
+  /* once the check is due, messages go to the new ring */
+  const dds_time_t tend = dds_time () + DDS_SECS (5);
+  uint32_t seq = 2, old = 0, seq_rx2;
+  do {
+    send_msg (tx, rx2, seq, 100);
+    if (recv_msg (rx, tx, &len) == seq)
+      old++;
+    seq_rx2 = recv_msg (rx2, tx, &len);
+    seq++;
+    dds_sleepfor (DDS_MSECS (50));
+  } while (seq_rx2 == UINT32_MAX && dds_time () < tend);
+  CU_ASSERT (seq_rx2 == seq - 1);
+  CU_ASSERT (old == seq - 3);
+  send_msg (tx, rx2, seq, 100);
+  CU_ASSERT (recv_msg (rx2, tx, &len) == seq);
+  CU_ASSERT (recv_msg (rx, tx, &len) == UINT32_MAX);
+
+  /* releasing the old one removes the name, so release the new one first */
+  ddsi_conn_free (tx);
+  ddsi_conn_free (rx2);
+  ddsi_conn_free (rx);
+}
+
+typedef struct ShmMsg {
+  int32_t seq;
+  char *text;
+} ShmMsg;
+
+static const dds_key_descriptor_t ShmMsg_keys[] = { { "seq", 0 } };
+static const uint32_t ShmMsg_ops[] = {
+  DDS_OP_ADR | DDS_OP_TYPE_4BY | DDS_OP_FLAG_SGN | DDS_OP_FLAG_KEY, offsetof (ShmMsg, seq),
+  DDS_OP_ADR | DDS_OP_TYPE_STR, offsetof (ShmMsg, text),
+  DDS_OP_RTS
+};
+static const dds_topic_descriptor_t ShmMsg_desc = {
+  sizeof (ShmMsg), sizeof (char *), DDS_TOPIC_FIXED_KEY | DDS_TOPIC_NO_OPTIMIZE, 1, "ShmMsg", ShmMsg_keys, 3, ShmMsg_ops, "", NULL
+};
+
+CU_Test(ddsi_shm_pubsub, roundtrip, .timeout = 30)
+{
+  /* two domains in one process with the same external domain id behave as
+     two processes on one host */
+  const char *config =
+    "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}"
+    "<General><Transport>shm</Transport></General>"
+    "<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>";
+  char *conf_pub = ddsrt_expand_envvars (config, 0);
+  char *conf_sub = ddsrt_expand_envvars (config, 1);
+  const dds_entity_t dom_pub = dds_create_domain (0, conf_pub);
+  CU_ASSERT_FATAL (dom_pub > 0);
+  const dds_entity_t dom_sub = dds_create_domain (1, conf_sub);
+  CU_ASSERT_FATAL (dom_sub > 0);
+  ddsrt_free (conf_pub);
+  ddsrt_free (conf_sub);
+
+  const dds_entity_t pp_pub = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp_pub > 0);
+  const dds_entity_t pp_sub = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (pp_sub > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t tp_pub = dds_create_topic (pp_pub, &ShmMsg_desc, "ddsi_shm_roundtrip", qos, NULL);
+  CU_ASSERT_FATAL (tp_pub > 0);
+  const dds_entity_t tp_sub = dds_create_topic (pp_sub, &ShmMsg_desc, "ddsi_shm_roundtrip", qos, NULL);
+  CU_ASSERT_FATAL (tp_sub > 0);
+  const dds_entity_t wr = dds_create_writer (pp_pub, tp_pub, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (pp_sub, tp_sub, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_qos (qos);
+
+  /* discovery goes over the shm transport as well */
+  dds_publication_matched_status_t pm;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    CU_ASSERT_FATAL (dds_get_publication_matched_status (wr, &pm) == DDS_RETCODE_OK);
+    if (pm.current_count == 0)
+      dds_sleepfor (DDS_MSECS (10));
+  } while (pm.current_count == 0 && dds_time () < tend);
+  CU_ASSERT_FATAL (pm.current_count == 1);
+
+  const int32_t n = 100;
+  for (int32_t i = 0; i < n; i++)
+  {
+    char text[32];
+    (void) snprintf (text, sizeof (text), "message %"PRId32, i);
+    ShmMsg msg = { .seq = i, .text = text };
+    CU_ASSERT_FATAL (dds_write (wr, &msg) == DDS_RETCODE_OK);
+  }
+
+  int32_t next = 0;
+  while (next < n && dds_time () < tend)
+  {
+    void *raw[1] = { NULL };
+    dds_sample_info_t si;
+    if (dds_take (rd, raw, &si, 1, 1) <= 0)
+      dds_sleepfor (DDS_MSECS (10));
+    else
+    {
+      const ShmMsg *msg = raw[0];
+      char text[32];
+      CU_ASSERT_FATAL (si.valid_data);
+      (void) snprintf (text, sizeof (text), "message %"PRId32, next);
+      CU_ASSERT (msg->seq == next);
+      CU_ASSERT_STRING_EQUAL (msg->text, text);
+      next++;
+      dds_return_loan (rd, raw, 1);
+    }
+  }
+  CU_ASSERT (next == n);
+
+  dds_delete (dom_pub);
+  dds_delete (dom_sub);
+}
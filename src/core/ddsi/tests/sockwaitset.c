@@ -0,0 +1,202 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/cdtors.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/rusage.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/q_sockwaitset.h"
+
+/* The waitset only needs the socket from a connection, so a connection here
+   is a UDP socket connected to itself, wrapped in a minimal ddsi_tran_conn */
+struct fake_conn {
+  struct ddsi_tran_conn c;
+  ddsrt_socket_t sock;
+};
+
+static ddsrt_socket_t fake_conn_handle (ddsi_tran_base_t base)
+{
+  return ((struct fake_conn *) base)->sock;
+}
+
+static struct fake_conn *fake_conns_new (uint32_t n)
+{
+  struct fake_conn *fcs = ddsrt_malloc (n * sizeof (*fcs));
+  for (uint32_t i = 0; i < n; i++)
+  {
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof (addr);
+    dds_return_t rc;
+    memset (&fcs[i], 0, sizeof (fcs[i]));
+    fcs[i].c.m_base.m_handle_fn = fake_conn_handle;
+    rc = ddsrt_socket (&fcs[i].sock, AF_INET, SOCK_DGRAM, 0);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    rc = ddsrt_bind (fcs[i].sock, (struct sockaddr *) &addr, sizeof (addr));
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+    rc = ddsrt_getsockname (fcs[i].sock, (struct sockaddr *) &addr, &addrlen);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+    rc = ddsrt_connect (fcs[i].sock, (struct sockaddr *) &addr, addrlen);
+    CU_ASSERT_FATAL (rc == DDS_RETCODE_OK);
+  }
+  return fcs;
+}
+
+static void fake_conns_free (struct fake_conn *fcs, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+    ddsrt_close (fcs[i].sock);
+  ddsrt_free (fcs);
+}
+
+static void fake_conn_send (struct fake_conn *fc)
+{
+  const char buf = 0;
+  ssize_t sent;
+  dds_return_t rc = ddsrt_send (fc->sock, &buf, sizeof (buf), 0, &sent);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK && sent == 1);
+}
+
+static void fake_conn_recv (struct fake_conn *fc)
+{
+  char buf;
+  ssize_t rcvd;
+  dds_return_t rc = ddsrt_recv (fc->sock, &buf, sizeof (buf), 0, &rcvd);
+  CU_ASSERT_FATAL (rc == DDS_RETCODE_OK && rcvd == 1);
+}
+
+/* Returns the index of the only event in the next wait, -1 if there is none */
+static int wait_one (os_sockWaitset ws, struct ddsi_tran_conn **conn)
+{
+  os_sockWaitsetCtx ctx;
+  struct ddsi_tran_conn *dummy;
+  int idx;
+  if ((ctx = os_sockWaitsetWait (ws)) == NULL)
+    return -1;
+  idx = os_sockWaitsetNextEvent (ctx, conn);
+  if (idx >= 0)
+    CU_ASSERT (os_sockWaitsetNextEvent (ctx, &dummy) < 0);
+  return idx;
+}
+
+CU_Init(ddsi_sockwaitset)
+{
+  ddsrt_init ();
+  return 0;
+}
+
+CU_Clean(ddsi_sockwaitset)
+{
+  ddsrt_fini ();
+  return 0;
+}
+
+CU_Test(ddsi_sockwaitset, add_remove_purge)
+{
+  const uint32_t n = 5;
+  struct fake_conn *fcs = fake_conns_new (n);
+  struct ddsi_tran_conn *conn;
+  os_sockWaitset ws = os_sockWaitsetNew ();
+  CU_ASSERT_FATAL (ws != NULL);
+  for (uint32_t i = 0; i < n; i++)
+    CU_ASSERT_FATAL (os_sockWaitsetAdd (ws, &fcs[i].c) == 1);
+  CU_ASSERT (os_sockWaitsetAdd (ws, &fcs[2].c) == 0);
+
+  /* indices are in order of addition */
+  for (uint32_t i = 0; i < n; i++)
+  {
+    fake_conn_send (&fcs[i]);
+    CU_ASSERT (wait_one (ws, &conn) == (int) i);
+    CU_ASSERT (conn == &fcs[i].c);
+    fake_conn_recv (&fcs[i]);
+  }
+
+  /* removing one moves the last one into its place */
+  os_sockWaitsetRemove (ws, &fcs[1].c);
+  fake_conn_send (&fcs[4]);
+  CU_ASSERT (wait_one (ws, &conn) == 1);
+  CU_ASSERT (conn == &fcs[4].c);
+  fake_conn_recv (&fcs[4]);
+
+  /* purging keeps the first ones; triggering wakes up without events */
+  os_sockWaitsetPurge (ws, 2);
+  fake_conn_send (&fcs[2]);
+  os_sockWaitsetTrigger (ws);
+  CU_ASSERT (wait_one (ws, &conn) == -1);
+  fake_conn_send (&fcs[0]);
+  CU_ASSERT (wait_one (ws, &conn) == 0);
+  CU_ASSERT (conn == &fcs[0].c);
+  fake_conn_recv (&fcs[0]);
+  fake_conn_recv (&fcs[2]);
+
+  /* re-adding after a purge appends again */
+  CU_ASSERT (os_sockWaitsetAdd (ws, &fcs[3].c) == 1);
+  fake_conn_send (&fcs[3]);
+  CU_ASSERT (wait_one (ws, &conn) == 2);
+  CU_ASSERT (conn == &fcs[3].c);
+  fake_conn_recv (&fcs[3]);
+
+  os_sockWaitsetFree (ws);
+  fake_conns_free (fcs, n);
+}
+
+#define WAKEUP_ITERS 20000
+
+CU_Test(ddsi_sockwaitset, bench_wakeup_cost, .timeout = 60)
+{
+  /* Cost of waking up on a single connection with data as a function of the
+     number of connections in the waitset, as with one socket per participant
+     in ManySocketsMode */
+  static const uint32_t nconns[] = { 1, 10, 50, 100, 250, 500 };
+  for (size_t k = 0; k < sizeof (nconns) / sizeof (nconns[0]); k++)
+  {
+    const uint32_t n = nconns[k];
+    struct fake_conn *fcs = fake_conns_new (n);
+    struct ddsi_tran_conn *conn;
+    ddsrt_rusage_t ru0, ru1;
+    ddsrt_mtime_t t0, t1;
+    os_sockWaitset ws = os_sockWaitsetNew ();
+    CU_ASSERT_FATAL (ws != NULL);
+    for (uint32_t i = 0; i < n; i++)
+      CU_ASSERT_FATAL (os_sockWaitsetAdd (ws, &fcs[i].c) == 1);
+
+    printf ("sockwaitset %u conns:", n);
+    fflush (stdout);
+    ddsrt_getrusage (DDSRT_RUSAGE_THREAD, &ru0);
+    t0 = ddsrt_time_monotonic ();
+    for (uint32_t iter = 0; iter < WAKEUP_ITERS; iter++)
+    {
+      const uint32_t i = (iter * 7919) % n;
+      fake_conn_send (&fcs[i]);
+      if (wait_one (ws, &conn) != (int) i || conn != &fcs[i].c)
+        CU_FAIL_FATAL ("wrong connection\n");
+      fake_conn_recv (&fcs[i]);
+    }
+    t1 = ddsrt_time_monotonic ();
+    ddsrt_getrusage (DDSRT_RUSAGE_THREAD, &ru1);
+    printf (" %.0f ns/wakeup %.0f ns cpu/wakeup\n",
+            (double) (t1.v - t0.v) / WAKEUP_ITERS,
+            (double) ((ru1.utime + ru1.stime) - (ru0.utime + ru0.stime)) / WAKEUP_ITERS);
+
+    os_sockWaitsetFree (ws);
+    fake_conns_free (fcs, n);
+  }
+}
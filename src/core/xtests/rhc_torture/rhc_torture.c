@@ -14,6 +14,7 @@
 #include <assert.h>
 #include <string.h>
 #include <inttypes.h>
+#include <limits.h>
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/process.h"
@@ -28,6 +29,7 @@
 #include "dds/ddsi/q_radmin.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_gc.h"
+#include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/ddsi_serdata.h"
 #include "dds__topic.h"
 #include "dds/ddsc/dds_rhc.h"
@@ -191,7 +193,7 @@ static void fwr (struct proxy_writer *wr)
   free (wr);
 }
 
-static struct dds_rhc *mkrhc (struct ddsi_domaingv *gv, dds_reader *rd, dds_history_kind_t hk, int32_t hdepth, dds_destination_order_kind_t dok)
+static struct dds_rhc *mkrhc (struct ddsi_domaingv *gv, dds_reader *rd, dds_history_kind_t hk, int32_t hdepth, dds_destination_order_kind_t dok, bool xchecks)
 {
   struct dds_rhc *rhc;
   dds_qos_t rqos;
@@ -202,7 +204,7 @@ static struct dds_rhc *mkrhc (struct ddsi_domaingv *gv, dds_reader *rd, dds_hist
   rqos.destination_order.kind = dok;
   ddsi_xqos_mergein_missing (&rqos, &gv->default_xqos_rd, ~(uint64_t)0);
   thread_state_awake_domain_ok (lookup_thread_state ());
-  rhc = dds_rhc_default_new_xchecks (rd, gv, mdtopic, true);
+  rhc = dds_rhc_default_new_xchecks (rd, gv, mdtopic, xchecks);
   dds_rhc_set_qos(rhc, &rqos);
   thread_state_asleep (lookup_thread_state ());
   return rhc;
@@ -488,6 +490,252 @@ static void tkcond (struct dds_rhc *rhc, dds_readcond *cond, const struct check
   rdtkcond (rhc, cond, chk, print, max, buf, dds_rhc_take, states_seen);
 }
 
+static void rdtk_check_seqs (struct dds_rhc *rhc, const char *opname, int (*op) (struct dds_rhc *rhc, bool lock, void **values, dds_sample_info_t *info_seq, uint32_t max_samples, uint32_t mask, dds_instance_handle_t handle, dds_readcond *cond), uint32_t max, uint32_t mask, int n, const int32_t *seqs, bool print)
+{
+  /* the operation must return exactly the samples with attribute x = seqs[0 .. n-1], in that order */
+  const uint32_t maxbuf = (uint32_t) (sizeof (rres_iseq) / sizeof (rres_iseq[0]));
+  if (print)
+    printf ("%s:\n", opname);
+  thread_state_awake_domain_ok (lookup_thread_state ());
+  const int cnt = op (rhc, true, rres_ptrs, rres_iseq, (max == 0 || max > maxbuf) ? maxbuf : max, mask, 0, NULL);
+  thread_state_asleep (lookup_thread_state ());
+  if (print && cnt > 0)
+    print_seq (cnt, rres_iseq, rres_mseq);
+  if (cnt != n)
+  {
+    printf ("%s: got %d samples, expected %d\n", opname, cnt, n);
+    abort ();
+  }
+  for (int i = 0; i < n; i++)
+  {
+    if (!rres_iseq[i].valid_data || rres_mseq[i].x != seqs[i])
+    {
+      printf ("%s: sample %d has x = %"PRId32", expected %"PRId32"\n", opname, i, rres_mseq[i].x, seqs[i]);
+      abort ();
+    }
+  }
+}
+
+static int32_t store_seq (struct ddsi_tkmap *tkmap, struct dds_rhc *rhc, struct proxy_writer *wr, int32_t keyval, bool print)
+{
+  (void) store (tkmap, rhc, wr, mksample (keyval, 0), print, false);
+  return (int32_t) seq;
+}
+
+static void test_ring (struct ddsi_domaingv *gv, bool print)
+{
+  /* the samples of an instance are stored in a ring buffer: check that the order is
+     maintained when overwriting in KEEP_LAST, when removing samples from the oldest end,
+     the newest end and the middle of the ring, and when growing it for KEEP_ALL */
+  const uint32_t any = DDS_ANY_SAMPLE_STATE | DDS_ANY_VIEW_STATE | DDS_ANY_INSTANCE_STATE;
+  const uint32_t read = DDS_READ_SAMPLE_STATE | DDS_ANY_VIEW_STATE | DDS_ANY_INSTANCE_STATE;
+  const uint32_t notread = DDS_NOT_READ_SAMPLE_STATE | DDS_ANY_VIEW_STATE | DDS_ANY_INSTANCE_STATE;
+  struct ddsi_tkmap *tkmap = gv->m_tkmap;
+  struct proxy_writer *wr = mkwr (gv, 0);
+  int32_t s[16];
+
+  struct dds_rhc *rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_LAST, 3, DDS_DESTINATIONORDER_BY_SOURCE_TIMESTAMP, true);
+  for (int i = 1; i <= 5; i++)
+    s[i] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "READ ALL", dds_rhc_read, 0, any, 3, (int32_t[]) { s[3], s[4], s[5] }, print);
+  s[6] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "TAKE NOT_READ", dds_rhc_take, 0, notread, 1, (int32_t[]) { s[6] }, print);
+  s[7] = store_seq (tkmap, rhc, wr, 0, print);
+  s[8] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "READ NOT_READ 1", dds_rhc_read, 1, notread, 1, (int32_t[]) { s[7] }, print);
+  rdtk_check_seqs (rhc, "TAKE READ", dds_rhc_take, 0, read, 2, (int32_t[]) { s[5], s[7] }, print);
+  for (int i = 9; i <= 11; i++)
+    s[i] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "READ ALL", dds_rhc_read, 0, any, 3, (int32_t[]) { s[9], s[10], s[11] }, print);
+  rdtk_check_seqs (rhc, "TAKE ALL", dds_rhc_take, 0, any, 3, (int32_t[]) { s[9], s[10], s[11] }, print);
+  rdtk_check_seqs (rhc, "TAKE ALL", dds_rhc_take, 0, any, 0, NULL, print);
+  for (int i = 12; i <= 14; i++)
+    s[i] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "READ 1", dds_rhc_read, 1, any, 1, (int32_t[]) { s[12] }, print);
+  rdtk_check_seqs (rhc, "TAKE NOT_READ 1", dds_rhc_take, 1, notread, 1, (int32_t[]) { s[13] }, print);
+  s[15] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "READ ALL", dds_rhc_read, 0, any, 3, (int32_t[]) { s[12], s[14], s[15] }, print);
+  s[1] = store_seq (tkmap, rhc, wr, 0, print);
+  rdtk_check_seqs (rhc, "TAKE 2", dds_rhc_take, 2, any, 2, (int32_t[]) { s[14], s[15] }, print);
+  rdtk_check_seqs (rhc, "TAKE ALL", dds_rhc_take, 0, any, 1, (int32_t[]) { s[1] }, print);
+  frhc (rhc);
+
+  /* KEEP_ALL: the ring grows a few times, and after taking the oldest samples, the
+     newer ones wrap around */
+  int32_t ka[120];
+  rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_ALL, 0, DDS_DESTINATIONORDER_BY_SOURCE_TIMESTAMP, true);
+  for (int i = 0; i < 100; i++)
+    ka[i] = store_seq (tkmap, rhc, wr, 1, print);
+  rdtk_check_seqs (rhc, "TAKE 30", dds_rhc_take, 30, any, 30, ka, print);
+  for (int i = 100; i < 120; i++)
+    ka[i] = store_seq (tkmap, rhc, wr, 1, print);
+  rdtk_check_seqs (rhc, "READ ALL", dds_rhc_read, 0, any, 90, ka + 30, print);
+  rdtk_check_seqs (rhc, "TAKE ALL", dds_rhc_take, 0, any, 90, ka + 30, print);
+  frhc (rhc);
+  fwr (wr);
+}
+
+static void bench_rhc (struct ddsi_domaingv *gv, dds_history_kind_t hk, int32_t depth, int count)
+{
+  /* round-robin writes to all N_KEYVALS instances, reading after every "depth" writes to
+     each instance (taking for KEEP_ALL), without any of the consistency checks */
+  const uint32_t any = DDS_ANY_SAMPLE_STATE | DDS_ANY_VIEW_STATE | DDS_ANY_INSTANCE_STATE;
+  const uint32_t maxbuf = (uint32_t) (sizeof (rres_iseq) / sizeof (rres_iseq[0]));
+  const int32_t period = (hk == DDS_HISTORY_KEEP_ALL) ? MAX_HIST_DEPTH : depth;
+  struct dds_rhc *rhc = mkrhc (gv, NULL, hk, depth, DDS_DESTINATIONORDER_BY_RECEPTION_TIMESTAMP, false);
+  struct proxy_writer *wr = mkwr (gv, 0);
+  struct ddsi_serdata *sd[N_KEYVALS];
+  struct ddsi_tkmap_instance *tk[N_KEYVALS];
+  struct ddsi_writer_info wrinfo;
+  int64_t nread = 0;
+  wrinfo.auto_dispose = false;
+  wrinfo.guid = wr->e.guid;
+  wrinfo.iid = wr->e.iid;
+  wrinfo.ownership_strength = 0;
+#ifdef DDSI_INCLUDE_LIFESPAN
+  wrinfo.lifespan_exp = DDSRT_MTIME_NEVER;
+#endif
+  thread_state_awake_domain_ok (lookup_thread_state ());
+  for (int32_t k = 0; k < N_KEYVALS; k++)
+  {
+    sd[k] = mksample (k, 0);
+    tk[k] = ddsi_tkmap_lookup_instance_ref (gv->m_tkmap, sd[k]);
+  }
+  const dds_time_t t0 = dds_time ();
+  for (int i = 0; i < count; i++)
+  {
+    (void) dds_rhc_store (rhc, &wrinfo, sd[i % N_KEYVALS], tk[i % N_KEYVALS]);
+    if ((i + 1) % (N_KEYVALS * period) == 0)
+    {
+      if (hk == DDS_HISTORY_KEEP_ALL)
+        nread += dds_rhc_take (rhc, true, rres_ptrs, rres_iseq, maxbuf, any, 0, NULL);
+      else
+        nread += dds_rhc_read (rhc, true, rres_ptrs, rres_iseq, maxbuf, any, 0, NULL);
+    }
+  }
+  const dds_time_t t1 = dds_time ();
+  for (int32_t k = 0; k < N_KEYVALS; k++)
+  {
+    ddsi_tkmap_instance_unref (gv->m_tkmap, tk[k]);
+    ddsi_serdata_unref (sd[k]);
+  }
+  thread_state_asleep (lookup_thread_state ());
+  printf ("%-9s depth %2"PRId32": %d stores, %"PRId64" samples read in %.3fs: %.0f stores/s\n",
+          (hk == DDS_HISTORY_KEEP_ALL) ? "KEEP_ALL" : "KEEP_LAST", depth, count, nread,
+          (double) (t1 - t0) / 1e9, (double) count * 1e9 / (double) (t1 - t0));
+  frhc (rhc);
+  fwr (wr);
+}
+
+#define MTBENCH_MAX_READERS 8
+#define MTBENCH_MAX_SAMPLES 32
+
+struct mtbench_reader_arg {
+  struct ddsi_domaingv *gv;
+  struct dds_rhc *rhc;
+  ddsrt_atomic_uint32_t *stop;
+  bool take;
+  uint64_t nsamples;
+};
+
+static uint32_t mtbench_reader (void *varg)
+{
+  struct mtbench_reader_arg * const arg = varg;
+  const uint32_t any = DDS_ANY_SAMPLE_STATE | DDS_ANY_VIEW_STATE | DDS_ANY_INSTANCE_STATE;
+  struct thread_state1 * const ts1 = lookup_thread_state ();
+  dds_sample_info_t iseq[MTBENCH_MAX_SAMPLES];
+  RhcTypes_T mseq[MTBENCH_MAX_SAMPLES];
+  void *ptrs[MTBENCH_MAX_SAMPLES];
+  memset (mseq, 0, sizeof (mseq));
+  for (size_t i = 0; i < MTBENCH_MAX_SAMPLES; i++)
+    ptrs[i] = &mseq[i];
+  while (!ddsrt_atomic_ld32 (arg->stop))
+  {
+    thread_state_awake (ts1, arg->gv);
+    const int32_t n = arg->take
+      ? dds_rhc_take (arg->rhc, true, ptrs, iseq, MTBENCH_MAX_SAMPLES, any, 0, NULL)
+      : dds_rhc_read (arg->rhc, true, ptrs, iseq, MTBENCH_MAX_SAMPLES, any, 0, NULL);
+    thread_state_asleep (ts1);
+    if (n > 0)
+      arg->nsamples += (uint32_t) n;
+  }
+  for (size_t i = 0; i < MTBENCH_MAX_SAMPLES; i++)
+    RhcTypes_T_free (&mseq[i], DDS_FREE_CONTENTS);
+  return 0;
+}
+
+static void mtbench_rhc (struct ddsi_domaingv *gv, int nreaders, bool take, int count, double *base_rate)
+{
+  /* one thread storing samples round-robin in N_KEYVALS instances in a KEEP_LAST 8 cache,
+     while nreaders threads concurrently read (or take) from it */
+  struct dds_rhc *rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_LAST, 8, DDS_DESTINATIONORDER_BY_RECEPTION_TIMESTAMP, false);
+  struct proxy_writer *wr = mkwr (gv, 0);
+  struct ddsi_serdata *sd[N_KEYVALS];
+  struct ddsi_tkmap_instance *tk[N_KEYVALS];
+  struct ddsi_writer_info wrinfo;
+  struct thread_state1 *rdthr[MTBENCH_MAX_READERS];
+  struct mtbench_reader_arg rdarg[MTBENCH_MAX_READERS];
+  ddsrt_atomic_uint32_t stop = DDSRT_ATOMIC_UINT32_INIT (0);
+  uint64_t nread = 0;
+  wrinfo.auto_dispose = false;
+  wrinfo.guid = wr->e.guid;
+  wrinfo.iid = wr->e.iid;
+  wrinfo.ownership_strength = 0;
+#ifdef DDSI_INCLUDE_LIFESPAN
+  wrinfo.lifespan_exp = DDSRT_MTIME_NEVER;
+#endif
+  thread_state_awake_domain_ok (lookup_thread_state ());
+  for (int32_t k = 0; k < N_KEYVALS; k++)
+  {
+    sd[k] = mksample (k, 0);
+    tk[k] = ddsi_tkmap_lookup_instance_ref (gv->m_tkmap, sd[k]);
+  }
+  for (int i = 0; i < N_KEYVALS * 8; i++)
+    (void) dds_rhc_store (rhc, &wrinfo, sd[i % N_KEYVALS], tk[i % N_KEYVALS]);
+  thread_state_asleep (lookup_thread_state ());
+
+  for (int i = 0; i < nreaders; i++)
+  {
+    char name[32];
+    rdarg[i].gv = gv;
+    rdarg[i].rhc = rhc;
+    rdarg[i].stop = &stop;
+    rdarg[i].take = take;
+    rdarg[i].nsamples = 0;
+    (void) snprintf (name, sizeof (name), "rd%d", i);
+    if (create_thread (&rdthr[i], gv, name, mtbench_reader, &rdarg[i]) != DDS_RETCODE_OK)
+      abort ();
+  }
+  const dds_time_t t0 = dds_time ();
+  thread_state_awake_domain_ok (lookup_thread_state ());
+  for (int i = 0; i < count; i++)
+    (void) dds_rhc_store (rhc, &wrinfo, sd[i % N_KEYVALS], tk[i % N_KEYVALS]);
+  thread_state_asleep (lookup_thread_state ());
+  const dds_time_t t1 = dds_time ();
+  ddsrt_atomic_st32 (&stop, 1);
+  for (int i = 0; i < nreaders; i++)
+  {
+    (void) join_thread (rdthr[i]);
+    nread += rdarg[i].nsamples;
+  }
+  const double dt = (double) (t1 - t0) / 1e9;
+  const double rate = (double) count / dt;
+  if (nreaders == 0)
+    *base_rate = rate;
+  printf ("%d %s: %d stores in %.3fs: %.0f stores/s (%.2f of 0 readers), %.0f samples %s/s\n",
+          nreaders, take ? "takers" : "readers", count, dt, rate, rate / *base_rate, (double) nread / dt, take ? "taken" : "read");
+
+  thread_state_awake_domain_ok (lookup_thread_state ());
+  for (int32_t k = 0; k < N_KEYVALS; k++)
+  {
+    ddsi_tkmap_instance_unref (gv->m_tkmap, tk[k]);
+    ddsi_serdata_unref (sd[k]);
+  }
+  thread_state_asleep (lookup_thread_state ());
+  frhc (rhc);
+  fwr (wr);
+}
+
 static void wait_gc_cycle_impl (struct gcreq *gcreq)
 {
   ddsrt_mutex_lock (&wait_gc_cycle_lock);
@@ -896,10 +1144,25 @@ int main (int argc, char **argv)
   bool print = false;
   int xchecks = 1;
   int first = 0, count = 10000;
+  bool bench = false, mtbench = false;
 
   ddsrt_mutex_init (&wait_gc_cycle_lock);
   ddsrt_cond_init (&wait_gc_cycle_cond);
 
+  if (argc > 1 && (strcmp (argv[1], "bench") == 0 || strcmp (argv[1], "mtbench") == 0))
+  {
+    /* "bench [count]": no test phases, only the store/read throughput measurements;
+       "mtbench [count]": same, but with 0 .. MTBENCH_MAX_READERS concurrently reading
+       threads and then with 1 .. MTBENCH_MAX_READERS taking threads */
+    if (strcmp (argv[1], "bench") == 0)
+      bench = true;
+    else
+      mtbench = true;
+    first = INT_MAX;
+    xchecks = -1;
+    count = (argc > 2) ? atoi (argv[2]) : 1000000;
+    argc = 1;
+  }
   if (argc > 1)
     seed = (unsigned) atoi (argv[1]);
   if (seed == 0)
@@ -911,7 +1174,7 @@ int main (int argc, char **argv)
   if (argc > 4)
     print = (atoi (argv[4]) != 0);
   if (argc > 5)
-    xchecks = atoi (argv[4]);
+    xchecks = atoi (argv[5]);
 
   printf ("prng seed %u first %d count %d print %d xchecks %d\n", seed, first, count, print, xchecks);
   ddsrt_prng_init_simple (&prng, seed);
@@ -945,7 +1208,7 @@ int main (int argc, char **argv)
     struct ddsi_tkmap *tkmap = gv->m_tkmap;
     if (print)
       printf ("************* 0 *************\n");
-    struct dds_rhc *rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_LAST, 1, DDS_DESTINATIONORDER_BY_SOURCE_TIMESTAMP);
+    struct dds_rhc *rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_LAST, 1, DDS_DESTINATIONORDER_BY_SOURCE_TIMESTAMP, true);
     struct proxy_writer *wr0 = mkwr (gv, 1);
     struct proxy_writer *wr1 = mkwr (gv, 1);
     uint64_t iid0, iid1, iid_t;
@@ -1020,7 +1283,7 @@ int main (int argc, char **argv)
     struct ddsi_tkmap *tkmap = gv->m_tkmap;
     if (print)
       printf ("************* 1 *************\n");
-    struct dds_rhc *rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_LAST, 4, DDS_DESTINATIONORDER_BY_SOURCE_TIMESTAMP);
+    struct dds_rhc *rhc = mkrhc (gv, NULL, DDS_HISTORY_KEEP_LAST, 4, DDS_DESTINATIONORDER_BY_SOURCE_TIMESTAMP, true);
     struct proxy_writer *wr[] = { mkwr (gv, 0), mkwr (gv, 0), mkwr (gv, 0) };
     uint64_t iid0, iid_t;
     int nregs = 3, isreg[] = { 1, 1, 1 };
@@ -1102,6 +1365,31 @@ int main (int argc, char **argv)
       }
   }
 
+  if (5 >= first)
+  {
+    if (print)
+      printf ("************* 5 *************\n");
+    test_ring (get_gv (pp), print);
+  }
+
+  if (bench)
+  {
+    struct ddsi_domaingv *gv = get_gv (pp);
+    bench_rhc (gv, DDS_HISTORY_KEEP_LAST, 1, count);
+    bench_rhc (gv, DDS_HISTORY_KEEP_LAST, 8, count);
+    bench_rhc (gv, DDS_HISTORY_KEEP_LAST, 64, count);
+    bench_rhc (gv, DDS_HISTORY_KEEP_ALL, 0, count);
+  }
+  if (mtbench)
+  {
+    struct ddsi_domaingv *gv = get_gv (pp);
+    double base_rate = 0.0;
+    for (int nreaders = 0; nreaders <= MTBENCH_MAX_READERS; nreaders = (nreaders == 0) ? 1 : 2 * nreaders)
+      mtbench_rhc (gv, nreaders, false, count, &base_rate);
+    for (int nreaders = 1; nreaders <= MTBENCH_MAX_READERS; nreaders *= 2)
+      mtbench_rhc (gv, nreaders, true, count, &base_rate);
+  }
+
   ddsrt_cond_destroy (&wait_gc_cycle_cond);
   ddsrt_mutex_destroy (&wait_gc_cycle_lock);
 
@@ -15,6 +15,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "dds/export.h"
 #include "dds/ddsrt/endian.h"
 
 #if defined (__cplusplus)
@@ -53,6 +54,14 @@ inline int64_t ddsrt_bswap8 (int64_t x)
   return (int64_t) ddsrt_bswap8u ((uint64_t) x);
 }
 
+/* Byte-swap arrays of n 2, 4 or 8-byte elements from src into dst. The source
+   and destination may be the same (in-place swapping), but may not otherwise
+   overlap. Neither needs to be aligned, hence the void pointers. These use SSE2, AVX2 or NEON if the
+   CPU supports it (determined at run-time for AVX2). */
+DDS_EXPORT void ddsrt_bswap2u_array (void *dst, const void *src, size_t n);
+DDS_EXPORT void ddsrt_bswap4u_array (void *dst, const void *src, size_t n);
+DDS_EXPORT void ddsrt_bswap8u_array (void *dst, const void *src, size_t n);
+
 #if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
 #define ddsrt_toBE2(x) ddsrt_bswap2 (x)
 #define ddsrt_toBE2u(x) ddsrt_bswap2u (x)
@@ -94,6 +94,31 @@ ddsrt_sendmsg(
   int flags,
   ssize_t *sent);
 
+#if DDSRT_HAVE_SENDMMSG
+/**
+ * @brief Send vlen datagrams in a single call.
+ *
+ * Each entry in msgvec is an independent datagram, typically the same
+ * payload addressed to different destinations.  Sending stops at the first
+ * datagram that fails, if that is the first one an error is returned.
+ *
+ * @param[in]  sock    Socket to send on
+ * @param[in]  msgvec  Message headers, msg_len is set on return
+ * @param[in]  vlen    Number of entries in msgvec
+ * @param[in]  flags   Flags for the send call
+ * @param[out] nsent   Number of datagrams sent
+ *
+ * @returns DDS_RETCODE_OK on success, an error code otherwise
+ */
+DDS_EXPORT dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  unsigned int vlen,
+  int flags,
+  int *nsent);
+#endif
+
 DDS_EXPORT dds_return_t
 ddsrt_recv(
   ddsrt_socket_t sock,
@@ -109,6 +134,30 @@ ddsrt_recvmsg(
   int flags,
   ssize_t *rcvd);
 
+#if DDSRT_HAVE_RECVMMSG
+/**
+ * @brief Receive up to vlen datagrams in a single call.
+ *
+ * Blocks until at least one datagram is available (unless the socket is
+ * non-blocking), then returns as many as are available without blocking.
+ *
+ * @param[in]  sock    Socket to receive from
+ * @param[in]  msgvec  Message headers to fill, msg_len is set on return
+ * @param[in]  vlen    Number of entries in msgvec
+ * @param[in]  flags   Flags for the receive call
+ * @param[out] nrcvd   Number of datagrams received
+ *
+ * @returns DDS_RETCODE_OK on success, an error code otherwise
+ */
+DDS_EXPORT dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_mmsghdr_t *msgvec,
+  unsigned int vlen,
+  int flags,
+  int *nrcvd);
+#endif
+
 DDS_EXPORT dds_return_t
 ddsrt_getsockopt(
   ddsrt_socket_t sock,
@@ -82,6 +82,34 @@ typedef struct msghdr ddsrt_msghdr_t;
 # define DDSRT_MSGHDR_FLAGS 1
 #endif
 
+#if defined(__linux) && !LWIP_SOCKET
+# define DDSRT_HAVE_RECVMMSG 1
+# define DDSRT_HAVE_SENDMMSG 1
+#else
+# define DDSRT_HAVE_RECVMMSG 0
+# define DDSRT_HAVE_SENDMMSG 0
+#endif
+
+#if defined(__linux) && !LWIP_SOCKET
+#include <netinet/udp.h>
+#endif
+#if defined(__linux) && !LWIP_SOCKET && defined(UDP_SEGMENT) && defined(UDP_GRO)
+/* UDP generic segmentation/receive offload: SOL_UDP socket options
+   UDP_SEGMENT and UDP_GRO, and the corresponding control messages */
+# define DDSRT_HAVE_UDP_GSO 1
+#else
+# define DDSRT_HAVE_UDP_GSO 0
+#endif
+
+#if DDSRT_HAVE_RECVMMSG || DDSRT_HAVE_SENDMMSG
+/* Layout-compatible with Linux' struct mmsghdr, which is only visible
+   with _GNU_SOURCE defined */
+typedef struct ddsrt_mmsghdr {
+  ddsrt_msghdr_t msg_hdr;
+  unsigned int msg_len;
+} ddsrt_mmsghdr_t;
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
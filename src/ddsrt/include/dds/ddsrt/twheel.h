@@ -0,0 +1,71 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSRT_TWHEEL_H
+#define DDSRT_TWHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dds/export.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Hierarchical timing wheel: a priority queue of nodes keyed on an int64_t
+   time stamp with O(1) insert and delete.  Keys are grouped into ticks of
+   2^tickshift units; each level has 64 slots of which the lowest level
+   covers individual ticks and each next level covers 64 times the range of
+   the previous one.  Nodes move down to the lower levels as time advances.
+
+   Time only advances through ddsrt_twheel_extract_due.  Nodes inserted with
+   a key before the current time are due immediately. */
+#define DDSRT_TWHEEL_LEVEL_BITS 6
+#define DDSRT_TWHEEL_SLOTS (1u << DDSRT_TWHEEL_LEVEL_BITS)
+#define DDSRT_TWHEEL_LEVELS 6
+#define DDSRT_TWHEEL_NLISTS (DDSRT_TWHEEL_LEVELS * DDSRT_TWHEEL_SLOTS + 2)
+
+typedef struct ddsrt_twheel_node {
+  struct ddsrt_twheel_node *prev, *next;
+  uint32_t list;
+} ddsrt_twheel_node_t;
+
+typedef struct ddsrt_twheel_def {
+  uintptr_t offset;    /* offset of ddsrt_twheel_node_t in node */
+  uintptr_t keyoffset; /* offset of int64_t key in node */
+  uint32_t tickshift;
+} ddsrt_twheel_def_t;
+
+typedef struct ddsrt_twheel {
+  int64_t now;         /* current time, in ticks */
+  int64_t next_cache;  /* cached result of ddsrt_twheel_next, valid iff next_valid */
+  bool next_valid;
+  uint64_t occupied[DDSRT_TWHEEL_LEVELS];
+  ddsrt_twheel_node_t lists[DDSRT_TWHEEL_NLISTS];
+} ddsrt_twheel_t;
+
+#define DDSRT_TWHEELDEF_INITIALIZER(offset, keyoffset, tickshift) { (offset), (keyoffset), (tickshift) }
+
+DDS_EXPORT void ddsrt_twheel_def_init (ddsrt_twheel_def_t *twdef, uintptr_t offset, uintptr_t keyoffset, uint32_t tickshift);
+DDS_EXPORT void ddsrt_twheel_init (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, int64_t tnow);
+DDS_EXPORT bool ddsrt_twheel_is_empty (const ddsrt_twheel_def_t *twdef, const ddsrt_twheel_t *tw);
+DDS_EXPORT void ddsrt_twheel_insert (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, const void *vnode);
+DDS_EXPORT void ddsrt_twheel_delete (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, const void *vnode);
+DDS_EXPORT void ddsrt_twheel_decrease_key (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, const void *vnode); /* to be called AFTER decreasing the key */
+DDS_EXPORT int64_t ddsrt_twheel_next (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw); /* lower bound on the smallest key, INT64_MAX if empty */
+DDS_EXPORT void *ddsrt_twheel_extract_due (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, int64_t tnow); /* some node with key <= tnow, or NULL */
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSRT_TWHEEL_H */
@@ -9,6 +9,7 @@
  *
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
+#include <string.h>
 #include "dds/ddsrt/bswap.h"
 
 extern inline uint16_t ddsrt_bswap2u (uint16_t x);
@@ -17,3 +18,162 @@ extern inline uint64_t ddsrt_bswap8u (uint64_t x);
 extern inline int16_t ddsrt_bswap2 (int16_t x);
 extern inline int32_t ddsrt_bswap4 (int32_t x);
 extern inline int64_t ddsrt_bswap8 (int64_t x);
+
+/* The vector kernels process the bulk of the data in blocks of 16 or 32
+   bytes using unaligned loads and stores and return the number of bytes
+   done, the remainder is done by the scalar loops.  Loading a block before
+   storing it makes in-place swapping work. */
+#if defined (__GNUC__) && (defined (__x86_64__) || (defined (__i386__) && defined (__SSE2__)))
+#define BSWAP_X86 1
+#include <immintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define BSWAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if BSWAP_X86
+/* SSE2 has no byte shuffle: swap the bytes within 16-bit words using shifts,
+   after permuting the 16-bit words within 32-bit/64-bit elements */
+static inline __m128i bswap_sse2_2 (__m128i x)
+{
+  return _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8));
+}
+
+static size_t bswap_sse2 (unsigned char *dst, const unsigned char *src, size_t nbytes, size_t elemsz)
+{
+  size_t i;
+  switch (elemsz)
+  {
+    case 2:
+      for (i = 0; i + 16 <= nbytes; i += 16)
+      {
+        const __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+        _mm_storeu_si128 ((__m128i *) (dst + i), bswap_sse2_2 (x));
+      }
+      return i;
+    case 4:
+      for (i = 0; i + 16 <= nbytes; i += 16)
+      {
+        __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+        x = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (2, 3, 0, 1)), _MM_SHUFFLE (2, 3, 0, 1));
+        _mm_storeu_si128 ((__m128i *) (dst + i), bswap_sse2_2 (x));
+      }
+      return i;
+    default:
+      for (i = 0; i + 16 <= nbytes; i += 16)
+      {
+        __m128i x = _mm_loadu_si128 ((const __m128i *) (src + i));
+        x = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (0, 1, 2, 3)), _MM_SHUFFLE (0, 1, 2, 3));
+        _mm_storeu_si128 ((__m128i *) (dst + i), bswap_sse2_2 (x));
+      }
+      return i;
+  }
+}
+
+__attribute__ ((target ("avx2")))
+static size_t bswap_avx2 (unsigned char *dst, const unsigned char *src, size_t nbytes, size_t elemsz)
+{
+  /* vpshufb shuffles within 128-bit lanes, so the same pattern twice */
+  static const unsigned char masks[3][32] = {
+    { 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14 },
+    { 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12 },
+    { 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8 }
+  };
+  const __m256i m = _mm256_loadu_si256 ((const __m256i *) masks[(elemsz == 2) ? 0 : (elemsz == 4) ? 1 : 2]);
+  size_t i;
+  for (i = 0; i + 64 <= nbytes; i += 64)
+  {
+    const __m256i x0 = _mm256_loadu_si256 ((const __m256i *) (src + i));
+    const __m256i x1 = _mm256_loadu_si256 ((const __m256i *) (src + i + 32));
+    _mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_shuffle_epi8 (x0, m));
+    _mm256_storeu_si256 ((__m256i *) (dst + i + 32), _mm256_shuffle_epi8 (x1, m));
+  }
+  for (; i + 32 <= nbytes; i += 32)
+  {
+    const __m256i x = _mm256_loadu_si256 ((const __m256i *) (src + i));
+    _mm256_storeu_si256 ((__m256i *) (dst + i), _mm256_shuffle_epi8 (x, m));
+  }
+  return i;
+}
+
+static size_t bswap_vector (unsigned char *dst, const unsigned char *src, size_t nbytes, size_t elemsz)
+{
+  if (nbytes < 16)
+    return 0;
+  else if (nbytes >= 64 && __builtin_cpu_supports ("avx2"))
+  {
+    const size_t i = bswap_avx2 (dst, src, nbytes, elemsz);
+    return i + bswap_sse2 (dst + i, src + i, nbytes - i, elemsz);
+  }
+  else
+    return bswap_sse2 (dst, src, nbytes, elemsz);
+}
+#elif BSWAP_NEON
+static size_t bswap_vector (unsigned char *dst, const unsigned char *src, size_t nbytes, size_t elemsz)
+{
+  size_t i;
+  switch (elemsz)
+  {
+    case 2:
+      for (i = 0; i + 16 <= nbytes; i += 16)
+        vst1q_u8 (dst + i, vrev16q_u8 (vld1q_u8 (src + i)));
+      return i;
+    case 4:
+      for (i = 0; i + 16 <= nbytes; i += 16)
+        vst1q_u8 (dst + i, vrev32q_u8 (vld1q_u8 (src + i)));
+      return i;
+    default:
+      for (i = 0; i + 16 <= nbytes; i += 16)
+        vst1q_u8 (dst + i, vrev64q_u8 (vld1q_u8 (src + i)));
+      return i;
+  }
+}
+#else
+static size_t bswap_vector (unsigned char *dst, const unsigned char *src, size_t nbytes, size_t elemsz)
+{
+  (void) dst; (void) src; (void) nbytes; (void) elemsz;
+  return 0;
+}
+#endif
+
+/* The scalar loops use memcpy for loading and storing elements because the
+   arrays need not be aligned, the compiler turns these into plain loads and
+   stores where the target allows unaligned access */
+void ddsrt_bswap2u_array (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = dst;
+  const unsigned char *s = src;
+  for (size_t i = bswap_vector (d, s, 2 * n, 2); i < 2 * n; i += 2)
+  {
+    uint16_t x;
+    memcpy (&x, s + i, sizeof (x));
+    x = ddsrt_bswap2u (x);
+    memcpy (d + i, &x, sizeof (x));
+  }
+}
+
+void ddsrt_bswap4u_array (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = dst;
+  const unsigned char *s = src;
+  for (size_t i = bswap_vector (d, s, 4 * n, 4); i < 4 * n; i += 4)
+  {
+    uint32_t x;
+    memcpy (&x, s + i, sizeof (x));
+    x = ddsrt_bswap4u (x);
+    memcpy (d + i, &x, sizeof (x));
+  }
+}
+
+void ddsrt_bswap8u_array (void *dst, const void *src, size_t n)
+{
+  unsigned char *d = dst;
+  const unsigned char *s = src;
+  for (size_t i = bswap_vector (d, s, 8 * n, 8); i < 8 * n; i += 8)
+  {
+    uint64_t x;
+    memcpy (&x, s + i, sizeof (x));
+    x = ddsrt_bswap8u (x);
+    memcpy (d + i, &x, sizeof (x));
+  }
+}
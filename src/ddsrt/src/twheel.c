@@ -0,0 +1,341 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <assert.h>
+
+#include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/twheel.h"
+
+/* A node at level k shares all bits above bit 6(k+1) of its tick with the
+   current time and is stored in the slot given by bits [6k,6(k+1)) of its
+   tick; which is necessarily > the corresponding bits of the current time
+   for k > 0 (else it would be at a lower level).  Anything farther away
+   than the highest level covers is in the "far" list, anything with a tick
+   before the current time in the "due" list. */
+#define LIST_DUE (DDSRT_TWHEEL_LEVELS * DDSRT_TWHEEL_SLOTS)
+#define LIST_FAR (LIST_DUE + 1)
+#define SLOT_MASK ((int64_t) DDSRT_TWHEEL_SLOTS - 1)
+
+static ddsrt_twheel_node_t *node_of (const ddsrt_twheel_def_t *twdef, const void *vnode)
+{
+  return (ddsrt_twheel_node_t *) ((char *) vnode + twdef->offset);
+}
+
+static int64_t key_of (const ddsrt_twheel_def_t *twdef, const ddsrt_twheel_node_t *node)
+{
+  return *((const int64_t *) ((const char *) node - twdef->offset + twdef->keyoffset));
+}
+
+static int64_t tick_of (const ddsrt_twheel_def_t *twdef, int64_t key)
+{
+  /* arithmetic shift, so negative keys end up before any sensible "now" */
+  return (key < 0) ? -((-(key + 1) >> twdef->tickshift) + 1) : (key >> twdef->tickshift);
+}
+
+static uint32_t digit (int64_t tick, uint32_t level)
+{
+  return (uint32_t) ((tick >> (level * DDSRT_TWHEEL_LEVEL_BITS)) & SLOT_MASK);
+}
+
+static uint32_t first_set (uint64_t x)
+{
+  assert (x != 0);
+#if defined (__GNUC__)
+  return (uint32_t) __builtin_ctzll (x);
+#else
+  uint32_t n = 0;
+  while (!(x & 1))
+  {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+static bool list_is_empty (const ddsrt_twheel_node_t *head)
+{
+  return head->next == head;
+}
+
+static void list_init (ddsrt_twheel_node_t *head, uint32_t list)
+{
+  head->next = head->prev = head;
+  head->list = list;
+}
+
+static uint32_t list_for_tick (const ddsrt_twheel_t *tw, int64_t tick)
+{
+  if (tick < tw->now)
+    return LIST_DUE;
+  else
+  {
+    const uint64_t diff = (uint64_t) tick ^ (uint64_t) tw->now;
+    for (uint32_t k = 0; k < DDSRT_TWHEEL_LEVELS; k++)
+      if ((diff >> ((k + 1) * DDSRT_TWHEEL_LEVEL_BITS)) == 0)
+        return k * DDSRT_TWHEEL_SLOTS + digit (tick, k);
+    return LIST_FAR;
+  }
+}
+
+static void link_node (ddsrt_twheel_t *tw, ddsrt_twheel_node_t *node, uint32_t list)
+{
+  ddsrt_twheel_node_t * const head = &tw->lists[list];
+  node->list = list;
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+  if (list < LIST_DUE)
+    tw->occupied[list / DDSRT_TWHEEL_SLOTS] |= (uint64_t) 1 << (list % DDSRT_TWHEEL_SLOTS);
+}
+
+static void unlink_node (ddsrt_twheel_t *tw, ddsrt_twheel_node_t *node)
+{
+  const uint32_t list = node->list;
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  if (list < LIST_DUE && list_is_empty (&tw->lists[list]))
+    tw->occupied[list / DDSRT_TWHEEL_SLOTS] &= ~((uint64_t) 1 << (list % DDSRT_TWHEEL_SLOTS));
+}
+
+static void insert_node (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, ddsrt_twheel_node_t *node)
+{
+  link_node (tw, node, list_for_tick (tw, tick_of (twdef, key_of (twdef, node))));
+}
+
+void ddsrt_twheel_def_init (ddsrt_twheel_def_t *twdef, uintptr_t offset, uintptr_t keyoffset, uint32_t tickshift)
+{
+  twdef->offset = offset;
+  twdef->keyoffset = keyoffset;
+  twdef->tickshift = tickshift;
+}
+
+void ddsrt_twheel_init (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, int64_t tnow)
+{
+  tw->now = tick_of (twdef, tnow);
+  tw->next_valid = true;
+  tw->next_cache = INT64_MAX;
+  for (uint32_t k = 0; k < DDSRT_TWHEEL_LEVELS; k++)
+    tw->occupied[k] = 0;
+  for (uint32_t i = 0; i < DDSRT_TWHEEL_NLISTS; i++)
+    list_init (&tw->lists[i], i);
+}
+
+bool ddsrt_twheel_is_empty (const ddsrt_twheel_def_t *twdef, const ddsrt_twheel_t *tw)
+{
+  DDSRT_UNUSED_ARG (twdef);
+  for (uint32_t k = 0; k < DDSRT_TWHEEL_LEVELS; k++)
+    if (tw->occupied[k])
+      return false;
+  return list_is_empty (&tw->lists[LIST_DUE]) && list_is_empty (&tw->lists[LIST_FAR]);
+}
+
+void ddsrt_twheel_insert (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, const void *vnode)
+{
+  ddsrt_twheel_node_t * const node = node_of (twdef, vnode);
+  const int64_t key = key_of (twdef, node);
+  insert_node (twdef, tw, node);
+  /* anything below the cached lower bound is necessarily the new minimum */
+  if (tw->next_valid && key < tw->next_cache)
+    tw->next_cache = key;
+}
+
+void ddsrt_twheel_delete (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, const void *vnode)
+{
+  ddsrt_twheel_node_t * const node = node_of (twdef, vnode);
+  /* Keeping a lower bound that is too low would cause spurious wakeups, which
+     can end up spinning if the lower bound is in the past */
+  if (node->list == LIST_DUE || key_of (twdef, node) <= tw->next_cache)
+    tw->next_valid = false;
+  unlink_node (tw, node);
+}
+
+void ddsrt_twheel_decrease_key (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, const void *vnode)
+{
+  /* a lower bound remains a lower bound when a key decreases */
+  ddsrt_twheel_node_t * const node = node_of (twdef, vnode);
+  unlink_node (tw, node);
+  ddsrt_twheel_insert (twdef, tw, vnode);
+}
+
+static int64_t min_key_in_list (const ddsrt_twheel_def_t *twdef, const ddsrt_twheel_node_t *head)
+{
+  int64_t min = INT64_MAX;
+  for (const ddsrt_twheel_node_t *n = head->next; n != head; n = n->next)
+  {
+    const int64_t key = key_of (twdef, n);
+    if (key < min)
+      min = key;
+  }
+  return min;
+}
+
+static uint64_t occupied_after (const ddsrt_twheel_t *tw, uint32_t level, uint32_t d)
+{
+  /* occupied slots at level with a digit > d */
+  return (d + 1 == DDSRT_TWHEEL_SLOTS) ? 0 : (tw->occupied[level] & (~(uint64_t) 0 << (d + 1)));
+}
+
+static int64_t next_boundary (const ddsrt_twheel_t *tw)
+{
+  /* first tick > now at which nodes at level 1 or higher need to be moved
+     down, INT64_MAX if never */
+  for (uint32_t k = 1; k < DDSRT_TWHEEL_LEVELS; k++)
+  {
+    const uint64_t occ = occupied_after (tw, k, digit (tw->now, k));
+    if (occ)
+    {
+      const uint32_t hishift = (k + 1) * DDSRT_TWHEEL_LEVEL_BITS;
+      return ((tw->now >> hishift) << hishift) | ((int64_t) first_set (occ) << (k * DDSRT_TWHEEL_LEVEL_BITS));
+    }
+  }
+  if (!list_is_empty (&tw->lists[LIST_FAR]))
+  {
+    const uint32_t hishift = DDSRT_TWHEEL_LEVELS * DDSRT_TWHEEL_LEVEL_BITS;
+    return ((tw->now >> hishift) + 1) << hishift;
+  }
+  return INT64_MAX;
+}
+
+static void redistribute (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, uint32_t list)
+{
+  ddsrt_twheel_node_t * const head = &tw->lists[list];
+  ddsrt_twheel_node_t *n = head->next;
+  list_init (head, list);
+  if (list < LIST_DUE)
+    tw->occupied[list / DDSRT_TWHEEL_SLOTS] &= ~((uint64_t) 1 << (list % DDSRT_TWHEEL_SLOTS));
+  while (n != head)
+  {
+    ddsrt_twheel_node_t * const next = n->next;
+    insert_node (twdef, tw, n);
+    n = next;
+  }
+}
+
+static void expire_level0 (ddsrt_twheel_t *tw, uint32_t from, uint32_t to)
+{
+  /* moves slots [from,to) of level 0 to the due list */
+  ddsrt_twheel_node_t * const due = &tw->lists[LIST_DUE];
+  uint64_t mask = ~(uint64_t) 0 << from;
+  if (to < DDSRT_TWHEEL_SLOTS)
+    mask &= ~(~(uint64_t) 0 << to);
+  uint64_t occ = tw->occupied[0] & mask;
+  tw->occupied[0] &= ~mask;
+  while (occ)
+  {
+    const uint32_t d = first_set (occ);
+    ddsrt_twheel_node_t * const head = &tw->lists[d];
+    for (ddsrt_twheel_node_t *n = head->next; n != head; n = n->next)
+      n->list = LIST_DUE;
+    head->next->prev = due->prev;
+    due->prev->next = head->next;
+    head->prev->next = due;
+    due->prev = head->prev;
+    list_init (head, d);
+    occ &= occ - 1;
+  }
+}
+
+static void move_down (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw)
+{
+  /* now has just moved to the start of a slot at level k > 0 (and therefore
+     also at all levels below it); nodes in the slots corresponding to the new
+     time must move down, those from the highest level first */
+  uint32_t k = 0;
+  while (k < DDSRT_TWHEEL_LEVELS && (tw->now & (((int64_t) 1 << ((k + 1) * DDSRT_TWHEEL_LEVEL_BITS)) - 1)) == 0)
+    k++;
+  assert (k >= 1);
+  if (k == DDSRT_TWHEEL_LEVELS)
+  {
+    redistribute (twdef, tw, LIST_FAR);
+    k = DDSRT_TWHEEL_LEVELS - 1;
+  }
+  for (uint32_t j = k; j >= 1; j--)
+    redistribute (twdef, tw, j * DDSRT_TWHEEL_SLOTS + digit (tw->now, j));
+}
+
+static void advance (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, int64_t tick)
+{
+  if (tick <= tw->now)
+    return;
+  tw->next_valid = false;
+  while (true)
+  {
+    if ((tick >> DDSRT_TWHEEL_LEVEL_BITS) == (tw->now >> DDSRT_TWHEEL_LEVEL_BITS))
+    {
+      expire_level0 (tw, digit (tw->now, 0), digit (tick, 0));
+      tw->now = tick;
+      return;
+    }
+    expire_level0 (tw, digit (tw->now, 0), DDSRT_TWHEEL_SLOTS);
+    /* nothing left at level 0, so skip straight to the next time any node
+       needs to be moved down (if that is before the target) */
+    const int64_t b = next_boundary (tw);
+    if (b > tick)
+    {
+      tw->now = tick;
+      return;
+    }
+    tw->now = b;
+    move_down (twdef, tw);
+  }
+}
+
+int64_t ddsrt_twheel_next (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw)
+{
+  if (tw->next_valid)
+    return tw->next_cache;
+  int64_t next;
+  uint64_t occ;
+  if (!list_is_empty (&tw->lists[LIST_DUE]))
+    next = min_key_in_list (twdef, &tw->lists[LIST_DUE]);
+  else if ((occ = tw->occupied[0] & (~(uint64_t) 0 << digit (tw->now, 0))) != 0)
+    next = min_key_in_list (twdef, &tw->lists[first_set (occ)]);
+  else
+  {
+    const int64_t b = next_boundary (tw);
+    next = (b == INT64_MAX) ? INT64_MAX : (b << twdef->tickshift);
+  }
+  tw->next_cache = next;
+  tw->next_valid = true;
+  return next;
+}
+
+void *ddsrt_twheel_extract_due (const ddsrt_twheel_def_t *twdef, ddsrt_twheel_t *tw, int64_t tnow)
+{
+  ddsrt_twheel_node_t * const due = &tw->lists[LIST_DUE];
+  advance (twdef, tw, tick_of (twdef, tnow));
+  if (list_is_empty (due))
+  {
+    /* current tick: move all with key <= tnow to the due list in one pass,
+       rather than scanning the slot for each call */
+    const uint32_t d = digit (tw->now, 0);
+    if (!(tw->occupied[0] & ((uint64_t) 1 << d)))
+      return NULL;
+    ddsrt_twheel_node_t * const head = &tw->lists[d];
+    for (ddsrt_twheel_node_t *n = head->next, *next; n != head; n = next)
+    {
+      next = n->next;
+      if (key_of (twdef, n) <= tnow)
+      {
+        unlink_node (tw, n);
+        link_node (tw, n, LIST_DUE);
+      }
+    }
+    if (list_is_empty (due))
+      return NULL;
+  }
+  void * const vnode = (char *) due->next - twdef->offset;
+  ddsrt_twheel_delete (twdef, tw, vnode);
+  return vnode;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsrt/bswap.h"
+
+static void swap_ref (unsigned char *dst, const unsigned char *src, size_t elemsz, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < elemsz; j++)
+      dst[i * elemsz + j] = src[i * elemsz + elemsz - 1 - j];
+}
+
+static void swap_array (void *dst, const void *src, size_t elemsz, size_t n)
+{
+  switch (elemsz)
+  {
+    case 2: ddsrt_bswap2u_array (dst, src, n); break;
+    case 4: ddsrt_bswap4u_array (dst, src, n); break;
+    case 8: ddsrt_bswap8u_array (dst, src, n); break;
+  }
+}
+
+CU_Test(ddsrt_bswap, array)
+{
+  /* all lengths around the vector sizes, at all alignments, in-place and
+     copying, checking that nothing outside the array gets touched */
+  const size_t maxn = 200, pad = 16;
+  unsigned char *src = ddsrt_malloc (8 * maxn + 2 * pad);
+  unsigned char *dst = ddsrt_malloc (8 * maxn + 2 * pad);
+  unsigned char *ref = ddsrt_malloc (8 * maxn + 2 * pad);
+  for (size_t elemsz = 2; elemsz <= 8; elemsz *= 2)
+  {
+    for (size_t n = 0; n < maxn; n++)
+    {
+      for (size_t a = 0; a < elemsz; a++)
+      {
+        for (size_t i = 0; i < 8 * maxn + 2 * pad; i++)
+          src[i] = (unsigned char) (i * 7 + 3);
+        memset (dst, 0xee, 8 * maxn + 2 * pad);
+        memcpy (ref, dst, 8 * maxn + 2 * pad);
+        swap_ref (ref + pad + a, src + pad + a, elemsz, n);
+        swap_array (dst + pad + a, src + pad + a, elemsz, n);
+        CU_ASSERT_FATAL (memcmp (dst, ref, 8 * maxn + 2 * pad) == 0);
+
+        memcpy (dst, src, 8 * maxn + 2 * pad);
+        memcpy (ref, src, 8 * maxn + 2 * pad);
+        swap_ref (ref + pad + a, src + pad + a, elemsz, n);
+        swap_array (dst + pad + a, dst + pad + a, elemsz, n);
+        CU_ASSERT_FATAL (memcmp (dst, ref, 8 * maxn + 2 * pad) == 0);
+      }
+    }
+  }
+  ddsrt_free (src);
+  ddsrt_free (dst);
+  ddsrt_free (ref);
+}
+
+/* Benchmark of in-place swapping, as done when normalizing big-endian data,
+   against the element-by-element loop it replaced */
+static void swap_loop (void *vbuf, size_t elemsz, size_t n)
+{
+  switch (elemsz)
+  {
+    case 2: { uint16_t *b = vbuf; for (size_t i = 0; i < n; i++) b[i] = ddsrt_bswap2u (b[i]); break; }
+    case 4: { uint32_t *b = vbuf; for (size_t i = 0; i < n; i++) b[i] = ddsrt_bswap4u (b[i]); break; }
+    case 8: { uint64_t *b = vbuf; for (size_t i = 0; i < n; i++) b[i] = ddsrt_bswap8u (b[i]); break; }
+  }
+}
+
+CU_Test(ddsrt_bswap, bench, .timeout = 120)
+{
+  const size_t maxsize = 16 * 1024 * 1024;
+  uint64_t *buf = ddsrt_calloc (1, maxsize);
+  for (size_t size = 16; size <= maxsize; size *= 4)
+  {
+    /* roughly the same amount of work for each size */
+    const size_t iters = 64 * maxsize / size;
+    for (size_t elemsz = 2; elemsz <= 8; elemsz *= 2)
+    {
+      const size_t n = size / elemsz;
+      const dds_time_t t0 = dds_time ();
+      for (size_t i = 0; i < iters; i++)
+        swap_loop (buf, elemsz, n);
+      const dds_time_t t1 = dds_time ();
+      for (size_t i = 0; i < iters; i++)
+        swap_array (buf, buf, elemsz, n);
+      const dds_time_t t2 = dds_time ();
+      printf ("bswap %zu x %zu bytes: loop %.2f GB/s array %.2f GB/s\n", n, elemsz,
+              (double) (size * iters) / (double) (t1 - t0), (double) (size * iters) / (double) (t2 - t1));
+    }
+  }
+  ddsrt_free (buf);
+}
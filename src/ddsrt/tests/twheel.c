@@ -0,0 +1,217 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include "CUnit/Test.h"
+
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/time.h"
+#include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/twheel.h"
+
+/* 2^16 ns ticks, as used for the timed event queue */
+#define TICKSHIFT 16
+
+struct ev {
+  ddsrt_fibheap_node_t fhnode;
+  ddsrt_twheel_node_t twnode;
+  int64_t key;
+  int64_t period;
+  bool queued;
+};
+
+static int compare_ev (const void *va, const void *vb)
+{
+  const struct ev *a = va;
+  const struct ev *b = vb;
+  return (a->key == b->key) ? 0 : (a->key < b->key) ? -1 : 1;
+}
+
+static const ddsrt_fibheap_def_t ev_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER (offsetof (struct ev, fhnode), compare_ev);
+static const ddsrt_twheel_def_t ev_twdef = DDSRT_TWHEELDEF_INITIALIZER (offsetof (struct ev, twnode), offsetof (struct ev, key), TICKSHIFT);
+
+static int64_t random_delay (ddsrt_prng_t *prng)
+{
+  /* mostly short, sometimes very long, so all levels get exercised */
+  switch (ddsrt_prng_random (prng) % 8)
+  {
+    case 0: return -(int64_t) (ddsrt_prng_random (prng) % DDS_MSECS (10));
+    case 1: return (int64_t) (ddsrt_prng_random (prng) % (1u << TICKSHIFT));
+    case 2: return DDS_SECS (ddsrt_prng_random (prng) % 100000);
+    case 3: return (int64_t) ddsrt_prng_random (prng) * 1000000;
+    default: return (int64_t) (ddsrt_prng_random (prng) % DDS_SECS (2));
+  }
+}
+
+CU_Test(ddsrt_twheel, random)
+{
+  const uint32_t n = 1000;
+  struct ev *evs = ddsrt_malloc (n * sizeof (*evs));
+  ddsrt_prng_t prng;
+  ddsrt_twheel_t tw;
+  int64_t tnow = DDS_SECS (1000);
+  ddsrt_prng_init_simple (&prng, ddsrt_random ());
+  ddsrt_twheel_init (&ev_twdef, &tw, tnow);
+  for (uint32_t i = 0; i < n; i++)
+    evs[i].queued = false;
+  for (uint32_t iter = 0; iter < 200000; iter++)
+  {
+    struct ev * const ev = &evs[ddsrt_prng_random (&prng) % n];
+    switch (ddsrt_prng_random (&prng) % 4)
+    {
+      case 0:
+        if (ev->queued)
+          ddsrt_twheel_delete (&ev_twdef, &tw, ev);
+        ev->queued = false;
+        break;
+      case 1:
+        if (ev->queued)
+        {
+          ev->key -= (int64_t) (ddsrt_prng_random (&prng) % DDS_SECS (1));
+          ddsrt_twheel_decrease_key (&ev_twdef, &tw, ev);
+          break;
+        }
+        /* fall through */
+      case 2:
+        if (!ev->queued)
+        {
+          ev->key = tnow + random_delay (&prng);
+          ev->queued = true;
+          ddsrt_twheel_insert (&ev_twdef, &tw, ev);
+        }
+        break;
+      case 3: {
+        struct ev *x;
+        int64_t min = INT64_MAX;
+        tnow += (ddsrt_prng_random (&prng) % 64 == 0) ? DDS_SECS (ddsrt_prng_random (&prng) % 10000) : (int64_t) (ddsrt_prng_random (&prng) % DDS_MSECS (20));
+        while ((x = ddsrt_twheel_extract_due (&ev_twdef, &tw, tnow)) != NULL)
+        {
+          CU_ASSERT_FATAL (x->queued && x->key <= tnow);
+          x->queued = false;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+          if (!evs[i].queued)
+            continue;
+          CU_ASSERT_FATAL (evs[i].key > tnow);
+          if (evs[i].key < min)
+            min = evs[i].key;
+        }
+        /* lower bound, and never in the past when nothing is due (or the
+           event thread would spin) */
+        const int64_t next = ddsrt_twheel_next (&ev_twdef, &tw);
+        CU_ASSERT_FATAL (next <= min);
+        CU_ASSERT_FATAL (next > tnow);
+        CU_ASSERT_FATAL ((next == INT64_MAX) == (min == INT64_MAX));
+        CU_ASSERT_FATAL (ddsrt_twheel_is_empty (&ev_twdef, &tw) == (min == INT64_MAX));
+        break;
+      }
+    }
+  }
+  ddsrt_free (evs);
+}
+
+/* Benchmark mimicking the timed event queue: periodic events (heartbeats,
+   SPDP, lease checks) that get rescheduled after firing, and many
+   "reschedule if earlier" calls (acknacks, heartbeats triggered by incoming
+   traffic) in between */
+struct bench_ops {
+  const char *name;
+  void (*init) (void *q, int64_t tnow);
+  void (*insert) (void *q, struct ev *ev);
+  void (*decrease) (void *q, struct ev *ev);
+  struct ev * (*extract_due) (void *q, int64_t tnow);
+  int64_t (*next) (void *q);
+};
+
+static void fh_init (void *q, int64_t tnow) { (void) tnow; ddsrt_fibheap_init (&ev_fhdef, q); }
+static void fh_insert (void *q, struct ev *ev) { ddsrt_fibheap_insert (&ev_fhdef, q, ev); }
+static void fh_decrease (void *q, struct ev *ev) { ddsrt_fibheap_decrease_key (&ev_fhdef, q, ev); }
+static struct ev *fh_extract_due (void *q, int64_t tnow) {
+  struct ev *min = ddsrt_fibheap_min (&ev_fhdef, q);
+  return (min && min->key <= tnow) ? ddsrt_fibheap_extract_min (&ev_fhdef, q) : NULL;
+}
+static int64_t fh_next (void *q) {
+  struct ev *min = ddsrt_fibheap_min (&ev_fhdef, q);
+  return min ? min->key : INT64_MAX;
+}
+static void tw_init (void *q, int64_t tnow) { ddsrt_twheel_init (&ev_twdef, q, tnow); }
+static void tw_insert (void *q, struct ev *ev) { ddsrt_twheel_insert (&ev_twdef, q, ev); }
+static void tw_decrease (void *q, struct ev *ev) { ddsrt_twheel_decrease_key (&ev_twdef, q, ev); }
+static struct ev *tw_extract_due (void *q, int64_t tnow) { return ddsrt_twheel_extract_due (&ev_twdef, q, tnow); }
+static int64_t tw_next (void *q) { return ddsrt_twheel_next (&ev_twdef, q); }
+
+static const struct bench_ops fhops = { "fibheap", fh_init, fh_insert, fh_decrease, fh_extract_due, fh_next };
+static const struct bench_ops twops = { "twheel", tw_init, tw_insert, tw_decrease, tw_extract_due, tw_next };
+
+static void bench (const struct bench_ops *ops, void *q, uint32_t nevents, uint32_t nresched)
+{
+  struct ev *evs = ddsrt_malloc (nevents * sizeof (*evs));
+  ddsrt_prng_t prng;
+  int64_t tnow = DDS_SECS (1000);
+  uint32_t fired = 0, wakeups = 0;
+  ddsrt_prng_init_simple (&prng, 1);
+  ops->init (q, tnow);
+  for (uint32_t i = 0; i < nevents; i++)
+  {
+    evs[i].period = DDS_MSECS (10) + (int64_t) (ddsrt_prng_random (&prng) % DDS_MSECS (990));
+    evs[i].key = tnow + (int64_t) (ddsrt_prng_random (&prng) % (uint32_t) evs[i].period);
+    ops->insert (q, &evs[i]);
+  }
+  const dds_time_t t0 = dds_time ();
+  for (uint32_t i = 0; i < nresched; i++)
+  {
+    struct ev * const ev = &evs[ddsrt_prng_random (&prng) % nevents];
+    const int64_t tsched = tnow + (int64_t) (ddsrt_prng_random (&prng) % DDS_MSECS (20));
+    /* like resched_xevent_if_earlier, including the check whether the
+       event thread needs to be woken up */
+    const int64_t tbefore = ops->next (q);
+    if (tsched < ev->key)
+    {
+      ev->key = tsched;
+      ops->decrease (q, ev);
+      if (tsched < tbefore)
+        wakeups++;
+    }
+    if ((i % 16) == 0)
+    {
+      struct ev *x;
+      tnow += DDS_USECS (100);
+      while ((x = ops->extract_due (q, tnow)) != NULL)
+      {
+        x->key = tnow + x->period;
+        ops->insert (q, x);
+        fired++;
+      }
+    }
+  }
+  const dds_time_t t1 = dds_time ();
+  ddsrt_free (evs);
+  printf ("%s %"PRIu32" events: %.1f ns/resched (%"PRIu32" fired, %"PRIu32" wakeups)\n", ops->name, nevents, (double) (t1 - t0) / nresched, fired, wakeups);
+}
+
+CU_Test(ddsrt_twheel, bench, .timeout = 120)
+{
+  static const uint32_t nevents[] = { 1000, 10000, 100000 };
+  ddsrt_fibheap_t fh;
+  ddsrt_twheel_t *tw = ddsrt_malloc (sizeof (*tw));
+  for (size_t k = 0; k < sizeof (nevents) / sizeof (nevents[0]); k++)
+  {
+    bench (&fhops, &fh, nevents[k], 2000000);
+    bench (&twops, tw, nevents[k], 2000000);
+  }
+  ddsrt_free (tw);
+}
@@ -28,6 +28,7 @@ public class IdlParams
     xmlgen = !opts.noxml;
     allstructs = opts.allstructs;
     notopics = opts.notopics;
+    genmarshal = opts.genmarshal;
   }
 
   public boolean timestamp;
@@ -39,6 +40,7 @@ public class IdlParams
   public boolean xmlgen;
   public boolean allstructs;
   public boolean notopics;
+  public boolean genmarshal;
   public String dllname;
   public String dllfile;
   public String basename = null;
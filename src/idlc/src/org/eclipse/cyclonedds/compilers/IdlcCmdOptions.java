@@ -39,6 +39,7 @@ public class IdlcCmdOptions extends CmdOptions
     io.println ("   -verbose         Enable console output other than error messages");
     io.println ("   -map_wide        Map the unsupported wchar and wstring types to char and string");
     io.println ("   -map_longdouble  Map the unsupported long double type to double");
+    io.println ("   -genmarshal      Generate type-specific (de)serializers for topic types");
   }
 
   public boolean process (String arg1, String arg2) throws CmdException
@@ -105,6 +106,10 @@ public class IdlcCmdOptions extends CmdOptions
     {
       forcpp = true;
     }
+    else if (arg1.equals ("-genmarshal"))
+    {
+      genmarshal = true;
+    }
     else
     {
       return super.process (arg1, arg2);
@@ -124,5 +129,6 @@ public class IdlcCmdOptions extends CmdOptions
   public boolean dumptree;
   public boolean dumpsymbols;
   public boolean forcpp;
+  public boolean genmarshal;
 }
 
@@ -175,6 +175,16 @@ public class ArrayType extends AbstractType
     return TypeUtil.deptest (subtype, deps, null);
   }
 
+  public Type getElementType ()
+  {
+    return realsub;
+  }
+
+  public long getLength ()
+  {
+    return size ();
+  }
+
   private long size()
   {
     long result = 1;
@@ -95,6 +95,7 @@ public class GenVisitor extends org.eclipse.cyclonedds.parser.IDLBaseVisitor <Vo
     this.params = params;
     String basesafe = params.basename.replace ('-', '_').replace (' ', '_');
     topics = new HashMap <ScopedName, ST> ();
+    topickeys = new HashMap <ScopedName, List <String>> ();
     alltypes = new LinkedHashMap <ScopedName, NamedType> ();
     constants = new HashMap <ScopedName, Long> ();
     group = new STGroupFile (templates);
@@ -118,6 +119,10 @@ public class GenVisitor extends org.eclipse.cyclonedds.parser.IDLBaseVisitor <Vo
       file.add ("name", params.basename);
     }
     file.add ("nameupper", basesafe.toUpperCase ());
+    if (params.genmarshal)
+    {
+      file.add ("genmarshal", "true");
+    }
     params.linetab.populateIncs (file);
 
     if (params.dllname != null)
@@ -1160,6 +1165,7 @@ public class GenVisitor extends org.eclipse.cyclonedds.parser.IDLBaseVisitor <Vo
 
       ST topic = topics.get (resultSN);
       StructType structMeta = (StructType)alltypes.get (resultSN);
+      List <String> keys = new ArrayList <String> ();
 
       if (!params.allstructs && !params.notopics)
       {
@@ -1173,7 +1179,9 @@ public class GenVisitor extends org.eclipse.cyclonedds.parser.IDLBaseVisitor <Vo
         field.add
           ("offset", Integer.toString (structMeta.addKeyField (fieldname)));
         topic.add ("keys", field);
+        keys.add (fieldname);
       }
+      topickeys.put (resultSN, keys);
       long size = structMeta.getKeySize ();
       if (size > 0 && size <= MAX_KEYSIZE)
       {
@@ -1211,6 +1219,26 @@ public class GenVisitor extends org.eclipse.cyclonedds.parser.IDLBaseVisitor <Vo
       {
         topicST.add ("flags", "DDS_TOPIC_CONTAINS_UNION");
       }
+      if (params.genmarshal)
+      {
+        if (MarshalGen.canGenerate (topicmeta))
+        {
+          List <String> keys = topickeys.get (topicname);
+          MarshalGen marshal =
+            new MarshalGen (topicmeta, (keys != null) ? keys : new ArrayList <String> ());
+          topicST.add ("marshal", marshal.generate ());
+          topicST.add ("marshalname", marshal.getName ());
+          topicST.add ("flags", "DDS_TOPIC_GENERATED_OPS");
+        }
+        else if (!params.quiet)
+        {
+          System.out.println
+          (
+            "Struct " + topicname.toString ("::") +
+            " contains datatypes not supported by -genmarshal, using generic (de)serializer."
+          );
+        }
+      }
       topicST.add ("alignment", topicmeta.getAlignment ());
     }
 
@@ -1346,6 +1374,7 @@ public class GenVisitor extends org.eclipse.cyclonedds.parser.IDLBaseVisitor <Vo
   private ParseState state;
   private IdlParams params;
   private Map <ScopedName, ST> topics;
+  private Map <ScopedName, List <String>> topickeys;
   private Map <ScopedName, NamedType> alltypes;
   private Map <ScopedName, Long> constants;
   private ST file;
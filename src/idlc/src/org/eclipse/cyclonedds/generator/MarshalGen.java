@@ -0,0 +1,537 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+package org.eclipse.cyclonedds.generator;
+
+import java.util.*;
+
+/* Generates straight-line C functions for (de)serializing a topic type,
+ * equivalent to what the op-code interpreter in ddsi_cdrstream.c does with
+ * the marshalling meta data.  Only types consisting of primitives, strings,
+ * bounded strings, nested structs, arrays of those and sequences of
+ * primitives are supported, for anything else the interpreter is used.
+ */
+public class MarshalGen
+{
+  public MarshalGen (StructType topic, List <String> keys)
+  {
+    this.topic = topic;
+    this.keys = keys;
+    this.cname = topic.getCType ();
+  }
+
+  public static boolean canGenerate (Type t)
+  {
+    t = resolve (t);
+    if (t instanceof BasicType || t instanceof BoundedStringType)
+    {
+      return true;
+    }
+    else if (t instanceof StructType)
+    {
+      StructType st = (StructType)t;
+      for (String m : st.getMemberNames ())
+      {
+        if (!canGenerate (st.getMemberType (m)))
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+    else if (t instanceof ArrayType)
+    {
+      Type e = resolve (((ArrayType)t).getElementType ());
+      return (e instanceof BasicType || (e instanceof StructType && canGenerate (e)));
+    }
+    else if (t instanceof SequenceType)
+    {
+      Type e = resolve (((SequenceType)t).getElementType ());
+      return (e instanceof BasicType && primSize (e) > 0);
+    }
+    return false;
+  }
+
+  public String getName ()
+  {
+    return cname + "_marshal";
+  }
+
+  public String generate ()
+  {
+    StringBuffer str = new StringBuffer ();
+
+    str.append ("static void " + cname + "_marshal_write (dds_ostream_t * __restrict os, const void * __restrict vsample)\n{\n");
+    str.append ("  const " + cname + " *sample = vsample;\n");
+    genWriteMembers (str, topic, "sample->", "  ", 0);
+    str.append ("}\n\n");
+
+    str.append ("static void " + cname + "_marshal_read (dds_istream_t * __restrict is, void * __restrict vsample)\n{\n");
+    str.append ("  " + cname + " *sample = vsample;\n");
+    for (String m : topic.getMemberNames ())
+    {
+      genRead (str, topic.getMemberType (m), "sample->" + m, "  ", 0);
+    }
+    str.append ("}\n\n");
+
+    str.append ("static void " + cname + "_marshal_write_key (dds_ostream_t * __restrict os, const void * __restrict vsample)\n{\n");
+    str.append ("  const " + cname + " *sample = vsample;\n");
+    if (keys.isEmpty ())
+    {
+      str.append ("  (void) os; (void) sample;\n");
+    }
+    for (String k : keys)
+    {
+      genWrite (str, topic.getMemberType (k), "sample->" + k, "  ", 0, false);
+    }
+    str.append ("}\n\n");
+
+    str.append ("static void " + cname + "_marshal_extract_key (dds_istream_t * __restrict is, dds_ostream_t * __restrict os)\n{\n");
+    if (keys.isEmpty ())
+    {
+      str.append ("  (void) is; (void) os;\n");
+    }
+    genExtractKey (str, topic, "  ", 0);
+    str.append ("}\n\n");
+
+    str.append ("static bool " + cname + "_marshal_normalize (char * __restrict data, uint32_t * __restrict off, uint32_t size, bool bswap)\n{\n");
+    genNormalize (str, topic, "  ", 0);
+    str.append ("  return true;\n");
+    str.append ("}\n\n");
+
+    str.append ("static const dds_topic_marshal_ops_t " + getName () + " =\n{\n");
+    str.append ("  " + cname + "_marshal_write,\n");
+    str.append ("  " + cname + "_marshal_read,\n");
+    str.append ("  " + cname + "_marshal_write_key,\n");
+    str.append ("  " + cname + "_marshal_extract_key,\n");
+    str.append ("  " + cname + "_marshal_normalize\n");
+    str.append ("};");
+    return str.toString ();
+  }
+
+  /* Consecutive members of a bounded size are written after reserving space
+   * for all of them at once, so that writing each one only needs to align and
+   * store.  That is pointless for a single primitive, and large arrays are
+   * excluded to not allocate excessively. */
+  private static final long MAX_RESERVE = 65536;
+
+  private void genWriteMembers (StringBuffer str, StructType st, String prefix, String ind, int depth)
+  {
+    List <String> members = st.getMemberNames ();
+    int i = 0;
+    while (i < members.size ())
+    {
+      int j = i;
+      long max = 0, msz;
+      while (j < members.size () && (msz = maxSize (st.getMemberType (members.get (j)))) > 0 && max + msz <= MAX_RESERVE)
+      {
+        max += msz;
+        j++;
+      }
+      if (j == i || (j == i + 1 && primSize (resolve (st.getMemberType (members.get (i)))) > 0))
+      {
+        genWrite (str, st.getMemberType (members.get (i)), prefix + members.get (i), ind, depth, false);
+        i++;
+      }
+      else
+      {
+        str.append (ind + "dds_cdr_resize (os, " + max + "u);\n");
+        for (; i < j; i++)
+        {
+          genWrite (str, st.getMemberType (members.get (i)), prefix + members.get (i), ind, depth, true);
+        }
+      }
+    }
+  }
+
+  private void genWrite (StringBuffer str, Type t, String lv, String ind, int depth, boolean reserved)
+  {
+    final String sfx = reserved ? "_reserved" : "";
+    t = resolve (t);
+    if (t instanceof BasicType)
+    {
+      int sz = primSize (t);
+      if (sz == 0)
+      {
+        str.append (ind + "dds_stream_write_string (os, " + lv + ");\n");
+      }
+      else
+      {
+        str.append (ind + genPut (t, sz, lv, sfx) + "\n");
+      }
+    }
+    else if (t instanceof BoundedStringType)
+    {
+      str.append (ind + "dds_stream_write_string (os, " + lv + ");\n");
+    }
+    else if (t instanceof StructType)
+    {
+      if (reserved)
+      {
+        StructType st = (StructType)t;
+        for (String m : st.getMemberNames ())
+        {
+          genWrite (str, st.getMemberType (m), lv + "." + m, ind, depth, true);
+        }
+      }
+      else
+      {
+        genWriteMembers (str, (StructType)t, lv + ".", ind, depth);
+      }
+    }
+    else if (t instanceof ArrayType)
+    {
+      ArrayType at = (ArrayType)t;
+      Type e = resolve (at.getElementType ());
+      int sz = primSize (e);
+      if (sz > 0)
+      {
+        str.append (ind + "dds_os_put_bytes_aligned" + sfx + " (os, " + lv + ", " + at.getLength () + "u, " + sz + "u);\n");
+      }
+      else
+      {
+        String iv = "i" + depth;
+        str.append (ind + "for (uint32_t " + iv + " = 0; " + iv + " < " + at.getLength () + "u; " + iv + "++)\n");
+        str.append (ind + "{\n");
+        genWrite (str, e, "((const " + e.getCType () + " *) " + lv + ")[" + iv + "]", ind + "  ", depth + 1, reserved);
+        str.append (ind + "}\n");
+      }
+    }
+    else if (t instanceof SequenceType)
+    {
+      Type e = resolve (((SequenceType)t).getElementType ());
+      str.append (ind + "dds_stream_write_primseq (os, (const dds_sequence_t *) &" + lv + ", " + primSize (e) + "u);\n");
+    }
+  }
+
+  private void genRead (StringBuffer str, Type t, String lv, String ind, int depth)
+  {
+    t = resolve (t);
+    if (t instanceof BasicType)
+    {
+      int sz = primSize (t);
+      if (sz == 0)
+      {
+        str.append (ind + lv + " = dds_stream_reuse_string (is, " + lv + ");\n");
+      }
+      else
+      {
+        str.append (ind + genGet (t, sz, lv) + "\n");
+      }
+    }
+    else if (t instanceof BoundedStringType)
+    {
+      long bound = ((BoundedStringType)t).getBound () + 1;
+      str.append (ind + "dds_stream_reuse_string_bound (is, " + lv + ", " + bound + "u);\n");
+    }
+    else if (t instanceof StructType)
+    {
+      StructType st = (StructType)t;
+      for (String m : st.getMemberNames ())
+      {
+        genRead (str, st.getMemberType (m), lv + "." + m, ind, depth);
+      }
+    }
+    else if (t instanceof ArrayType)
+    {
+      ArrayType at = (ArrayType)t;
+      Type e = resolve (at.getElementType ());
+      int sz = primSize (e);
+      if (sz > 0)
+      {
+        str.append (ind + "dds_is_get_bytes (is, " + lv + ", " + at.getLength () + "u, " + sz + "u);\n");
+      }
+      else
+      {
+        String iv = "i" + depth;
+        str.append (ind + "for (uint32_t " + iv + " = 0; " + iv + " < " + at.getLength () + "u; " + iv + "++)\n");
+        str.append (ind + "{\n");
+        genRead (str, e, "((" + e.getCType () + " *) " + lv + ")[" + iv + "]", ind + "  ", depth + 1);
+        str.append (ind + "}\n");
+      }
+    }
+    else if (t instanceof SequenceType)
+    {
+      Type e = resolve (((SequenceType)t).getElementType ());
+      str.append (ind + "dds_stream_read_primseq (is, (dds_sequence_t *) &" + lv + ", " + primSize (e) + "u);\n");
+    }
+  }
+
+  private void genNormalize (StringBuffer str, Type t, String ind, int depth)
+  {
+    t = resolve (t);
+    if (t instanceof BasicType)
+    {
+      int sz = primSize (t);
+      if (sz == 0)
+      {
+        str.append (ind + "if (!dds_stream_normalize_string (data, off, size, bswap, SIZE_MAX)) return false;\n");
+      }
+      else
+      {
+        str.append (ind + "if (!dds_stream_normalize_uint" + (8 * sz) + " (data, off, size, bswap)) return false;\n");
+      }
+    }
+    else if (t instanceof BoundedStringType)
+    {
+      long bound = ((BoundedStringType)t).getBound () + 1;
+      str.append (ind + "if (!dds_stream_normalize_string (data, off, size, bswap, " + bound + "u)) return false;\n");
+    }
+    else if (t instanceof StructType)
+    {
+      StructType st = (StructType)t;
+      for (String m : st.getMemberNames ())
+      {
+        genNormalize (str, st.getMemberType (m), ind, depth);
+      }
+    }
+    else if (t instanceof ArrayType)
+    {
+      ArrayType at = (ArrayType)t;
+      Type e = resolve (at.getElementType ());
+      int sz = primSize (e);
+      if (sz > 0)
+      {
+        str.append (ind + "if (!dds_stream_normalize_primarray (data, off, size, bswap, " + at.getLength () + "u, " + typeCode (sz) + ")) return false;\n");
+      }
+      else
+      {
+        String iv = "i" + depth;
+        str.append (ind + "for (uint32_t " + iv + " = 0; " + iv + " < " + at.getLength () + "u; " + iv + "++)\n");
+        str.append (ind + "{\n");
+        genNormalize (str, e, ind + "  ", depth + 1);
+        str.append (ind + "}\n");
+      }
+    }
+    else if (t instanceof SequenceType)
+    {
+      Type e = resolve (((SequenceType)t).getElementType ());
+      str.append (ind + "if (!dds_stream_normalize_primseq (data, off, size, bswap, " + typeCode (primSize (e)) + ")) return false;\n");
+    }
+  }
+
+  /* Key extraction walks the serialized data in declaration order, copying
+   * the key fields and skipping the others, and stops after the last key
+   * field, like the interpreter. */
+  private void genExtractKey (StringBuffer str, StructType st, String ind, int depth)
+  {
+    List <String> members = st.getMemberNames ();
+    int last = -1;
+    for (int i = 0; i < members.size (); i++)
+    {
+      if (resolve (st.getMemberType (members.get (i))).isKeyField ())
+      {
+        last = i;
+      }
+    }
+    for (int i = 0; i <= last; i++)
+    {
+      Type t = resolve (st.getMemberType (members.get (i)));
+      if (!t.isKeyField ())
+      {
+        genSkip (str, t, ind, depth);
+      }
+      else if (t instanceof StructType)
+      {
+        genExtractKey (str, (StructType)t, ind, depth);
+      }
+      else if (t instanceof BasicType && primSize (t) > 0)
+      {
+        int sz = primSize (t);
+        str.append (ind + "dds_os_put" + sz + " (os, dds_is_get" + sz + " (is));\n");
+      }
+      else if (t instanceof BasicType || t instanceof BoundedStringType)
+      {
+        str.append (ind + "dds_stream_extract_key_string (is, os);\n");
+      }
+      else if (t instanceof ArrayType)
+      {
+        ArrayType at = (ArrayType)t;
+        int sz = primSize (resolve (at.getElementType ()));
+        str.append (ind + "dds_stream_extract_key_primarray (is, os, " + at.getLength () + "u, " + sz + "u);\n");
+      }
+    }
+  }
+
+  private void genSkip (StringBuffer str, Type t, String ind, int depth)
+  {
+    t = resolve (t);
+    if (t instanceof BasicType)
+    {
+      int sz = primSize (t);
+      if (sz == 0)
+      {
+        str.append (ind + "dds_stream_skip_string (is);\n");
+      }
+      else
+      {
+        str.append (ind + "(void) dds_is_get" + sz + " (is);\n");
+      }
+    }
+    else if (t instanceof BoundedStringType)
+    {
+      str.append (ind + "dds_stream_skip_string (is);\n");
+    }
+    else if (t instanceof StructType)
+    {
+      StructType st = (StructType)t;
+      for (String m : st.getMemberNames ())
+      {
+        genSkip (str, st.getMemberType (m), ind, depth);
+      }
+    }
+    else if (t instanceof ArrayType)
+    {
+      ArrayType at = (ArrayType)t;
+      Type e = resolve (at.getElementType ());
+      int sz = primSize (e);
+      if (sz > 0)
+      {
+        str.append (ind + "dds_stream_skip_primarray (is, " + at.getLength () + "u, " + sz + "u);\n");
+      }
+      else
+      {
+        String iv = "i" + depth;
+        str.append (ind + "for (uint32_t " + iv + " = 0; " + iv + " < " + at.getLength () + "u; " + iv + "++)\n");
+        str.append (ind + "{\n");
+        genSkip (str, e, ind + "  ", depth + 1);
+        str.append (ind + "}\n");
+      }
+    }
+    else if (t instanceof SequenceType)
+    {
+      Type e = resolve (((SequenceType)t).getElementType ());
+      str.append (ind + "dds_stream_skip_primseq (is, " + primSize (e) + "u);\n");
+    }
+  }
+
+  private static Type resolve (Type t)
+  {
+    while (t instanceof TypedefType)
+    {
+      t = ((TypedefType)t).getRef ();
+    }
+    return t;
+  }
+
+  /* size in CDR of a primitive type, 0 for a string or not a primitive */
+  private static int primSize (Type t)
+  {
+    if (!(t instanceof BasicType))
+    {
+      return 0;
+    }
+    switch (((BasicType)t).type)
+    {
+      case BOOLEAN:
+      case OCTET:
+      case CHAR:
+        return 1;
+      case SHORT:
+      case USHORT:
+        return 2;
+      case LONG:
+      case ULONG:
+      case FLOAT:
+        return 4;
+      case LONGLONG:
+      case ULONGLONG:
+      case DOUBLE:
+        return 8;
+      default:
+        return 0;
+    }
+  }
+
+  /* upper bound on the number of bytes written for a value of type t,
+   * including alignment padding, or 0 if there is none */
+  private static long maxSize (Type t)
+  {
+    t = resolve (t);
+    if (t instanceof BasicType)
+    {
+      int sz = primSize (t);
+      return (sz == 0) ? 0 : 2 * sz - 1;
+    }
+    else if (t instanceof StructType)
+    {
+      StructType st = (StructType)t;
+      long max = 0;
+      for (String m : st.getMemberNames ())
+      {
+        long msz = maxSize (st.getMemberType (m));
+        if (msz == 0)
+        {
+          return 0;
+        }
+        max += msz;
+      }
+      return max;
+    }
+    else if (t instanceof ArrayType)
+    {
+      ArrayType at = (ArrayType)t;
+      Type e = resolve (at.getElementType ());
+      int sz = primSize (e);
+      if (sz > 0)
+      {
+        return at.getLength () * sz + sz - 1;
+      }
+      return at.getLength () * maxSize (e);
+    }
+    return 0;
+  }
+
+  /* floating-point values are copied as bytes to stay within the aliasing
+   * rules, integers are simply converted */
+  private static boolean isFloat (Type t)
+  {
+    return ((BasicType)t).type == BasicType.BT.FLOAT || ((BasicType)t).type == BasicType.BT.DOUBLE;
+  }
+
+  private static String genPut (Type t, int sz, String lv, String sfx)
+  {
+    if (isFloat (t))
+    {
+      return "dds_os_put_bytes_aligned" + sfx + " (os, &" + lv + ", 1u, " + sz + "u);";
+    }
+    return "dds_os_put" + sz + sfx + " (os, (" + uintType (sz) + ") " + lv + ");";
+  }
+
+  private static String genGet (Type t, int sz, String lv)
+  {
+    if (isFloat (t))
+    {
+      return "dds_is_get_bytes (is, &" + lv + ", 1u, " + sz + "u);";
+    }
+    return lv + " = (" + t.getCType () + ") dds_is_get" + sz + " (is);";
+  }
+
+  private static String uintType (int sz)
+  {
+    return "uint" + (8 * sz) + "_t";
+  }
+
+  private static String typeCode (int sz)
+  {
+    switch (sz)
+    {
+      case 1: return "DDS_OP_VAL_1BY";
+      case 2: return "DDS_OP_VAL_2BY";
+      case 4: return "DDS_OP_VAL_4BY";
+      default: return "DDS_OP_VAL_8BY";
+    }
+  }
+
+  private final StructType topic;
+  private final List <String> keys;
+  private final String cname;
+}
@@ -137,6 +137,11 @@ public class SequenceType extends AbstractType
     return Alignment.PTR;
   }
 
+  public Type getElementType ()
+  {
+    return realsub;
+  }
+
   public void getXML (StringBuffer str, ModuleContext mod)
   {
     str.append ("<Sequence>");
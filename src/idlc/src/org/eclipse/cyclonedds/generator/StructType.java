@@ -85,6 +85,42 @@ public class StructType extends AbstractType implements NamedType
     return result;
   }
 
+  public List <String> getMemberNames ()
+  {
+    List <String> result = new ArrayList <String> ();
+    for (Member m : members)
+    {
+      result.add (m.name);
+    }
+    return result;
+  }
+
+  public Type getMemberType (String fieldname)
+  {
+    // fieldname may refer to a member of a nested struct, as in a keylist
+
+    int dotpos = fieldname.indexOf ('.');
+    String search = (dotpos == -1) ? fieldname : fieldname.substring (0, dotpos);
+
+    for (Member m : members)
+    {
+      if (m.name.equals (search))
+      {
+        if (dotpos == -1)
+        {
+          return m.type;
+        }
+        Type mtype = m.type;
+        while (mtype instanceof TypedefType)
+        {
+          mtype = ((TypedefType)mtype).getRef ();
+        }
+        return ((StructType)mtype).getMemberType (fieldname.substring (dotpos + 1));
+      }
+    }
+    return null;
+  }
+
   public ArrayList <String> getMetaOp (String myname, String structname)
   {
     ArrayList <String> result = new ArrayList <String> ();
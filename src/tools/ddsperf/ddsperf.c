@@ -1358,6 +1358,26 @@ static int cmp_uint64 (const void *va, const void *vb)
   return (*a == *b) ? 0 : (*a < *b) ? -1 : 1;
 }
 
+static void print_recv_stats (const char *prefix, dds_time_t tnow, dds_time_t tprev)
+{
+  /* packets and receive system calls of the domain: with batched receiving
+     (Internal/ReceiveBatchSize) one system call can return many packets */
+  static uint64_t packets_ref = 0, syscalls_ref = 0;
+  uint64_t packets, syscalls;
+  if (dds_domain_get_recv_stats (dp, &packets, &syscalls) < 0)
+    return;
+  if (packets > packets_ref && syscalls > syscalls_ref)
+  {
+    const double dt = (double) (tnow - tprev);
+    printf ("%s recv %.2f kpkt/s %.2f pkt/syscall [%"PRIu64" %"PRIu64"]\n",
+            prefix, (double) (packets - packets_ref) * 1e6 / dt,
+            (double) (packets - packets_ref) / (double) (syscalls - syscalls_ref),
+            packets, syscalls);
+  }
+  packets_ref = packets;
+  syscalls_ref = syscalls;
+}
+
 static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, struct record_cputime_state *cputime_state, struct record_netload_state *netload_state)
 {
   char prefix[128];
@@ -1482,7 +1502,10 @@ static bool print_stats (dds_time_t tref, dds_time_t tnow, dds_time_t tprev, str
   }
 
   if (output)
+  {
     record_netload (netload_state, prefix, tnow);
+    print_recv_stats (prefix, tnow, tprev);
+  }
   fflush (stdout);
   return output;
 }
@@ -1626,6 +1649,11 @@ EXAMPLES:\n\
   ddsperf -L -TOU -D10 pub sub\n\
     basic throughput test within the process with tiny, keyless samples,\n\
     running for 10s\n\
+  CYCLONEDDS_URI=\"<Internal><ReceiveBatchSize>16</></>\" \\\n\
+    ddsperf -d eth0:1e9 -u sub\n\
+    subscriber receiving up to 16 packets per system call, reporting the\n\
+    network load and packet rate of eth0 and the number of packets\n\
+    received per system call\n\
 ", argv0, argv0, argv0);
   fflush (stdout);
   exit (3);
@@ -31,6 +31,8 @@ struct record_netload_state {
   bool errored;
   bool data_valid;
   dds_time_t tprev;
+  uint64_t ipkt;
+  uint64_t opkt;
   uint64_t ibytes;
   uint64_t obytes;
 };
@@ -52,12 +54,17 @@ void record_netload (struct record_netload_state *st, const char *prefix, dds_ti
         const double dt = (double) (tnow - st->tprev) / 1e9;
         const double dxpct = 100.0 * dx / dt / st->bw;
         const double drpct = 100.0 * dr / dt / st->bw;
+        /* packet rates, to relate CPU time of the receive threads to the number of packets */
+        const double dxkpps = (double) (x.opkt - st->opkt) / dt / 1e3;
+        const double drkpps = (double) (x.ipkt - st->ipkt) / dt / 1e3;
         if (dxpct >= 0.5 || drpct >= 0.5)
         {
-          printf ("%s %s: xmit %.0f%% recv %.0f%% [%"PRIu64" %"PRIu64"]\n",
-                  prefix, st->name, dxpct, drpct, x.obytes, x.ibytes);
+          printf ("%s %s: xmit %.0f%% %.1fkpkt/s recv %.0f%% %.1fkpkt/s [%"PRIu64" %"PRIu64"]\n",
+                  prefix, st->name, dxpct, dxkpps, drpct, drkpps, x.obytes, x.ibytes);
         }
       }
+      st->opkt = x.opkt;
+      st->ipkt = x.ipkt;
       st->obytes = x.obytes;
       st->ibytes = x.ibytes;
       st->tprev = tnow;